@@ -0,0 +1,75 @@
+/**
+ * @file admit.h
+ * @brief Overload admission control for received PLDM requests.
+ *
+ * The receive stage estimates how long a new request would wait for the
+ * core: frames queued ahead of it (receive queue, worker pool and the
+ * kernel's input queue) times the recent mean handler time.  While that
+ * estimate exceeds the configured delay, low-priority PLDM requests are
+ * answered at once with ERROR_NOT_READY instead of being queued, so the work
+ * that is admitted keeps a bounded latency.  MCTP control messages and PLDM
+ * base (discovery) requests are always admitted.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef ADMIT_H
+#define ADMIT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADMIT_DEFAULT_DELAY_MS 100
+
+/* PLDM base type and the completion code returned to shed requests */
+#define PLDM_TYPE_BASE 0x00
+#define PLDM_CC_ERROR_NOT_READY 0x04
+
+typedef struct {
+    uint64_t checked;          /* low-priority requests considered */
+    uint64_t shed;             /* answered with ERROR_NOT_READY */
+    uint64_t overloads;        /* times the endpoint became overloaded */
+    uint64_t overload_ns;      /* time spent overloaded */
+    uint64_t wait_ns;          /* latest estimated wait */
+    uint64_t wait_ns_max;
+    uint32_t handler_ns;       /* mean handler time estimate */
+    uint32_t frame_bytes;      /* mean received frame size estimate */
+} admit_stats_t;
+
+void admit_init(unsigned delay_ms);
+int admit_enabled();
+void admit_note_handler(uint64_t ns);
+int admit_not_ready(const mctp_frame_t* req, mctp_frame_t* out);
+int admit_shed(const mctp_frame_t* req, unsigned backlog, mctp_frame_t* out);
+void admit_get_stats(admit_stats_t* out);
+void admit_dump_stats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADMIT_H */
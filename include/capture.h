@@ -0,0 +1,74 @@
+/**
+ * @file capture.h
+ * @brief pcap capture of every MCTP packet the endpoint sends or receives.
+ *
+ * Packets are written with nanosecond timestamps using LINKTYPE_MCTP (291):
+ * each record starts at the MCTP transport header, without the serial
+ * binding's framing, so Wireshark dissects the transport header and the
+ * control/PLDM messages directly.  The I/O stages only copy packets into
+ * per-direction lock-free rings; a background thread batches them to disk
+ * and rotates files by size and age.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAPTURE_LINKTYPE_MCTP 291
+#define CAPTURE_RING_FRAMES 256
+#define CAPTURE_FLUSH_MS 20
+#define CAPTURE_DEFAULT_FILES 4
+
+typedef enum {
+    CAPTURE_RX = 0,
+    CAPTURE_TX,
+    CAPTURE_DIRECTIONS
+} capture_dir_t;
+
+typedef struct {
+    uint64_t packets;          /* records written */
+    uint64_t dropped;          /* packets lost because a ring was full */
+    uint64_t bytes;            /* bytes written, all files */
+    uint32_t files;            /* files opened, including the first */
+    uint32_t write_errors;
+} capture_stats_t;
+
+int capture_open(const char* path, uint64_t max_bytes, unsigned max_seconds, unsigned files);
+void capture_close();
+void capture_frame(capture_dir_t dir, const mctp_frame_t* f, uint64_t t_ns);
+void capture_get_stats(capture_stats_t* out);
+void capture_dump_stats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAPTURE_H */
@@ -23,6 +23,35 @@ typedef struct {
     int hwflow;               /* hardware flow control enabled (1) or disabled (0) */
     char path[SERIAL_PATH_MAX];    /* null-terminated device path */
     int fd;                        /* POSIX file descriptor for the device, -1 if closed */
+    int inherit_fd;                /* already-open descriptor used instead of a device, -1 if none */
+    int pipeline;                  /* overlap RX, dispatch and TX on separate threads (1) or not (0) */
+    int tx_outq_limit;             /* kernel output queue bytes before the TX stage waits (0 = off) */
+    int templates;                 /* answer idempotent control queries from cached images */
+    int replay_entries;            /* responses kept for retransmitted requests (0 = off) */
+    int replay_ttl_ms;             /* lifetime of a cached response */
+    int workers;                   /* worker threads for long-running handlers (0 = inline) */
+    int work_queue;                /* maximum jobs waiting for a worker */
+    const char* stats_path;        /* statistics segment, NULL for default, "none" for private */
+    const char* capture_path;      /* pcap capture file, NULL when not capturing */
+    int capture_size_mb;           /* rotate capture files at this size (0 = never) */
+    int capture_seconds;           /* rotate capture files at this age (0 = never) */
+    int capture_files;             /* capture files kept, including the current one */
+    const char* fault_spec;        /* fault injection specification, NULL when off */
+    const char* flight_path;       /* flight recorder file, NULL for default, "none" for off */
+    int flight_records;            /* flight recorder ring capacity */
+    int jitter;                    /* measure main-loop scheduling jitter */
+    int handler_budget_ms;         /* slow-handler watchdog budget (0 = off) */
+    int handler_backtrace;         /* sample the stack of a handler over budget */
+    int tty_sample_ms;             /* kernel tty queue sampling period (0 = off) */
+    int admit_delay_ms;            /* shed low-priority requests beyond this queueing delay (0 = off) */
+    const char* rate_spec;         /* per-source and per-type request rate limits, NULL when off */
+    const char* demux_path;        /* local MCTP demux socket, NULL when off */
+    int demux_fd;                  /* already-listening demux socket, -1 if none */
+    const char* takeover_path;     /* socket for handing the open device to a new process, NULL when off */
+    int takeover_fd;               /* already-listening takeover socket, -1 if none */
+    const char* state_path;        /* file keeping the assigned EID across restarts, NULL when off */
+    int state_verify;              /* confirm a restored EID with the bus owner */
+    int ready_fd;                  /* readiness message written here, then closed; -1 if none */
 } config_t;
 
 #ifdef __cplusplus
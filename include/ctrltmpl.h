@@ -0,0 +1,76 @@
+/**
+ * @file ctrltmpl.h
+ * @brief Pre-encoded response templates for idempotent MCTP control queries.
+ *
+ * Bus owners poll GET_ENDPOINT_ID, GET_MCTP_VERSION_SUPPORT and
+ * GET_MESSAGE_TYPE_SUPPORT constantly, and the answers only differ in the
+ * destination EID, message tag and instance id.  The first response the core
+ * produces for each distinct query is kept as a fully framed and escaped
+ * image; later identical queries are answered by the receive stage by
+ * patching the variable bytes and the FCS, without involving the core.
+ *
+ * Templates are discarded whenever a control request that may change
+ * endpoint state (e.g. SET_ENDPOINT_ID) is received.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CTRLTMPL_H
+#define CTRLTMPL_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CTRLTMPL_SLOTS 8
+#define CTRLTMPL_KEY_PAYLOAD 4
+
+/* MCTP control commands whose responses are cached */
+#define MCTP_CTRL_CMD_SET_ENDPOINT_ID 0x01
+#define MCTP_CTRL_CMD_GET_ENDPOINT_ID 0x02
+#define MCTP_CTRL_CMD_GET_VERSION_SUPPORT 0x04
+#define MCTP_CTRL_CMD_GET_MESSAGE_TYPE_SUPPORT 0x05
+
+typedef struct {
+    uint64_t hits;            /* queries answered from a template */
+    uint64_t patched;         /* answered by patching the cached wire image in place */
+    uint64_t misses;          /* cacheable queries passed to the core */
+    uint64_t learned;         /* templates captured from core responses */
+    uint64_t invalidations;   /* times the cache was cleared */
+} ctrltmpl_stats_t;
+
+void ctrltmpl_init(int enabled);
+int ctrltmpl_answer(const mctp_frame_t* req, mctp_frame_t* out);
+void ctrltmpl_learn(const mctp_frame_t* req, const mctp_frame_t* resp);
+void ctrltmpl_invalidate(uint32_t seq);
+void ctrltmpl_get_stats(ctrltmpl_stats_t* out);
+void ctrltmpl_dump_stats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CTRLTMPL_H */
@@ -0,0 +1,98 @@
+/**
+ * @file demux.h
+ * @brief Local MCTP demultiplexer socket for other processes on the host.
+ *
+ * Applications on the endpoint host (a telemetry agent, a firmware updater)
+ * share the serial link through a UNIX SOCK_SEQPACKET socket, in the manner
+ * of mctp-demux-daemon.  A client connects and sends one registration
+ * datagram: the MCTP message type it wants, optionally followed by a flags
+ * byte.  Every later datagram in either direction is one MCTP message:
+ *
+ *   demux_hdr_t, message type, message body
+ *
+ * From the endpoint, eid is the sender and tag carries DEMUX_TAG_OWNER for
+ * requests.  From a client, eid is the destination; a tag with
+ * DEMUX_TAG_OWNER asks for a new request tag, and the response is delivered
+ * back to that client only.  A tag without it answers a request received
+ * with that tag.
+ *
+ * Clients registered for a type other than MCTP control and PLDM receive
+ * every message of that type; those two stay with the core, and their
+ * clients only see responses to their own requests.  A datagram may carry a
+ * memfd (SCM_RIGHTS) whose contents continue the message, and clients that
+ * register with DEMUX_REG_SHM receive large messages the same way, so bulk
+ * payloads are not copied through the socket.
+ *
+ * The socket runs on its own thread and needs the threaded pipeline; frames
+ * reach it from the receive stage and leave through the transmit scheduler.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef DEMUX_H
+#define DEMUX_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEMUX_MAX_CLIENTS 16
+/* largest message reassembled or accepted from a client */
+#define DEMUX_MSG_MAX 16384
+/* largest memfd payload accepted from a client */
+#define DEMUX_SHM_MAX (1 << 20)
+/* datagrams moved per recvmmsg/sendmmsg call */
+#define DEMUX_BATCH 16
+/* payload bytes per transmitted packet (MCTP baseline transmission unit) */
+#define DEMUX_MTU 64
+/* a request's tag is reserved for its response this long */
+#define DEMUX_TAG_TIMEOUT_MS 5000
+/* larger messages go to DEMUX_REG_SHM clients in a memfd */
+#define DEMUX_INLINE_MAX 512
+
+/* registration flags */
+#define DEMUX_REG_SHM 0x01
+
+/* tag byte: tag owner bit and tag value, as in the transport header */
+#define DEMUX_TAG_OWNER MCTP_FLAG_TO
+#define DEMUX_TAG_MASK MCTP_FLAG_TAG_MASK
+
+typedef struct {
+    uint8_t eid;
+    uint8_t tag;
+} demux_hdr_t;
+
+int demux_start(const char* path, int fd);
+void demux_stop();
+int demux_offer(const mctp_frame_t* f);
+void demux_note_eid(uint8_t eid);
+void demux_dump_stats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEMUX_H */
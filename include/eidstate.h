@@ -0,0 +1,89 @@
+/**
+ * @file eidstate.h
+ * @brief Endpoint ID and bus owner kept in a small file across restarts.
+ *
+ * Every accepted SET_ENDPOINT_ID is written to a memory-mapped state file.
+ * On the next start the endpoint hands the saved EID to the core before it
+ * answers anything, instead of waiting for the bus owner to rediscover it.
+ *
+ * The file holds two records written alternately.  Each carries a sequence
+ * number and a CRC; the newest record with a good CRC wins, so a write torn
+ * by a crash or power loss leaves the previous state in force.  The file is
+ * flushed with msync(MS_SYNC) after each write; EID changes are rare.
+ *
+ * With verification on, a restored EID is confirmed by sending GET_ENDPOINT_ID
+ * to the saved bus owner.  If the owner does not answer from its saved EID
+ * within EIDSTATE_VERIFY_MS, the restored EID is withdrawn.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef EIDSTATE_H
+#define EIDSTATE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EIDSTATE_MAGIC 0x54534945u     /* "EIST" */
+#define EIDSTATE_VERSION 1
+
+/* how long the bus owner has to confirm a restored EID */
+#define EIDSTATE_VERIFY_MS 1000
+/* the request is repeated this often until answered, in case a frame is lost */
+#define EIDSTATE_PROBE_RETRY_MS 250
+/* message tag of the confirmation request */
+#define EIDSTATE_PROBE_TAG 7
+
+typedef struct {
+    uint64_t seq;              /* newer record wins; 0 = never written */
+    uint64_t assigned_ns;      /* CLOCK_REALTIME when the EID was assigned */
+    uint8_t eid;               /* 0 = none assigned */
+    uint8_t owner_eid;         /* bus owner that assigned it */
+    uint8_t reserved[2];
+    uint32_t crc;              /* CRC-32 of the fields above */
+} eidstate_record_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;             /* sizeof(eidstate_file_t) */
+    eidstate_record_t rec[2];  /* written alternately */
+} eidstate_file_t;
+
+int eidstate_open(const char* path, int verify);
+int eidstate_restore();
+void eidstate_note(uint8_t eid, uint8_t owner);
+int eidstate_offer(const mctp_frame_t* f);
+void eidstate_service();
+void eidstate_close();
+void eidstate_dump_stats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EIDSTATE_H */
@@ -0,0 +1,82 @@
+/**
+ * @file endpoint.h
+ * @brief Embeddable endpoint: initialization, descriptors to wait on and a non-blocking step.
+ *
+ * The endpoint program's main() is a thin wrapper around these calls; a host
+ * with its own event loop (poll, epoll, libuv) links libiotfoundry-endpoint
+ * instead and runs the endpoint in-process:
+ *
+ *     endpoint_config_defaults(&cfg);
+ *     cfg.inherit_fd = fd;   // or cfg.path, cfg.baud, ...
+ *     cfg.pipeline = 0;      // stay on the caller's thread
+ *     cfg.workers = 0;
+ *     endpoint_init(&cfg);
+ *     for (;;) {
+ *         int r = endpoint_step();
+ *         if (r < 0) break;      // a successor is taking over (--takeover)
+ *         if (r > 0) continue;
+ *         n = endpoint_pollfds(fds, ENDPOINT_MAX_POLLFDS, &timeout_ms);
+ *         ... add fds to the host's wait, wake at timeout_ms ...
+ *     }
+ *     endpoint_shutdown();   // -1: the successor could not be handed the device
+ *
+ * All calls are made from one thread.  The core keeps its state in globals,
+ * so there is one endpoint per process.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef ENDPOINT_H
+#define ENDPOINT_H
+
+#include <poll.h>
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* descriptors endpoint_pollfds() reports at most */
+#define ENDPOINT_MAX_POLLFDS 3
+
+/* longest wait between steps, so signal-requested dumps and housekeeping run */
+#define ENDPOINT_IDLE_MS 100
+
+/* packets dispatched by one endpoint_step() before it yields to the host */
+#define ENDPOINT_STEP_BUDGET 32
+
+/* the library is compiled with -fvisibility=hidden; only these calls are exported */
+#define ENDPOINT_API __attribute__((visibility("default")))
+
+ENDPOINT_API void endpoint_config_defaults(config_t* cfg);
+ENDPOINT_API int endpoint_init(const config_t* cfg);
+ENDPOINT_API int endpoint_pollfds(struct pollfd* fds, int max, int* timeout_ms);
+ENDPOINT_API int endpoint_step();
+ENDPOINT_API int endpoint_shutdown();
+ENDPOINT_API void endpoint_request_dump();
+ENDPOINT_API void endpoint_request_reset();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ENDPOINT_H */
@@ -0,0 +1,70 @@
+/**
+ * @file fairq.h
+ * @brief Receive queue with fair service across requesting endpoints.
+ *
+ * Frames bound for the core are queued per source EID and handed out by
+ * deficit round robin.  Each visit grants a source a quantum of handler time;
+ * the time its handlers actually take is charged back when they return, so a
+ * source whose requests are slow or frequent waits its turn while the bus
+ * owner's requests keep flowing.  Packets from one source stay in order.
+ *
+ * The receive stage is the only producer and the I/O thread the only
+ * consumer, as with a single frameq.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef FAIRQ_H
+#define FAIRQ_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mctp_serial.h"
+#include "stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* one queue per tracked source; the last is shared by the rest */
+#define FAIRQ_SOURCES STATS_SOURCES
+/* handler time granted to a source per round */
+#define FAIRQ_QUANTUM_NS 1000000ull
+/* debt a source may carry after a long handler, in quanta */
+#define FAIRQ_MAX_DEBT 16
+
+int fairq_init(uint32_t depth_per_source);
+void fairq_free();
+int fairq_source(const mctp_frame_t* f);
+mctp_frame_t* fairq_slot(const mctp_frame_t* f);
+void fairq_commit();
+mctp_frame_t* fairq_peek();
+void fairq_pop(uint64_t t_start_ns);
+void fairq_charge(uint64_t ns);
+uint32_t fairq_count();
+void fairq_dump_stats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FAIRQ_H */
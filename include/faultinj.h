@@ -0,0 +1,91 @@
+/**
+ * @file faultinj.h
+ * @brief Seedable fault injection on the serial byte streams.
+ *
+ * For testing throughput and recovery on noisy lines, the receive and transmit
+ * stages can pass their bytes through an injector that flips bits, drops,
+ * duplicates or inserts flag bytes, cuts frames short and delays writes.
+ * Faults are drawn from a seeded generator per direction, so a given
+ * specification and byte stream always produce the same damage.
+ *
+ * Specification (--fault): comma separated key=value pairs
+ *
+ *   ber=<p>         probability that a bit is flipped
+ *   drop=<p>        probability that a byte is lost
+ *   dup=<p>         probability that a byte is delivered twice
+ *   flag=<p>        probability that a spurious 0x7E is inserted before a byte
+ *   trunc=<p>       probability that a frame is cut short
+ *   delay=<p>       probability that a transmitted frame is delayed
+ *   delay-max=<us>  longest delay (default 10000)
+ *   dir=rx|tx|both  streams affected (default both)
+ *   seed=<n>        generator seed (default 1)
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef FAULTINJ_H
+#define FAULTINJ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FAULTINJ_DEFAULT_DELAY_US 10000
+#define FAULTINJ_MAX_CUT 32        /* truncated frames keep 1..32 bytes after the flag */
+
+typedef enum {
+    FAULTINJ_RX = 0,
+    FAULTINJ_TX,
+    FAULTINJ_DIRECTIONS
+} faultinj_dir_t;
+
+typedef struct {
+    uint64_t bytes;            /* bytes passed through the injector */
+    uint64_t bit_errors;
+    uint64_t dropped;
+    uint64_t duplicated;
+    uint64_t flags;            /* spurious flag bytes inserted */
+    uint64_t truncated;        /* frames cut short */
+    uint64_t delays;           /* delayed writes (tx) */
+    uint64_t delay_us;         /* total injected delay (tx) */
+    uint64_t resyncs;          /* good frames received after a fault (rx) */
+    uint64_t resync_ns_total;  /* fault -> start of the next good frame (rx) */
+    uint64_t resync_ns_max;
+    uint64_t damaged;          /* frames that failed between a fault and the resync (rx) */
+} faultinj_stats_t;
+
+int faultinj_init(const char* spec);
+int faultinj_active(faultinj_dir_t dir);
+size_t faultinj_apply(faultinj_dir_t dir, const uint8_t* in, size_t len, uint8_t* out, size_t cap);
+void faultinj_delay_write();
+void faultinj_rx_frame(int ok, uint64_t t_first_ns);
+void faultinj_get_stats(faultinj_dir_t dir, faultinj_stats_t* out);
+void faultinj_dump_stats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FAULTINJ_H */
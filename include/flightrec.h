@@ -0,0 +1,103 @@
+/**
+ * @file flightrec.h
+ * @brief Crash-surviving flight recorder of recent frames and events.
+ *
+ * A fixed-size ring of records in a memory-mapped file holds the most recent
+ * frames in both directions and state changes (EID assignment, framing
+ * errors, noise, transmit stalls).  The file is written through a shared
+ * mapping, so its contents survive the process being killed or crashing and
+ * can be read afterwards with tools/endpoint-flight.  Recording a frame costs
+ * one atomic increment and a copy of its first FLIGHT_DATA_MAX bytes.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef FLIGHTREC_H
+#define FLIGHTREC_H
+
+#include <stdint.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLIGHT_MAGIC 0x52464649u    /* "IFFR" */
+#define FLIGHT_VERSION 1
+#define FLIGHT_DIR "/var/tmp"
+#define FLIGHT_PREFIX "iotfoundry-endpoint."
+#define FLIGHT_SUFFIX ".flight"
+#define FLIGHT_DEFAULT_RECORDS 4096
+#define FLIGHT_DATA_MAX 64          /* unescaped frame bytes kept per record */
+
+typedef enum {
+    FLIGHT_RX_FRAME = 1,       /* arg: mctp_frame_status_t, data: unescaped frame */
+    FLIGHT_TX_FRAME,           /* arg: 0, data: unescaped frame */
+    FLIGHT_START,              /* arg: pid */
+    FLIGHT_STOP,               /* arg: 0 */
+    FLIGHT_EID_SET,            /* arg: new EID */
+    FLIGHT_NOISE,              /* arg: bytes discarded outside frames */
+    FLIGHT_TX_STALL,           /* arg: stall in ms, frame dropped */
+    FLIGHT_TX_ERROR,           /* arg: errno */
+    FLIGHT_SLOW_HANDLER,       /* arg: handler time in us, data: unescaped request */
+    FLIGHT_HANDLER_STACK,      /* arg: budget in ms, data: return addresses of the overrunning handler */
+    FLIGHT_TTY_OVERRUN,        /* arg: overruns reported by the serial driver since the last sample */
+    FLIGHT_OVERLOAD,           /* arg: estimated wait in ms on entering overload, 0 on leaving */
+    FLIGHT_TYPE_COUNT
+} flight_type_t;
+
+typedef struct {
+    uint64_t seq;              /* 1-based sequence number, 0 while being written */
+    uint64_t t_ns;             /* CLOCK_MONOTONIC */
+    uint16_t type;             /* flight_type_t */
+    uint16_t len;              /* full length of the frame or event data */
+    uint32_t arg;
+    uint8_t data[FLIGHT_DATA_MAX];
+} flight_record_t;
+
+typedef struct {
+    uint32_t magic;            /* FLIGHT_MAGIC, written last */
+    uint32_t version;
+    uint32_t header_size;      /* records start at this offset */
+    uint32_t record_size;
+    uint32_t records;          /* ring capacity */
+    uint32_t pid;
+    uint64_t start_realtime_ns; /* CLOCK_REALTIME at start ... */
+    uint64_t start_monotonic_ns; /* ... and CLOCK_MONOTONIC at the same moment */
+    uint64_t next;             /* sequence numbers handed out so far */
+    uint32_t clean_exit;       /* set by flight_close() */
+    uint32_t reserved;
+    char port[64];             /* serial device path */
+} flight_header_t;
+
+int flight_open(const char* path, const char* port, unsigned records);
+void flight_close();
+const char* flight_path();
+void flight_frame(flight_type_t type, const mctp_frame_t* f, uint64_t t_ns);
+void flight_event(flight_type_t type, uint32_t arg);
+void flight_data(flight_type_t type, uint32_t arg, const void* data, uint16_t len, uint64_t t_ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLIGHTREC_H */
@@ -0,0 +1,113 @@
+/**
+ * @file frameq.h
+ * @brief Fixed-capacity single-producer/single-consumer queue of MCTP serial frames.
+ *
+ * Slots are preallocated so the hot path never allocates.  The producer fills
+ * the slot returned by frameq_slot() in place and publishes it with
+ * frameq_commit(); the consumer reads the slot returned by frameq_peek() in
+ * place and releases it with frameq_pop().  Head and tail are updated with
+ * acquire/release atomics, so one producer thread and one consumer thread may
+ * use a queue without further locking.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef FRAMEQ_H
+#define FRAMEQ_H
+
+#include <stdint.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    mctp_frame_t* slots;
+    uint32_t mask;          /* capacity - 1, capacity is a power of two */
+    uint32_t head;          /* next slot to consume */
+    uint32_t tail;          /* next slot to produce */
+} frameq_t;
+
+int frameq_init(frameq_t* q, uint32_t capacity);
+void frameq_free(frameq_t* q);
+
+/**
+ * @brief Number of frames currently queued.
+ *
+ * @param q - the queue.
+ * @return uint32_t Queued frames.
+ */
+static inline uint32_t frameq_count(const frameq_t* q) {
+    return __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) -
+           __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Producer: return the next free slot, or NULL when the queue is full.
+ *
+ * @param q - the queue.
+ * @return mctp_frame_t* Slot to fill, valid until frameq_commit().
+ */
+static inline mctp_frame_t* frameq_slot(frameq_t* q) {
+    uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    if (tail - head > q->mask) return 0;
+    return &q->slots[tail & q->mask];
+}
+
+/**
+ * @brief Producer: publish the slot returned by frameq_slot().
+ *
+ * @param q - the queue.
+ */
+static inline void frameq_commit(frameq_t* q) {
+    __atomic_store_n(&q->tail, q->tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Consumer: return the oldest queued frame, or NULL when empty.
+ *
+ * @param q - the queue.
+ * @return mctp_frame_t* Frame to read, valid until frameq_pop().
+ */
+static inline mctp_frame_t* frameq_peek(frameq_t* q) {
+    uint32_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    if (head == tail) return 0;
+    return &q->slots[head & q->mask];
+}
+
+/**
+ * @brief Consumer: release the frame returned by frameq_peek().
+ *
+ * @param q - the queue.
+ */
+static inline void frameq_pop(frameq_t* q) {
+    __atomic_store_n(&q->head, q->head + 1, __ATOMIC_RELEASE);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAMEQ_H */
@@ -0,0 +1,80 @@
+/**
+ * @file jitter.h
+ * @brief Main-loop scheduling jitter monitor.
+ *
+ * When enabled, the I/O loop in main() marks the end of each of its stages
+ * and the pipeline reports how long data sat readable before the loop got
+ * to it.  Every measurement lands in a fixed-memory log-linear histogram;
+ * each new maximum is also kept in a small trace with its time and stage so
+ * a latency spike can be attributed to the scheduler, a handler or the link.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef JITTER_H
+#define JITTER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* new maxima remembered by the trace */
+#define JITTER_TRACE_RECORDS 16
+
+typedef enum {
+    JITTER_WAKE = 0,    /* frame queued by the receive thread -> I/O loop woken */
+    JITTER_TIMER,       /* poll() timeout requested -> I/O loop woken (oversleep) */
+    JITTER_SERVICE,     /* closing flag seen -> I/O loop starts reading the frame */
+    JITTER_UPDATE,      /* mctp_update() */
+    JITTER_DISPATCH,    /* message handler */
+    JITTER_WORK,        /* worker-pool completions */
+    JITTER_LOOP,        /* one loop iteration, excluding time asleep */
+    JITTER_STAGES
+} jitter_stage_t;
+
+typedef struct {
+    uint64_t t_ns;             /* CLOCK_MONOTONIC when the maximum was seen */
+    uint64_t value_ns;         /* the new maximum */
+    uint64_t iteration;        /* loop iteration it occurred in */
+    uint8_t stage;             /* jitter_stage_t */
+} jitter_trace_t;
+
+void jitter_init(int enabled);
+int jitter_enabled();
+void jitter_loop_begin();
+void jitter_mark(jitter_stage_t stage);
+void jitter_sleep();
+void jitter_loop_end();
+void jitter_record(jitter_stage_t stage, uint64_t start_ns, uint64_t end_ns);
+void jitter_reset();
+void jitter_request_reset();
+void jitter_request_dump();
+void jitter_service(FILE* out);
+void jitter_dump(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JITTER_H */
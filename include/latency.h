@@ -0,0 +1,102 @@
+/**
+ * @file latency.h
+ * @brief Fixed-memory log-linear latency histograms per MCTP command.
+ *
+ * Every response the endpoint transmits is matched with the request it
+ * answers and its life is split into phases: receiving the request, waiting
+ * for the core, running the handler, and queueing/writing the response.
+ * Each phase, and the total from the request's first byte to the response's
+ * last byte, is recorded in an HDR-style histogram (16 linear sub-buckets per
+ * power of two, about 6% resolution) kept per control command and per PLDM
+ * (type, command).
+ *
+ * The histograms live in the shared statistics segment so endpoint-stat can
+ * read them while the endpoint runs.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LATENCY_SUB_BITS 4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+/* values are clamped below 2^LATENCY_MAX_BITS ns (about 68 s) */
+#define LATENCY_MAX_BITS 36
+#define LATENCY_BUCKETS ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS)
+/* distinct commands tracked; the last slot collects everything else */
+#define LATENCY_SLOTS 24
+#define LATENCY_SLOT_OTHER 0xFF
+
+typedef enum {
+    LATENCY_RX = 0,     /* request first byte -> closing flag */
+    LATENCY_QUEUE,      /* closing flag -> handler start */
+    LATENCY_HANDLER,    /* handler start -> response produced */
+    LATENCY_TX,         /* response produced -> last byte written */
+    LATENCY_TOTAL,      /* request first byte -> response last byte */
+    LATENCY_PHASES
+} latency_phase_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint32_t buckets[LATENCY_BUCKETS];
+} latency_hist_t;
+
+typedef struct {
+    uint8_t used;
+    uint8_t msg_type;   /* LATENCY_SLOT_OTHER for the overflow slot */
+    uint8_t pldm_type;
+    uint8_t cmd;
+    uint32_t reserved;
+    latency_hist_t phase[LATENCY_PHASES];
+} latency_slot_t;
+
+typedef struct {
+    uint64_t reset_realtime_ns;  /* CLOCK_REALTIME of the last reset */
+    latency_slot_t slot[LATENCY_SLOTS];
+} latency_table_t;
+
+void latency_record(const mctp_req_timing_t* t, uint64_t sent_ns);
+void latency_reset();
+void latency_request_reset();
+void latency_request_dump();
+void latency_service(FILE* out);
+void latency_hist_add(latency_hist_t* h, uint64_t v);
+uint64_t latency_percentile(const latency_hist_t* h, double pct);
+void latency_print(FILE* out, const latency_table_t* table);
+void latency_dump(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATENCY_H */
@@ -0,0 +1,228 @@
+/**
+ * @file log.h
+ * @brief Asynchronous logger that keeps formatting and console I/O off the I/O path.
+ *
+ * LOG_ERROR/LOG_WARN/LOG_INFO copy their arguments in binary form into a ring
+ * owned by the calling thread; a background thread formats the records and
+ * writes them out every LOG_FLUSH_MS.  A slow console or journald pipe
+ * therefore never stalls frame processing: when a ring is full the record is
+ * dropped and counted instead.  Each call site is also rate limited, so an
+ * error storm yields a handful of lines plus a count of what was suppressed.
+ * LOG_CONT adds lines to the record logged just before it on the same
+ * thread: they bypass the rate limit and are written exactly when that
+ * record was, so a multi-line report is never cut short.
+ *
+ * Formats use printf syntax with at most LOG_MAX_ARGS arguments.  Length
+ * modifiers are accepted and ignored (every integer is carried as 64 bits),
+ * %m prints strerror() of errno at the call, strings are copied (up to
+ * LOG_STR_MAX bytes per record) and '*' widths are not supported.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_MAX_ARGS 6
+#define LOG_STR_MAX 96             /* bytes of copied string arguments per record */
+#define LOG_RING_RECORDS 256       /* per thread */
+#define LOG_FLUSH_MS 50
+#define LOG_RATE_LIMIT 10          /* records per call site per window */
+#define LOG_RATE_WINDOW_MS 1000
+
+typedef enum {
+    LOG_LEVEL_ERROR = 0,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVELS
+} log_level_t;
+
+typedef enum {
+    LOG_ARG_INT = 0,
+    LOG_ARG_UINT,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STR,               /* value is an offset into the record's str */
+    LOG_ARG_PTR
+} log_arg_type_t;
+
+/* one per call site, static; the rate limiter state is shared by all threads */
+typedef struct {
+    log_level_t level;
+    const char* fmt;
+    const char* file;
+    int line;
+    uint64_t window_ns;        /* start of the current rate window */
+    uint32_t count;            /* records in the current window */
+    uint32_t suppressed;       /* records refused since the last one accepted */
+    uint8_t continued;         /* LOG_CONT: written only if the thread's previous record was */
+} log_site_t;
+
+typedef struct {
+    const log_site_t* site;
+    uint64_t t_ns;
+    uint32_t suppressed;       /* similar records refused before this one */
+    int err;                   /* errno at the call, for %m */
+    uint8_t nargs;
+    uint8_t str_len;
+    uint8_t type[LOG_MAX_ARGS];
+    uint64_t arg[LOG_MAX_ARGS];
+    char str[LOG_STR_MAX];
+} log_record_t;
+
+typedef struct {
+    uint64_t records;          /* records written out */
+    uint64_t dropped;          /* records lost because a thread's ring was full */
+    uint64_t suppressed;       /* records refused by the per-site rate limit */
+} log_stats_t;
+
+int log_init();
+void log_shutdown();
+log_record_t* log_begin(log_site_t* site);
+void log_commit(log_record_t* r);
+void log_flush();
+void log_get_stats(log_stats_t* out);
+void log_dump_stats(FILE* out);
+
+/**
+ * @brief Add a signed integer argument to a record.
+ *
+ * @param r - record from log_begin().
+ * @param v - the value.
+ */
+static inline void log_arg_int(log_record_t* r, long long v) {
+    if (r->nargs >= LOG_MAX_ARGS) return;
+    r->type[r->nargs] = LOG_ARG_INT;
+    r->arg[r->nargs++] = (uint64_t)v;
+}
+
+/**
+ * @brief Add an unsigned integer argument to a record.
+ *
+ * @param r - record from log_begin().
+ * @param v - the value.
+ */
+static inline void log_arg_uint(log_record_t* r, unsigned long long v) {
+    if (r->nargs >= LOG_MAX_ARGS) return;
+    r->type[r->nargs] = LOG_ARG_UINT;
+    r->arg[r->nargs++] = v;
+}
+
+/**
+ * @brief Add a floating-point argument to a record.
+ *
+ * @param r - record from log_begin().
+ * @param v - the value.
+ */
+static inline void log_arg_double(log_record_t* r, double v) {
+    if (r->nargs >= LOG_MAX_ARGS) return;
+    r->type[r->nargs] = LOG_ARG_DOUBLE;
+    memcpy(&r->arg[r->nargs++], &v, sizeof v);
+}
+
+/**
+ * @brief Copy a string argument into a record, truncating it if space runs out.
+ *
+ * @param r - record from log_begin().
+ * @param s - the string (NULL prints as "(null)").
+ */
+static inline void log_arg_str(log_record_t* r, const char* s) {
+    if (r->nargs >= LOG_MAX_ARGS) return;
+    if (!s) s = "(null)";
+    size_t room = LOG_STR_MAX - r->str_len;
+    r->type[r->nargs] = LOG_ARG_STR;
+    if (!room) {
+        // full: point at the previous string's terminator, printing nothing
+        r->arg[r->nargs++] = LOG_STR_MAX - 1;
+        return;
+    }
+    size_t n = strnlen(s, room - 1);
+    r->arg[r->nargs++] = r->str_len;
+    memcpy(&r->str[r->str_len], s, n);
+    r->str[r->str_len + n] = '\0';
+    r->str_len = (uint8_t)(r->str_len + n + 1);
+}
+
+/**
+ * @brief Add a pointer argument (for %p) to a record.
+ *
+ * @param r - record from log_begin().
+ * @param p - the pointer.
+ */
+static inline void log_arg_ptr(log_record_t* r, const void* p) {
+    if (r->nargs >= LOG_MAX_ARGS) return;
+    r->type[r->nargs] = LOG_ARG_PTR;
+    r->arg[r->nargs++] = (uint64_t)(uintptr_t)p;
+}
+
+/* pick the packing function from the argument's type */
+#define LOG_ARG_(r, x) _Generic((x),                                            \
+    char*: log_arg_str, const char*: log_arg_str,                               \
+    float: log_arg_double, double: log_arg_double,                              \
+    unsigned char: log_arg_uint, unsigned short: log_arg_uint,                  \
+    unsigned int: log_arg_uint, unsigned long: log_arg_uint,                    \
+    unsigned long long: log_arg_uint,                                           \
+    void*: log_arg_ptr, const void*: log_arg_ptr,                               \
+    default: log_arg_int)((r), (x))
+
+#define LOG_COUNT_(...) LOG_COUNT_N_(_, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_COUNT_N_(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+#define LOG_CAT_(a, b) LOG_CAT2_(a, b)
+#define LOG_CAT2_(a, b) a##b
+#define LOG_PACK_N_0(r)
+#define LOG_PACK_N_1(r, a) LOG_ARG_(r, a)
+#define LOG_PACK_N_2(r, a, ...) LOG_ARG_(r, a); LOG_PACK_N_1(r, __VA_ARGS__)
+#define LOG_PACK_N_3(r, a, ...) LOG_ARG_(r, a); LOG_PACK_N_2(r, __VA_ARGS__)
+#define LOG_PACK_N_4(r, a, ...) LOG_ARG_(r, a); LOG_PACK_N_3(r, __VA_ARGS__)
+#define LOG_PACK_N_5(r, a, ...) LOG_ARG_(r, a); LOG_PACK_N_4(r, __VA_ARGS__)
+#define LOG_PACK_N_6(r, a, ...) LOG_ARG_(r, a); LOG_PACK_N_5(r, __VA_ARGS__)
+#define LOG_PACK_(r, ...) LOG_CAT_(LOG_PACK_N_, LOG_COUNT_(__VA_ARGS__))(r, ##__VA_ARGS__)
+
+#define LOG_SITE_(lvl, cont, fmt, ...)                                          \
+    do {                                                                        \
+        static log_site_t log_site_ = { (lvl), (fmt), __FILE__, __LINE__, 0, 0, 0, (cont) }; \
+        log_record_t* log_rec_ = log_begin(&log_site_);                         \
+        if (log_rec_) {                                                         \
+            LOG_PACK_(log_rec_, ##__VA_ARGS__);                                 \
+            log_commit(log_rec_);                                               \
+        }                                                                       \
+    } while (0)
+
+#define LOG_AT(lvl, fmt, ...) LOG_SITE_(lvl, 0, fmt, ##__VA_ARGS__)
+/* a further line of the record just logged by this thread */
+#define LOG_CONT(lvl, fmt, ...) LOG_SITE_(lvl, 1, fmt, ##__VA_ARGS__)
+
+#define LOG_ERROR(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_H */
@@ -0,0 +1,166 @@
+/**
+ * @file mctp_serial.h
+ * @brief MCTP serial (DSP0253) framing helpers used by the Linux platform layer.
+ *
+ * The core owns protocol handling; these helpers let the platform layer see
+ * frame boundaries and header fields in the byte streams it moves to and from
+ * the serial device.  They are also shared with the host-side tools so that
+ * framing, escaping and FCS logic exist in one place.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef MCTP_SERIAL_H
+#define MCTP_SERIAL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MCTP_SERIAL_FLAG 0x7E
+#define MCTP_SERIAL_ESCAPE 0x7D
+#define MCTP_SERIAL_ESCAPE_XOR 0x20
+#define MCTP_SERIAL_PROTOCOL 0x01
+#define MCTP_SERIAL_INIT_FCS 0xFFFF
+
+/* protocol + byte count + up to 255 body bytes + 2 FCS bytes */
+#define MCTP_SERIAL_DATA_MAX 259
+/* every data byte escaped plus opening and closing flags */
+#define MCTP_SERIAL_RAW_MAX (2 * MCTP_SERIAL_DATA_MAX + 2)
+
+/* offsets into the unescaped frame data */
+#define MCTP_OFF_PROTOCOL 0
+#define MCTP_OFF_BYTE_COUNT 1
+#define MCTP_OFF_HDR_VERSION 2
+#define MCTP_OFF_DEST 3
+#define MCTP_OFF_SRC 4
+#define MCTP_OFF_FLAGS 5
+#define MCTP_OFF_MSG_TYPE 6
+#define MCTP_OFF_INSTANCE 7
+#define MCTP_OFF_CTRL_CMD 8
+#define MCTP_OFF_PLDM_TYPE 8
+#define MCTP_OFF_PLDM_CMD 9
+/* smallest data length holding a transport header and message type */
+#define MCTP_SERIAL_MIN_DATA 9
+
+/* transport header flag bits */
+#define MCTP_FLAG_SOM 0x80
+#define MCTP_FLAG_EOM 0x40
+#define MCTP_FLAG_TO 0x08
+#define MCTP_FLAG_TAG_MASK 0x07
+#define MCTP_FLAG_SEQ_SHIFT 4
+
+#define MCTP_MSG_TYPE_CONTROL 0x00
+#define MCTP_MSG_TYPE_PLDM 0x01
+#define MCTP_MSG_TYPE_MASK 0x7F
+
+/* control and PLDM message header Rq bit and instance id */
+#define MCTP_INSTANCE_RQ 0x80
+#define MCTP_INSTANCE_D 0x40
+#define MCTP_INSTANCE_ID_MASK 0x1F
+
+typedef enum {
+    MCTP_FRAME_OK = 0,
+    MCTP_FRAME_FCS_ERROR,
+    MCTP_FRAME_ESCAPE_ERROR,
+    MCTP_FRAME_LENGTH_ERROR,
+    MCTP_FRAME_OVERSIZE,
+    MCTP_FRAME_STATUS_COUNT
+} mctp_frame_status_t;
+
+/* timing of the request a transmitted frame answers, carried for latency accounting */
+typedef struct {
+    uint64_t rx_first_ns;              /* request's opening flag */
+    uint64_t rx_done_ns;               /* request's closing flag */
+    uint64_t start_ns;                 /* handler started on the request */
+    uint64_t end_ns;                   /* response fully produced */
+    uint8_t valid;                     /* non-zero on the last frame of a correlated response */
+    uint8_t msg_type;                  /* request message type */
+    uint8_t pldm_type;                 /* request PLDM type (PLDM only) */
+    uint8_t cmd;                       /* request control or PLDM command code */
+} mctp_req_timing_t;
+
+typedef struct {
+    uint64_t t_first_ns;               /* opening flag seen (rx) / first byte queued (tx) */
+    uint64_t t_done_ns;                /* closing flag seen (rx) / frame queued (tx) */
+    uint64_t t_sent_ns;                /* last byte handed to the kernel (tx) */
+    uint32_t seq;                      /* receive sequence number (rx) */
+    mctp_req_timing_t req;             /* request being answered (tx) */
+    uint16_t raw_len;                  /* escaped bytes in raw, including flags */
+    uint16_t len;                      /* unescaped bytes in data */
+    uint8_t status;                    /* mctp_frame_status_t */
+    uint8_t raw[MCTP_SERIAL_RAW_MAX];  /* bytes exactly as seen on the wire */
+    uint8_t data[MCTP_SERIAL_DATA_MAX]; /* unescaped protocol..FCS */
+} mctp_frame_t;
+
+/* incremental receive-side frame extractor */
+typedef struct {
+    mctp_frame_t frame;
+    uint64_t noise;             /* bytes discarded outside any frame */
+    uint8_t in_frame;
+    uint8_t escape;
+    uint8_t restart;
+} mctp_deframer_t;
+
+uint16_t mctp_serial_fcs(uint16_t fcs, const uint8_t* data, uint16_t len);
+void mctp_deframer_init(mctp_deframer_t* d);
+int mctp_deframer_push(mctp_deframer_t* d, uint8_t b, uint64_t now_ns);
+void mctp_serial_decode(mctp_frame_t* f);
+int mctp_serial_encode(mctp_frame_t* f, const uint8_t* body, uint8_t body_len);
+void mctp_frame_copy(mctp_frame_t* dst, const mctp_frame_t* src);
+
+/**
+ * @brief Report whether a frame carries a complete transport and message header.
+ *
+ * @param f - the frame to test.
+ * @return int Non-zero when the header accessors below may be used.
+ */
+static inline int mctp_frame_has_header(const mctp_frame_t* f) {
+    return f->status == MCTP_FRAME_OK && f->len >= MCTP_SERIAL_MIN_DATA;
+}
+
+/**
+ * @brief Return the MCTP message type of a frame (integrity check bit removed).
+ *
+ * @param f - a frame for which mctp_frame_has_header() is true.
+ * @return uint8_t The message type.
+ */
+static inline uint8_t mctp_frame_msg_type(const mctp_frame_t* f) {
+    return f->data[MCTP_OFF_MSG_TYPE] & MCTP_MSG_TYPE_MASK;
+}
+
+/**
+ * @brief Return non-zero when the frame is a request (tag owner bit set).
+ *
+ * @param f - a frame for which mctp_frame_has_header() is true.
+ * @return int Non-zero for requests.
+ */
+static inline int mctp_frame_is_request(const mctp_frame_t* f) {
+    return (f->data[MCTP_OFF_FLAGS] & MCTP_FLAG_TO) != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MCTP_SERIAL_H */
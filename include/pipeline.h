@@ -0,0 +1,94 @@
+/**
+ * @file pipeline.h
+ * @brief Overlapped receive, dispatch and transmit stages for the serial link.
+ *
+ * The core reads and writes the link one byte at a time.  The pipeline sits
+ * underneath the platform serial functions so that receiving (reading and
+ * deframing) and transmitting (draining encoded frames to the device) run as
+ * independent stages.  The I/O loop can then parse and execute the next
+ * request while the previous response is still on the wire.
+ *
+ * With threading enabled the receive and transmit stages each run on their
+ * own thread.  Without threading both stages are pumped inline from the
+ * platform functions, which preserves the original single-threaded behaviour.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* frames buffered between stages */
+#define PIPELINE_RX_FRAMES 32
+#define PIPELINE_TX_FRAMES 32
+
+/* default bytes allowed in the kernel output queue before the TX stage waits */
+#define PIPELINE_TX_OUTQ_LIMIT 128
+
+/* give up on a frame the device has refused to accept for this long */
+#define PIPELINE_TX_STALL_LIMIT_MS 1000
+
+/* a request answered after its handler returned: who asked, with which tag, and when */
+typedef struct {
+    mctp_req_timing_t timing;   /* end_ns is filled in when the response is sent */
+    uint32_t seq;               /* request's receive sequence number */
+    uint8_t src;                /* requester EID */
+    uint8_t tag;                /* request's message tag */
+} pipeline_request_t;
+
+int pipeline_start(int fd, int threaded);
+void pipeline_stop();
+size_t pipeline_stop_unread(uint8_t* out, size_t max);
+int pipeline_preload(const uint8_t* raw, size_t len);
+void pipeline_set_pacing(unsigned bps, unsigned outq_limit);
+uint8_t pipeline_rx_has_data();
+uint8_t pipeline_rx_read_byte();
+const mctp_frame_t* pipeline_rx_last();
+void pipeline_dispatch_begin();
+void pipeline_dispatch_end();
+void pipeline_tx_byte(uint8_t b);
+uint8_t pipeline_tx_can_accept();
+int pipeline_wait_fd();
+int pipeline_wait_begin(int timeout_ms);
+void pipeline_wait_end();
+int pipeline_threaded();
+void pipeline_tx_notify();
+void pipeline_restore_eid(uint8_t eid, uint8_t owner);
+void pipeline_withdraw_eid(uint8_t owner);
+int pipeline_send_local(const uint8_t* body, uint8_t len);
+int pipeline_request_capture(pipeline_request_t* out);
+int pipeline_send_deferred(const uint8_t* raw, size_t len, const pipeline_request_t* req, uint64_t end_ns);
+int pipeline_eid(uint8_t* eid, uint8_t* owner);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PIPELINE_H */
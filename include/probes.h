@@ -0,0 +1,70 @@
+/**
+ * @file probes.h
+ * @brief USDT (SystemTap/DTrace style) static probes for the I/O hot path.
+ *
+ * When <sys/sdt.h> is available (systemtap-sdt-dev / systemtap-sdt-devel)
+ * each probe compiles to a single nop plus an ELF note describing where its
+ * arguments live, so bpftrace or perf can attach to a running endpoint
+ * without a rebuild:
+ *
+ *   bpftrace -e 'usdt:./endpoint:iotfoundry:tx_flush { @us = hist(arg2 / 1000); }'
+ *   perf probe -x ./endpoint sdt_iotfoundry:frame_complete
+ *
+ * Without the header, or when built with -DIOTFOUNDRY_NO_PROBES, the probes
+ * expand to nothing beyond evaluating their (side-effect free) arguments.
+ *
+ * Probes (provider "iotfoundry"):
+ *   rx_read(bytes)                       bulk read from the serial device
+ *   frame_complete(seq, len, rx_ns)      closing flag seen; rx_ns = first byte -> flag
+ *   frame_error(seq, status)             frame failed FCS, escape or length checks
+ *   fcs_fail(seq, raw_len)               frame failed the FCS check
+ *   fastpath(seq, kind)                  answered or refused by the receive stage (1 template,
+ *                                        2 replay, 3 shed, 4 rate limit, 5 source queue full)
+ *   rx_consumed(seq)                     core has read the whole frame
+ *   dispatch(seq, msg_type, cmd)         main loop hands the frame to a handler;
+ *                                        cmd is (pldm_type << 8 | command) for PLDM
+ *   handler_return(seq, handler_ns)      handler returned
+ *   tx_flush(seq, raw_len, queued_ns)    last byte of a frame written; queued_ns = produced -> written
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef PROBES_H
+#define PROBES_H
+
+#if !defined(IOTFOUNDRY_NO_PROBES) && defined(__has_include)
+#  if __has_include(<sys/sdt.h>)
+#    include <sys/sdt.h>
+#    define IOTFOUNDRY_PROBES 1
+#  endif
+#endif
+
+#ifdef IOTFOUNDRY_PROBES
+#  define PROBE1(name, a) DTRACE_PROBE1(iotfoundry, name, a)
+#  define PROBE2(name, a, b) DTRACE_PROBE2(iotfoundry, name, a, b)
+#  define PROBE3(name, a, b, c) DTRACE_PROBE3(iotfoundry, name, a, b, c)
+#else
+#  define PROBE1(name, a) do { (void)(a); } while (0)
+#  define PROBE2(name, a, b) do { (void)(a); (void)(b); } while (0)
+#  define PROBE3(name, a, b, c) do { (void)(a); (void)(b); (void)(c); } while (0)
+#endif
+
+#endif /* PROBES_H */
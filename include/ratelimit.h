@@ -0,0 +1,62 @@
+/**
+ * @file ratelimit.h
+ * @brief Token-bucket request rate limits per source EID and message type.
+ *
+ * Requests are checked in the receive stage after the cached-response fast
+ * paths, so a poller that only repeats cacheable queries costs nothing and is
+ * never limited.  A request over its source's or its message type's rate is
+ * refused before it is queued for the core.
+ *
+ * The specification is a comma separated list of <key>=<rate>[/<burst>]
+ * items, rates in requests per second and 0 meaning unlimited:
+ *
+ *   eid=<r>         default for every source EID
+ *   eid.<n>=<r>     source EID n, overriding the default
+ *   type.<n>=<r>    MCTP message type n, across all sources
+ *
+ * e.g. "eid=20/5,eid.8=0,type.1=200" limits every source but EID 8 to 20
+ * requests per second with bursts of 5, and PLDM to 200 per second overall.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int ratelimit_init(const char* spec);
+int ratelimit_enabled();
+int ratelimit_allow(const mctp_frame_t* f, uint64_t now_ns);
+void ratelimit_dump_stats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RATELIMIT_H */
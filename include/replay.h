@@ -0,0 +1,99 @@
+/**
+ * @file replay.h
+ * @brief Duplicate-request detection and response replay cache.
+ *
+ * A bus owner that times out retransmits the identical request (same source
+ * EID, tag and instance id).  Running the handler again wastes time and can
+ * repeat side effects, so the receive stage remembers recent requests and the
+ * encoded responses the core produced for them:
+ *
+ *  - a duplicate of a request whose response is cached is answered by
+ *    replaying the cached frames;
+ *  - a duplicate of a request the core is still working on is dropped, since
+ *    the original's response answers it.
+ *
+ * The cache has a fixed number of entries with least-recently-used eviction,
+ * and entries expire after a configurable time so that instance ids reused
+ * later by the requester are treated as new requests.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REPLAY_DEFAULT_ENTRIES 16
+#define REPLAY_MAX_ENTRIES 256
+#define REPLAY_DEFAULT_TTL_MS 2000
+/* responses larger than this are not cached */
+#define REPLAY_MAX_FRAMES 8
+#define REPLAY_RAW_MAX 1024
+
+typedef enum {
+    REPLAY_MISS = 0,      /* new request: pass it to the core */
+    REPLAY_HIT,           /* cached response available: replay it */
+    REPLAY_IN_PROGRESS    /* original still being handled: drop the duplicate */
+} replay_result_t;
+
+typedef struct {
+    uint64_t lookups;
+    uint64_t hits;            /* duplicates answered from the cache */
+    uint64_t in_progress;     /* duplicates dropped while the original was pending */
+    uint64_t misses;
+    uint64_t stored;          /* responses captured */
+    uint64_t evictions;       /* entries displaced by LRU */
+    uint64_t expirations;     /* entries older than the TTL */
+    uint64_t flushed;         /* query answers dropped because state may have changed */
+    uint64_t uncacheable;     /* responses too large to keep */
+} replay_stats_t;
+
+/* cached response handed back by replay_lookup() */
+typedef struct {
+    uint8_t frames;
+    uint16_t frame_len[REPLAY_MAX_FRAMES];
+    uint8_t raw[REPLAY_RAW_MAX];
+} replay_response_t;
+
+int replay_init(unsigned entries, unsigned ttl_ms);
+void replay_free();
+replay_result_t replay_lookup(const mctp_frame_t* req, replay_response_t* out);
+void replay_record(const mctp_frame_t* req, const mctp_frame_t* resp);
+void replay_record_answer(uint32_t seq, uint8_t src, uint8_t tag, const mctp_frame_t* resp);
+void replay_cancel(const mctp_frame_t* req);
+void replay_complete(uint32_t seq);
+void replay_flush();
+void replay_get_stats(replay_stats_t* out);
+void replay_dump_stats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REPLAY_H */
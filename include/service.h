@@ -0,0 +1,68 @@
+/**
+ * @file service.h
+ * @brief Service manager integration: inherited sockets and readiness notification.
+ *
+ * A service manager (or a test harness) can open the device and the local
+ * sockets before the endpoint starts and pass them with the LISTEN_FDS
+ * protocol, so nothing has to be created by the time a client connects.
+ * Once the endpoint can accept traffic it says so, once, over NOTIFY_SOCKET
+ * and/or a descriptor given with --ready-fd.  The message carries the
+ * device path, the EID and how long the endpoint took to get there:
+ *
+ *     READY=1
+ *     STATUS=...
+ *     MAINPID=<pid>
+ *     MCTP_DEVICE=/dev/pts/3
+ *     MCTP_EID=8
+ *     READY_USEC=2150
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <stdint.h>
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* first descriptor passed by the LISTEN_FDS protocol */
+#define SERVICE_LISTEN_FDS_START 3
+
+/* LISTEN_FDNAMES entries that select a role; any other name is placed by its type */
+#define SERVICE_FDNAME_DEVICE "device"
+#define SERVICE_FDNAME_DEMUX "demux"
+#define SERVICE_FDNAME_TAKEOVER "takeover"
+
+void service_mark_start();
+int service_collect_fds(config_t* cfg);
+void service_ready(int ready_fd, const char* device, uint8_t eid);
+uint64_t service_ready_ns();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SERVICE_H */
@@ -0,0 +1,227 @@
+/**
+ * @file stats.h
+ * @brief Shared-memory statistics segment for the Linux endpoint.
+ *
+ * The endpoint publishes a fixed-layout block of counters in a file under
+ * /dev/shm (or a private mapping if that is not possible).  External tools
+ * such as endpoint-stat map the file read-only and sample it; the endpoint
+ * never blocks on a reader.
+ *
+ * Each counter has a single writer thread (the receive stage, the transmit
+ * stage or the I/O thread), so updates are a relaxed load and store, which
+ * compiles to a plain add on common targets.  Counters shared by several
+ * writers use a relaxed atomic add.  Groups of values that must be read as a
+ * consistent set are published under the seqlock in the header.
+ *
+ * This header is shared with the host tools and must not depend on anything
+ * else in the endpoint.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+#include "latency.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATS_MAGIC 0x54534649u     /* "IFST" */
+#define STATS_VERSION 5
+#define STATS_DIR "/dev/shm"
+#define STATS_PREFIX "iotfoundry-endpoint."
+#define STATS_SUFFIX ".stats"
+
+/* message types 0..STATS_MSG_TYPES-2 are counted individually, the rest together */
+#define STATS_MSG_TYPES 8
+
+/* slots reserved for drop reasons, see stats_drop_t */
+#define STATS_DROP_REASONS 12
+
+/* reasons a received frame or byte was discarded, or a transmit frame lost */
+typedef enum {
+    STATS_DROP_NOISE = 0,      /* bytes outside any frame */
+    STATS_DROP_BAD_FRAME,      /* FCS, escape, length or size errors */
+    STATS_DROP_DUPLICATE,      /* retransmission of a request still being handled */
+    STATS_DROP_TX_STALL,       /* transmit frame abandoned after the device stalled */
+    STATS_DROP_TX_ERROR,       /* transmit frame abandoned after a write error */
+    STATS_DROP_SHED,           /* request refused with ERROR_NOT_READY under overload */
+    STATS_DROP_RATE_LIMIT      /* request over its source's or message type's rate limit */
+} stats_drop_t;
+
+/* requesting endpoints counted individually; the last slot is shared by any others */
+#define STATS_SOURCES 16
+
+/* traffic from one source EID, see fairq */
+typedef struct {
+    uint32_t eid;               /* source EID, valid once used is set */
+    uint32_t used;              /* written by the receive stage when the slot is claimed */
+    uint64_t rx_packets;        /* queued for the core */
+    uint64_t rate_limited;      /* requests refused by a token bucket */
+    uint64_t shed;              /* requests refused by admission control */
+    uint64_t served;            /* packets consumed by the core */
+    uint64_t handler_ns;        /* handler time charged to the source */
+    uint64_t queue_ns_total;    /* queued -> first byte read by the core */
+    uint64_t queue_ns_max;
+} stats_source_t;
+
+typedef struct {
+    /* header, written once at startup */
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;              /* sizeof(endpoint_stats_t) */
+    uint32_t pid;
+    uint64_t start_realtime_ns; /* CLOCK_REALTIME when the endpoint started */
+    char port[64];              /* serial device path */
+    volatile uint32_t seq;      /* seqlock: odd while a grouped update is in progress */
+    uint32_t ready_us;          /* start to ready, 0 until ready */
+
+    /* receive stage */
+    uint64_t rx_bytes;
+    uint64_t rx_frames_ok;
+    uint64_t rx_fcs_errors;
+    uint64_t rx_escape_errors;
+    uint64_t rx_length_errors;  /* includes oversize frames */
+    uint64_t rx_msg_type[STATS_MSG_TYPES];
+    uint64_t rx_read_calls;
+    uint64_t rx_poll_calls;
+
+    /* receive-stage fast paths */
+    uint64_t rx_template_answers;
+    uint64_t rx_replay_answers;
+
+    /* transmit stage */
+    uint64_t tx_bytes;
+    uint64_t tx_frames;
+    uint64_t tx_msg_type[STATS_MSG_TYPES];
+    uint64_t tx_write_calls;
+    uint64_t tx_poll_calls;
+    uint64_t tx_ioctl_calls;
+    uint64_t tx_stall_ns;       /* time spent waiting for the device to accept data */
+
+    /* I/O thread */
+    uint64_t io_poll_calls;
+    uint64_t io_wakeups;
+    uint64_t io_slow_handlers;  /* dispatches over the watchdog budget */
+    uint64_t io_handler_max_ns; /* longest dispatch while the watchdog is enabled */
+
+    uint64_t drops[STATS_DROP_REASONS];
+
+    /* kernel tty queues and driver error counts, sampled by ttyq */
+    uint64_t tty_samples;
+    uint64_t tty_inq;           /* gauge: bytes received by the driver, not yet read */
+    uint64_t tty_inq_max;
+    uint64_t tty_outq;          /* gauge: bytes written, not yet on the wire */
+    uint64_t tty_outq_max;
+    uint64_t tty_overruns;      /* UART overruns since start (TIOCGICOUNT) */
+    uint64_t tty_buf_overruns;  /* tty buffer overruns since start */
+    uint64_t tty_frame_errors;
+    uint64_t tty_parity_errors;
+    uint64_t tty_breaks;
+
+    /* receive queue, one slot per requesting endpoint */
+    stats_source_t sources[STATS_SOURCES];
+
+    /* response latency histograms, updated under the seqlock */
+    latency_table_t latency;
+} endpoint_stats_t;
+
+/* currently mapped statistics block; never NULL once stats_open() has run */
+extern endpoint_stats_t* endpoint_stats;
+
+int stats_open(const char* path, const char* port);
+void stats_close();
+const char* stats_path();
+
+/**
+ * @brief Add to a counter that only the calling thread writes.
+ *
+ * @param c - the counter.
+ * @param n - amount to add.
+ */
+static inline void stats_add(uint64_t* c, uint64_t n) {
+    __atomic_store_n(c, __atomic_load_n(c, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Add to a counter that more than one thread writes.
+ *
+ * @param c - the counter.
+ * @param n - amount to add.
+ */
+static inline void stats_add_shared(uint64_t* c, uint64_t n) {
+    __atomic_fetch_add(c, n, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Set a gauge and raise its high-water mark; safe from any thread.
+ *
+ * @param gauge - the gauge.
+ * @param max - its high-water mark.
+ * @param v - the new value.
+ */
+static inline void stats_gauge(uint64_t* gauge, uint64_t* max, uint64_t v) {
+    __atomic_store_n(gauge, v, __ATOMIC_RELAXED);
+    uint64_t m = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (v > m && !__atomic_compare_exchange_n(max, &m, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * @brief Map a message type to its slot in the per-type counters.
+ *
+ * @param type - MCTP message type.
+ * @return unsigned Index into rx_msg_type/tx_msg_type.
+ */
+static inline unsigned stats_msg_slot(uint8_t type) {
+    return type < STATS_MSG_TYPES - 1 ? type : STATS_MSG_TYPES - 1;
+}
+
+/**
+ * @brief Begin a grouped update that readers must see atomically.
+ *
+ * Only one thread may hold the write side at a time.
+ *
+ * @param s - statistics block.
+ */
+static inline void stats_write_begin(endpoint_stats_t* s) {
+    __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief End a grouped update started with stats_write_begin().
+ *
+ * @param s - statistics block.
+ */
+static inline void stats_write_end(endpoint_stats_t* s) {
+    __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELEASE);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATS_H */
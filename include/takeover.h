@@ -0,0 +1,100 @@
+/**
+ * @file takeover.h
+ * @brief Handing the open device and link state to a new endpoint process.
+ *
+ * An endpoint started with --takeover <path> first connects to <path>.  If
+ * an older endpoint is listening there, the newcomer sends a request and
+ * the old process shuts down, keeping the device open.  Its last message
+ * passes the device descriptor (SCM_RIGHTS), the line settings, the
+ * assigned EID and the bytes it received but did not handle; then it
+ * exits.  The newcomer continues on the same descriptor, so the link never
+ * drops and the bus owner need not rediscover the endpoint.  Either way the
+ * new process then listens on <path> for its own successor.
+ *
+ * Messages on the SOCK_SEQPACKET connection:
+ *
+ *     new -> old   takeover_request_t
+ *     old -> new   takeover_state_t, then unread_len bytes; device fd attached
+ *
+ * If the hand-over cannot be sent, the old process closes the device and
+ * then sends a takeover_state_t with TAKEOVER_REOPEN and no descriptor; the
+ * newcomer starts as if nobody had been listening and opens the device itself.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TAKEOVER_H
+#define TAKEOVER_H
+
+#include <stdint.h>
+#include <termios.h>
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TAKEOVER_MAGIC 0x564f5449u     /* "ITOV" */
+#define TAKEOVER_VERSION 1
+
+/* longest the new process waits for the old one to shut down */
+#define TAKEOVER_TIMEOUT_MS 5000
+/* received but unhandled bytes carried over; frames beyond this are dropped */
+#define TAKEOVER_UNREAD_MAX 65536
+
+/* takeover_state_t flags */
+#define TAKEOVER_HAS_TERMIOS 0x0001
+#define TAKEOVER_HAS_EID 0x0002
+#define TAKEOVER_REOPEN 0x0004     /* no descriptor: the device is closed, open it afresh */
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+} takeover_request_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;                /* TAKEOVER_HAS_* */
+    uint8_t eid;                   /* assigned endpoint ID */
+    uint8_t owner_eid;             /* bus owner that assigned it */
+    uint16_t reserved;
+    uint32_t unread_len;           /* received bytes that follow this header */
+    struct termios tio;            /* line settings of a tty */
+    char path[SERIAL_PATH_MAX];    /* device (or pty slave) path */
+} takeover_state_t;
+
+int takeover_acquire(const char* path, config_t* cfg);
+int takeover_listen(const char* path, int fd);
+int takeover_fd();
+int takeover_timeout();
+int takeover_poll();
+int takeover_detach();
+int takeover_release(int dev_fd, const char* dev_path);
+void takeover_close();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TAKEOVER_H */
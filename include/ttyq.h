@@ -0,0 +1,64 @@
+/**
+ * @file ttyq.h
+ * @brief Kernel tty queue depth and driver error sampling.
+ *
+ * The receive stage periodically samples how many bytes wait in the
+ * kernel's receive (TIOCINQ) and transmit (TIOCOUTQ) queues, and the driver's
+ * overrun, framing, parity and break counts (TIOCGICOUNT) where the driver
+ * provides them.  Values are published as gauges and high-water marks in the
+ * statistics segment and are available to transmit pacing and admission
+ * control through ttyq_get().
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TTYQ_H
+#define TTYQ_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TTYQ_DEFAULT_INTERVAL_MS 100
+
+typedef struct {
+    uint64_t t_ns;             /* CLOCK_MONOTONIC of the last periodic sample */
+    uint32_t inq;              /* bytes waiting in the kernel receive queue */
+    uint32_t outq;             /* bytes waiting in the kernel transmit queue */
+    uint32_t inq_max;
+    uint32_t outq_max;
+    uint64_t overruns;         /* UART and tty buffer overruns since start */
+    uint64_t errors;           /* framing and parity errors since start */
+} ttyq_sample_t;
+
+void ttyq_init(int fd, unsigned interval_ms);
+int ttyq_poll_timeout();
+void ttyq_poll();
+int ttyq_outq();
+void ttyq_get(ttyq_sample_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTYQ_H */
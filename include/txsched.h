@@ -0,0 +1,105 @@
+/**
+ * @file txsched.h
+ * @brief Priority-aware transmit scheduler for outgoing MCTP serial frames.
+ *
+ * Frames are sorted into priority classes as they leave the core.  The
+ * transmit stage always sends the next packet from the highest non-empty
+ * class, so a small MCTP control response or PLDM event is slotted in between
+ * the packets of a large multi-packet transfer instead of waiting behind it.
+ * Packets of one message keep their class, and each class is FIFO per
+ * producer, so packet order within a message is preserved.
+ *
+ * Three producers may queue frames: the I/O thread (responses from the core),
+ * the receive stage (responses it answers itself, e.g. from cached
+ * templates) and the demux thread (messages from local clients).  Each
+ * producer has its own queue per class so no locking is needed between them.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TXSCHED_H
+#define TXSCHED_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* lower value = higher priority */
+typedef enum {
+    TX_CLASS_CONTROL = 0,   /* MCTP control messages */
+    TX_CLASS_EVENT,         /* time-critical PLDM platform events */
+    TX_CLASS_NORMAL,        /* other single-packet messages */
+    TX_CLASS_BULK,          /* packets of multi-packet messages */
+    TX_CLASS_COUNT
+} tx_class_t;
+
+/* PLDM platform monitoring and control type and its event commands */
+#define PLDM_TYPE_PLATFORM 0x02
+#define PLDM_CMD_PLATFORM_EVENT_MESSAGE 0x0A
+#define PLDM_CMD_POLL_FOR_PLATFORM_EVENT 0x0B
+#define PLDM_TYPE_MASK 0x3F
+
+/* frame sources, each the single producer of its own queues */
+typedef enum {
+    TX_PRODUCER_CORE = 0,   /* I/O thread, frames written by the core */
+    TX_PRODUCER_RX,         /* receive stage fast paths */
+    TX_PRODUCER_DEMUX,      /* messages from local demux clients */
+    TX_PRODUCER_WORK,       /* I/O thread, responses finished by the worker pool */
+    TX_PRODUCER_COUNT
+} tx_producer_t;
+
+/* identifies the queue a frame returned by txsched_peek() came from */
+typedef struct {
+    uint8_t producer;
+    uint8_t cls;
+} txsched_ref_t;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t queue_ns_total;   /* queued -> first byte written */
+    uint64_t queue_ns_max;
+    uint64_t preemptions;      /* sent ahead of queued lower-priority frames */
+    uint32_t depth;
+    uint32_t depth_max;
+} txsched_class_stats_t;
+
+int txsched_init(uint32_t depth_per_class);
+void txsched_free();
+tx_class_t txsched_classify(const mctp_frame_t* f);
+mctp_frame_t* txsched_slot(tx_producer_t p, tx_class_t c);
+void txsched_commit(tx_producer_t p, tx_class_t c);
+mctp_frame_t* txsched_peek(txsched_ref_t* ref);
+void txsched_pop(txsched_ref_t ref, uint64_t t_start_ns);
+int txsched_pending();
+void txsched_get_stats(tx_class_t c, txsched_class_stats_t* out);
+void txsched_dump_stats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TXSCHED_H */
@@ -0,0 +1,59 @@
+/**
+ * @file watchdog.h
+ * @brief Slow-handler watchdog for the I/O loop.
+ *
+ * Each dispatch of a received message to the core is timed against a budget.
+ * When a handler returns late, the offending request, its source and the
+ * elapsed time are logged, counted and kept in the flight recorder.
+ * Optionally, a handler still running when the budget expires has its stack
+ * sampled by a timer signal on the I/O thread.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mctp_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WATCHDOG_DEFAULT_BUDGET_MS 20
+
+/* return addresses sampled from an overrunning handler */
+#define WATCHDOG_STACK_DEPTH 16
+
+int watchdog_init(unsigned budget_ms, int backtraces);
+void watchdog_shutdown();
+void watchdog_arm(const mctp_frame_t* req, uint64_t start_ns);
+void watchdog_disarm();
+void watchdog_dump_stats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WATCHDOG_H */
@@ -0,0 +1,98 @@
+/**
+ * @file workpool.h
+ * @brief Bounded worker thread pool for long-running message handlers.
+ *
+ * Handlers that may block (file access, slow sensors, image verification)
+ * opt in by registering with the pool and submitting jobs instead of doing
+ * the work inline on the I/O thread.  The job's run function executes on a
+ * worker thread; its completion (and any encoded response it produced) is
+ * handed back to the I/O thread through workpool_poll() so that transmission
+ * stays single-threaded.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Compile-time limits for the pool */
+#define WORKPOOL_MAX_WORKERS 16
+#define WORKPOOL_MAX_HANDLERS 32
+#define WORKPOOL_DEFAULT_WORKERS 2
+#define WORKPOOL_DEFAULT_QUEUE 16
+
+typedef struct workpool_job workpool_job_t;
+
+/* run executes on a worker thread, complete executes on the I/O thread */
+typedef void (*workpool_fn_t)(workpool_job_t* job);
+
+struct workpool_job {
+    workpool_fn_t run;         /* long-running work, called off the I/O thread */
+    workpool_fn_t complete;    /* optional completion, called from workpool_poll() */
+    void* arg;                 /* caller context */
+    int handler;               /* id returned by workpool_register_handler() */
+    const uint8_t* response;   /* optional framed response to transmit on completion */
+    uint16_t response_len;     /* number of bytes in response */
+    pipeline_request_t request; /* filled in by the pool: the request being handled at submit */
+    uint64_t t_submit_ns;      /* filled in by the pool */
+    uint64_t t_start_ns;       /* filled in by the pool */
+    uint64_t t_end_ns;         /* filled in by the pool */
+    workpool_job_t* next;      /* queue linkage, owned by the pool */
+};
+
+/* per-handler counters, readable through workpool_get_stats() */
+typedef struct {
+    char name[24];
+    uint32_t depth;            /* jobs queued or running right now */
+    uint32_t max_depth;        /* high-water mark of depth */
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t rejected;         /* submissions refused because the queue was full */
+    uint64_t wait_ns_total;    /* submit -> start */
+    uint64_t wait_ns_max;
+    uint64_t run_ns_total;     /* start -> end */
+    uint64_t run_ns_max;
+} workpool_handler_stats_t;
+
+int workpool_init(unsigned workers, unsigned queue_depth);
+void workpool_shutdown();
+int workpool_register_handler(const char* name);
+int workpool_submit(workpool_job_t* job);
+int workpool_poll();
+int workpool_event_fd();
+unsigned workpool_pending();
+int workpool_get_stats(int handler, workpool_handler_stats_t* out);
+void workpool_dump_stats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WORKPOOL_H */
@@ -0,0 +1,223 @@
+/**
+ * @file admit.c
+ * @brief Overload admission control for received PLDM requests.
+ *
+ * Decisions are made by the receive stage, which is also the only writer of
+ * the counters; the I/O thread contributes handler times through a single
+ * relaxed atomic.  Overload is entered when the estimated wait reaches the
+ * configured delay and left only once it falls below half of it, so the
+ * endpoint does not flap between the two states on every frame.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "admit.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "clock.h"
+#include "flightrec.h"
+#include "log.h"
+#include "ttyq.h"
+#include "workpool.h"
+
+/* weight of a new sample in the running means: 1 / 2^EWMA_SHIFT */
+#define EWMA_SHIFT 3
+
+static uint64_t delay_ns = 0;        /* 0 while disabled */
+static uint32_t handler_ns = 0;      /* written by the I/O thread */
+static uint32_t frame_bytes = 0;
+static int overloaded = 0;
+static uint64_t overload_since_ns = 0;
+static uint64_t overload_seen_ns = 0;   /* last decision made while overloaded */
+static admit_stats_t stats;
+
+/**
+ * @brief Configure admission control.
+ *
+ * @param delay_ms - longest acceptable wait for the core, 0 to admit everything.
+ */
+void admit_init(unsigned delay_ms) {
+    delay_ns = (uint64_t)delay_ms * 1000000ull;
+    handler_ns = frame_bytes = 0;
+    overloaded = 0;
+    memset(&stats, 0, sizeof stats);
+}
+
+/**
+ * @brief Report whether admission control is active.
+ *
+ * @return int Non-zero when requests may be shed.
+ */
+int admit_enabled() {
+    return delay_ns != 0;
+}
+
+/**
+ * @brief Fold the duration of a completed dispatch into the mean handler time.
+ *
+ * @param ns - handler time.
+ */
+void admit_note_handler(uint64_t ns) {
+    if (!delay_ns) return;
+    uint32_t v = ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+    uint32_t m = __atomic_load_n(&handler_ns, __ATOMIC_RELAXED);
+    m = m ? (uint32_t)(m - (m >> EWMA_SHIFT) + (v >> EWMA_SHIFT)) : v;
+    __atomic_store_n(&handler_ns, m, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Report whether a request can be answered with ERROR_NOT_READY.
+ *
+ * @param f - a received frame.
+ * @return int Non-zero for a complete, single-packet, unicast PLDM request.
+ */
+static int refusable(const mctp_frame_t* f) {
+    if (!mctp_frame_has_header(f) || f->len <= MCTP_OFF_PLDM_CMD + 2) return 0;
+    if (mctp_frame_msg_type(f) != MCTP_MSG_TYPE_PLDM) return 0;
+    uint8_t flags = f->data[MCTP_OFF_FLAGS];
+    if ((flags & (MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO)) !=
+        (MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO)) {
+        return 0;
+    }
+    if ((f->data[MCTP_OFF_INSTANCE] & (MCTP_INSTANCE_RQ | MCTP_INSTANCE_D)) != MCTP_INSTANCE_RQ) return 0;
+    return f->data[MCTP_OFF_DEST] != 0xFF;   // broadcast: no EID to answer from
+}
+
+/**
+ * @brief Report whether a request may be refused under overload.
+ *
+ * Only refusable requests outside the base type qualify; discovery must keep
+ * working so the bus owner can still see the endpoint.
+ *
+ * @param f - a received frame.
+ * @return int Non-zero for a low-priority request.
+ */
+static int low_priority(const mctp_frame_t* f) {
+    return refusable(f) && (f->data[MCTP_OFF_PLDM_TYPE] & 0x3F) != PLDM_TYPE_BASE;
+}
+
+/**
+ * @brief Build the ERROR_NOT_READY response to a PLDM request.
+ *
+ * @param req - the received frame.
+ * @param out - destination for the encoded response.
+ * @return int 1 if out holds the response, 0 if the frame is not a request
+ *             that can be answered this way.
+ */
+int admit_not_ready(const mctp_frame_t* req, mctp_frame_t* out) {
+    if (!refusable(req)) return 0;
+    const uint8_t* d = req->data;
+    uint8_t body[] = {
+        d[MCTP_OFF_HDR_VERSION],
+        d[MCTP_OFF_SRC],
+        d[MCTP_OFF_DEST],
+        (uint8_t)(MCTP_FLAG_SOM | MCTP_FLAG_EOM | (d[MCTP_OFF_FLAGS] & MCTP_FLAG_TAG_MASK)),
+        MCTP_MSG_TYPE_PLDM,
+        (uint8_t)(d[MCTP_OFF_INSTANCE] & MCTP_INSTANCE_ID_MASK),
+        d[MCTP_OFF_PLDM_TYPE],
+        d[MCTP_OFF_PLDM_CMD],
+        PLDM_CC_ERROR_NOT_READY
+    };
+    return mctp_serial_encode(out, body, sizeof body) > 0;
+}
+
+/**
+ * @brief Move between the admitting and overloaded states.
+ *
+ * @param wait - estimated wait for the core.
+ * @param now - current time.
+ */
+static void update_state(uint64_t wait, uint64_t now) {
+    if (!overloaded && wait >= delay_ns) {
+        overloaded = 1;
+        overload_since_ns = overload_seen_ns = now;
+        stats.overloads++;
+        LOG_WARN("overloaded: about %llu ms queued, refusing low-priority PLDM requests",
+                 (unsigned long long)(wait / 1000000));
+        flight_event(FLIGHT_OVERLOAD, (uint32_t)(wait / 1000000));
+    } else if (overloaded && wait < delay_ns / 2) {
+        overloaded = 0;
+        LOG_INFO("overload cleared after %llu ms", (unsigned long long)((now - overload_since_ns) / 1000000));
+        flight_event(FLIGHT_OVERLOAD, 0);
+    }
+    if (overloaded) {
+        // counted up to the latest decision, so a quiet line does not inflate it
+        stats.overload_ns += now - overload_seen_ns;
+        overload_seen_ns = now;
+    }
+}
+
+/**
+ * @brief Decide whether a received request is admitted, answering it if not.
+ *
+ * @param req - the received frame.
+ * @param backlog - frames already waiting in the receive queue.
+ * @param out - destination for the ERROR_NOT_READY response, or NULL if no slot is free.
+ * @return int 1 if out holds the response and the request must not reach the core.
+ */
+int admit_shed(const mctp_frame_t* req, unsigned backlog, mctp_frame_t* out) {
+    if (!delay_ns) return 0;
+    frame_bytes = frame_bytes ? frame_bytes - (frame_bytes >> EWMA_SHIFT) + (req->raw_len >> EWMA_SHIFT)
+                              : req->raw_len;
+    if (!low_priority(req)) return 0;
+
+    // bytes still in the kernel are frames the core has not even seen yet
+    ttyq_sample_t q;
+    ttyq_get(&q);
+    uint64_t frames = backlog + workpool_pending() + (frame_bytes ? q.inq / frame_bytes : 0);
+    uint64_t wait = frames * __atomic_load_n(&handler_ns, __ATOMIC_RELAXED);
+    uint64_t now = clock_now_ns();
+
+    stats.checked++;
+    stats.wait_ns = wait;
+    if (wait > stats.wait_ns_max) stats.wait_ns_max = wait;
+    update_state(wait, now);
+    if (!overloaded || !out || !admit_not_ready(req, out)) return 0;
+    stats.shed++;
+    return 1;
+}
+
+/**
+ * @brief Copy the admission counters.
+ *
+ * @param out - destination for the snapshot.
+ */
+void admit_get_stats(admit_stats_t* out) {
+    *out = stats;
+    out->handler_ns = __atomic_load_n(&handler_ns, __ATOMIC_RELAXED);
+    out->frame_bytes = frame_bytes;
+}
+
+/**
+ * @brief Print the admission counters.
+ *
+ * @param out - stream to print to.
+ */
+void admit_dump_stats(FILE* out) {
+    if (!delay_ns) return;
+    admit_stats_t s;
+    admit_get_stats(&s);
+    fprintf(out, "Admission: %llu low-priority requests, %llu shed, %llu overloads (%.1f ms overloaded), "
+                 "worst estimated wait %.1f ms, mean handler %.1f us\n",
+            (unsigned long long)s.checked, (unsigned long long)s.shed, (unsigned long long)s.overloads,
+            s.overload_ns / 1e6, s.wait_ns_max / 1e6, s.handler_ns / 1000.0);
+}
@@ -0,0 +1,320 @@
+/**
+ * @file capture.c
+ * @brief pcap capture of every MCTP packet the endpoint sends or receives.
+ *
+ * Each direction has its own single-producer ring (frameq), so the receive
+ * and transmit stages never contend with each other or with the writer.  The
+ * writer thread wakes every CAPTURE_FLUSH_MS, merges both rings in timestamp
+ * order and writes the batch through a buffered stream.  When the current
+ * file reaches its size or age limit it is renamed to <path>.1 (older files
+ * shift up, the oldest is dropped) and a new <path> is started.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "capture.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "clock.h"
+#include "frameq.h"
+#include "log.h"
+
+/* pcap file header for nanosecond timestamps */
+#define PCAP_MAGIC_NS 0xa1b23c4du
+#define PCAP_VERSION_MAJOR 2
+#define PCAP_VERSION_MINOR 4
+#define PCAP_SNAPLEN 65535
+#define PCAP_FILE_HEADER_LEN 24
+#define PCAP_RECORD_HEADER_LEN 16
+
+static frameq_t rings[CAPTURE_DIRECTIONS];
+static uint64_t dropped[CAPTURE_DIRECTIONS];   /* each written by its producer only */
+static int active = 0;
+static volatile int stopping = 0;
+static pthread_t writer;
+
+static char path[1024];
+static FILE* file = NULL;
+static uint64_t max_bytes = 0;
+static uint64_t max_age_ns = 0;
+static unsigned keep_files = CAPTURE_DEFAULT_FILES;
+static uint64_t file_bytes = 0;
+static uint64_t file_opened_ns = 0;
+static int64_t realtime_offset_ns = 0;         /* CLOCK_REALTIME - CLOCK_MONOTONIC */
+static capture_stats_t stats;
+
+/**
+ * @brief Append bytes to the current file, counting failures.
+ *
+ * @param p - data.
+ * @param len - number of bytes.
+ */
+static void put(const void* p, size_t len) {
+    if (fwrite(p, 1, len, file) != len) {
+        stats.write_errors++;
+        return;
+    }
+    file_bytes += len;
+    stats.bytes += len;
+}
+
+/**
+ * @brief Open <path> and write the pcap file header.
+ *
+ * @return int 0 on success, -1 on error.
+ */
+static int open_file() {
+    file = fopen(path, "wb");
+    if (!file) return -1;
+    setvbuf(file, NULL, _IOFBF, 64 * 1024);
+
+    uint32_t magic = PCAP_MAGIC_NS;
+    uint16_t major = PCAP_VERSION_MAJOR, minor = PCAP_VERSION_MINOR;
+    uint32_t zone = 0, sigfigs = 0, snaplen = PCAP_SNAPLEN, link = CAPTURE_LINKTYPE_MCTP;
+    file_bytes = 0;
+    put(&magic, 4);
+    put(&major, 2);
+    put(&minor, 2);
+    put(&zone, 4);
+    put(&sigfigs, 4);
+    put(&snaplen, 4);
+    put(&link, 4);
+    file_opened_ns = clock_now_ns();
+    stats.files++;
+    return 0;
+}
+
+/**
+ * @brief Close the current file, shift the older ones and start a new one.
+ */
+static void rotate() {
+    char from[sizeof path + 16], to[sizeof path + 16];
+
+    fclose(file);
+    file = NULL;
+    for (unsigned k = keep_files - 1; k >= 2; k--) {
+        snprintf(from, sizeof from, "%s.%u", path, k - 1);
+        snprintf(to, sizeof to, "%s.%u", path, k);
+        rename(from, to);
+    }
+    if (keep_files > 1) {
+        snprintf(to, sizeof to, "%s.1", path);
+        rename(path, to);
+    }
+    if (open_file() != 0) {
+        LOG_ERROR("capture %s: %m", path);
+        stats.write_errors++;
+    }
+}
+
+/**
+ * @brief Write one queued packet as a pcap record.
+ *
+ * @param f - queued packet; data holds the MCTP packet, t_done_ns its time.
+ */
+static void write_record(const mctp_frame_t* f) {
+    uint64_t rec = PCAP_RECORD_HEADER_LEN + f->len;
+    uint64_t now = clock_now_ns();
+    if ((max_bytes && file_bytes > PCAP_FILE_HEADER_LEN && file_bytes + rec > max_bytes) ||
+        (max_age_ns && now - file_opened_ns >= max_age_ns)) {
+        rotate();
+    }
+    if (!file) return;
+
+    uint64_t ts = (uint64_t)((int64_t)f->t_done_ns + realtime_offset_ns);
+    uint32_t hdr[4] = {
+        (uint32_t)(ts / 1000000000ull),
+        (uint32_t)(ts % 1000000000ull),
+        f->len,
+        f->len
+    };
+    put(hdr, sizeof hdr);
+    put(f->data, f->len);
+    stats.packets++;
+}
+
+/**
+ * @brief Write everything queued so far, oldest packet first.
+ *
+ * @return int Number of records written.
+ */
+static int drain() {
+    int n = 0;
+    for (;;) {
+        mctp_frame_t* rx = frameq_peek(&rings[CAPTURE_RX]);
+        mctp_frame_t* tx = frameq_peek(&rings[CAPTURE_TX]);
+        if (!rx && !tx) break;
+        capture_dir_t d = (!tx || (rx && rx->t_done_ns <= tx->t_done_ns)) ? CAPTURE_RX : CAPTURE_TX;
+        write_record(d == CAPTURE_RX ? rx : tx);
+        frameq_pop(&rings[d]);
+        n++;
+    }
+    if (n && file) fflush(file);
+    return n;
+}
+
+/**
+ * @brief Writer thread: batch queued packets to disk until stopped.
+ *
+ * @param unused - unused.
+ * @return void* NULL.
+ */
+static void* writer_main(void* unused) {
+    (void)unused;
+    struct timespec nap = { 0, CAPTURE_FLUSH_MS * 1000000L };
+    while (!stopping) {
+        drain();
+        nanosleep(&nap, NULL);
+    }
+    drain();
+    return NULL;
+}
+
+/**
+ * @brief Start capturing to a pcap file.
+ *
+ * @param file_path - capture file.
+ * @param max_file_bytes - rotate once a file would exceed this size (0 = never).
+ * @param max_seconds - rotate files older than this (0 = never).
+ * @param files - files to keep, including the one being written.
+ * @return int 0 on success, -1 on error.
+ */
+int capture_open(const char* file_path, uint64_t max_file_bytes, unsigned max_seconds, unsigned files) {
+    if (active) return 0;
+
+    snprintf(path, sizeof path, "%s", file_path);
+    max_bytes = max_file_bytes;
+    max_age_ns = (uint64_t)max_seconds * 1000000000ull;
+    keep_files = files ? files : 1;
+    memset(&stats, 0, sizeof stats);
+    memset(dropped, 0, sizeof dropped);
+
+    struct timespec rt;
+    clock_gettime(CLOCK_REALTIME, &rt);
+    realtime_offset_ns = (int64_t)((uint64_t)rt.tv_sec * 1000000000ull + (uint64_t)rt.tv_nsec) -
+                         (int64_t)clock_now_ns();
+
+    if (frameq_init(&rings[CAPTURE_RX], CAPTURE_RING_FRAMES) != 0 ||
+        frameq_init(&rings[CAPTURE_TX], CAPTURE_RING_FRAMES) != 0) {
+        frameq_free(&rings[CAPTURE_RX]);
+        return -1;
+    }
+    if (open_file() != 0) {
+        LOG_ERROR("capture %s: %m", path);
+        frameq_free(&rings[CAPTURE_RX]);
+        frameq_free(&rings[CAPTURE_TX]);
+        return -1;
+    }
+
+    // the writer never handles process signals
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    stopping = 0;
+    int err = pthread_create(&writer, NULL, writer_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (err != 0) {
+        LOG_ERROR("capture: %s", strerror(err));
+        fclose(file);
+        file = NULL;
+        frameq_free(&rings[CAPTURE_RX]);
+        frameq_free(&rings[CAPTURE_TX]);
+        return -1;
+    }
+
+    __atomic_store_n(&active, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * @brief Stop capturing, writing out any queued packets.
+ *
+ * The I/O stages must no longer be calling capture_frame().
+ */
+void capture_close() {
+    if (!active) return;
+    active = 0;
+    stopping = 1;
+    pthread_join(writer, NULL);
+    if (file) fclose(file);
+    file = NULL;
+    frameq_free(&rings[CAPTURE_RX]);
+    frameq_free(&rings[CAPTURE_TX]);
+}
+
+/**
+ * @brief Queue a packet for capture.
+ *
+ * Only the MCTP packet (transport header onward) is copied.  Frames that
+ * failed the serial checks have no trustworthy header and are skipped.  Each
+ * direction must be fed by a single thread.
+ *
+ * @param dir - CAPTURE_RX or CAPTURE_TX.
+ * @param f - decoded frame.
+ * @param t_ns - CLOCK_MONOTONIC time to record for the packet.
+ */
+void capture_frame(capture_dir_t dir, const mctp_frame_t* f, uint64_t t_ns) {
+    if (!__atomic_load_n(&active, __ATOMIC_ACQUIRE) || !mctp_frame_has_header(f)) return;
+
+    uint8_t n = f->data[MCTP_OFF_BYTE_COUNT];
+    if (MCTP_OFF_HDR_VERSION + n > f->len) return;
+
+    mctp_frame_t* slot = frameq_slot(&rings[dir]);
+    if (!slot) {
+        __atomic_store_n(&dropped[dir], dropped[dir] + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    slot->t_done_ns = t_ns;
+    slot->len = n;
+    memcpy(slot->data, &f->data[MCTP_OFF_HDR_VERSION], n);
+    frameq_commit(&rings[dir]);
+}
+
+/**
+ * @brief Copy the capture counters.
+ *
+ * @param out - destination.
+ */
+void capture_get_stats(capture_stats_t* out) {
+    *out = stats;
+    out->dropped = __atomic_load_n(&dropped[CAPTURE_RX], __ATOMIC_RELAXED) +
+                   __atomic_load_n(&dropped[CAPTURE_TX], __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Print the capture counters, if a capture was taken.
+ *
+ * @param out - destination stream.
+ */
+void capture_dump_stats(FILE* out) {
+    capture_stats_t s;
+    capture_get_stats(&s);
+    if (!s.files) return;
+    fprintf(out, "Capture: %llu packets, %llu dropped, %llu bytes in %u file%s, %u write errors\n",
+            (unsigned long long)s.packets, (unsigned long long)s.dropped,
+            (unsigned long long)s.bytes, s.files, s.files == 1 ? "" : "s", s.write_errors);
+}
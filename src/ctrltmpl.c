@@ -0,0 +1,311 @@
+/**
+ * @file ctrltmpl.c
+ * @brief Pre-encoded response templates for idempotent MCTP control queries.
+ *
+ * Templates are learned on the I/O thread (from the core's responses) and
+ * used on the receive stage, so the table is protected by a mutex.  Each
+ * lookup touches at most CTRLTMPL_SLOTS small entries.
+ *
+ * Answering a query normally copies the cached wire image and overwrites five
+ * bytes in place: destination EID, tag, instance id and the two FCS bytes.
+ * The FCS is resumed from the cached value over the constant leading bytes
+ * rather than recomputed from the start of the frame.  Only if one of the new
+ * bytes needs escaping is the frame re-encoded.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "ctrltmpl.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* variable bytes of a response, in data order */
+enum { VAR_DEST, VAR_FLAGS, VAR_INSTANCE, VAR_FCS_HI, VAR_FCS_LO, VAR_COUNT };
+
+typedef struct {
+    uint8_t valid;
+    uint8_t cmd;                            /* key: control command */
+    uint8_t dest;                           /* key: EID the request was addressed to */
+    uint8_t payload_len;                    /* key: request data after the command */
+    uint8_t payload[CTRLTMPL_KEY_PAYLOAD];
+    uint8_t patchable;                      /* variable bytes are unescaped in raw */
+    uint16_t fcs_prefix;                    /* FCS over the bytes before the dest EID */
+    uint16_t raw_off[VAR_COUNT];            /* where each variable byte sits in raw */
+    uint64_t last_used;
+    mctp_frame_t frame;                     /* response image (data and raw) */
+} template_t;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static template_t templates[CTRLTMPL_SLOTS];
+static int enabled = 0;
+static uint32_t valid_after_seq = 0;
+static uint64_t use_clock = 0;
+static ctrltmpl_stats_t stats;
+
+/**
+ * @brief Enable or disable the template cache and clear it.
+ *
+ * @param on - non-zero to answer cacheable queries from templates.
+ */
+void ctrltmpl_init(int on) {
+    pthread_mutex_lock(&lock);
+    memset(templates, 0, sizeof templates);
+    memset(&stats, 0, sizeof stats);
+    valid_after_seq = 0;
+    enabled = on;
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Report whether a control command's response may be cached.
+ *
+ * @param cmd - MCTP control command code.
+ * @return int Non-zero for the idempotent queries handled here.
+ */
+static int cacheable(uint8_t cmd) {
+    return cmd == MCTP_CTRL_CMD_GET_ENDPOINT_ID || cmd == MCTP_CTRL_CMD_GET_VERSION_SUPPORT ||
+           cmd == MCTP_CTRL_CMD_GET_MESSAGE_TYPE_SUPPORT;
+}
+
+/**
+ * @brief Report whether a frame is a single-packet MCTP control request.
+ *
+ * @param f - received frame.
+ * @return int Non-zero if the frame is a control request with a command byte.
+ */
+static int is_control_request(const mctp_frame_t* f) {
+    if (!mctp_frame_has_header(f) || f->len < MCTP_OFF_CTRL_CMD + 3) return 0;
+    uint8_t flags = f->data[MCTP_OFF_FLAGS];
+    if ((flags & (MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO)) !=
+        (MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO)) {
+        return 0;
+    }
+    // integrity-checked messages are left to the core
+    if (f->data[MCTP_OFF_MSG_TYPE] != MCTP_MSG_TYPE_CONTROL) return 0;
+    return (f->data[MCTP_OFF_INSTANCE] & (MCTP_INSTANCE_RQ | MCTP_INSTANCE_D)) == MCTP_INSTANCE_RQ;
+}
+
+/**
+ * @brief Find the template matching a request.  Caller holds the lock.
+ *
+ * @param req - a control request for which is_control_request() is true.
+ * @return template_t* The matching template, or NULL.
+ */
+static template_t* find_locked(const mctp_frame_t* req) {
+    uint8_t cmd = req->data[MCTP_OFF_CTRL_CMD];
+    uint16_t plen = req->len - 2 - (MCTP_OFF_CTRL_CMD + 1);
+    const uint8_t* payload = &req->data[MCTP_OFF_CTRL_CMD + 1];
+
+    for (int i = 0; i < CTRLTMPL_SLOTS; i++) {
+        template_t* t = &templates[i];
+        if (t->valid && t->cmd == cmd && t->dest == req->data[MCTP_OFF_DEST] &&
+            t->payload_len == plen && memcmp(t->payload, payload, plen) == 0) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Drop all templates learned from requests up to a receive sequence number.
+ *
+ * @param seq - receive sequence number of the request that invalidated the cache.
+ */
+void ctrltmpl_invalidate(uint32_t seq) {
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < CTRLTMPL_SLOTS; i++) templates[i].valid = 0;
+    valid_after_seq = seq;
+    stats.invalidations++;
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Answer a received control query from a cached template.
+ *
+ * Control requests that may change endpoint state invalidate the cache and
+ * are never answered here.
+ *
+ * @param req - the received frame.
+ * @param out - destination for the response, or NULL to only observe the request.
+ * @return int 1 if out holds a response and the request must not reach the core.
+ */
+int ctrltmpl_answer(const mctp_frame_t* req, mctp_frame_t* out) {
+    if (!enabled || !is_control_request(req)) return 0;
+
+    uint8_t cmd = req->data[MCTP_OFF_CTRL_CMD];
+    if (!cacheable(cmd)) {
+        ctrltmpl_invalidate(req->seq);
+        return 0;
+    }
+
+    pthread_mutex_lock(&lock);
+    template_t* t = find_locked(req);
+    if (!t || !out) {
+        stats.misses++;
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+
+    const mctp_frame_t* img = &t->frame;
+    memcpy(out->data, img->data, img->len);
+    out->len = img->len;
+    out->status = MCTP_FRAME_OK;
+
+    uint8_t* d = out->data;
+    d[MCTP_OFF_DEST] = req->data[MCTP_OFF_SRC];
+    d[MCTP_OFF_FLAGS] = (uint8_t)((img->data[MCTP_OFF_FLAGS] & ~MCTP_FLAG_TAG_MASK) |
+                                  (req->data[MCTP_OFF_FLAGS] & MCTP_FLAG_TAG_MASK));
+    d[MCTP_OFF_INSTANCE] = (uint8_t)((img->data[MCTP_OFF_INSTANCE] & ~MCTP_INSTANCE_ID_MASK) |
+                                     (req->data[MCTP_OFF_INSTANCE] & MCTP_INSTANCE_ID_MASK));
+    uint16_t n = out->len - 2;
+    uint16_t fcs = mctp_serial_fcs(t->fcs_prefix, &d[MCTP_OFF_DEST], n - MCTP_OFF_DEST);
+    d[n] = (uint8_t)(fcs >> 8);
+    d[n + 1] = (uint8_t)fcs;
+
+    uint8_t vals[VAR_COUNT] = {d[MCTP_OFF_DEST], d[MCTP_OFF_FLAGS], d[MCTP_OFF_INSTANCE], d[n],
+                               d[n + 1]};
+    int patch = t->patchable;
+    for (int i = 0; i < VAR_COUNT && patch; i++) {
+        if (vals[i] == MCTP_SERIAL_FLAG || vals[i] == MCTP_SERIAL_ESCAPE) patch = 0;
+    }
+
+    if (patch) {
+        memcpy(out->raw, img->raw, img->raw_len);
+        out->raw_len = img->raw_len;
+        for (int i = 0; i < VAR_COUNT; i++) out->raw[t->raw_off[i]] = vals[i];
+        stats.patched++;
+    } else {
+        mctp_serial_encode(out, &d[MCTP_OFF_HDR_VERSION], d[MCTP_OFF_BYTE_COUNT]);
+    }
+    t->last_used = ++use_clock;
+    stats.hits++;
+    pthread_mutex_unlock(&lock);
+    return 1;
+}
+
+/**
+ * @brief Capture the core's response to a cacheable query as a template.
+ *
+ * Only successful, single-packet responses that match the request's tag and
+ * instance id are kept.  Requests received before the last invalidation are
+ * ignored so a response computed from stale state is never cached.
+ *
+ * @param req - the request the core was processing.
+ * @param resp - the frame the core transmitted.
+ */
+void ctrltmpl_learn(const mctp_frame_t* req, const mctp_frame_t* resp) {
+    if (!enabled || !is_control_request(req) || !cacheable(req->data[MCTP_OFF_CTRL_CMD])) return;
+    if (!mctp_frame_has_header(resp) || resp->len < MCTP_OFF_CTRL_CMD + 4) return;
+
+    const uint8_t* q = req->data;
+    const uint8_t* r = resp->data;
+    if ((r[MCTP_OFF_FLAGS] & (MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO)) !=
+            (MCTP_FLAG_SOM | MCTP_FLAG_EOM) ||
+        (r[MCTP_OFF_FLAGS] & MCTP_FLAG_TAG_MASK) != (q[MCTP_OFF_FLAGS] & MCTP_FLAG_TAG_MASK) ||
+        r[MCTP_OFF_MSG_TYPE] != MCTP_MSG_TYPE_CONTROL || r[MCTP_OFF_DEST] != q[MCTP_OFF_SRC] ||
+        (r[MCTP_OFF_INSTANCE] & MCTP_INSTANCE_RQ) ||
+        (r[MCTP_OFF_INSTANCE] & MCTP_INSTANCE_ID_MASK) != (q[MCTP_OFF_INSTANCE] & MCTP_INSTANCE_ID_MASK) ||
+        r[MCTP_OFF_CTRL_CMD] != q[MCTP_OFF_CTRL_CMD] || r[MCTP_OFF_CTRL_CMD + 1] != 0) {
+        return;
+    }
+
+    uint16_t plen = req->len - 2 - (MCTP_OFF_CTRL_CMD + 1);
+    if (plen > CTRLTMPL_KEY_PAYLOAD) return;
+
+    pthread_mutex_lock(&lock);
+    if ((int32_t)(req->seq - valid_after_seq) <= 0) {
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+
+    template_t* t = find_locked(req);
+    if (!t) {
+        // take a free slot, else the least recently used one
+        t = &templates[0];
+        for (int i = 0; i < CTRLTMPL_SLOTS; i++) {
+            if (!templates[i].valid) {
+                t = &templates[i];
+                break;
+            }
+            if (templates[i].last_used < t->last_used) t = &templates[i];
+        }
+    }
+
+    t->cmd = q[MCTP_OFF_CTRL_CMD];
+    t->dest = q[MCTP_OFF_DEST];
+    t->payload_len = (uint8_t)plen;
+    memcpy(t->payload, &q[MCTP_OFF_CTRL_CMD + 1], plen);
+    mctp_serial_encode(&t->frame, &r[MCTP_OFF_HDR_VERSION], r[MCTP_OFF_BYTE_COUNT]);
+    t->fcs_prefix = mctp_serial_fcs(MCTP_SERIAL_INIT_FCS, t->frame.data, MCTP_OFF_DEST);
+
+    // locate the variable bytes in the wire image; escaped ones force re-encoding
+    uint16_t n = t->frame.len - 2;
+    const uint16_t var_data_off[VAR_COUNT] = {MCTP_OFF_DEST, MCTP_OFF_FLAGS, MCTP_OFF_INSTANCE, n,
+                                              (uint16_t)(n + 1)};
+    t->patchable = 1;
+    uint16_t di = 0;
+    int v = 0;
+    for (uint16_t ri = 1; ri + 1 < t->frame.raw_len && v < VAR_COUNT; ri++) {
+        int escaped = t->frame.raw[ri] == MCTP_SERIAL_ESCAPE;
+        if (escaped) ri++;
+        if (di == var_data_off[v]) {
+            if (escaped) t->patchable = 0;
+            t->raw_off[v++] = ri;
+        }
+        di++;
+    }
+    if (v != VAR_COUNT) t->patchable = 0;
+
+    t->last_used = ++use_clock;
+    t->valid = 1;
+    stats.learned++;
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Copy the template cache counters.
+ *
+ * @param out - destination for the snapshot.
+ */
+void ctrltmpl_get_stats(ctrltmpl_stats_t* out) {
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Print the template cache counters.
+ *
+ * @param out - stream to print to.
+ */
+void ctrltmpl_dump_stats(FILE* out) {
+    ctrltmpl_stats_t s;
+    ctrltmpl_get_stats(&s);
+    if (!enabled) return;
+    fprintf(out, "Control response templates: %llu hits (%llu patched in place), %llu misses, "
+                 "%llu learned, %llu invalidations\n",
+            (unsigned long long)s.hits, (unsigned long long)s.patched,
+            (unsigned long long)s.misses, (unsigned long long)s.learned,
+            (unsigned long long)s.invalidations);
+}
@@ -0,0 +1,835 @@
+/**
+ * @file demux.c
+ * @brief UNIX seqpacket demultiplexer sharing the MCTP link with local clients.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+#include "demux.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "frameq.h"
+#include "log.h"
+#include "pipeline.h"
+#include "txsched.h"
+
+#define DEMUX_RX_FRAMES 64
+#define DEMUX_REASSEMBLY 8
+/* retry period while the transmit scheduler is full */
+#define DEMUX_TX_RETRY_MS 2
+
+#define EIDS 256
+#define TAGS (MCTP_FLAG_TAG_MASK + 1)
+#define TYPES (MCTP_MSG_TYPE_MASK + 1)
+#define HDR_LEN ((int)sizeof(demux_hdr_t))
+#define MCTP_HDR_VERSION 0x01
+
+typedef struct {
+    int fd;                     /* -1 when free */
+    int registered;
+    int closing;                /* peer gone, dropped once its batch is sent */
+    uint8_t type;
+    uint8_t flags;              /* DEMUX_REG_* */
+    uint8_t out[DEMUX_BATCH];   /* deliveries waiting for the next flush */
+    int out_count;
+} client_t;
+
+/* a message being reassembled from received packets */
+typedef struct {
+    int used;
+    uint8_t src;
+    uint8_t tag;                /* DEMUX_TAG_OWNER | tag */
+    uint8_t seq;                /* next expected packet sequence number */
+    uint16_t len;
+    uint64_t t_ns;              /* last packet, to recycle the oldest */
+    uint8_t msg[DEMUX_MSG_MAX];
+} reasm_t;
+
+/* a received message waiting to be sent to clients */
+typedef struct {
+    uint32_t len;               /* header and message */
+    uint8_t buf[HDR_LEN + DEMUX_MSG_MAX];
+} delivery_t;
+
+/* client datagrams taken by the last recvmmsg, packetized in order */
+typedef struct {
+    int client;                 /* -1 when no batch is in progress */
+    int count;
+    int pos;                    /* datagram being sent */
+    int ready;                  /* a datagram is being packetized */
+    size_t off;                 /* message bytes already queued */
+    size_t len;                 /* message length, type byte included */
+    uint8_t dest;
+    uint8_t tag;
+    uint8_t seq;
+    uint8_t type;
+    const uint8_t* body;        /* message after the type byte */
+    void* map;                  /* memfd payload mapping */
+    size_t map_len;
+} outbound_t;
+
+typedef struct {
+    uint64_t connections;
+    uint64_t rx_frames;         /* frames routed to clients by the receive stage */
+    uint64_t rx_messages;
+    uint64_t rx_errors;         /* sequence errors and oversize messages */
+    uint64_t delivered;
+    uint64_t undeliverable;     /* no client left, or its socket was full */
+    uint64_t tx_messages;
+    uint64_t tx_frames;
+    uint64_t tx_rejected;       /* malformed datagrams from clients */
+} demux_stats_t;
+
+/* shared with the receive stage */
+static int running = 0;
+static uint32_t type_clients[TYPES];
+static uint64_t tag_expiry_ns[EIDS][TAGS];  /* our request to EID, tag awaits a response */
+static uint8_t own_eid = 0;
+static frameq_t inbound;
+static int event_fd = -1;
+static uint64_t rx_overflows = 0;           /* written by the receive stage only */
+
+/* receive stage only: message in progress is routed here, by source and (owner, tag) */
+static uint8_t rx_owned[EIDS][2 * TAGS];
+
+/* demux thread */
+static pthread_t thread;
+static volatile int stopping = 0;
+static int listen_fd = -1;
+static char sock_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+static client_t clients[DEMUX_MAX_CLIENTS];
+static uint8_t tag_client[EIDS][TAGS];
+static uint8_t next_tag[EIDS];
+static reasm_t reasm[DEMUX_REASSEMBLY];
+static delivery_t deliveries[DEMUX_BATCH];
+static int delivery_count = 0;
+static uint8_t in_bufs[DEMUX_BATCH][HDR_LEN + DEMUX_MSG_MAX];
+static union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+} in_ctrl[DEMUX_BATCH];
+static struct mmsghdr in_msgs[DEMUX_BATCH];
+static struct iovec in_iov[DEMUX_BATCH];
+static outbound_t outb = {.client = -1};
+static demux_stats_t stats;
+
+/**
+ * @brief Receive stage: decide whether a new message belongs to the clients.
+ *
+ * @param f - first packet of the message.
+ * @return int Non-zero to route the message to the demux thread.
+ */
+static int wanted(const mctp_frame_t* f) {
+    uint8_t flags = f->data[MCTP_OFF_FLAGS];
+    if (!(flags & MCTP_FLAG_TO)) {
+        uint64_t exp = __atomic_load_n(&tag_expiry_ns[f->data[MCTP_OFF_SRC]][flags & MCTP_FLAG_TAG_MASK],
+                                       __ATOMIC_ACQUIRE);
+        if (exp > f->t_done_ns) return 1;
+    }
+    uint8_t type = mctp_frame_msg_type(f);
+    if (type == MCTP_MSG_TYPE_CONTROL || type == MCTP_MSG_TYPE_PLDM) return 0;
+    return __atomic_load_n(&type_clients[type], __ATOMIC_ACQUIRE) != 0;
+}
+
+/**
+ * @brief Receive stage: take a frame that belongs to a local client.
+ *
+ * Packets after the first follow the routing decided for their message.
+ *
+ * @param f - a received frame.
+ * @return int 1 if the frame was taken (or dropped) and must not reach the core.
+ */
+int demux_offer(const mctp_frame_t* f) {
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE) || !mctp_frame_has_header(f)) return 0;
+
+    uint8_t flags = f->data[MCTP_OFF_FLAGS];
+    uint8_t* owned = &rx_owned[f->data[MCTP_OFF_SRC]][((flags & MCTP_FLAG_TO) ? TAGS : 0) + (flags & MCTP_FLAG_TAG_MASK)];
+    if (flags & MCTP_FLAG_SOM) *owned = (uint8_t)wanted(f);
+    if (!*owned) return 0;
+    if (flags & MCTP_FLAG_EOM) *owned = 0;
+
+    mctp_frame_t* slot = frameq_slot(&inbound);
+    if (!slot) {
+        __atomic_store_n(&rx_overflows, rx_overflows + 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+    mctp_frame_copy(slot, f);
+    frameq_commit(&inbound);
+    // the demux thread drains until empty, so only the first frame needs a wakeup
+    if (frameq_count(&inbound) == 1) {
+        uint64_t one = 1;
+        ssize_t r = write(event_fd, &one, sizeof one);
+        (void)r;
+    }
+    return 1;
+}
+
+/**
+ * @brief Record the endpoint's own EID, used as the source of client messages.
+ *
+ * @param eid - EID assigned by the bus owner.
+ */
+void demux_note_eid(uint8_t eid) {
+    __atomic_store_n(&own_eid, eid, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Queue a received message for the clients that should see it.
+ *
+ * A response to a client's request goes to that client alone; anything
+ * else goes to every client registered for its message type.
+ *
+ * @param src - sender EID.
+ * @param tag - DEMUX_TAG_OWNER | tag from the transport header.
+ * @param msg - message type and body.
+ * @param len - message length.
+ */
+static void deliver(uint8_t src, uint8_t tag, const uint8_t* msg, uint16_t len) {
+    delivery_t* d = &deliveries[delivery_count];
+    d->buf[0] = src;
+    d->buf[1] = tag;
+    memcpy(&d->buf[HDR_LEN], msg, len);
+    d->len = (uint32_t)(HDR_LEN + len);
+
+    int recipients = 0;
+    uint8_t t = tag & DEMUX_TAG_MASK;
+    if (!(tag & DEMUX_TAG_OWNER) && __atomic_load_n(&tag_expiry_ns[src][t], __ATOMIC_RELAXED) > clock_now_ns()) {
+        client_t* c = &clients[tag_client[src][t]];
+        __atomic_store_n(&tag_expiry_ns[src][t], 0, __ATOMIC_RELEASE);
+        if (c->fd >= 0) {
+            c->out[c->out_count++] = (uint8_t)delivery_count;
+            recipients++;
+        }
+    } else {
+        for (int i = 0; i < DEMUX_MAX_CLIENTS; i++) {
+            client_t* c = &clients[i];
+            if (c->fd < 0 || !c->registered || c->type != (msg[0] & MCTP_MSG_TYPE_MASK)) continue;
+            c->out[c->out_count++] = (uint8_t)delivery_count;
+            recipients++;
+        }
+    }
+    stats.rx_messages++;
+    if (!recipients) {
+        stats.undeliverable++;
+        return;
+    }
+    delivery_count++;
+}
+
+/**
+ * @brief Create a memfd holding a message body for a shared-memory client.
+ *
+ * @param data - bytes to place in it.
+ * @param len - number of bytes.
+ * @return int The descriptor, or -1 on failure.
+ */
+static int make_memfd(const uint8_t* data, size_t len) {
+    int fd = memfd_create("iotfoundry-demux", MFD_CLOEXEC);
+    if (fd < 0) return -1;
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(fd, data + off, len - off);
+        if (n <= 0) {
+            close(fd);
+            return -1;
+        }
+        off += (size_t)n;
+    }
+    return fd;
+}
+
+/**
+ * @brief Send every queued delivery, one sendmmsg call per client.
+ */
+static void flush_deliveries() {
+    struct mmsghdr msgs[DEMUX_BATCH];
+    struct iovec iov[DEMUX_BATCH];
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } ctrl[DEMUX_BATCH];
+    int fds[DEMUX_BATCH];
+
+    for (int i = 0; i < DEMUX_MAX_CLIENTS; i++) {
+        client_t* c = &clients[i];
+        if (!c->out_count) continue;
+        memset(msgs, 0, sizeof msgs);
+        for (int k = 0; k < c->out_count; k++) {
+            delivery_t* d = &deliveries[c->out[k]];
+            iov[k].iov_base = d->buf;
+            iov[k].iov_len = d->len;
+            msgs[k].msg_hdr.msg_iov = &iov[k];
+            msgs[k].msg_hdr.msg_iovlen = 1;
+            fds[k] = -1;
+            if (!(c->flags & DEMUX_REG_SHM) || d->len <= HDR_LEN + DEMUX_INLINE_MAX) continue;
+
+            // header and message type inline, the body in a memfd
+            fds[k] = make_memfd(&d->buf[HDR_LEN + 1], d->len - HDR_LEN - 1);
+            if (fds[k] < 0) continue;
+            iov[k].iov_len = HDR_LEN + 1;
+            msgs[k].msg_hdr.msg_control = ctrl[k].buf;
+            msgs[k].msg_hdr.msg_controllen = sizeof ctrl[k].buf;
+            struct cmsghdr* cm = CMSG_FIRSTHDR(&msgs[k].msg_hdr);
+            cm->cmsg_level = SOL_SOCKET;
+            cm->cmsg_type = SCM_RIGHTS;
+            cm->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cm), &fds[k], sizeof(int));
+        }
+
+        int sent = sendmmsg(c->fd, msgs, (unsigned)c->out_count, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) sent = 0;
+        stats.delivered += (uint64_t)sent;
+        stats.undeliverable += (uint64_t)(c->out_count - sent);
+        for (int k = 0; k < c->out_count; k++) {
+            if (fds[k] >= 0) close(fds[k]);
+        }
+        c->out_count = 0;
+    }
+    delivery_count = 0;
+}
+
+/**
+ * @brief Add a received packet to its message, delivering it when complete.
+ *
+ * @param f - a frame routed here by demux_offer().
+ */
+static void reassemble(const mctp_frame_t* f) {
+    uint8_t flags = f->data[MCTP_OFF_FLAGS];
+    uint8_t src = f->data[MCTP_OFF_SRC];
+    uint8_t tag = flags & (DEMUX_TAG_OWNER | DEMUX_TAG_MASK);
+    uint8_t seq = (flags >> MCTP_FLAG_SEQ_SHIFT) & 0x03;
+    const uint8_t* payload = &f->data[MCTP_OFF_MSG_TYPE];
+    uint16_t len = (uint16_t)(f->len - MCTP_OFF_MSG_TYPE - 2);
+
+    reasm_t* r = NULL;
+    for (int i = 0; i < DEMUX_REASSEMBLY; i++) {
+        if (reasm[i].used && reasm[i].src == src && reasm[i].tag == tag) r = &reasm[i];
+    }
+    if (flags & MCTP_FLAG_SOM) {
+        // restart this message, else take a free context or the one idle longest
+        for (int i = 0; !r && i < DEMUX_REASSEMBLY; i++) {
+            if (!reasm[i].used) r = &reasm[i];
+        }
+        if (!r) {
+            r = &reasm[0];
+            for (int i = 1; i < DEMUX_REASSEMBLY; i++) {
+                if (reasm[i].t_ns < r->t_ns) r = &reasm[i];
+            }
+        }
+        r->used = 1;
+        r->src = src;
+        r->tag = tag;
+        r->len = 0;
+    } else if (!r || r->seq != seq) {
+        if (r) r->used = 0;
+        stats.rx_errors++;
+        return;
+    }
+
+    if (r->len + len > DEMUX_MSG_MAX) {
+        r->used = 0;
+        stats.rx_errors++;
+        return;
+    }
+    memcpy(&r->msg[r->len], payload, len);
+    r->len = (uint16_t)(r->len + len);
+    r->seq = (uint8_t)((seq + 1) & 0x03);
+    r->t_ns = f->t_done_ns;
+
+    if (flags & MCTP_FLAG_EOM) {
+        r->used = 0;
+        if (r->len) deliver(src, tag, r->msg, r->len);
+        if (delivery_count == DEMUX_BATCH) flush_deliveries();
+    }
+}
+
+/**
+ * @brief Move frames queued by the receive stage into client messages.
+ */
+static void drain_inbound() {
+    uint64_t count;
+    ssize_t r = read(event_fd, &count, sizeof count);
+    (void)r;
+
+    mctp_frame_t* f;
+    while ((f = frameq_peek(&inbound)) != NULL) {
+        stats.rx_frames++;
+        reassemble(f);
+        frameq_pop(&inbound);
+    }
+    flush_deliveries();
+}
+
+/**
+ * @brief Pick the tag for a client's request and reserve it for the response.
+ *
+ * @param dest - destination EID.
+ * @param client - requesting client.
+ * @return uint8_t The tag.
+ */
+static uint8_t alloc_tag(uint8_t dest, int client) {
+    uint64_t now = clock_now_ns();
+    uint8_t tag = next_tag[dest];
+    for (int i = 0; i < TAGS; i++) {
+        uint8_t t = (uint8_t)((next_tag[dest] + i) & DEMUX_TAG_MASK);
+        if (__atomic_load_n(&tag_expiry_ns[dest][t], __ATOMIC_RELAXED) <= now) {
+            tag = t;
+            break;
+        }
+    }
+    next_tag[dest] = (uint8_t)((tag + 1) & DEMUX_TAG_MASK);
+    tag_client[dest][tag] = (uint8_t)client;
+    // published before the request leaves, so the response is routed back here
+    __atomic_store_n(&tag_expiry_ns[dest][tag], now + (uint64_t)DEMUX_TAG_TIMEOUT_MS * 1000000ull,
+                     __ATOMIC_RELEASE);
+    return tag;
+}
+
+/**
+ * @brief Release the memfd mapping of the datagram being sent.
+ */
+static void unmap_payload() {
+    if (outb.map) munmap(outb.map, outb.map_len);
+    outb.map = NULL;
+}
+
+/**
+ * @brief Prepare the next datagram of the current batch for packetizing.
+ *
+ * @return int 1 when a message is ready, 0 when the batch is finished.
+ */
+static int next_datagram() {
+    while (outb.pos < outb.count) {
+        struct msghdr* h = &in_msgs[outb.pos].msg_hdr;
+        const uint8_t* buf = in_bufs[outb.pos];
+        size_t len = in_msgs[outb.pos].msg_len;
+        outb.pos++;
+
+        // a descriptor continues the message: header and type inline, body mapped
+        int fd = -1;
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(h); cm; cm = CMSG_NXTHDR(h, cm)) {
+            if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS) memcpy(&fd, CMSG_DATA(cm), sizeof fd);
+        }
+        int ok = len >= HDR_LEN + 1 && !(h->msg_flags & (MSG_TRUNC | MSG_CTRUNC));
+        if (fd >= 0) {
+            struct stat st;
+            ok = ok && len == HDR_LEN + 1 && fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size <= DEMUX_SHM_MAX;
+            if (ok) {
+                outb.map_len = (size_t)st.st_size;
+                outb.map = mmap(NULL, outb.map_len, PROT_READ, MAP_SHARED, fd, 0);
+                if (outb.map == MAP_FAILED) outb.map = NULL;
+                ok = outb.map != NULL;
+            }
+            close(fd);
+        }
+        if (!ok) {
+            stats.tx_rejected++;
+            continue;
+        }
+
+        outb.dest = buf[0];
+        outb.type = buf[HDR_LEN];
+        outb.body = outb.map ? (const uint8_t*)outb.map : &buf[HDR_LEN + 1];
+        outb.len = 1 + (outb.map ? outb.map_len : len - HDR_LEN - 1);
+        outb.off = 0;
+        outb.seq = 0;
+        outb.tag = (buf[1] & DEMUX_TAG_OWNER) ? (uint8_t)(DEMUX_TAG_OWNER | alloc_tag(outb.dest, outb.client))
+                                              : (uint8_t)(buf[1] & DEMUX_TAG_MASK);
+        outb.ready = 1;
+        return 1;
+    }
+    outb.client = -1;
+    return 0;
+}
+
+/**
+ * @brief Packetize client messages into the transmit scheduler.
+ *
+ * @return int 1 if the scheduler filled up before the batch was sent.
+ */
+static int send_batch() {
+    int queued = 0;
+    while (outb.client >= 0) {
+        if (!outb.ready && !next_datagram()) break;
+        tx_class_t cls = outb.len <= DEMUX_MTU ? TX_CLASS_NORMAL : TX_CLASS_BULK;
+
+        while (outb.off < outb.len) {
+            mctp_frame_t* out = txsched_slot(TX_PRODUCER_DEMUX, cls);
+            if (!out) {
+                if (queued) pipeline_tx_notify();
+                return 1;
+            }
+            size_t chunk = outb.len - outb.off < DEMUX_MTU ? outb.len - outb.off : DEMUX_MTU;
+            uint8_t body[4 + DEMUX_MTU];
+            body[0] = MCTP_HDR_VERSION;
+            body[1] = outb.dest;
+            body[2] = __atomic_load_n(&own_eid, __ATOMIC_RELAXED);
+            body[3] = (uint8_t)((outb.off == 0 ? MCTP_FLAG_SOM : 0) |
+                                (outb.off + chunk == outb.len ? MCTP_FLAG_EOM : 0) |
+                                (outb.seq << MCTP_FLAG_SEQ_SHIFT) | outb.tag);
+            uint8_t* p = &body[4];
+            size_t off = outb.off, n = chunk;
+            if (off == 0) {
+                *p++ = outb.type;
+                off = 1;
+                n--;
+            }
+            memcpy(p, outb.body + off - 1, n);
+            mctp_serial_encode(out, body, (uint8_t)(4 + chunk));
+            out->t_first_ns = out->t_done_ns = clock_now_ns();
+            out->t_sent_ns = 0;
+            out->seq = 0;
+            out->req.valid = 0;
+            txsched_commit(TX_PRODUCER_DEMUX, cls);
+            outb.off += chunk;
+            outb.seq = (uint8_t)((outb.seq + 1) & 0x03);
+            stats.tx_frames++;
+            queued = 1;
+        }
+        stats.tx_messages++;
+        unmap_payload();
+        outb.ready = 0;
+    }
+    if (queued) pipeline_tx_notify();
+    return 0;
+}
+
+/**
+ * @brief Disconnect a client and forget its registration and pending requests.
+ *
+ * @param i - client index.
+ */
+static void drop_client(int i) {
+    client_t* c = &clients[i];
+    if (c->registered) __atomic_fetch_sub(&type_clients[c->type], 1, __ATOMIC_RELEASE);
+    for (int e = 0; e < EIDS; e++) {
+        for (int t = 0; t < TAGS; t++) {
+            if (tag_client[e][t] == i) __atomic_store_n(&tag_expiry_ns[e][t], 0, __ATOMIC_RELEASE);
+        }
+    }
+    if (outb.client == i) {
+        unmap_payload();
+        outb.ready = 0;
+        outb.client = -1;
+    }
+    close(c->fd);
+    c->fd = -1;
+    c->registered = 0;
+    c->closing = 0;
+    c->out_count = 0;
+}
+
+/**
+ * @brief Read a client's registration or a batch of its messages.
+ *
+ * @param i - client index.
+ */
+static void read_client(int i) {
+    client_t* c = &clients[i];
+    if (!c->registered) {
+        uint8_t reg[2];
+        ssize_t n = recv(c->fd, reg, sizeof reg, MSG_DONTWAIT);
+        if (n < 0 && errno == EAGAIN) return;
+        if (n <= 0) {
+            drop_client(i);
+            return;
+        }
+        c->type = reg[0] & MCTP_MSG_TYPE_MASK;
+        c->flags = n > 1 ? reg[1] : 0;
+        c->registered = 1;
+        __atomic_fetch_add(&type_clients[c->type], 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    for (int k = 0; k < DEMUX_BATCH; k++) {
+        in_iov[k].iov_base = in_bufs[k];
+        in_iov[k].iov_len = sizeof in_bufs[k];
+        memset(&in_msgs[k].msg_hdr, 0, sizeof in_msgs[k].msg_hdr);
+        in_msgs[k].msg_hdr.msg_iov = &in_iov[k];
+        in_msgs[k].msg_hdr.msg_iovlen = 1;
+        in_msgs[k].msg_hdr.msg_control = in_ctrl[k].buf;
+        in_msgs[k].msg_hdr.msg_controllen = sizeof in_ctrl[k].buf;
+    }
+    int n = recvmmsg(c->fd, in_msgs, DEMUX_BATCH, MSG_DONTWAIT | MSG_CMSG_CLOEXEC, NULL);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    // a zero-length datagram is how a seqpacket peer's close shows up
+    int count = 0;
+    while (count < n && in_msgs[count].msg_len > 0) count++;
+    if (count) {
+        outb.client = i;
+        outb.count = count;
+        outb.pos = 0;
+        outb.ready = 0;
+        send_batch();
+    }
+    if (n <= 0 || count < n) {
+        // messages already read still go out before the client is forgotten
+        if (outb.client == i) {
+            c->closing = 1;
+        } else {
+            drop_client(i);
+        }
+    }
+}
+
+/**
+ * @brief Accept a new client connection.
+ */
+static void accept_client() {
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;
+    for (int i = 0; i < DEMUX_MAX_CLIENTS; i++) {
+        if (clients[i].fd < 0) {
+            clients[i].fd = fd;
+            clients[i].registered = 0;
+            clients[i].out_count = 0;
+            stats.connections++;
+            return;
+        }
+    }
+    LOG_WARN("demux: client limit reached, connection refused");
+    close(fd);
+}
+
+/**
+ * @brief Demux thread: accept clients, move messages both ways.
+ *
+ * @param unused - required by the pthread signature.
+ * @return void* Always NULL.
+ */
+static void* demux_main(void* unused) {
+    (void)unused;
+    struct pollfd fds[2 + DEMUX_MAX_CLIENTS];
+    int idx[2 + DEMUX_MAX_CLIENTS];
+
+    while (!stopping) {
+        int blocked = outb.client >= 0;
+        int n = 0;
+        fds[n].fd = event_fd;
+        fds[n++].events = POLLIN;
+        fds[n].fd = listen_fd;
+        fds[n++].events = POLLIN;
+        for (int i = 0; i < DEMUX_MAX_CLIENTS; i++) {
+            if (clients[i].fd < 0 || clients[i].closing) continue;
+            // while a batch waits for the transmit scheduler, leave further input in the sockets
+            fds[n].fd = clients[i].fd;
+            fds[n].events = blocked ? 0 : POLLIN;
+            idx[n++] = i;
+        }
+
+        int r = poll(fds, (nfds_t)n, blocked ? DEMUX_TX_RETRY_MS : 1000);
+        if (r < 0 && errno != EINTR) {
+            LOG_ERROR("demux: poll: %m");
+            break;
+        }
+        if (stopping) break;
+        if (blocked && !send_batch()) {
+            for (int i = 0; i < DEMUX_MAX_CLIENTS; i++) {
+                if (clients[i].closing) drop_client(i);
+            }
+        }
+        if (r <= 0) continue;
+        if (fds[0].revents) drain_inbound();
+        if (fds[1].revents) accept_client();
+        for (int k = 2; k < n; k++) {
+            int i = idx[k];
+            if (!fds[k].revents || clients[i].fd < 0) continue;
+            if (fds[k].revents & POLLIN) {
+                read_client(i);
+            } else if (fds[k].revents & (POLLHUP | POLLERR)) {
+                drop_client(i);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Remove a socket left behind by an endpoint that did not exit cleanly.
+ *
+ * Only a socket owned by this user that nobody answers on is removed.  Any
+ * other file, or a socket another process is serving, is left in place.
+ *
+ * @param path - the socket path.
+ * @param addr - its address.
+ * @param addr_len - length of the address.
+ * @return int 0 if the path is free, -1 with errno set otherwise.
+ */
+static int remove_stale_socket(const char* path, const struct sockaddr_un* addr, socklen_t addr_len) {
+    struct stat st;
+    if (lstat(path, &st) != 0) return errno == ENOENT ? 0 : -1;
+    if (!S_ISSOCK(st.st_mode) || st.st_uid != geteuid()) {
+        errno = EEXIST;
+        return -1;
+    }
+    int probe = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (probe < 0) return -1;
+    int live = connect(probe, (const struct sockaddr*)addr, addr_len) == 0 || errno != ECONNREFUSED;
+    close(probe);
+    if (live) {
+        errno = EADDRINUSE;
+        return -1;
+    }
+    return unlink(path) != 0 && errno != ENOENT ? -1 : 0;
+}
+
+/**
+ * @brief Open the demux socket and start its thread.
+ *
+ * @param path - socket path; a leading '@' selects the abstract namespace.
+ * @param fd - a socket already listening (socket activation), or -1 to create one at path.
+ * @return int 0 on success, -1 on error.
+ */
+int demux_start(const char* path, int fd) {
+    if (fd < 0 && (!path || !*path)) return 0;
+    if (!pipeline_threaded()) {
+        LOG_WARN("demux: needs the threaded pipeline, not started");
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    socklen_t addr_len = 0;
+    sock_path[0] = '\0';
+    if (fd < 0) {
+        if (strlen(path) >= sizeof addr.sun_path) {
+            LOG_ERROR("demux: socket path too long: %s", path);
+            return -1;
+        }
+        strcpy(addr.sun_path, path);
+        addr_len = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + strlen(path));
+        if (path[0] == '@') {
+            addr.sun_path[0] = '\0';
+        } else if (remove_stale_socket(path, &addr, addr_len) != 0) {
+            LOG_ERROR("demux: %s: %s", path,
+                      errno == EADDRINUSE ? "another process is serving it" : "not a stale socket of ours");
+            return -1;
+        } else {
+            snprintf(sock_path, sizeof sock_path, "%s", path);
+        }
+    }
+
+    memset(&stats, 0, sizeof stats);
+    memset(type_clients, 0, sizeof type_clients);
+    memset(tag_expiry_ns, 0, sizeof tag_expiry_ns);
+    memset(rx_owned, 0, sizeof rx_owned);
+    memset(reasm, 0, sizeof reasm);
+    for (int i = 0; i < DEMUX_MAX_CLIENTS; i++) clients[i].fd = -1;
+    outb.client = -1;
+    outb.ready = 0;
+    delivery_count = 0;
+    rx_overflows = 0;
+
+    if (fd >= 0) {
+        // the service manager keeps its own copy and the path; accepts must not block the thread
+        listen_fd = fd;
+        fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+    } else {
+        listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, addr_len) != 0 || listen(listen_fd, 8) != 0) {
+            LOG_ERROR("demux: %s: %m", path);
+            if (listen_fd >= 0) close(listen_fd);
+            listen_fd = -1;
+            return -1;
+        }
+    }
+    // both kept until exit: the receive stage may be inside demux_offer() when the demux stops
+    if (event_fd < 0) event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0 || (!inbound.slots && frameq_init(&inbound, DEMUX_RX_FRAMES) != 0)) {
+        LOG_ERROR("demux: %m");
+        demux_stop();
+        return -1;
+    }
+
+    stopping = 0;
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int err = pthread_create(&thread, NULL, demux_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (err != 0) {
+        LOG_ERROR("demux: pthread_create: %s", strerror(err));
+        demux_stop();
+        return -1;
+    }
+    __atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * @brief Stop the demux thread and disconnect every client.
+ *
+ * The receive stage stops routing frames here before the queue is released.
+ */
+void demux_stop() {
+    int was_running = __atomic_exchange_n(&running, 0, __ATOMIC_ACQ_REL);
+    if (was_running) {
+        stopping = 1;
+        uint64_t one = 1;
+        ssize_t r = write(event_fd, &one, sizeof one);
+        (void)r;
+        pthread_join(thread, NULL);
+        for (int i = 0; i < DEMUX_MAX_CLIENTS; i++) {
+            if (clients[i].fd >= 0) drop_client(i);
+        }
+    }
+    if (listen_fd >= 0) close(listen_fd);
+    listen_fd = -1;
+    if (sock_path[0]) unlink(sock_path);
+    sock_path[0] = '\0';
+}
+
+/**
+ * @brief Print demux traffic counters.
+ *
+ * @param out - stream to print to.
+ */
+void demux_dump_stats(FILE* out) {
+    if (!stats.connections && !stats.rx_frames) return;
+    fprintf(out, "Demux: %llu connections; rx %llu frames, %llu messages, %llu delivered, %llu undeliverable, "
+                 "%llu errors, %llu overflows; tx %llu messages in %llu frames, %llu rejected\n",
+            (unsigned long long)stats.connections, (unsigned long long)stats.rx_frames,
+            (unsigned long long)stats.rx_messages, (unsigned long long)stats.delivered,
+            (unsigned long long)stats.undeliverable, (unsigned long long)stats.rx_errors,
+            (unsigned long long)__atomic_load_n(&rx_overflows, __ATOMIC_RELAXED),
+            (unsigned long long)stats.tx_messages, (unsigned long long)stats.tx_frames,
+            (unsigned long long)stats.tx_rejected);
+}
@@ -0,0 +1,286 @@
+/**
+ * @file eidstate.c
+ * @brief Crash-safe state file for the assigned endpoint ID.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "eidstate.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "ctrltmpl.h"
+#include "log.h"
+#include "pipeline.h"
+
+static eidstate_file_t* file = NULL;
+static char file_path[256];
+static int current = -1;        /* record holding the newest state, -1 if none */
+static int verify = 0;
+static uint64_t writes = 0;
+
+/* restored EID and its confirmation; the result is set by the receive stage */
+static uint8_t restored_eid = 0;
+static uint8_t restored_owner = 0;
+static uint64_t probe_deadline_ns = 0;   /* 0 while no confirmation is outstanding */
+static uint64_t probe_next_ns = 0;       /* when to repeat the request */
+static unsigned probes = 0;
+static int probe_active = 0;
+static int probe_result = 0;             /* 1 confirmed, -1 refuted, 0 no answer yet */
+static const char* outcome = "";
+
+/**
+ * @brief CRC-32 (IEEE 802.3) of a buffer.
+ *
+ * @param p - the bytes.
+ * @param n - number of bytes.
+ * @return uint32_t The CRC.
+ */
+static uint32_t crc32(const void* p, size_t n) {
+    const uint8_t* b = p;
+    uint32_t crc = 0xFFFFFFFFu;
+    while (n--) {
+        crc ^= *b++;
+        for (int i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Report whether a record was written completely.
+ *
+ * @param r - the record.
+ * @return int Non-zero if its CRC matches.
+ */
+static int record_ok(const eidstate_record_t* r) {
+    return r->seq != 0 && r->crc == crc32(r, offsetof(eidstate_record_t, crc));
+}
+
+/**
+ * @brief Find the newest complete record.
+ *
+ * @return int Its index, or -1 if neither is usable.
+ */
+static int newest() {
+    int a = record_ok(&file->rec[0]), b = record_ok(&file->rec[1]);
+    if (a && b) return file->rec[1].seq > file->rec[0].seq ? 1 : 0;
+    return a ? 0 : b ? 1 : -1;
+}
+
+/**
+ * @brief Open or create the state file.
+ *
+ * @param path - the state file.
+ * @param verify_on - non-zero to confirm a restored EID with the bus owner.
+ * @return int 0 on success, -1 on failure.
+ */
+int eidstate_open(const char* path, int verify_on) {
+    if (!path || !*path) return -1;
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) != 0 ||
+        (st.st_size != (off_t)sizeof(eidstate_file_t) && ftruncate(fd, (off_t)sizeof(eidstate_file_t)) != 0)) {
+        LOG_ERROR("EID state %s: %m", path);
+        if (fd != -1) close(fd);
+        return -1;
+    }
+    void* p = mmap(NULL, sizeof(eidstate_file_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        LOG_ERROR("mmap %s: %m", path);
+        return -1;
+    }
+
+    file = p;
+    snprintf(file_path, sizeof file_path, "%s", path);
+    if (file->magic != EIDSTATE_MAGIC || file->version != EIDSTATE_VERSION || file->size != sizeof *file) {
+        // new, or written by an incompatible version: start with no state
+        memset(file, 0, sizeof *file);
+        file->magic = EIDSTATE_MAGIC;
+        file->version = EIDSTATE_VERSION;
+        file->size = sizeof *file;
+        msync(file, sizeof *file, MS_SYNC);
+    }
+    current = newest();
+    verify = verify_on;
+    return 0;
+}
+
+/**
+ * @brief Ask the bus owner for its EID, from the restored EID.
+ *
+ * A response addressed to the restored EID confirms the bus owner still
+ * knows it.
+ *
+ * @return int 0 if queued, -1 otherwise.
+ */
+static int send_probe() {
+    uint8_t body[] = {
+        1, restored_owner, restored_eid, MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO | EIDSTATE_PROBE_TAG,
+        MCTP_MSG_TYPE_CONTROL, MCTP_INSTANCE_RQ, MCTP_CTRL_CMD_GET_ENDPOINT_ID
+    };
+    probe_next_ns = clock_now_ns() + (uint64_t)EIDSTATE_PROBE_RETRY_MS * 1000000ull;
+    if (pipeline_send_local(body, sizeof body) != 0) return -1;
+    probes++;
+    return 0;
+}
+
+/**
+ * @brief Hand the saved EID to the core, and ask the bus owner to confirm it.
+ *
+ * Called once the pipeline is running.
+ *
+ * @return int 1 if an EID was restored, 0 otherwise.
+ */
+int eidstate_restore() {
+    if (!file || current < 0 || !file->rec[current].eid) return 0;
+    const eidstate_record_t* r = &file->rec[current];
+    restored_eid = r->eid;
+    restored_owner = r->owner_eid;
+    pipeline_restore_eid(restored_eid, restored_owner);
+    outcome = "restored";
+    LOG_INFO("EID state: restored EID %u assigned by bus owner %u", restored_eid, restored_owner);
+    if (!verify) return 1;
+
+    __atomic_store_n(&probe_result, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&probe_active, 1, __ATOMIC_RELEASE);
+    if (send_probe() != 0) {
+        __atomic_store_n(&probe_active, 0, __ATOMIC_RELEASE);
+        LOG_WARN("EID state: could not ask bus owner %u to confirm EID %u", restored_owner, restored_eid);
+        outcome = "restored (unconfirmed)";
+        return 1;
+    }
+    probe_deadline_ns = clock_now_ns() + (uint64_t)EIDSTATE_VERIFY_MS * 1000000ull;
+    return 1;
+}
+
+/**
+ * @brief Record an EID accepted by the core.  I/O thread only.
+ *
+ * @param eid - the endpoint ID now in force (0 if none).
+ * @param owner - EID of the bus owner that assigned it.
+ */
+void eidstate_note(uint8_t eid, uint8_t owner) {
+    // a new assignment from the bus owner settles any confirmation still outstanding
+    if (probe_deadline_ns && (eid != restored_eid || owner != restored_owner)) {
+        __atomic_store_n(&probe_active, 0, __ATOMIC_RELEASE);
+        probe_deadline_ns = 0;
+        outcome = "reassigned";
+    }
+    if (!file) return;
+    if (current >= 0 && file->rec[current].eid == eid && file->rec[current].owner_eid == owner) return;
+
+    int next = current == 0 ? 1 : 0;
+    eidstate_record_t* r = &file->rec[next];
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    memset(r, 0, sizeof *r);
+    r->seq = current >= 0 ? file->rec[current].seq + 1 : 1;
+    r->assigned_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    r->eid = eid;
+    r->owner_eid = owner;
+    r->crc = crc32(r, offsetof(eidstate_record_t, crc));
+    if (msync(file, sizeof *file, MS_SYNC) != 0) LOG_WARN("EID state %s: msync: %m", file_path);
+    current = next;
+    writes++;
+}
+
+/**
+ * @brief Take the bus owner's answer to the confirmation request.  Receive stage.
+ *
+ * @param f - a received frame.
+ * @return int 1 if the frame was the answer and is consumed here.
+ */
+int eidstate_offer(const mctp_frame_t* f) {
+    if (!__atomic_load_n(&probe_active, __ATOMIC_ACQUIRE)) return 0;
+    if (!mctp_frame_has_header(f) || mctp_frame_is_request(f) || mctp_frame_msg_type(f) != MCTP_MSG_TYPE_CONTROL) {
+        return 0;
+    }
+    const uint8_t* d = f->data;
+    if ((d[MCTP_OFF_FLAGS] & MCTP_FLAG_TAG_MASK) != EIDSTATE_PROBE_TAG ||
+        (d[MCTP_OFF_INSTANCE] & MCTP_INSTANCE_RQ) || f->len <= MCTP_OFF_CTRL_CMD ||
+        d[MCTP_OFF_CTRL_CMD] != MCTP_CTRL_CMD_GET_ENDPOINT_ID) {
+        return 0;
+    }
+    // response: command, completion code, EID, ..., FCS
+    int confirmed = f->len >= MCTP_OFF_CTRL_CMD + 3 + 2 && d[MCTP_OFF_CTRL_CMD + 1] == 0 &&
+                    d[MCTP_OFF_CTRL_CMD + 2] == restored_owner && d[MCTP_OFF_DEST] == restored_eid;
+    __atomic_store_n(&probe_result, confirmed ? 1 : -1, __ATOMIC_RELEASE);
+    __atomic_store_n(&probe_active, 0, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/**
+ * @brief Act on the bus owner's confirmation, or its absence.  Called from the I/O loop.
+ */
+void eidstate_service() {
+    if (!probe_deadline_ns) return;
+    int result = __atomic_load_n(&probe_result, __ATOMIC_ACQUIRE);
+    uint64_t now = clock_now_ns();
+    if (!result && now < probe_deadline_ns) {
+        if (now >= probe_next_ns) send_probe();
+        return;
+    }
+    __atomic_store_n(&probe_active, 0, __ATOMIC_RELEASE);
+    probe_deadline_ns = 0;
+
+    if (result > 0) {
+        outcome = "restored and confirmed";
+        LOG_INFO("EID state: bus owner %u confirmed EID %u", restored_owner, restored_eid);
+        return;
+    }
+    outcome = result < 0 ? "withdrawn (refuted)" : "withdrawn (no answer)";
+    LOG_WARN("EID state: bus owner %u %s EID %u, withdrawing it", restored_owner,
+             result < 0 ? "did not confirm" : "did not answer for", restored_eid);
+    // forget it even if the core keeps the EID, so the next start does not restore it again
+    eidstate_note(0, 0);
+    pipeline_withdraw_eid(restored_owner);
+}
+
+/**
+ * @brief Unmap the state file; it stays on disk for the next start.
+ */
+void eidstate_close() {
+    if (!file) return;
+    munmap(file, sizeof *file);
+    file = NULL;
+    current = -1;
+}
+
+/**
+ * @brief Print what was restored and how often the state was written.
+ *
+ * @param out - stream to print to.
+ */
+void eidstate_dump_stats(FILE* out) {
+    if (!file_path[0]) return;
+    fprintf(out, "EID state: %s%s%s, %u confirmation requests, %llu writes\n", file_path,
+            outcome[0] ? ", " : "", outcome, probes, (unsigned long long)writes);
+}
@@ -0,0 +1,406 @@
+/**
+ * @file endpoint.c
+ * @brief Endpoint life cycle and the non-blocking I/O loop step.
+ *
+ * endpoint_init() brings the platform modules up in dependency order,
+ * endpoint_step() runs the I/O loop until nothing is ready and
+ * endpoint_shutdown() flushes, reports and closes everything again.
+ * Waiting is left to the caller through endpoint_pollfds().
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "endpoint.h"
+
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "admit.h"
+#include "capture.h"
+#include "config.h"
+#include "ctrltmpl.h"
+#include "demux.h"
+#include "eidstate.h"
+#include "fairq.h"
+#include "faultinj.h"
+#include "flightrec.h"
+#include "jitter.h"
+#include "latency.h"
+#include "log.h"
+#include "pipeline.h"
+#include "ratelimit.h"
+#include "service.h"
+#include "replay.h"
+#include "stats.h"
+#include "takeover.h"
+#include "ttyq.h"
+#include "txsched.h"
+#include "watchdog.h"
+#include "workpool.h"
+
+#include "core/mctp.h"
+#include "core/platform.h"
+
+#ifdef PLDM_SUPPORT
+#include "core/pldm_version.h"
+#endif
+
+// the running configuration, read by the platform layer
+config_t serial_device = {
+    .fd = -1,
+    .inherit_fd = -1,
+    .demux_fd = -1,
+    .takeover_fd = -1,
+    .ready_fd = -1
+};
+
+static const config_t defaults = {
+    .baud = 115200,
+    .hwflow = 0,
+    .path = "",
+    .fd = -1,
+    .inherit_fd = -1,
+    .pipeline = 1,
+    .tx_outq_limit = PIPELINE_TX_OUTQ_LIMIT,
+    .templates = 1,
+    .replay_entries = REPLAY_DEFAULT_ENTRIES,
+    .replay_ttl_ms = REPLAY_DEFAULT_TTL_MS,
+    .workers = WORKPOOL_DEFAULT_WORKERS,
+    .work_queue = WORKPOOL_DEFAULT_QUEUE,
+    .capture_files = CAPTURE_DEFAULT_FILES,
+    .flight_records = FLIGHT_DEFAULT_RECORDS,
+    .handler_budget_ms = WATCHDOG_DEFAULT_BUDGET_MS,
+    .tty_sample_ms = TTYQ_DEFAULT_INTERVAL_MS,
+    .admit_delay_ms = ADMIT_DEFAULT_DELAY_MS,
+    .demux_fd = -1,
+    .takeover_fd = -1,
+    .ready_fd = -1
+};
+
+static int started = 0;
+static int announced = 0;
+
+/**
+ * @brief Fill a configuration with the defaults the endpoint program uses.
+ *
+ * @param cfg - the configuration to fill.
+ */
+void endpoint_config_defaults(config_t* cfg) {
+    *cfg = defaults;
+}
+
+/**
+ * @brief Bring up the endpoint on the configured device.
+ *
+ * Nothing is read or written until the first endpoint_step().  A device
+ * that cannot be opened is logged and leaves the endpoint idle, as the
+ * endpoint program has always done.
+ *
+ * @param cfg - the configuration; copied, so it need not outlive the call.
+ * @return int 0 on success, -1 for a bad specification or a second call.
+ */
+int endpoint_init(const config_t* cfg) {
+    if (started) return -1;
+    service_mark_start();
+    serial_device = *cfg;
+
+    /* faults are injected from the first byte the pipeline moves */
+    if (faultinj_init(serial_device.fault_spec) != 0) {
+        printf("Error: bad --fault specification '%s'.\n", serial_device.fault_spec);
+        return -1;
+    }
+    if (ratelimit_init(serial_device.rate_spec) != 0) {
+        printf("Error: bad --rate-limit specification '%s'.\n", serial_device.rate_spec);
+        return -1;
+    }
+
+    /* from here on, diagnostics are formatted and written off the I/O path; inline, they stay on it */
+    if (serial_device.pipeline && log_init() != 0) {
+        printf("Warning: logging thread unavailable, messages are written inline.\n");
+    }
+
+    /* a predecessor listening on the takeover socket hands over its open device */
+    int took_over = 0;
+    if (serial_device.takeover_path &&
+        (took_over = takeover_acquire(serial_device.takeover_path, &serial_device)) < 0) {
+        printf("Error: could not take over from %s.\n", serial_device.takeover_path);
+        return -1;
+    }
+
+    if (serial_device.fd > -1) {
+        printf("Using serial device: %s at baud %d, hwflow %s\n",
+               serial_device.path,
+               serial_device.baud,
+               serial_device.hwflow ? "TRUE" : "FALSE");
+    } else {
+        printf("Using simulated pty device:\n");
+    }
+
+    /* counters are shared with endpoint-stat before any traffic flows */
+    if (stats_open(serial_device.stats_path, serial_device.path) == 0) {
+        printf("Statistics: %s\n", stats_path());
+    }
+
+    /* always on, so there is something to look at after a crash */
+    if (flight_open(serial_device.flight_path, serial_device.path, (unsigned)serial_device.flight_records) == 0) {
+        printf("Flight recorder: %s\n", flight_path());
+    }
+
+    /* packets are captured from the moment the pipeline starts */
+    if (serial_device.capture_path &&
+        capture_open(serial_device.capture_path, (uint64_t)serial_device.capture_size_mb << 20,
+                     (unsigned)serial_device.capture_seconds, (unsigned)serial_device.capture_files) != 0) {
+        LOG_WARN("capture to %s unavailable", serial_device.capture_path);
+    }
+
+    /* cached responses and overload refusals are served by the receive stage once it starts */
+    ctrltmpl_init(serial_device.templates);
+    admit_init((unsigned)serial_device.admit_delay_ms);
+    if (replay_init(serial_device.replay_entries, serial_device.replay_ttl_ms) != 0) {
+        LOG_WARN("replay cache unavailable");
+    }
+
+    /* every EID the bus owner assigns is kept for the next start */
+    if (serial_device.state_path && eidstate_open(serial_device.state_path, serial_device.state_verify) == 0) {
+        printf("EID state: %s\n", serial_device.state_path);
+    }
+
+    /* initialize the mctp subsystem (and platform)*/
+    mctp_init();
+
+    /* the core gets its saved EID before anything from the wire; a predecessor's is newer */
+    if (!took_over) eidstate_restore();
+
+    /* local clients share the link once the pipeline's threads are running */
+    if ((serial_device.demux_path || serial_device.demux_fd >= 0) &&
+        demux_start(serial_device.demux_path, serial_device.demux_fd) == 0) {
+        printf("Demux socket: %s\n", serial_device.demux_path ? serial_device.demux_path : "(inherited)");
+    }
+
+    /* long-running handlers opt in to the worker pool */
+    if (workpool_init(serial_device.workers, serial_device.work_queue) != 0) {
+        LOG_WARN("worker pool unavailable, handlers will run inline");
+    }
+
+    /* handlers are timed on this thread, so the watchdog's signal interrupts the one running */
+    if (watchdog_init((unsigned)serial_device.handler_budget_ms, serial_device.handler_backtrace) != 0) {
+        LOG_WARN("handler stack sampling unavailable");
+    }
+
+    /* the next version takes over from here */
+    if ((serial_device.takeover_path || serial_device.takeover_fd >= 0) &&
+        takeover_listen(serial_device.takeover_path, serial_device.takeover_fd) == 0) {
+        printf("Takeover socket: %s\n", serial_device.takeover_path ? serial_device.takeover_path : "(inherited)");
+    }
+
+    /* the loop marks its stages; each mark is a no-op unless --jitter is given */
+    jitter_init(serial_device.jitter);
+    started = 1;
+    return 0;
+}
+
+/**
+ * @brief Report the descriptors to wait on and how long to wait at most.
+ *
+ * Readable descriptors mean received frames, finished worker jobs or a
+ * successor asking to take over.  A
+ * timeout of 0 means work is already waiting and endpoint_step() should be
+ * called without sleeping.
+ *
+ * @param fds - receives up to max entries, with events set to POLLIN.
+ * @param max - capacity of fds (ENDPOINT_MAX_POLLFDS covers every descriptor).
+ * @param timeout_ms - receives the longest the caller may wait before the next step.
+ * @return int Number of entries filled in.
+ */
+int endpoint_pollfds(struct pollfd* fds, int max, int* timeout_ms) {
+    int wait = ENDPOINT_IDLE_MS;
+    // inline, tty queue sampling happens when the loop reads the device
+    if (!pipeline_threaded()) {
+        int sample = ttyq_poll_timeout();
+        if (sample >= 0 && sample < wait) wait = sample;
+    }
+    // a connected successor that has not sent its request is given up on time
+    int pending = takeover_timeout();
+    if (pending >= 0 && pending < wait) wait = pending;
+    if (pipeline_wait_begin(wait)) wait = 0;
+    *timeout_ms = wait;
+
+    int wanted[] = { pipeline_wait_fd(), workpool_event_fd(), takeover_fd() };
+    int n = 0;
+    for (unsigned i = 0; i < sizeof wanted / sizeof wanted[0] && n < max; i++) {
+        if (wanted[i] < 0) continue;
+        fds[n].fd = wanted[i];
+        fds[n].events = POLLIN;
+        fds[n++].revents = 0;
+    }
+    return n;
+}
+
+/**
+ * @brief Run the I/O loop until nothing is ready or the budget is spent.
+ *
+ * @return int As endpoint_step().
+ */
+static int step() {
+    int dispatched = 0;
+
+    pipeline_wait_end();
+    if (takeover_poll()) return -1;
+    eidstate_service();
+    for (;;) {
+        int handled = 0;
+        jitter_loop_begin();
+
+        /* update the mctp framer state */
+        mctp_update();
+        jitter_mark(JITTER_UPDATE);
+
+        /* process_packet */
+        if (mctp_is_packet_available()) {
+            pipeline_dispatch_begin();
+            if (mctp_is_control_packet()) {
+                mctp_process_control_message();
+            }
+#ifdef PLDM_SUPPORT
+            else if (mctp_is_pldm_packet()) {
+                pldm_process_packet();
+            }
+#endif
+            else {
+                // non-control packet - drop packet
+                mctp_ignore_packet();
+            }
+            pipeline_dispatch_end();
+            jitter_mark(JITTER_DISPATCH);
+            handled = 1;
+        }
+
+        /* transmit responses produced by worker-pool handlers */
+        workpool_poll();
+        jitter_mark(JITTER_WORK);
+
+        /* latency dump/reset requested by SIGUSR1/SIGUSR2 */
+        latency_service(stdout);
+        jitter_service(stdout);
+        jitter_loop_end();
+
+        // a successor takes over the rest of the queue rather than waiting for it
+        if (handled && takeover_poll()) return -1;
+        if (!handled && !platform_serial_has_data()) return 0;
+        if (handled && ++dispatched >= ENDPOINT_STEP_BUDGET) return platform_serial_has_data() ? 1 : 0;
+    }
+}
+
+/**
+ * @brief Run the I/O loop until nothing is ready, without blocking.
+ *
+ * Each iteration feeds received bytes to the core, dispatches a complete
+ * packet, transmits finished worker jobs and serves signal-requested
+ * reports.  At most ENDPOINT_STEP_BUDGET packets are dispatched per call so
+ * that a busy link cannot starve the rest of the host's loop.  The first
+ * call also announces readiness, once a restored or inherited EID is in
+ * force.
+ *
+ * @return int 1 when work is still waiting (call again before sleeping), 0 when idle,
+ *             -1 when a successor is taking over (call endpoint_shutdown()).
+ */
+int endpoint_step() {
+    int ready = step();
+    if (!announced && ready >= 0 && serial_device.fd >= 0) {
+        uint8_t eid = 0, owner;
+        announced = 1;
+        pipeline_eid(&eid, &owner);
+        service_ready(serial_device.ready_fd, serial_device.path, eid);
+    }
+    return ready;
+}
+
+/**
+ * @brief Flush queued responses, report the counters and release everything.
+ *
+ * @return int 0, or -1 if a successor asked for the device and could not be
+ *             handed it; it then opens the device itself.
+ */
+int endpoint_shutdown() {
+    if (!started) return 0;
+    started = 0;
+
+    workpool_dump_stats(stdout);
+    workpool_shutdown();
+    watchdog_dump_stats(stdout);
+    watchdog_shutdown();
+    demux_stop();
+
+    // flush queued responses; a successor also gets what was received but not handled
+    if (!takeover_detach()) pipeline_stop();
+    txsched_dump_stats(stdout);
+    fairq_dump_stats(stdout);
+    ratelimit_dump_stats(stdout);
+    demux_dump_stats(stdout);
+    eidstate_dump_stats(stdout);
+    ctrltmpl_dump_stats(stdout);
+    replay_dump_stats(stdout);
+    admit_dump_stats(stdout);
+    latency_dump(stdout);
+    jitter_dump(stdout);
+    capture_close();
+    capture_dump_stats(stdout);
+    faultinj_dump_stats(stdout);
+    replay_free();
+    eidstate_close();
+    flight_close();
+    log_shutdown();
+    log_dump_stats(stdout);
+    stats_close();
+
+    // the device outlives this process if a successor took it
+    int handed = takeover_release(serial_device.fd, serial_device.path);
+    if (serial_device.fd != -1) {
+        close(serial_device.fd);
+        serial_device.fd = -1;
+    }
+    // a successor the device could not be handed to opens it once it is closed here
+    takeover_close();
+    return handed < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Ask for the latency and jitter histograms to be printed.
+ *
+ * Only flags the request, so it is safe to call from a signal handler; the
+ * next endpoint_step() prints them.
+ */
+void endpoint_request_dump() {
+    latency_request_dump();
+    jitter_request_dump();
+}
+
+/**
+ * @brief Ask for the latency and jitter histograms to be cleared.
+ *
+ * Safe to call from a signal handler, as endpoint_request_dump().
+ */
+void endpoint_request_reset() {
+    latency_request_reset();
+    jitter_request_reset();
+}
@@ -0,0 +1,240 @@
+/**
+ * @file fairq.c
+ * @brief Per-source receive queues served by deficit round robin.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fairq.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "frameq.h"
+
+/* charged for every packet, so packets that never reach a handler still take turns */
+#define FAIRQ_PACKET_NS 50000
+
+static frameq_t queues[FAIRQ_SOURCES];
+
+/* receive stage */
+static uint8_t source_of[256];      /* EID -> source + 1, 0 until first seen */
+static int sources_claimed = 0;
+static int producer_source = 0;     /* source of the slot returned by fairq_slot() */
+
+/* I/O thread */
+static int64_t deficit[FAIRQ_SOURCES];
+static int current = FAIRQ_SOURCES - 1;  /* source holding the turn */
+static int head_source = -1;        /* source of the frame returned by fairq_peek() */
+static int charged_source = -1;     /* source of the frame last popped */
+
+/**
+ * @brief Allocate one queue per source and forget previously seen EIDs.
+ *
+ * @param depth_per_source - frames each source may have queued.
+ * @return int 0 on success, -1 on allocation failure.
+ */
+int fairq_init(uint32_t depth_per_source) {
+    memset(queues, 0, sizeof queues);
+    for (int s = 0; s < FAIRQ_SOURCES; s++) {
+        if (frameq_init(&queues[s], depth_per_source) != 0) {
+            fairq_free();
+            return -1;
+        }
+    }
+    memset(source_of, 0, sizeof source_of);
+    memset(deficit, 0, sizeof deficit);
+    memset(endpoint_stats->sources, 0, sizeof endpoint_stats->sources);
+    sources_claimed = 0;
+    producer_source = 0;
+    current = FAIRQ_SOURCES - 1;
+    head_source = charged_source = -1;
+    return 0;
+}
+
+/**
+ * @brief Release the source queues.
+ */
+void fairq_free() {
+    for (int s = 0; s < FAIRQ_SOURCES; s++) frameq_free(&queues[s]);
+}
+
+/**
+ * @brief Receive stage: return the source a frame is queued and counted under.
+ *
+ * The first FAIRQ_SOURCES - 1 EIDs seen get a source of their own; later
+ * EIDs, and frames too damaged to show one, share the last.
+ *
+ * @param f - a received frame.
+ * @return int Source index.
+ */
+int fairq_source(const mctp_frame_t* f) {
+    int shared = FAIRQ_SOURCES - 1;
+    stats_source_t* slots = endpoint_stats->sources;
+    if (!mctp_frame_has_header(f)) {
+        __atomic_store_n(&slots[shared].used, 1, __ATOMIC_RELEASE);
+        return shared;
+    }
+
+    uint8_t eid = f->data[MCTP_OFF_SRC];
+    if (source_of[eid]) return source_of[eid] - 1;
+    int s = sources_claimed < shared ? sources_claimed++ : shared;
+    if (s != shared) slots[s].eid = eid;
+    __atomic_store_n(&slots[s].used, 1, __ATOMIC_RELEASE);
+    source_of[eid] = (uint8_t)(s + 1);
+    return s;
+}
+
+/**
+ * @brief Receive stage: return a free slot in the frame's source queue.
+ *
+ * @param f - the frame about to be queued.
+ * @return mctp_frame_t* Slot to fill, or NULL when that source's queue is full.
+ */
+mctp_frame_t* fairq_slot(const mctp_frame_t* f) {
+    producer_source = fairq_source(f);
+    return frameq_slot(&queues[producer_source]);
+}
+
+/**
+ * @brief Receive stage: publish the slot returned by fairq_slot().
+ */
+void fairq_commit() {
+    frameq_commit(&queues[producer_source]);
+    stats_add(&endpoint_stats->sources[producer_source].rx_packets, 1);
+}
+
+/**
+ * @brief I/O thread: return the next frame for the core.
+ *
+ * The source holding the turn keeps it while it has credit and frames.
+ * Otherwise the turn passes round the backlogged sources, each visit adding
+ * a quantum, until one is in credit; a source still in debt from a long
+ * handler is skipped for as many rounds as it takes to repay.
+ *
+ * @return mctp_frame_t* The frame, or NULL when nothing is queued.
+ */
+mctp_frame_t* fairq_peek() {
+    mctp_frame_t* f;
+    if (deficit[current] > 0 && (f = frameq_peek(&queues[current]))) {
+        head_source = current;
+        return f;
+    }
+
+    for (int pass = 0; pass <= FAIRQ_MAX_DEBT; pass++) {
+        int backlogged = 0;
+        for (int i = 1; i <= FAIRQ_SOURCES; i++) {
+            int s = (current + i) % FAIRQ_SOURCES;
+            if (!(f = frameq_peek(&queues[s]))) {
+                // an idle source keeps its debt but not its credit
+                if (deficit[s] > 0) deficit[s] = 0;
+                continue;
+            }
+            backlogged = 1;
+            deficit[s] += FAIRQ_QUANTUM_NS;
+            if (deficit[s] > 0) {
+                current = head_source = s;
+                return f;
+            }
+        }
+        if (!backlogged) break;
+    }
+    head_source = -1;
+    return NULL;
+}
+
+/**
+ * @brief I/O thread: release the frame returned by fairq_peek().
+ *
+ * @param t_start_ns - time the core began reading the frame.
+ */
+void fairq_pop(uint64_t t_start_ns) {
+    int s = head_source;
+    if (s < 0) return;
+    mctp_frame_t* f = frameq_peek(&queues[s]);
+    if (!f) return;
+
+    stats_source_t* st = &endpoint_stats->sources[s];
+    uint64_t delay = t_start_ns > f->t_done_ns ? t_start_ns - f->t_done_ns : 0;
+    stats_add(&st->served, 1);
+    stats_add(&st->queue_ns_total, delay);
+    if (delay > st->queue_ns_max) __atomic_store_n(&st->queue_ns_max, delay, __ATOMIC_RELAXED);
+    frameq_pop(&queues[s]);
+
+    head_source = -1;
+    charged_source = s;
+    deficit[s] -= FAIRQ_PACKET_NS;
+}
+
+/**
+ * @brief I/O thread: charge handler time to the source of the last popped frame.
+ *
+ * @param ns - time the handler ran.
+ */
+void fairq_charge(uint64_t ns) {
+    int s = charged_source;
+    if (s < 0) return;
+    stats_add(&endpoint_stats->sources[s].handler_ns, ns);
+    charged_source = -1;
+    const int64_t max_debt = (int64_t)(FAIRQ_MAX_DEBT * FAIRQ_QUANTUM_NS);
+    int64_t d = deficit[s] - (ns < (uint64_t)max_debt ? (int64_t)ns : max_debt);
+    deficit[s] = d < -max_debt ? -max_debt : d;
+}
+
+/**
+ * @brief Number of frames queued across all sources.
+ *
+ * @return uint32_t Queued frames.
+ */
+uint32_t fairq_count() {
+    uint32_t n = 0;
+    for (int s = 0; s < FAIRQ_SOURCES; s++) n += frameq_count(&queues[s]);
+    return n;
+}
+
+/**
+ * @brief Print per-source receive counters.
+ *
+ * @param out - stream to print to.
+ */
+void fairq_dump_stats(FILE* out) {
+    const stats_source_t* slots = endpoint_stats->sources;
+    fprintf(out, "Receive sources:\n");
+    fprintf(out, "  %-6s %10s %10s %8s %8s %12s %10s %10s\n", "eid", "packets", "served", "limited",
+            "shed", "handler-ms", "q-avg", "q-max");
+    for (int s = 0; s < FAIRQ_SOURCES; s++) {
+        const stats_source_t* st = &slots[s];
+        if (!st->used) continue;
+        char eid[8];
+        if (s == FAIRQ_SOURCES - 1) {
+            snprintf(eid, sizeof eid, "other");
+        } else {
+            snprintf(eid, sizeof eid, "%u", (unsigned)st->eid);
+        }
+        uint64_t n = st->served ? st->served : 1;
+        fprintf(out, "  %-6s %10llu %10llu %8llu %8llu %12.1f %8lluus %8lluus\n", eid,
+                (unsigned long long)st->rx_packets, (unsigned long long)st->served,
+                (unsigned long long)st->rate_limited, (unsigned long long)st->shed, st->handler_ns / 1e6,
+                (unsigned long long)(st->queue_ns_total / n / 1000),
+                (unsigned long long)(st->queue_ns_max / 1000));
+    }
+}
@@ -0,0 +1,340 @@
+/**
+ * @file faultinj.c
+ * @brief Seedable fault injection on the serial byte streams.
+ *
+ * Each direction is touched only by the stage that owns it (the receive
+ * thread for rx, the transmit thread or inline I/O loop for tx), so the
+ * generators and counters need no locking.  Every enabled fault draws from
+ * its direction's xorshift generator once per byte, which keeps the damage
+ * for a given seed independent of how reads and writes happen to be split.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "faultinj.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "mctp_serial.h"
+
+/* per-byte probabilities scaled to the generator's 64-bit range */
+typedef struct {
+    uint64_t flip;             /* at least one bit of the byte in error */
+    uint64_t drop;
+    uint64_t dup;
+    uint64_t flag;
+    uint64_t trunc;            /* per frame */
+    uint64_t delay;            /* per transmitted frame */
+} thresholds_t;
+
+typedef struct {
+    int enabled;
+    uint64_t rng;
+    unsigned frame_pos;        /* bytes since the last flag */
+    unsigned cut_at;           /* drop bytes after this position, 0 = frame kept whole */
+    uint64_t fault_ns;         /* first fault not yet followed by a good frame (rx) */
+    faultinj_stats_t stats;
+} dir_state_t;
+
+static thresholds_t th;
+static unsigned delay_max_us = FAULTINJ_DEFAULT_DELAY_US;
+static dir_state_t dirs[FAULTINJ_DIRECTIONS];
+
+/**
+ * @brief xorshift64* step for one direction.
+ *
+ * @param s - direction state.
+ * @return uint64_t Next value.
+ */
+static uint64_t next_random(dir_state_t* s) {
+    s->rng ^= s->rng >> 12;
+    s->rng ^= s->rng << 25;
+    s->rng ^= s->rng >> 27;
+    return s->rng * 0x2545F4914F6CDD1Dull;
+}
+
+/**
+ * @brief Draw one Bernoulli trial.
+ *
+ * Nothing is drawn for a disabled fault.
+ *
+ * @param s - direction state.
+ * @param threshold - scaled probability.
+ * @return int Non-zero if the fault happens.
+ */
+static int chance(dir_state_t* s, uint64_t threshold) {
+    return threshold && next_random(s) < threshold;
+}
+
+/**
+ * @brief Scale a probability to the generator's range.
+ *
+ * @param p - probability, clamped to [0, 1].
+ * @return uint64_t Threshold for chance().
+ */
+static uint64_t scale(double p) {
+    if (p <= 0) return 0;
+    if (p >= 1) return UINT64_MAX;
+    return (uint64_t)(p * 18446744073709551616.0);
+}
+
+/**
+ * @brief Remember when the first unrecovered receive fault happened.
+ *
+ * @param s - direction state.
+ */
+static void note_fault(dir_state_t* s) {
+    if (s == &dirs[FAULTINJ_RX] && !s->fault_ns) s->fault_ns = clock_now_ns();
+}
+
+/**
+ * @brief Parse a fault specification and enable injection.
+ *
+ * @param spec - comma separated key=value pairs (see faultinj.h); NULL or
+ *               empty leaves injection off.
+ * @return int 0 on success, -1 if the specification is malformed.
+ */
+int faultinj_init(const char* spec) {
+    double ber = 0, p_drop = 0, p_dup = 0, p_flag = 0, p_trunc = 0, p_delay = 0;
+    uint64_t seed = 1;
+    int use_rx = 1, use_tx = 1;
+
+    memset(&th, 0, sizeof th);
+    memset(dirs, 0, sizeof dirs);
+    if (!spec || !*spec) return 0;
+
+    char* copy = strdup(spec);
+    if (!copy) return -1;
+    int rc = 0;
+    for (char* save = NULL, *item = strtok_r(copy, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        char* eq = strchr(item, '=');
+        if (!eq) {
+            rc = -1;
+            break;
+        }
+        *eq++ = '\0';
+        char* end = NULL;
+        double v = strtod(eq, &end);
+        int numeric = end != eq && *end == '\0' && v >= 0;
+        if (strcmp(item, "dir") == 0) {
+            use_rx = strcmp(eq, "rx") == 0 || strcmp(eq, "both") == 0;
+            use_tx = strcmp(eq, "tx") == 0 || strcmp(eq, "both") == 0;
+            if (!use_rx && !use_tx) rc = -1;
+        } else if (!numeric) {
+            rc = -1;
+        } else if (strcmp(item, "ber") == 0) {
+            ber = v;
+        } else if (strcmp(item, "drop") == 0) {
+            p_drop = v;
+        } else if (strcmp(item, "dup") == 0) {
+            p_dup = v;
+        } else if (strcmp(item, "flag") == 0) {
+            p_flag = v;
+        } else if (strcmp(item, "trunc") == 0) {
+            p_trunc = v;
+        } else if (strcmp(item, "delay") == 0) {
+            p_delay = v;
+        } else if (strcmp(item, "delay-max") == 0) {
+            delay_max_us = v >= 1 ? (unsigned)v : 1;
+        } else if (strcmp(item, "seed") == 0) {
+            seed = strtoull(eq, NULL, 0);
+        } else {
+            rc = -1;
+        }
+        if (rc) break;
+    }
+    free(copy);
+    if (rc) return -1;
+
+    // probability that at least one of a byte's eight bits is flipped
+    double clean = 1;
+    for (int i = 0; i < 8; i++) clean *= 1 - (ber < 1 ? ber : 1);
+    th.flip = scale(1 - clean);
+    th.drop = scale(p_drop);
+    th.dup = scale(p_dup);
+    th.flag = scale(p_flag);
+    th.trunc = scale(p_trunc);
+    th.delay = scale(p_delay);
+
+    int any = th.flip || th.drop || th.dup || th.flag || th.trunc;
+    dirs[FAULTINJ_RX].enabled = use_rx && any;
+    dirs[FAULTINJ_TX].enabled = use_tx && (any || th.delay);
+    // distinct, never-zero streams per direction; every seed bit counts
+    dirs[FAULTINJ_RX].rng = seed ^ 0x9E3779B97F4A7C15ull;
+    dirs[FAULTINJ_TX].rng = seed ^ 0xD1B54A32D192ED03ull;
+    if (!dirs[FAULTINJ_RX].rng) dirs[FAULTINJ_RX].rng = 0x9E3779B97F4A7C15ull;
+    if (!dirs[FAULTINJ_TX].rng) dirs[FAULTINJ_TX].rng = 0xD1B54A32D192ED03ull;
+    return 0;
+}
+
+/**
+ * @brief Report whether a direction passes through the injector.
+ *
+ * @param dir - stream direction.
+ * @return int Non-zero when faults are injected on it.
+ */
+int faultinj_active(faultinj_dir_t dir) {
+    return dirs[dir].enabled;
+}
+
+/**
+ * @brief Copy bytes from in to out, damaging them as configured.
+ *
+ * Bytes that would not fit in out (duplicates and inserted flags can grow the
+ * stream) are passed through undamaged instead of being added.
+ *
+ * @param dir - stream direction.
+ * @param in - bytes as read from or about to be written to the device.
+ * @param len - number of bytes in in.
+ * @param out - destination.
+ * @param cap - capacity of out; at least len.
+ * @return size_t Number of bytes placed in out.
+ */
+size_t faultinj_apply(faultinj_dir_t dir, const uint8_t* in, size_t len, uint8_t* out, size_t cap) {
+    dir_state_t* s = &dirs[dir];
+    size_t n = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = in[i];
+        // room still needed for the rest of the input, one byte each
+        size_t spare = cap - n - (len - i);
+
+        if (chance(s, th.flag) && spare) {
+            out[n++] = MCTP_SERIAL_FLAG;
+            spare--;
+            s->stats.flags++;
+            note_fault(s);
+        }
+
+        if (b == MCTP_SERIAL_FLAG) {
+            s->frame_pos = 0;
+            s->cut_at = 0;
+        } else {
+            if (s->frame_pos++ == 0 && chance(s, th.trunc)) {
+                s->cut_at = 1 + (unsigned)(next_random(s) % FAULTINJ_MAX_CUT);
+            }
+            if (s->cut_at && s->frame_pos > s->cut_at) {
+                if (s->frame_pos == s->cut_at + 1) {
+                    s->stats.truncated++;
+                    note_fault(s);
+                }
+                s->stats.bytes++;
+                continue;
+            }
+        }
+
+        s->stats.bytes++;
+        if (chance(s, th.drop)) {
+            s->stats.dropped++;
+            note_fault(s);
+            continue;
+        }
+        if (chance(s, th.flip)) {
+            b ^= (uint8_t)(1u << (next_random(s) & 7));
+            s->stats.bit_errors++;
+            note_fault(s);
+        }
+        out[n++] = b;
+        if (chance(s, th.dup) && spare) {
+            out[n++] = b;
+            s->stats.duplicated++;
+            note_fault(s);
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Possibly hold up the frame about to be written (transmit stage).
+ */
+void faultinj_delay_write() {
+    dir_state_t* s = &dirs[FAULTINJ_TX];
+    if (!s->enabled || !chance(s, th.delay)) return;
+
+    unsigned us = 1 + (unsigned)(next_random(s) % delay_max_us);
+    s->stats.delays++;
+    s->stats.delay_us += us;
+    usleep(us);
+}
+
+/**
+ * @brief Account a received frame for resynchronization time.
+ *
+ * The first frame that passes its FCS after an injected fault ends the
+ * outage; frames failing in between are counted as damaged.
+ *
+ * @param ok - non-zero if the frame was received intact.
+ * @param t_first_ns - when the frame's opening flag was seen.
+ */
+void faultinj_rx_frame(int ok, uint64_t t_first_ns) {
+    dir_state_t* s = &dirs[FAULTINJ_RX];
+    if (!s->enabled || !s->fault_ns) return;
+    if (!ok) {
+        s->stats.damaged++;
+        return;
+    }
+    uint64_t ns = t_first_ns > s->fault_ns ? t_first_ns - s->fault_ns : 0;
+    s->stats.resyncs++;
+    s->stats.resync_ns_total += ns;
+    if (ns > s->stats.resync_ns_max) s->stats.resync_ns_max = ns;
+    s->fault_ns = 0;
+}
+
+/**
+ * @brief Copy one direction's counters.
+ *
+ * @param dir - stream direction.
+ * @param out - destination.
+ */
+void faultinj_get_stats(faultinj_dir_t dir, faultinj_stats_t* out) {
+    *out = dirs[dir].stats;
+}
+
+/**
+ * @brief Print the injection counters, if injection was enabled.
+ *
+ * @param out - destination stream.
+ */
+void faultinj_dump_stats(FILE* out) {
+    static const char* names[FAULTINJ_DIRECTIONS] = { "rx", "tx" };
+    for (int d = 0; d < FAULTINJ_DIRECTIONS; d++) {
+        const faultinj_stats_t* s = &dirs[d].stats;
+        if (!dirs[d].enabled) continue;
+        fprintf(out, "Fault injection %s: %llu bytes, %llu bit errors, %llu dropped, %llu duplicated, "
+                "%llu flags, %llu truncated",
+                names[d], (unsigned long long)s->bytes, (unsigned long long)s->bit_errors,
+                (unsigned long long)s->dropped, (unsigned long long)s->duplicated,
+                (unsigned long long)s->flags, (unsigned long long)s->truncated);
+        if (d == FAULTINJ_TX) {
+            fprintf(out, ", %llu delayed (%.1f ms)", (unsigned long long)s->delays, s->delay_us / 1e3);
+        }
+        fprintf(out, "\n");
+        if (d == FAULTINJ_RX && s->resyncs) {
+            fprintf(out, "  resync: %llu recoveries, mean %.1f us, max %.1f us, %llu frames damaged\n",
+                    (unsigned long long)s->resyncs, s->resync_ns_total / 1e3 / s->resyncs,
+                    s->resync_ns_max / 1e3, (unsigned long long)s->damaged);
+        }
+    }
+}
@@ -0,0 +1,266 @@
+/**
+ * @file flightrec.c
+ * @brief Crash-surviving flight recorder of recent frames and events.
+ *
+ * Writers on any thread claim a sequence number with one atomic increment
+ * and own the slot it maps to.  A slot's seq is cleared before its contents
+ * change and set afterwards, so a record torn by a crash is recognized and
+ * skipped by the reader.  On a clean shutdown the file is marked and kept;
+ * the file of an unnamed pty endpoint is removed instead, so test runs do not
+ * accumulate them.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "flightrec.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "log.h"
+
+/* records start on a cache line after the header */
+#define FLIGHT_HEADER_SIZE ((sizeof(flight_header_t) + 63) & ~(size_t)63)
+
+static flight_header_t* header = NULL;
+static flight_record_t* ring = NULL;
+static size_t map_len = 0;
+static char file_path[256] = "";
+static int remove_on_close = 0;
+
+/**
+ * @brief Build the default file path for a port, named like the statistics segment.
+ *
+ * @param port - serial device path, possibly empty for a simulated pty.
+ * @param out - destination buffer.
+ * @param len - size of out.
+ */
+static void default_path(const char* port, char* out, size_t len) {
+    char name[64];
+    if (!port || !port[0]) {
+        snprintf(name, sizeof name, "pty-%d", (int)getpid());
+    } else {
+        const char* base = strncmp(port, "/dev/", 5) == 0 ? port + 5 : port;
+        size_t i = 0;
+        for (; base[i] && i < sizeof name - 1; i++) {
+            name[i] = isalnum((unsigned char)base[i]) ? base[i] : '-';
+        }
+        name[i] = '\0';
+    }
+    snprintf(out, len, "%s/%s%s%s", FLIGHT_DIR, FLIGHT_PREFIX, name, FLIGHT_SUFFIX);
+}
+
+/**
+ * @brief Move aside the record of a run that did not exit cleanly.
+ *
+ * A recorder file whose header lacks the clean-exit mark is renamed to
+ * <path>.prev, replacing any older one, so a restart after a crash does not
+ * overwrite the frames that led up to it.
+ *
+ * @param path - recorder file about to be created.
+ */
+static void keep_unclean(const char* path) {
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1) return;
+    flight_header_t h;
+    struct stat st;
+    int unclean = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+                  pread(fd, &h, sizeof h, 0) == (ssize_t)sizeof h && h.magic == FLIGHT_MAGIC &&
+                  !h.clean_exit;
+    close(fd);
+    if (!unclean) return;
+
+    char prev[sizeof file_path + 8];
+    snprintf(prev, sizeof prev, "%s.prev", path);
+    if (rename(path, prev) == 0) {
+        LOG_WARN("flight recorder: run by pid %u did not exit cleanly; kept as %s", h.pid, prev);
+    } else {
+        LOG_ERROR("flight recorder: keep %s as %s: %m", path, prev);
+    }
+}
+
+/**
+ * @brief Create and map the flight recorder file.
+ *
+ * A file left by a clean exit is replaced; one left by a crash is kept as
+ * <path>.prev.  The file is never opened through a symlink, and an existing
+ * file that belongs to another user is left alone.
+ *
+ * @param path - file, NULL/empty for the default location, or "none" to record nothing.
+ * @param port - serial device path, used for the default name and the header.
+ * @param records - ring capacity.
+ * @return int 0 if the recorder is running, -1 otherwise.
+ */
+int flight_open(const char* path, const char* port, unsigned records) {
+    if (path && strcmp(path, "none") == 0) return -1;
+    if (records < 16) records = 16;
+    if (path && path[0]) {
+        snprintf(file_path, sizeof file_path, "%s", path);
+    } else {
+        default_path(port, file_path, sizeof file_path);
+        remove_on_close = !port || !port[0];
+    }
+
+    map_len = FLIGHT_HEADER_SIZE + (size_t)records * sizeof(flight_record_t);
+    keep_unclean(file_path);
+    int fd = open(file_path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644);
+    struct stat st;
+    if (fd != -1 && (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != geteuid())) {
+        close(fd);
+        fd = -1;
+        errno = EPERM;
+    }
+    if (fd == -1 || ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)map_len) != 0) {
+        LOG_ERROR("flight recorder %s: %m", file_path);
+        if (fd != -1) close(fd);
+        file_path[0] = '\0';
+        return -1;
+    }
+    void* p = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        LOG_ERROR("mmap %s: %m", file_path);
+        unlink(file_path);
+        file_path[0] = '\0';
+        return -1;
+    }
+
+    flight_header_t* h = p;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    h->version = FLIGHT_VERSION;
+    h->header_size = (uint32_t)FLIGHT_HEADER_SIZE;
+    h->record_size = sizeof(flight_record_t);
+    h->records = records;
+    h->pid = (uint32_t)getpid();
+    h->start_realtime_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    h->start_monotonic_ns = clock_now_ns();
+    snprintf(h->port, sizeof h->port, "%s", port && port[0] ? port : "(pty)");
+    __atomic_store_n(&h->magic, FLIGHT_MAGIC, __ATOMIC_RELEASE);
+
+    ring = (flight_record_t*)((uint8_t*)p + FLIGHT_HEADER_SIZE);
+    __atomic_store_n(&header, h, __ATOMIC_RELEASE);
+    flight_event(FLIGHT_START, h->pid);
+    return 0;
+}
+
+/**
+ * @brief Mark a clean shutdown and unmap the recorder.
+ */
+void flight_close() {
+    flight_header_t* h = header;
+    if (!h) return;
+    flight_event(FLIGHT_STOP, 0);
+    __atomic_store_n(&header, NULL, __ATOMIC_RELEASE);
+    h->clean_exit = 1;
+    munmap(h, map_len);
+    if (remove_on_close) unlink(file_path);
+    ring = NULL;
+    file_path[0] = '\0';
+}
+
+/**
+ * @brief Path of the recorder file, or an empty string if none is open.
+ *
+ * @return const char* The path.
+ */
+const char* flight_path() {
+    return file_path;
+}
+
+/**
+ * @brief Claim the next slot and invalidate it for writing.
+ *
+ * @param h - mapped header.
+ * @param seq - receives the record's sequence number.
+ * @return flight_record_t* The slot.
+ */
+static flight_record_t* claim(flight_header_t* h, uint64_t* seq) {
+    *seq = __atomic_add_fetch(&h->next, 1, __ATOMIC_RELAXED);
+    flight_record_t* r = &ring[(*seq - 1) % h->records];
+    __atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return r;
+}
+
+/**
+ * @brief Record a frame received or transmitted.
+ *
+ * @param type - FLIGHT_RX_FRAME or FLIGHT_TX_FRAME.
+ * @param f - the frame; its unescaped data is kept, up to FLIGHT_DATA_MAX bytes.
+ * @param t_ns - when the frame completed.
+ */
+void flight_frame(flight_type_t type, const mctp_frame_t* f, uint64_t t_ns) {
+    flight_data(type, f->status, f->data, f->len, t_ns);
+}
+
+/**
+ * @brief Record an event that carries data.
+ *
+ * Claiming a slot is lock-free, so this may be called from a signal handler.
+ *
+ * @param type - event type.
+ * @param arg - event argument, see flight_type_t.
+ * @param data - event data; up to FLIGHT_DATA_MAX bytes are kept.
+ * @param len - full length of the data.
+ * @param t_ns - when the event happened.
+ */
+void flight_data(flight_type_t type, uint32_t arg, const void* data, uint16_t len, uint64_t t_ns) {
+    flight_header_t* h = __atomic_load_n(&header, __ATOMIC_ACQUIRE);
+    if (!h) return;
+
+    uint64_t seq;
+    flight_record_t* r = claim(h, &seq);
+    uint16_t n = len < FLIGHT_DATA_MAX ? len : FLIGHT_DATA_MAX;
+    r->t_ns = t_ns;
+    r->type = (uint16_t)type;
+    r->len = len;
+    r->arg = arg;
+    memcpy(r->data, data, n);
+    __atomic_store_n(&r->seq, seq, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Record a state change.
+ *
+ * @param type - event type.
+ * @param arg - event argument, see flight_type_t.
+ */
+void flight_event(flight_type_t type, uint32_t arg) {
+    flight_header_t* h = __atomic_load_n(&header, __ATOMIC_ACQUIRE);
+    if (!h) return;
+
+    uint64_t seq;
+    flight_record_t* r = claim(h, &seq);
+    r->t_ns = clock_now_ns();
+    r->type = (uint16_t)type;
+    r->len = 0;
+    r->arg = arg;
+    __atomic_store_n(&r->seq, seq, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,59 @@
+/**
+ * @file frameq.c
+ * @brief Fixed-capacity single-producer/single-consumer queue of MCTP serial frames.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "frameq.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @brief Allocate the slots for a queue.
+ *
+ * @param q - the queue to initialize.
+ * @param capacity - requested capacity, rounded up to a power of two.
+ * @return int 0 on success, -1 if allocation failed.
+ */
+int frameq_init(frameq_t* q, uint32_t capacity) {
+    uint32_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    q->slots = calloc(cap, sizeof(mctp_frame_t));
+    if (!q->slots) return -1;
+    q->mask = cap - 1;
+    q->head = 0;
+    q->tail = 0;
+    return 0;
+}
+
+/**
+ * @brief Release the slots of a queue.
+ *
+ * @param q - the queue.
+ */
+void frameq_free(frameq_t* q) {
+    free(q->slots);
+    q->slots = NULL;
+    q->mask = 0;
+    q->head = q->tail = 0;
+}
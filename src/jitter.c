@@ -0,0 +1,265 @@
+/**
+ * @file jitter.c
+ * @brief Main-loop scheduling jitter monitor.
+ *
+ * Everything here runs on the I/O thread, so the histograms need no locking;
+ * only the dump and reset requests arrive from signal handlers, and those are
+ * flagged and carried out by jitter_service().  When the monitor is disabled
+ * every entry point returns after a single test, so the hooks can stay in
+ * the loop permanently.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "jitter.h"
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "clock.h"
+#include "latency.h"
+
+static int enabled = 0;
+static volatile sig_atomic_t reset_pending = 0;
+static volatile sig_atomic_t dump_pending = 0;
+
+static latency_hist_t hist[JITTER_STAGES];
+static jitter_trace_t trace[JITTER_TRACE_RECORDS];
+static unsigned trace_next = 0;   /* total maxima traced, oldest overwritten */
+
+static uint64_t iteration = 0;
+static uint64_t loop_start_ns = 0;
+static uint64_t mark_ns = 0;
+static uint64_t asleep_ns = 0;
+static uint64_t cur[JITTER_STAGES];    /* stage times of the iteration in progress */
+static uint64_t worst[JITTER_STAGES];  /* stage times of the slowest iteration */
+static uint64_t worst_t_ns = 0;
+static uint64_t worst_iteration = 0;
+
+static const char* stage_names[JITTER_STAGES] = {
+    "wake", "timer", "service", "update", "dispatch", "work", "loop"
+};
+
+/**
+ * @brief Add a sample to a stage, tracing it if it is a new maximum.
+ *
+ * @param stage - stage the sample belongs to.
+ * @param v - value in nanoseconds.
+ * @param now_ns - when the sample completed.
+ */
+static void add_sample(jitter_stage_t stage, uint64_t v, uint64_t now_ns) {
+    latency_hist_t* h = &hist[stage];
+    int new_max = v > h->max_ns;
+    latency_hist_add(h, v);
+    cur[stage] += v;
+    if (new_max) {
+        jitter_trace_t* t = &trace[trace_next++ % JITTER_TRACE_RECORDS];
+        t->t_ns = now_ns;
+        t->value_ns = v;
+        t->iteration = iteration;
+        t->stage = (uint8_t)stage;
+    }
+}
+
+/**
+ * @brief Turn the monitor on or off and clear it.
+ *
+ * @param on - non-zero to measure.
+ */
+void jitter_init(int on) {
+    enabled = on;
+    jitter_reset();
+}
+
+/**
+ * @brief Report whether the monitor is measuring.
+ *
+ * @return int Non-zero when enabled.
+ */
+int jitter_enabled() {
+    return enabled;
+}
+
+/**
+ * @brief Mark the start of an I/O loop iteration.
+ */
+void jitter_loop_begin() {
+    if (!enabled) return;
+    iteration++;
+    loop_start_ns = mark_ns = clock_now_ns();
+    asleep_ns = 0;
+    memset(cur, 0, sizeof cur);
+}
+
+/**
+ * @brief Charge the time since the previous mark to a loop stage.
+ *
+ * @param stage - the stage that just finished.
+ */
+void jitter_mark(jitter_stage_t stage) {
+    if (!enabled) return;
+    uint64_t now = clock_now_ns();
+    add_sample(stage, now - mark_ns, now);
+    mark_ns = now;
+}
+
+/**
+ * @brief Note that the time since the previous mark was spent asleep.
+ *
+ * Sleeping is not loop work, so it is left out of the iteration time.
+ */
+void jitter_sleep() {
+    if (!enabled) return;
+    uint64_t now = clock_now_ns();
+    asleep_ns += now - mark_ns;
+    mark_ns = now;
+}
+
+/**
+ * @brief Mark the end of an I/O loop iteration.
+ */
+void jitter_loop_end() {
+    if (!enabled) return;
+    uint64_t now = clock_now_ns();
+    uint64_t busy = now - loop_start_ns - asleep_ns;
+    add_sample(JITTER_LOOP, busy, now);
+    if (busy >= worst[JITTER_LOOP]) {
+        memcpy(worst, cur, sizeof worst);
+        worst_t_ns = now;
+        worst_iteration = iteration;
+    }
+}
+
+/**
+ * @brief Record an interval measured outside the loop marks.
+ *
+ * @param stage - JITTER_WAKE, JITTER_TIMER or JITTER_SERVICE.
+ * @param start_ns - when the data became readable (or the wait should have ended).
+ * @param end_ns - when the I/O loop got to it.
+ */
+void jitter_record(jitter_stage_t stage, uint64_t start_ns, uint64_t end_ns) {
+    if (!enabled || !start_ns) return;
+    add_sample(stage, end_ns > start_ns ? end_ns - start_ns : 0, end_ns);
+}
+
+/**
+ * @brief Clear the histograms, the trace and the worst iteration.
+ */
+void jitter_reset() {
+    memset(hist, 0, sizeof hist);
+    memset(trace, 0, sizeof trace);
+    memset(worst, 0, sizeof worst);
+    trace_next = 0;
+    worst_t_ns = 0;
+    worst_iteration = 0;
+}
+
+/**
+ * @brief Ask for a reset from a signal handler.
+ */
+void jitter_request_reset() {
+    reset_pending = 1;
+}
+
+/**
+ * @brief Ask for a dump from a signal handler.
+ */
+void jitter_request_dump() {
+    dump_pending = 1;
+}
+
+/**
+ * @brief Carry out dump and reset requests; called from the I/O loop.
+ *
+ * @param out - destination for a requested dump.
+ */
+void jitter_service(FILE* out) {
+    if (dump_pending) {
+        dump_pending = 0;
+        jitter_dump(out);
+    }
+    if (reset_pending) {
+        reset_pending = 0;
+        jitter_reset();
+    }
+}
+
+/**
+ * @brief Format a monotonic timestamp as local wall-clock time.
+ *
+ * @param buf - destination.
+ * @param len - size of buf.
+ * @param mono_ns - CLOCK_MONOTONIC time.
+ * @return const char* buf.
+ */
+static const char* wall_time(char* buf, size_t len, uint64_t mono_ns) {
+    struct timespec rt;
+    clock_gettime(CLOCK_REALTIME, &rt);
+    uint64_t real_ns = (uint64_t)rt.tv_sec * 1000000000ull + (uint64_t)rt.tv_nsec;
+    real_ns -= clock_now_ns() - mono_ns;
+
+    time_t sec = (time_t)(real_ns / 1000000000ull);
+    struct tm tm;
+    localtime_r(&sec, &tm);
+    size_t n = strftime(buf, len, "%H:%M:%S", &tm);
+    snprintf(buf + n, len - n, ".%06llu", (unsigned long long)(real_ns % 1000000000ull / 1000));
+    return buf;
+}
+
+/**
+ * @brief Print the histograms, the worst iteration and the maxima trace.
+ *
+ * @param out - destination.
+ */
+void jitter_dump(FILE* out) {
+    if (!enabled) return;
+    char when[32];
+
+    fprintf(out, "Main loop jitter (us), %llu iterations:\n", (unsigned long long)iteration);
+    fprintf(out, "  %-9s %10s %9s %9s %9s %9s %9s\n", "stage", "count", "mean", "p50", "p99", "p99.9", "max");
+    for (int s = 0; s < JITTER_STAGES; s++) {
+        const latency_hist_t* h = &hist[s];
+        fprintf(out, "  %-9s %10llu %9.1f %9.1f %9.1f %9.1f %9.1f\n", stage_names[s],
+                (unsigned long long)h->count, h->count ? (double)h->sum_ns / (double)h->count / 1000.0 : 0.0,
+                latency_percentile(h, 50.0) / 1000.0, latency_percentile(h, 99.0) / 1000.0,
+                latency_percentile(h, 99.9) / 1000.0, h->max_ns / 1000.0);
+    }
+
+    if (worst_iteration) {
+        fprintf(out, "  slowest iteration %llu at %s: %.1f us busy (",
+                (unsigned long long)worst_iteration, wall_time(when, sizeof when, worst_t_ns),
+                worst[JITTER_LOOP] / 1000.0);
+        for (int s = 0; s < JITTER_LOOP; s++) {
+            fprintf(out, "%s%s %.1f", s ? ", " : "", stage_names[s], worst[s] / 1000.0);
+        }
+        fprintf(out, ")\n");
+    }
+
+    unsigned n = trace_next < JITTER_TRACE_RECORDS ? trace_next : JITTER_TRACE_RECORDS;
+    if (n) fprintf(out, "  new maxima, oldest first:\n");
+    for (unsigned i = trace_next - n; i != trace_next; i++) {
+        const jitter_trace_t* t = &trace[i % JITTER_TRACE_RECORDS];
+        fprintf(out, "    %s  iteration %-10llu %-9s %10.1f\n", wall_time(when, sizeof when, t->t_ns),
+                (unsigned long long)t->iteration, stage_names[t->stage], t->value_ns / 1000.0);
+    }
+    fflush(out);
+}
@@ -0,0 +1,275 @@
+/**
+ * @file latency.c
+ * @brief Fixed-memory log-linear latency histograms per MCTP command.
+ *
+ * Responses are recorded by whichever thread writes them to the device.  The
+ * histograms sit in the shared statistics segment and every update is wrapped
+ * in the segment's seqlock so that an external reader never sees a sample
+ * counted in one phase but not yet in another.  Dump and reset requests may
+ * come from signal handlers; they are only flagged there and carried out by
+ * latency_service() on the I/O thread.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "latency.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t reset_pending = 0;
+static volatile sig_atomic_t dump_pending = 0;
+static latency_table_t snapshot;   /* copy printed by latency_dump() */
+
+static const char* phase_names[LATENCY_PHASES] = { "rx", "queue", "handler", "tx", "total" };
+
+/**
+ * @brief Map a value to its histogram bucket.
+ *
+ * Values below LATENCY_SUB_BUCKETS have a bucket each; above that every power
+ * of two is split into LATENCY_SUB_BUCKETS equal parts.
+ *
+ * @param v - value in nanoseconds.
+ * @return unsigned Bucket index.
+ */
+static unsigned bucket_index(uint64_t v) {
+    if (v >= (1ull << LATENCY_MAX_BITS)) v = (1ull << LATENCY_MAX_BITS) - 1;
+    if (v < LATENCY_SUB_BUCKETS) return (unsigned)v;
+    unsigned msb = 63 - (unsigned)__builtin_clzll(v);
+    unsigned shift = msb - LATENCY_SUB_BITS;
+    return (msb - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS +
+           (unsigned)((v >> shift) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+/**
+ * @brief Return the largest value that falls in a bucket.
+ *
+ * @param idx - bucket index.
+ * @return uint64_t Upper bound of the bucket in nanoseconds.
+ */
+static uint64_t bucket_upper(unsigned idx) {
+    if (idx < LATENCY_SUB_BUCKETS) return idx;
+    unsigned shift = idx / LATENCY_SUB_BUCKETS - 1;
+    uint64_t low = (uint64_t)(LATENCY_SUB_BUCKETS + idx % LATENCY_SUB_BUCKETS) << shift;
+    return low + (1ull << shift) - 1;
+}
+
+/**
+ * @brief Add one value to a histogram.
+ *
+ * @param h - the histogram.
+ * @param v - value in nanoseconds.
+ */
+void latency_hist_add(latency_hist_t* h, uint64_t v) {
+    h->count++;
+    h->sum_ns += v;
+    if (v > h->max_ns) h->max_ns = v;
+    h->buckets[bucket_index(v)]++;
+}
+
+/**
+ * @brief Find or claim the slot for a request's command.
+ *
+ * @param table - histogram table.
+ * @param t - request timing and identity.
+ * @return latency_slot_t* The slot; the overflow slot once the table is full.
+ */
+static latency_slot_t* find_slot(latency_table_t* table, const mctp_req_timing_t* t) {
+    uint8_t pldm_type = t->msg_type == MCTP_MSG_TYPE_PLDM ? t->pldm_type : 0;
+    for (unsigned i = 0; i < LATENCY_SLOTS - 1; i++) {
+        latency_slot_t* s = &table->slot[i];
+        if (!s->used) {
+            s->msg_type = t->msg_type;
+            s->pldm_type = pldm_type;
+            s->cmd = t->cmd;
+            s->used = 1;
+            return s;
+        }
+        if (s->msg_type == t->msg_type && s->pldm_type == pldm_type && s->cmd == t->cmd) return s;
+    }
+    latency_slot_t* other = &table->slot[LATENCY_SLOTS - 1];
+    other->used = 1;
+    other->msg_type = LATENCY_SLOT_OTHER;
+    return other;
+}
+
+/**
+ * @brief Return b - a, or zero if the stamps are out of order or missing.
+ *
+ * @param a - earlier stamp.
+ * @param b - later stamp.
+ * @return uint64_t Elapsed nanoseconds.
+ */
+static uint64_t elapsed(uint64_t a, uint64_t b) {
+    return (a && b > a) ? b - a : 0;
+}
+
+/**
+ * @brief Record the phases of one answered request.
+ *
+ * @param t - timing carried by the last frame of the response.
+ * @param sent_ns - time the last byte of the response was written.
+ */
+void latency_record(const mctp_req_timing_t* t, uint64_t sent_ns) {
+    if (!t->valid) return;
+
+    uint64_t v[LATENCY_PHASES];
+    v[LATENCY_RX] = elapsed(t->rx_first_ns, t->rx_done_ns);
+    v[LATENCY_QUEUE] = elapsed(t->rx_done_ns, t->start_ns);
+    v[LATENCY_HANDLER] = elapsed(t->start_ns, t->end_ns);
+    v[LATENCY_TX] = elapsed(t->end_ns, sent_ns);
+    v[LATENCY_TOTAL] = elapsed(t->rx_first_ns, sent_ns);
+
+    pthread_mutex_lock(&lock);
+    endpoint_stats_t* s = endpoint_stats;
+    stats_write_begin(s);
+    latency_slot_t* slot = find_slot(&s->latency, t);
+    for (int p = 0; p < LATENCY_PHASES; p++) latency_hist_add(&slot->phase[p], v[p]);
+    stats_write_end(s);
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Clear every histogram.
+ */
+void latency_reset() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    pthread_mutex_lock(&lock);
+    endpoint_stats_t* s = endpoint_stats;
+    stats_write_begin(s);
+    memset(s->latency.slot, 0, sizeof s->latency.slot);
+    s->latency.reset_realtime_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    stats_write_end(s);
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Ask for a reset from a signal handler.
+ */
+void latency_request_reset() {
+    reset_pending = 1;
+}
+
+/**
+ * @brief Ask for a dump from a signal handler.
+ */
+void latency_request_dump() {
+    dump_pending = 1;
+}
+
+/**
+ * @brief Carry out dump and reset requests flagged by signal handlers.
+ *
+ * A dump requested together with a reset is printed first.
+ *
+ * @param out - destination for dumps.
+ */
+void latency_service(FILE* out) {
+    if (dump_pending) {
+        dump_pending = 0;
+        latency_dump(out);
+    }
+    if (reset_pending) {
+        reset_pending = 0;
+        latency_reset();
+    }
+}
+
+/**
+ * @brief Return the value at a percentile of a histogram.
+ *
+ * The result is the upper bound of the bucket holding the percentile, never
+ * more than the largest value recorded.
+ *
+ * @param h - the histogram.
+ * @param pct - percentile, 0..100.
+ * @return uint64_t Value in nanoseconds, 0 for an empty histogram.
+ */
+uint64_t latency_percentile(const latency_hist_t* h, double pct) {
+    if (!h->count) return 0;
+    uint64_t target = (uint64_t)((double)h->count * pct / 100.0 + 0.999999);
+    if (target < 1) target = 1;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= target) {
+            uint64_t v = bucket_upper(i);
+            return v < h->max_ns ? v : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+/**
+ * @brief Print the histograms of a table as a percentile summary.
+ *
+ * @param out - destination.
+ * @param table - histogram table, e.g. a snapshot of the statistics segment.
+ */
+void latency_print(FILE* out, const latency_table_t* table) {
+    fprintf(out, "Response latency (us):\n");
+    fprintf(out, "  %-18s %-8s %10s %9s %9s %9s %9s %9s\n",
+            "message", "phase", "count", "mean", "p50", "p99", "p99.9", "max");
+    for (unsigned i = 0; i < LATENCY_SLOTS; i++) {
+        const latency_slot_t* s = &table->slot[i];
+        if (!s->used || !s->phase[LATENCY_TOTAL].count) continue;
+
+        char name[24];
+        if (s->msg_type == LATENCY_SLOT_OTHER) {
+            snprintf(name, sizeof name, "other");
+        } else if (s->msg_type == MCTP_MSG_TYPE_CONTROL) {
+            snprintf(name, sizeof name, "control 0x%02x", s->cmd);
+        } else if (s->msg_type == MCTP_MSG_TYPE_PLDM) {
+            snprintf(name, sizeof name, "pldm 0x%02x/0x%02x", s->pldm_type, s->cmd);
+        } else {
+            snprintf(name, sizeof name, "type 0x%02x", s->msg_type);
+        }
+
+        for (int p = 0; p < LATENCY_PHASES; p++) {
+            const latency_hist_t* h = &s->phase[p];
+            fprintf(out, "  %-18s %-8s %10llu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                    p == 0 ? name : "", phase_names[p], (unsigned long long)h->count,
+                    h->count ? (double)h->sum_ns / (double)h->count / 1000.0 : 0.0,
+                    latency_percentile(h, 50.0) / 1000.0, latency_percentile(h, 99.0) / 1000.0,
+                    latency_percentile(h, 99.9) / 1000.0, h->max_ns / 1000.0);
+        }
+    }
+}
+
+/**
+ * @brief Print a consistent snapshot of the endpoint's histograms.
+ *
+ * @param out - destination.
+ */
+void latency_dump(FILE* out) {
+    pthread_mutex_lock(&lock);
+    memcpy(&snapshot, &endpoint_stats->latency, sizeof snapshot);
+    pthread_mutex_unlock(&lock);
+    latency_print(out, &snapshot);
+    fflush(out);
+}
@@ -0,0 +1,454 @@
+/**
+ * @file log.c
+ * @brief Asynchronous logger that keeps formatting and console I/O off the I/O path.
+ *
+ * Every thread that logs gets its own single-producer ring, registered once
+ * on a lock-free list.  The flusher thread merges the rings in timestamp
+ * order, formats each record from its binary arguments and writes errors
+ * and warnings to stderr, everything else to stdout.  Outside the flusher's
+ * lifetime (before log_init() and after log_shutdown()) records are written
+ * out by the caller as soon as they are committed.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+#include "log.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "clock.h"
+
+typedef struct log_ring {
+    uint64_t head;             /* next record to write out, owned by the flusher */
+    uint64_t tail;             /* next free record, owned by the producing thread */
+    uint64_t dropped;          /* written by the producing thread only */
+    int tid;
+    struct log_ring* next;
+    log_record_t rec[LOG_RING_RECORDS];
+} log_ring_t;
+
+static const char* level_names[LOG_LEVELS] = { "ERROR", "WARN", "INFO" };
+
+static __thread log_ring_t* my_ring = NULL;
+static __thread int last_logged = 0;   /* whether this thread's last rate-limited record got through */
+static log_ring_t* rings = NULL;            /* push-only list */
+static pthread_mutex_t flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cv;
+static pthread_t flusher;
+static int flusher_running = 0;
+static int stopping = 0;
+static uint64_t epoch_ns = 0;
+static uint64_t written = 0;
+static uint64_t suppressed_total = 0;
+
+/**
+ * @brief Return the calling thread's ring, creating it on first use.
+ *
+ * @return log_ring_t* The ring, or NULL if it could not be allocated.
+ */
+static log_ring_t* this_ring() {
+    if (my_ring) return my_ring;
+    log_ring_t* r = calloc(1, sizeof *r);
+    if (!r) return NULL;
+    r->tid = (int)syscall(SYS_gettid);
+    r->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&rings, &r->next, r, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    my_ring = r;
+    return r;
+}
+
+/**
+ * @brief Apply a call site's rate limit.
+ *
+ * @param s - the call site.
+ * @param now - current time.
+ * @return int Non-zero if the record may be logged.
+ */
+static int rate_ok(log_site_t* s, uint64_t now) {
+    uint64_t start = __atomic_load_n(&s->window_ns, __ATOMIC_RELAXED);
+    if (now - start >= (uint64_t)LOG_RATE_WINDOW_MS * 1000000ull &&
+        __atomic_compare_exchange_n(&s->window_ns, &start, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&s->count, 0, __ATOMIC_RELAXED);
+    }
+    if (__atomic_add_fetch(&s->count, 1, __ATOMIC_RELAXED) <= LOG_RATE_LIMIT) return 1;
+    __atomic_add_fetch(&s->suppressed, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&suppressed_total, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/**
+ * @brief Reserve a record in the calling thread's ring.
+ *
+ * errno is preserved, so the arguments may still refer to it.  A LOG_CONT
+ * site follows the fate of the thread's previous record instead of its own
+ * rate limit.
+ *
+ * @param site - the call site.
+ * @return log_record_t* The record to fill in, or NULL if it is rate limited or the ring is full.
+ */
+log_record_t* log_begin(log_site_t* site) {
+    int err = errno;
+    uint64_t now = clock_now_ns();
+    log_record_t* rec = NULL;
+
+    int allowed;
+    if (site->continued) {
+        allowed = last_logged;
+        if (!allowed) __atomic_add_fetch(&suppressed_total, 1, __ATOMIC_RELAXED);
+    } else {
+        allowed = rate_ok(site, now);
+    }
+    log_ring_t* r = allowed ? this_ring() : NULL;
+    if (r) {
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        if (r->tail - head >= LOG_RING_RECORDS) {
+            __atomic_store_n(&r->dropped, r->dropped + 1, __ATOMIC_RELAXED);
+        } else {
+            rec = &r->rec[r->tail % LOG_RING_RECORDS];
+            rec->site = site;
+            rec->t_ns = now;
+            rec->err = err;
+            rec->nargs = 0;
+            rec->str_len = 0;
+            rec->suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+        }
+    }
+    if (!site->continued) last_logged = rec != NULL;
+    errno = err;
+    return rec;
+}
+
+/**
+ * @brief Publish a record filled in after log_begin().
+ *
+ * @param rec - the record.
+ */
+void log_commit(log_record_t* rec) {
+    (void)rec;
+    log_ring_t* r = my_ring;
+    __atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+    if (!__atomic_load_n(&flusher_running, __ATOMIC_ACQUIRE)) log_flush();
+}
+
+/**
+ * @brief Read argument i of a record as an integer, whatever it was packed as.
+ *
+ * @param r - the record.
+ * @param i - argument index.
+ * @return uint64_t The value.
+ */
+static uint64_t arg_int(const log_record_t* r, unsigned i) {
+    if (r->type[i] == LOG_ARG_DOUBLE) {
+        double d;
+        memcpy(&d, &r->arg[i], sizeof d);
+        return (uint64_t)(int64_t)d;
+    }
+    return r->arg[i];
+}
+
+/**
+ * @brief Read argument i of a record as a double.
+ *
+ * @param r - the record.
+ * @param i - argument index.
+ * @return double The value.
+ */
+static double arg_double(const log_record_t* r, unsigned i) {
+    double d;
+    if (r->type[i] == LOG_ARG_DOUBLE) {
+        memcpy(&d, &r->arg[i], sizeof d);
+    } else if (r->type[i] == LOG_ARG_INT) {
+        d = (double)(int64_t)r->arg[i];
+    } else {
+        d = (double)r->arg[i];
+    }
+    return d;
+}
+
+/**
+ * @brief Expand a record's format string with its packed arguments.
+ *
+ * Each conversion is handed to snprintf on its own, with the length
+ * modifier replaced to match how the argument was packed.
+ *
+ * @param r - the record.
+ * @param out - destination buffer.
+ * @param len - size of out.
+ */
+static void format_message(const log_record_t* r, char* out, size_t len) {
+    const char* f = r->site->fmt;
+    size_t n = 0;
+    unsigned ai = 0;
+
+    while (*f && n + 1 < len) {
+        if (*f != '%') {
+            out[n++] = *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            out[n++] = '%';
+            f += 2;
+            continue;
+        }
+        if (f[1] == 'm') {
+            char buf[128];
+            n += (size_t)snprintf(out + n, len - n, "%s", strerror_r(r->err, buf, sizeof buf));
+            f += 2;
+            if (n >= len) n = len - 1;
+            continue;
+        }
+
+        char spec[24];
+        size_t k = 0;
+        spec[k++] = *f++;
+        while (*f && strchr("-+ #0123456789.", *f) && k < sizeof spec - 4) spec[k++] = *f++;
+        while (*f && strchr("hlLqjzt", *f)) f++;
+        char conv = *f;
+        if (conv) f++;
+        if (ai >= r->nargs) {
+            n += (size_t)snprintf(out + n, len - n, "?");
+            if (n >= len) n = len - 1;
+            continue;
+        }
+
+        int w;
+        unsigned i = ai++;
+        switch (conv) {
+        case 'd':
+        case 'i':
+            spec[k++] = 'l';
+            spec[k++] = 'l';
+            spec[k++] = conv;
+            spec[k] = '\0';
+            w = snprintf(out + n, len - n, spec, (long long)arg_int(r, i));
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            spec[k++] = 'l';
+            spec[k++] = 'l';
+            spec[k++] = conv;
+            spec[k] = '\0';
+            w = snprintf(out + n, len - n, spec, (unsigned long long)arg_int(r, i));
+            break;
+        case 'c':
+            spec[k++] = conv;
+            spec[k] = '\0';
+            w = snprintf(out + n, len - n, spec, (int)arg_int(r, i));
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            spec[k++] = conv;
+            spec[k] = '\0';
+            w = snprintf(out + n, len - n, spec, arg_double(r, i));
+            break;
+        case 's':
+            spec[k++] = conv;
+            spec[k] = '\0';
+            w = snprintf(out + n, len - n, spec,
+                         r->type[i] == LOG_ARG_STR && r->arg[i] < LOG_STR_MAX ? &r->str[r->arg[i]] : "?");
+            break;
+        case 'p':
+            spec[k++] = conv;
+            spec[k] = '\0';
+            w = snprintf(out + n, len - n, spec, (void*)(uintptr_t)r->arg[i]);
+            break;
+        default:
+            w = snprintf(out + n, len - n, "?");
+            break;
+        }
+        if (w > 0) n += (size_t)w;
+        if (n >= len) n = len - 1;
+    }
+    out[n] = '\0';
+}
+
+/**
+ * @brief Format one record and write it to its stream.
+ *
+ * @param r - the record.
+ * @param tid - thread that logged it.
+ */
+static void write_record(const log_record_t* r, int tid) {
+    char msg[512];
+    const log_site_t* s = r->site;
+    const char* file = strrchr(s->file, '/');
+    file = file ? file + 1 : s->file;
+
+    format_message(r, msg, sizeof msg);
+    FILE* out = s->level <= LOG_LEVEL_WARN ? stderr : stdout;
+    uint64_t t = r->t_ns > epoch_ns ? r->t_ns - epoch_ns : 0;
+    fprintf(out, "[%5llu.%06llu] %-5s %s:%d [%d] %s", (unsigned long long)(t / 1000000000ull),
+            (unsigned long long)(t % 1000000000ull / 1000), level_names[s->level], file, s->line, tid, msg);
+    if (r->suppressed) fprintf(out, " (%u similar suppressed)", r->suppressed);
+    fputc('\n', out);
+}
+
+/**
+ * @brief Write out every committed record, oldest first across all threads.
+ */
+void log_flush() {
+    pthread_mutex_lock(&flush_lock);
+    if (!epoch_ns) epoch_ns = clock_now_ns();
+    uint64_t n = 0;
+    for (;;) {
+        log_ring_t* oldest = NULL;
+        uint64_t oldest_ns = 0;
+        for (log_ring_t* r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+            uint64_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+            if (r->head == tail) continue;
+            uint64_t t = r->rec[r->head % LOG_RING_RECORDS].t_ns;
+            if (!oldest || t < oldest_ns) {
+                oldest = r;
+                oldest_ns = t;
+            }
+        }
+        if (!oldest) break;
+        write_record(&oldest->rec[oldest->head % LOG_RING_RECORDS], oldest->tid);
+        __atomic_store_n(&oldest->head, oldest->head + 1, __ATOMIC_RELEASE);
+        n++;
+    }
+    if (n) {
+        fflush(stdout);
+        fflush(stderr);
+        __atomic_add_fetch(&written, n, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&flush_lock);
+}
+
+/**
+ * @brief Flusher thread: write out the rings every LOG_FLUSH_MS until stopped.
+ *
+ * @param unused - required by the pthread signature.
+ * @return void* Always NULL.
+ */
+static void* flusher_main(void* unused) {
+    (void)unused;
+    pthread_mutex_lock(&wake_lock);
+    while (!stopping) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_nsec += LOG_FLUSH_MS * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&wake_cv, &wake_lock, &ts);
+        pthread_mutex_unlock(&wake_lock);
+        log_flush();
+        pthread_mutex_lock(&wake_lock);
+    }
+    pthread_mutex_unlock(&wake_lock);
+    return NULL;
+}
+
+/**
+ * @brief Start the flusher thread.
+ *
+ * Records logged earlier have already been written synchronously.
+ *
+ * @return int 0 on success, -1 if the thread could not be started (logging stays synchronous).
+ */
+int log_init() {
+    if (flusher_running) return 0;
+    pthread_mutex_lock(&flush_lock);
+    if (!epoch_ns) epoch_ns = clock_now_ns();
+    pthread_mutex_unlock(&flush_lock);
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wake_cv, &attr);
+    pthread_condattr_destroy(&attr);
+
+    // process signals stay with the I/O thread
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    stopping = 0;
+    int err = pthread_create(&flusher, NULL, flusher_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    __atomic_store_n(&flusher_running, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * @brief Stop the flusher thread and write out whatever is left.
+ */
+void log_shutdown() {
+    if (flusher_running) {
+        pthread_mutex_lock(&wake_lock);
+        stopping = 1;
+        pthread_cond_signal(&wake_cv);
+        pthread_mutex_unlock(&wake_lock);
+        pthread_join(flusher, NULL);
+        __atomic_store_n(&flusher_running, 0, __ATOMIC_RELEASE);
+    }
+    log_flush();
+}
+
+/**
+ * @brief Copy the logger counters.
+ *
+ * @param out - destination.
+ */
+void log_get_stats(log_stats_t* out) {
+    memset(out, 0, sizeof *out);
+    out->records = __atomic_load_n(&written, __ATOMIC_RELAXED);
+    out->suppressed = __atomic_load_n(&suppressed_total, __ATOMIC_RELAXED);
+    for (log_ring_t* r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        out->dropped += __atomic_load_n(&r->dropped, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Print the logger counters, if anything was lost or suppressed.
+ *
+ * @param out - destination stream.
+ */
+void log_dump_stats(FILE* out) {
+    log_stats_t s;
+    log_get_stats(&s);
+    if (!s.dropped && !s.suppressed) return;
+    fprintf(out, "Log: %llu records written, %llu dropped (ring full), %llu suppressed (rate limit)\n",
+            (unsigned long long)s.records, (unsigned long long)s.dropped, (unsigned long long)s.suppressed);
+}
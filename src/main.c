@@ -28,6 +28,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <poll.h>
 #include <sys/stat.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -37,33 +38,55 @@
 #include <termios.h>
 #include <unistd.h>
 
+#include "admit.h"
+#include "capture.h"
+#include "eidstate.h"
+#include "endpoint.h"
+#include "flightrec.h"
 #include "config.h"
+#include "log.h"
+#include "pipeline.h"
+#include "replay.h"
+#include "service.h"
+#include "stats.h"
+#include "ttyq.h"
+#include "watchdog.h"
+#include "workpool.h"
 
-#include "core/mctp.h"
-#include "core/platform.h"
+// options parsed from the command line
+static config_t config;
 
-#ifdef PLDM_SUPPORT
-#include "core/pldm_version.h"
-#endif
-
-// our configuration structure
-config_t serial_device = {
-    .baud = 115200,
-    .hwflow = 0,
-    .path = "",
-    .fd = -1
-};
+// exit status when a --takeover successor could not be handed the device
+#define EXIT_HANDOVER_FAILED 3
 
 /*
  * @brief Handle signals (e.g., SIGINT, SIGTERM) by setting the interrupted flag.
  *
+ * Only the signal number is recorded; the main loop reports it, since
+ * printing from a signal handler is not async-signal-safe.
+ *
  * @param signum  Signal number received.
  * @return void
  */
-static volatile int interrupted = 0;
+static volatile sig_atomic_t interrupted = 0;
 void signalHandler(int signum) {
-    printf("\nCaught signal %d, cleaning up...\n", signum);
-    interrupted = 1;
+    interrupted = signum;
+}
+
+/*
+ * @brief SIGUSR1 prints the latency and jitter histograms, SIGUSR2 clears them.
+ *
+ * Both only flag the request; the main loop carries it out.
+ *
+ * @param signum  Signal number received.
+ * @return void
+ */
+static void latencySignalHandler(int signum) {
+    if (signum == SIGUSR1) {
+        endpoint_request_dump();
+    } else {
+        endpoint_request_reset();
+    }
 }
 
 /**
@@ -104,12 +127,63 @@ void printUsage(const char* progName) {
     printf("Optional:\n");
     printf("  --baud <baud-string>    Baud rate string (e.g. 9600, 115200). If omitted, default 115200 is used\n");
     printf("  --hwflow <TRUE|FALSE>   Hardware flow control. TRUE to enable RTS/CTS, FALSE (default) to disable.\n");
+    printf("  --fd <n>                Use an already-open descriptor (socket, pipe end) instead of a\n"
+           "                          device, e.g. one end of a socketpair from endpoint-replay.\n"
+           "                          Descriptors passed with LISTEN_FDS are taken up without it.\n");
+    printf("  --ready-fd <n>          Write the readiness message (device, EID, time to ready) to\n"
+           "                          descriptor <n> and close it; NOTIFY_SOCKET is also honoured.\n");
+    printf("  --pipeline <TRUE|FALSE> Overlap receive, dispatch and transmit on separate threads (default TRUE).\n");
+    printf("  --tx-outq <bytes>       Kernel output queue limit that lets urgent frames preempt bulk data\n"
+           "                          (default %d, 0 disables pacing).\n", PIPELINE_TX_OUTQ_LIMIT);
+    printf("  --tty-sample <ms>       Period for sampling kernel tty queue depths and driver overruns\n"
+           "                          (default %d, 0 disables).\n", TTYQ_DEFAULT_INTERVAL_MS);
+    printf("  --templates <TRUE|FALSE> Answer repeated GET_ENDPOINT_ID/version/message-type queries from\n"
+           "                          cached response images (default TRUE).\n");
+    printf("  --replay-cache <n>      Recent responses kept for retransmitted requests (default %d, 0 disables).\n",
+           REPLAY_DEFAULT_ENTRIES);
+    printf("  --replay-ttl <ms>       How long a cached response stays valid (default %d).\n",
+           REPLAY_DEFAULT_TTL_MS);
+    printf("  --admit-delay <ms>      Answer low-priority PLDM requests with ERROR_NOT_READY while the\n"
+           "                          estimated wait for a handler exceeds this (default %d, 0 disables).\n",
+           ADMIT_DEFAULT_DELAY_MS);
+    printf("  --rate-limit <spec>     Refuse requests over a per-source or per-message-type rate,\n"
+           "                          e.g. eid=20/5,eid.8=0,type.1=200 (requests/s[/burst], 0 = unlimited).\n");
+    printf("  --demux <path>          Share the link with local applications over a seqpacket socket\n"
+           "                          (a leading @ selects the abstract namespace).\n");
+    printf("  --takeover <path>       Take the open device and EID over from an endpoint listening on\n"
+           "                          <path>, then listen there for the next version (@ = abstract).\n");
+    printf("  --state <path>          Keep the assigned EID in <path> and restore it at the next start.\n");
+    printf("  --state-verify <TRUE|FALSE> Ask the bus owner to confirm a restored EID, withdrawing it if\n"
+           "                          the owner does not answer within %d ms (default FALSE).\n", EIDSTATE_VERIFY_MS);
+    printf("  --workers <n>           Worker threads for long-running handlers (default %d, 0 runs inline).\n",
+           WORKPOOL_DEFAULT_WORKERS);
+    printf("  --work-queue <n>        Maximum jobs waiting for a worker (default %d).\n",
+           WORKPOOL_DEFAULT_QUEUE);
+    printf("  --stats <path|none>     Shared-memory statistics segment read by endpoint-stat\n"
+           "                          (default %s/%s<port>%s).\n", STATS_DIR, STATS_PREFIX, STATS_SUFFIX);
+    printf("  --capture <file.pcap>   Record every MCTP packet sent or received (LINKTYPE_MCTP).\n");
+    printf("  --capture-size <MiB>    Rotate the capture file at this size (default 0, never).\n");
+    printf("  --capture-time <s>      Rotate the capture file at this age (default 0, never).\n");
+    printf("  --capture-files <n>     Capture files kept, including the current one (default %d).\n",
+           CAPTURE_DEFAULT_FILES);
+    printf("  --flight <path|none>    Crash-surviving record of recent frames and events, read by\n"
+           "                          endpoint-flight (default %s/%s<port>%s).\n", FLIGHT_DIR, FLIGHT_PREFIX,
+           FLIGHT_SUFFIX);
+    printf("  --flight-records <n>    Records kept by the flight recorder (default %d).\n", FLIGHT_DEFAULT_RECORDS);
+    printf("  --jitter <TRUE|FALSE>   Measure main-loop wakeup and stage times (default FALSE).\n");
+    printf("  --handler-budget <ms>   Log and count message handlers running longer than this\n"
+           "                          (default %d, 0 disables).\n", WATCHDOG_DEFAULT_BUDGET_MS);
+    printf("  --handler-backtrace <TRUE|FALSE> Sample the stack of a handler still running at its budget\n"
+           "                          (default FALSE; the sampling signal cuts short sleeps in the handler).\n");
+    printf("  --fault <spec>          Inject serial faults for testing, e.g. ber=1e-5,drop=1e-4,seed=7\n"
+           "                          (keys: ber drop dup flag trunc delay delay-max dir seed).\n");
     printf("  --help                  Show this help message and exit.\n\n");
 
     printf("Examples:\n");
     printf("  %s --tty /dev/ttyUSB0 --baud 115200 --hwflow TRUE \n", progName);
     printf("Notes:\n");
     printf("  - The code is blocking and will run until iterrupted with SIGINT.\n");
+    printf("  - SIGUSR1 prints response latency (and jitter) percentiles, SIGUSR2 resets them.\n");
     printf("\n");
 }
 
@@ -150,6 +224,33 @@ static int parseBool(char* s) {
  *   --tty  <tty-path>     (optional)
  *   --baud <baud-string>  (optional)
  *   --hwflow <TRUE|FALSE> (optional)
+ *   --fd <n>              (optional)
+ *   --pipeline <TRUE|FALSE> (optional)
+ *   --tx-outq <bytes>     (optional)
+ *   --tty-sample <ms>     (optional)
+ *   --templates <TRUE|FALSE> (optional)
+ *   --replay-cache <n>    (optional)
+ *   --replay-ttl <ms>     (optional)
+ *   --admit-delay <ms>    (optional)
+ *   --rate-limit <spec>   (optional)
+ *   --demux <path>        (optional)
+ *   --takeover <path>     (optional)
+ *   --state <path>        (optional)
+ *   --state-verify <TRUE|FALSE> (optional)
+ *   --ready-fd <n>        (optional)
+ *   --workers <n>         (optional)
+ *   --work-queue <n>      (optional)
+ *   --stats <path|none>   (optional)
+ *   --capture <file>      (optional)
+ *   --capture-size <MiB>  (optional)
+ *   --capture-time <s>    (optional)
+ *   --capture-files <n>   (optional)
+ *   --fault <spec>        (optional)
+ *   --flight <path|none>  (optional)
+ *   --flight-records <n>  (optional)
+ *   --jitter <TRUE|FALSE> (optional)
+ *   --handler-budget <ms> (optional)
+ *   --handler-backtrace <TRUE|FALSE> (optional)
  *   --help                (prints usage and returns 0)
  *
  * On parse/validation error this function prints usage (via printUsage)
@@ -164,13 +265,40 @@ int parseArgs(int argc, char** argv) {
         {"tty",     optional_argument, NULL, 't'},
         {"baud",    optional_argument, NULL, 'b'},
         {"hwflow",  optional_argument, NULL, 'f'},
+        {"fd",      required_argument, NULL, 'd'},
+        {"pipeline", optional_argument, NULL, 'p'},
+        {"tx-outq", required_argument, NULL, 'o'},
+        {"tty-sample", required_argument, NULL, 'Q'},
+        {"templates", optional_argument, NULL, 'c'},
+        {"replay-cache", required_argument, NULL, 'r'},
+        {"replay-ttl", required_argument, NULL, 'R'},
+        {"admit-delay", required_argument, NULL, 'A'},
+        {"rate-limit", required_argument, NULL, 'L'},
+        {"demux",   required_argument, NULL, 'U'},
+        {"takeover", required_argument, NULL, 'X'},
+        {"state",   required_argument, NULL, 'E'},
+        {"state-verify", required_argument, NULL, 'V'},
+        {"ready-fd", required_argument, NULL, 'Y'},
+        {"workers", required_argument, NULL, 'w'},
+        {"work-queue", required_argument, NULL, 'q'},
+        {"stats",   required_argument, NULL, 's'},
+        {"capture", required_argument, NULL, 'C'},
+        {"capture-size", required_argument, NULL, 'M'},
+        {"capture-time", required_argument, NULL, 'T'},
+        {"capture-files", required_argument, NULL, 'K'},
+        {"fault",   required_argument, NULL, 'F'},
+        {"flight",  required_argument, NULL, 'G'},
+        {"flight-records", required_argument, NULL, 'N'},
+        {"jitter",  optional_argument, NULL, 'J'},
+        {"handler-budget", required_argument, NULL, 'H'},
+        {"handler-backtrace", optional_argument, NULL, 'S'},
         {"help",    no_argument,       NULL, 'h'},
         {NULL, 0, NULL, 0}
     };
 
     int opt;
     int longIndex = 0;
-    while ((opt = getopt_long(argc, argv, "t:b:f:h", longOpts, &longIndex)) != -1) {
+    while ((opt = getopt_long(argc, argv, "t:b:f:d:p:o:c:r:R:w:q:s:C:M:T:K:F:G:N:J:H:S:Q:A:L:U:X:E:V:Y:h", longOpts, &longIndex)) != -1) {
         switch (opt) {
         case 't':
             {
@@ -179,10 +307,10 @@ int parseArgs(int argc, char** argv) {
                     val = argv[optind++];
                 }
                 if (val) {
-                    strncpy(serial_device.path, val, SERIAL_PATH_MAX - 1);
-                    serial_device.path[SERIAL_PATH_MAX - 1] = '\0';
+                    strncpy(config.path, val, SERIAL_PATH_MAX - 1);
+                    config.path[SERIAL_PATH_MAX - 1] = '\0';
                 } else {
-                    serial_device.path[0] = '\0';
+                    config.path[0] = '\0';
                 }
             }
             break;
@@ -194,7 +322,7 @@ int parseArgs(int argc, char** argv) {
                 }
                 if (val) {
                     int b = baudRateFromString(val);
-                    serial_device.baud = b;
+                    config.baud = b;
                 }
             }
             break;
@@ -207,11 +335,133 @@ int parseArgs(int argc, char** argv) {
                 }
                 if (val) {
                     int pb = parseBool(val);
-                    serial_device.hwflow = pb;
+                    config.hwflow = pb;
                 }
             }
             break;
         }
+        case 'd':
+            config.inherit_fd = atoi(optarg);
+            if (config.inherit_fd < 0 || fcntl(config.inherit_fd, F_GETFD) == -1) {
+                printf("Error: --fd %s is not an open descriptor.\n", optarg);
+                return 0;
+            }
+            break;
+        case 'p': {
+            char *val = optarg;
+            if (!val && optind < argc && argv[optind][0] != '-') {
+                val = argv[optind++];
+            }
+            config.pipeline = val ? parseBool(val) : 1;
+            break;
+        }
+        case 'c': {
+            char *val = optarg;
+            if (!val && optind < argc && argv[optind][0] != '-') {
+                val = argv[optind++];
+            }
+            config.templates = val ? parseBool(val) : 1;
+            break;
+        }
+        case 'r':
+            config.replay_entries = atoi(optarg);
+            if (config.replay_entries < 0) config.replay_entries = 0;
+            break;
+        case 'R':
+            config.replay_ttl_ms = atoi(optarg);
+            if (config.replay_ttl_ms < 1) config.replay_ttl_ms = 1;
+            break;
+        case 'o':
+            config.tx_outq_limit = atoi(optarg);
+            if (config.tx_outq_limit < 0) config.tx_outq_limit = 0;
+            break;
+        case 'Q':
+            config.tty_sample_ms = atoi(optarg);
+            if (config.tty_sample_ms < 0) config.tty_sample_ms = 0;
+            break;
+        case 'A':
+            config.admit_delay_ms = atoi(optarg);
+            if (config.admit_delay_ms < 0) config.admit_delay_ms = 0;
+            break;
+        case 'L':
+            config.rate_spec = optarg;
+            break;
+        case 'U':
+            config.demux_path = optarg;
+            break;
+        case 'X':
+            config.takeover_path = optarg;
+            break;
+        case 'E':
+            config.state_path = optarg;
+            break;
+        case 'V':
+            config.state_verify = parseBool(optarg);
+            break;
+        case 'Y':
+            config.ready_fd = atoi(optarg);
+            if (config.ready_fd < 0 || fcntl(config.ready_fd, F_GETFD) == -1) {
+                printf("Error: --ready-fd %s is not an open descriptor.\n", optarg);
+                return 0;
+            }
+            fcntl(config.ready_fd, F_SETFD, FD_CLOEXEC);
+            break;
+        case 'w':
+            config.workers = atoi(optarg);
+            if (config.workers < 0) config.workers = 0;
+            break;
+        case 'q':
+            config.work_queue = atoi(optarg);
+            if (config.work_queue < 1) config.work_queue = 1;
+            break;
+        case 's':
+            config.stats_path = optarg;
+            break;
+        case 'C':
+            config.capture_path = optarg;
+            break;
+        case 'M':
+            config.capture_size_mb = atoi(optarg);
+            if (config.capture_size_mb < 0) config.capture_size_mb = 0;
+            break;
+        case 'T':
+            config.capture_seconds = atoi(optarg);
+            if (config.capture_seconds < 0) config.capture_seconds = 0;
+            break;
+        case 'K':
+            config.capture_files = atoi(optarg);
+            if (config.capture_files < 1) config.capture_files = 1;
+            break;
+        case 'F':
+            config.fault_spec = optarg;
+            break;
+        case 'G':
+            config.flight_path = optarg;
+            break;
+        case 'N':
+            config.flight_records = atoi(optarg);
+            if (config.flight_records < 16) config.flight_records = 16;
+            break;
+        case 'J': {
+            char *val = optarg;
+            if (!val && optind < argc && argv[optind][0] != '-') {
+                val = argv[optind++];
+            }
+            config.jitter = val ? parseBool(val) : 1;
+            break;
+        }
+        case 'H':
+            config.handler_budget_ms = atoi(optarg);
+            if (config.handler_budget_ms < 0) config.handler_budget_ms = 0;
+            break;
+        case 'S': {
+            char *val = optarg;
+            if (!val && optind < argc && argv[optind][0] != '-') {
+                val = argv[optind++];
+            }
+            config.handler_backtrace = val ? parseBool(val) : 1;
+            break;
+        }
         case 'h':
         default:
             printUsage(argv[0]);
@@ -231,55 +481,38 @@ int parseArgs(int argc, char** argv) {
  * dispatched to their respective handlers; other packets are ignored.
  *
  * @return int Returns 0 on normal termination (never reached in typical
- *             embedded runtime where main runs indefinitely).
+ *             embedded runtime where main runs indefinitely), or 3 if a
+ *             --takeover successor could not be handed the device.
  */
 int main(int argc, char *argv[]) {
+    // time to ready is measured from here
+    service_mark_start();
+
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+    signal(SIGUSR1, latencySignalHandler);
+    signal(SIGUSR2, latencySignalHandler);
 
-    // get command line options
+    // descriptors opened by a service manager, then command line options
+    endpoint_config_defaults(&config);
+    if (service_collect_fds(&config) < 0) return EXIT_FAILURE;
     if (!parseArgs(argc, argv)) return EXIT_FAILURE;
-
-    if (serial_device.fd > -1) {
-        printf("Using serial device: %s at baud %d, hwflow %s\n",
-               serial_device.path,
-               serial_device.baud,
-               serial_device.hwflow ? "TRUE" : "FALSE");
-    } else {
-        printf("Using simulated pty device:\n");
-    }
-
-    /* initialize the mctp subsystem (and platform)*/
-    mctp_init();
+    if (endpoint_init(&config) != 0) return EXIT_FAILURE;
 
     while (!interrupted) {
-        /* update the mctp framer state */
-        mctp_update();
+        /* process whatever is ready, then sleep until a frame arrives or a worker completes */
+        int ready = endpoint_step();
+        if (ready < 0) break;   /* a new version is taking over */
+        if (ready > 0) continue;
 
-        /* process_packet */
-        if (mctp_is_packet_available()) {
-            if (mctp_is_control_packet()) {
-                mctp_process_control_message();
-            }
-#ifdef PLDM_SUPPORT
-            else if (mctp_is_pldm_packet()) {
-                pldm_process_packet();
-            }
-#endif
-            else {
-                // non-control packet - drop packet
-                mctp_ignore_packet();
-            }
-        }
+        struct pollfd fds[ENDPOINT_MAX_POLLFDS];
+        int timeout_ms;
+        int n = endpoint_pollfds(fds, ENDPOINT_MAX_POLLFDS, &timeout_ms);
+        poll(fds, (nfds_t)n, timeout_ms);
 
         /* other application tasks can be added here */
     }
 
-    // close the file descriptor if open
-    if (serial_device.fd != -1) {
-        close(serial_device.fd);
-        serial_device.fd = -1;
-    }
-
-    return 0;
+    if (interrupted) LOG_INFO("caught signal %d, cleaning up", (int)interrupted);
+    return endpoint_shutdown() == 0 ? 0 : EXIT_HANDOVER_FAILED;
 }
@@ -0,0 +1,290 @@
+/**
+ * @file mctp_serial.c
+ * @brief MCTP serial (DSP0253) framing helpers used by the Linux platform layer.
+ *
+ * Provides the FCS-16 calculation, an incremental deframer for received
+ * bytes, and encode/decode helpers.  Frames keep both the wire image (raw)
+ * and the unescaped contents (data) so the platform layer can pass bytes to
+ * the core untouched while still inspecting header fields.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "mctp_serial.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* FCS-16 lookup table (RFC 1662) */
+static const uint16_t fcstab[256] = {
+    0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+    0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+    0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+    0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+    0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+    0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+    0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+    0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+    0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+    0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+    0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+    0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+    0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+    0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+    0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+    0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+    0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+    0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+    0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+    0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+    0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+    0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+    0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+    0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+    0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+    0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+    0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+    0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+    0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+    0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+    0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+    0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78,
+};
+
+/**
+ * @brief Accumulate the FCS-16 over a block of bytes.
+ *
+ * @param fcs - running FCS value (MCTP_SERIAL_INIT_FCS for a new frame).
+ * @param data - bytes to add.
+ * @param len - number of bytes.
+ * @return uint16_t The updated FCS value.
+ */
+uint16_t mctp_serial_fcs(uint16_t fcs, const uint8_t* data, uint16_t len) {
+    while (len--) {
+        fcs = (fcs >> 8) ^ fcstab[(fcs ^ *data++) & 0xff];
+    }
+    return fcs;
+}
+
+/**
+ * @brief Validate the unescaped contents of a complete frame and set its status.
+ *
+ * @param f - frame with data/len filled in.  Status is only changed if it is
+ *            currently MCTP_FRAME_OK.
+ */
+static void validate(mctp_frame_t* f) {
+    if (f->status != MCTP_FRAME_OK) return;
+    if (f->len < 4 || f->len != f->data[MCTP_OFF_BYTE_COUNT] + 4) {
+        f->status = MCTP_FRAME_LENGTH_ERROR;
+        return;
+    }
+    uint16_t n = f->len - 2;
+    uint16_t fcs = mctp_serial_fcs(MCTP_SERIAL_INIT_FCS, f->data, n);
+    if (fcs != (uint16_t)((f->data[n] << 8) | f->data[n + 1])) {
+        f->status = MCTP_FRAME_FCS_ERROR;
+    }
+}
+
+/**
+ * @brief Reset a deframer so that it waits for an opening flag.
+ *
+ * @param d - the deframer.
+ */
+void mctp_deframer_init(mctp_deframer_t* d) {
+    memset(d, 0, sizeof *d);
+}
+
+/**
+ * @brief Start a new frame in the deframer at an opening flag.
+ *
+ * @param d - the deframer.
+ * @param now_ns - timestamp of the flag.
+ */
+static void start_frame(mctp_deframer_t* d, uint64_t now_ns) {
+    mctp_frame_t* f = &d->frame;
+    f->raw[0] = MCTP_SERIAL_FLAG;
+    f->raw_len = 1;
+    f->len = 0;
+    f->status = MCTP_FRAME_OK;
+    f->t_first_ns = now_ns;
+    f->t_done_ns = 0;
+    f->t_sent_ns = 0;
+    d->in_frame = 1;
+    d->escape = 0;
+}
+
+/**
+ * @brief Feed one received byte to the deframer.
+ *
+ * A frame is reported once its closing flag arrives.  The closing flag is
+ * also treated as the opening flag of the next frame, so both shared and
+ * separate flags between frames are handled.  Repeated flags with no data
+ * between them are folded into the raw image of a single opening flag.  Bytes
+ * outside a frame are discarded.
+ *
+ * @param d - the deframer.
+ * @param b - the received byte.
+ * @param now_ns - receive timestamp.
+ * @return int 1 when d->frame holds a complete frame (valid or not), 0 otherwise.
+ */
+int mctp_deframer_push(mctp_deframer_t* d, uint8_t b, uint64_t now_ns) {
+    mctp_frame_t* f = &d->frame;
+
+    if (d->restart) {
+        // previous closing flag doubles as this frame's opening flag
+        start_frame(d, f->t_done_ns);
+        d->restart = 0;
+    }
+
+    if (b == MCTP_SERIAL_FLAG) {
+        if (!d->in_frame || f->raw_len <= 1) {
+            start_frame(d, now_ns);
+            return 0;
+        }
+        if (f->raw_len < MCTP_SERIAL_RAW_MAX) {
+            f->raw[f->raw_len++] = b;
+        } else {
+            f->status = MCTP_FRAME_OVERSIZE;
+        }
+        if (d->escape) f->status = MCTP_FRAME_ESCAPE_ERROR;
+        f->t_done_ns = now_ns;
+        validate(f);
+        d->restart = 1;
+        return 1;
+    }
+
+    if (!d->in_frame) {
+        d->noise++;
+        return 0;
+    }
+
+    if (f->raw_len < MCTP_SERIAL_RAW_MAX - 1) {
+        f->raw[f->raw_len++] = b;
+    } else {
+        f->status = MCTP_FRAME_OVERSIZE;
+    }
+
+    if (b == MCTP_SERIAL_ESCAPE) {
+        if (d->escape) f->status = MCTP_FRAME_ESCAPE_ERROR;
+        d->escape = 1;
+        return 0;
+    }
+    if (d->escape) {
+        b ^= MCTP_SERIAL_ESCAPE_XOR;
+        d->escape = 0;
+    }
+    if (f->len < MCTP_SERIAL_DATA_MAX) {
+        f->data[f->len++] = b;
+    } else {
+        f->status = MCTP_FRAME_OVERSIZE;
+    }
+    return 0;
+}
+
+/**
+ * @brief Fill in data, len and status of a frame from its raw wire image.
+ *
+ * Used on the transmit side where the core produces escaped bytes.  Leading
+ * bytes before the first flag are ignored.
+ *
+ * @param f - frame with raw/raw_len filled in.
+ */
+void mctp_serial_decode(mctp_frame_t* f) {
+    uint16_t i = 0;
+    uint8_t escape = 0;
+
+    f->len = 0;
+    f->status = MCTP_FRAME_OK;
+    while (i < f->raw_len && f->raw[i] != MCTP_SERIAL_FLAG) i++;
+    while (i < f->raw_len && f->raw[i] == MCTP_SERIAL_FLAG) i++;
+    for (; i < f->raw_len; i++) {
+        uint8_t b = f->raw[i];
+        if (b == MCTP_SERIAL_FLAG) break;
+        if (b == MCTP_SERIAL_ESCAPE) {
+            if (escape) f->status = MCTP_FRAME_ESCAPE_ERROR;
+            escape = 1;
+            continue;
+        }
+        if (escape) {
+            b ^= MCTP_SERIAL_ESCAPE_XOR;
+            escape = 0;
+        }
+        if (f->len >= MCTP_SERIAL_DATA_MAX) {
+            f->status = MCTP_FRAME_OVERSIZE;
+            return;
+        }
+        f->data[f->len++] = b;
+    }
+    if (escape) f->status = MCTP_FRAME_ESCAPE_ERROR;
+    validate(f);
+}
+
+/**
+ * @brief Build a complete frame (data and escaped wire image) from an MCTP packet.
+ *
+ * @param f - destination frame.
+ * @param body - transport header followed by message bytes (header version first).
+ * @param body_len - number of body bytes.
+ * @return int Number of raw bytes produced.
+ */
+int mctp_serial_encode(mctp_frame_t* f, const uint8_t* body, uint8_t body_len) {
+    f->data[MCTP_OFF_PROTOCOL] = MCTP_SERIAL_PROTOCOL;
+    f->data[MCTP_OFF_BYTE_COUNT] = body_len;
+    memcpy(&f->data[2], body, body_len);
+    uint16_t fcs = mctp_serial_fcs(MCTP_SERIAL_INIT_FCS, f->data, body_len + 2);
+    f->data[body_len + 2] = (uint8_t)(fcs >> 8);
+    f->data[body_len + 3] = (uint8_t)fcs;
+    f->len = body_len + 4;
+    f->status = MCTP_FRAME_OK;
+
+    uint16_t n = 0;
+    f->raw[n++] = MCTP_SERIAL_FLAG;
+    for (uint16_t i = 0; i < f->len; i++) {
+        uint8_t b = f->data[i];
+        if (b == MCTP_SERIAL_FLAG || b == MCTP_SERIAL_ESCAPE) {
+            f->raw[n++] = MCTP_SERIAL_ESCAPE;
+            b ^= MCTP_SERIAL_ESCAPE_XOR;
+        }
+        f->raw[n++] = b;
+    }
+    f->raw[n++] = MCTP_SERIAL_FLAG;
+    f->raw_len = n;
+    return n;
+}
+
+/**
+ * @brief Copy a frame, touching only the used portion of its buffers.
+ *
+ * @param dst - destination frame.
+ * @param src - source frame.
+ */
+void mctp_frame_copy(mctp_frame_t* dst, const mctp_frame_t* src) {
+    dst->t_first_ns = src->t_first_ns;
+    dst->t_done_ns = src->t_done_ns;
+    dst->t_sent_ns = src->t_sent_ns;
+    dst->seq = src->seq;
+    dst->req = src->req;
+    dst->raw_len = src->raw_len;
+    dst->len = src->len;
+    dst->status = src->status;
+    memcpy(dst->raw, src->raw, src->raw_len);
+    memcpy(dst->data, src->data, src->len);
+}
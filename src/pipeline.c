@@ -0,0 +1,1290 @@
+/**
+ * @file pipeline.c
+ * @brief Overlapped receive, dispatch and transmit stages for the serial link.
+ *
+ * Receive stage: bulk reads from the device are deframed and complete frames
+ * are queued for the core.  The core then consumes the queued wire image one
+ * byte at a time through platform_serial_read_byte(), so its own framer sees
+ * exactly the bytes that arrived.  Queries the receive stage can answer on
+ * its own (cached control responses, retransmitted requests) are answered
+ * here and never reach the core.
+ *
+ * Transmit stage: bytes written by the core are collected until a frame's
+ * closing flag, then the whole frame is handed to the priority scheduler
+ * (txsched.c) and written to the device with a single system call where
+ * possible.  On real UARTs the stage keeps only a small amount of data in the
+ * kernel's output queue, so a newly queued high-priority frame is not stuck
+ * behind kilobytes of bulk data the kernel has already accepted.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE
+#endif
+#include "pipeline.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "admit.h"
+#include "clock.h"
+#include "ctrltmpl.h"
+#include "capture.h"
+#include "demux.h"
+#include "eidstate.h"
+#include "fairq.h"
+#include "faultinj.h"
+#include "flightrec.h"
+#include "jitter.h"
+#include "latency.h"
+#include "log.h"
+#include "mctp_serial.h"
+#include "probes.h"
+#include "ratelimit.h"
+#include "replay.h"
+#include "stats.h"
+#include "ttyq.h"
+#include "txsched.h"
+#include "watchdog.h"
+
+#define RX_READ_CHUNK 512
+
+static int serial_fd = -1;
+static int use_threads = 0;
+static int running = 0;
+static volatile int stopping = 0;
+
+/* receive stage state (owned by the RX thread, or the I/O thread when inline) */
+static mctp_deframer_t deframer;
+static int deframed_pending = 0;
+static uint8_t rx_buf[2 * RX_READ_CHUNK];   /* room for bytes added by fault injection */
+static uint8_t rx_raw[RX_READ_CHUNK];       /* bytes as read, when faults are injected */
+static size_t rx_buf_pos = 0;
+static size_t rx_buf_len = 0;
+static uint32_t rx_seq = 0;
+static replay_response_t rx_replay;
+
+/* frame currently being handed to the core (I/O thread) */
+static mctp_frame_t* rx_cur = NULL;
+static uint16_t rx_pos = 0;
+static uint64_t rx_cur_ns = 0;  /* core started reading rx_cur */
+static mctp_frame_t rx_last;    /* last frame fully consumed by the core */
+static uint64_t dispatch_ns = 0; /* core began handling rx_last */
+static int in_dispatch = 0;      /* a handler for rx_last is running */
+
+/* splits deferred responses (worker pool) into frames; I/O thread */
+static mctp_deframer_t deferred;
+
+/* request generated on this host, handed to the core ahead of the receive queue */
+static mctp_frame_t local_frame;
+static int local_pending = 0;
+static int rx_cur_local = 0;    /* rx_cur is local_frame */
+static int rx_last_local = 0;   /* rx_last came from local_frame: its response is not sent */
+
+/* received bytes carried over from a previous process, deframed when the stages start */
+static uint8_t* preload = NULL;
+static size_t preload_len = 0;
+
+/* endpoint ID as last assigned by SET_ENDPOINT_ID, and who assigned it */
+static uint8_t assigned_eid = 0;
+static uint8_t owner_eid = 0;
+
+/* transmit stage state */
+static mctp_frame_t tx_asm;
+static int tx_asm_has_data = 0;
+static unsigned tx_bps = 0;          /* line rate for pacing, 0 = unknown */
+static unsigned tx_outq_limit = 0;   /* kernel output queue target, 0 = no pacing */
+
+static pthread_t rx_thread;
+static pthread_t tx_thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rx_space_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t tx_ready_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t tx_space_cv = PTHREAD_COND_INITIALIZER;
+static int wake_fd = -1;    /* stops the RX thread's poll */
+static int notify_fd = -1;  /* tells the I/O thread that frames were queued */
+static uint64_t notify_ns = 0;  /* first notification since the I/O thread last slept (jitter monitor) */
+static uint64_t wait_start_ns = 0;     /* I/O thread went to sleep, 0 while awake */
+static uint64_t wait_deadline_ns = 0;  /* latest it expected to wake */
+
+/**
+ * @brief Initialize a condition variable that waits on CLOCK_MONOTONIC.
+ *
+ * @param cv - the condition variable.
+ */
+static void init_monotonic_cond(pthread_cond_t* cv) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cv, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/**
+ * @brief Wait on a condition variable for at most the given number of milliseconds.
+ *
+ * @param cv - condition variable initialized with init_monotonic_cond().
+ * @param ms - timeout in milliseconds.
+ */
+static void timed_wait(pthread_cond_t* cv, int ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_nsec += (long)ms * 1000000L;
+    ts.tv_sec += ts.tv_nsec / 1000000000L;
+    ts.tv_nsec %= 1000000000L;
+    pthread_cond_timedwait(cv, &lock, &ts);
+}
+
+static void tx_kick();
+
+/**
+ * @brief Capture who sent a request and when, for the response that answers it.
+ *
+ * @param r - receives the identity and timing (timing.valid set on success).
+ * @param req - the request.
+ * @param start_ns - when handling of the request began.
+ * @return int 0 if req is the first packet of a request, -1 otherwise.
+ */
+static int capture_request(pipeline_request_t* r, const mctp_frame_t* req, uint64_t start_ns) {
+    memset(r, 0, sizeof *r);
+    if (!mctp_frame_has_header(req) || req->len < MCTP_OFF_PLDM_CMD + 1) return -1;
+    uint8_t qf = req->data[MCTP_OFF_FLAGS];
+    if (!(qf & MCTP_FLAG_TO) || !(qf & MCTP_FLAG_SOM)) return -1;
+
+    mctp_req_timing_t* t = &r->timing;
+    t->msg_type = mctp_frame_msg_type(req);
+    t->pldm_type = req->data[MCTP_OFF_PLDM_TYPE] & 0x3F;
+    t->cmd = t->msg_type == MCTP_MSG_TYPE_PLDM ? req->data[MCTP_OFF_PLDM_CMD]
+                                               : req->data[MCTP_OFF_CTRL_CMD];
+    t->rx_first_ns = req->t_first_ns;
+    t->rx_done_ns = req->t_done_ns;
+    t->start_ns = start_ns > req->t_done_ns ? start_ns : req->t_done_ns;
+    t->valid = 1;
+    r->seq = req->seq;
+    r->src = req->data[MCTP_OFF_SRC];
+    r->tag = qf & MCTP_FLAG_TAG_MASK;
+    return 0;
+}
+
+/**
+ * @brief Attach a captured request's timing to a response frame for latency accounting.
+ *
+ * Only the last frame of a response that answers the request (same tag,
+ * addressed back to its source) carries valid timing.
+ *
+ * @param resp - decoded response frame.
+ * @param r - the request it may answer.
+ * @param end_ns - when the response was produced.
+ */
+static void stamp_captured(mctp_frame_t* resp, const pipeline_request_t* r, uint64_t end_ns) {
+    resp->req.valid = 0;
+    if (!r->timing.valid || !mctp_frame_has_header(resp)) return;
+    uint8_t rf = resp->data[MCTP_OFF_FLAGS];
+    if (!(rf & MCTP_FLAG_EOM) || (rf & MCTP_FLAG_TO) || (rf & MCTP_FLAG_TAG_MASK) != r->tag ||
+        resp->data[MCTP_OFF_DEST] != r->src) {
+        return;
+    }
+    resp->req = r->timing;
+    resp->req.end_ns = end_ns;
+}
+
+/**
+ * @brief Attach the request's timing to a response frame for latency accounting.
+ *
+ * @param resp - decoded response frame.
+ * @param req - the request it may answer.
+ * @param start_ns - when handling of the request began.
+ * @param end_ns - when the response was produced.
+ */
+static void stamp_response(mctp_frame_t* resp, const mctp_frame_t* req, uint64_t start_ns,
+                           uint64_t end_ns) {
+    pipeline_request_t r;
+    capture_request(&r, req, start_ns);
+    stamp_captured(resp, &r, end_ns);
+}
+
+/**
+ * @brief Account for a completed received frame in the statistics segment.
+ *
+ * @param f - the frame.
+ */
+static void rx_count_frame(const mctp_frame_t* f) {
+    endpoint_stats_t* s = endpoint_stats;
+    switch (f->status) {
+    case MCTP_FRAME_OK:
+        stats_add(&s->rx_frames_ok, 1);
+        if (mctp_frame_has_header(f) && (f->data[MCTP_OFF_FLAGS] & MCTP_FLAG_SOM)) {
+            stats_add(&s->rx_msg_type[stats_msg_slot(mctp_frame_msg_type(f))], 1);
+        }
+        return;
+    case MCTP_FRAME_FCS_ERROR:
+        PROBE2(fcs_fail, f->seq, f->raw_len);
+        stats_add(&s->rx_fcs_errors, 1);
+        break;
+    case MCTP_FRAME_ESCAPE_ERROR:
+        stats_add(&s->rx_escape_errors, 1);
+        break;
+    default:
+        stats_add(&s->rx_length_errors, 1);
+        break;
+    }
+    // still handed to the core, which discards it
+    PROBE2(frame_error, f->seq, f->status);
+    stats_add(&s->drops[STATS_DROP_BAD_FRAME], 1);
+}
+
+/**
+ * @brief Queue the packets of a cached response from the receive stage.
+ *
+ * @param req - the retransmitted request.
+ * @param resp - the cached response frames.
+ */
+static void rx_send_replay(const mctp_frame_t* req, const replay_response_t* resp) {
+    tx_class_t c = TX_CLASS_BULK;
+    if (resp->frames == 1) {
+        c = req->data[MCTP_OFF_MSG_TYPE] == MCTP_MSG_TYPE_CONTROL ? TX_CLASS_CONTROL
+                                                                  : TX_CLASS_NORMAL;
+    }
+
+    uint16_t off = 0;
+    for (uint8_t i = 0; i < resp->frames; i++) {
+        mctp_frame_t* out = txsched_slot(TX_PRODUCER_RX, c);
+        if (!out) break;  // the requester will retry
+        memcpy(out->raw, &resp->raw[off], resp->frame_len[i]);
+        out->raw_len = resp->frame_len[i];
+        off += resp->frame_len[i];
+        mctp_serial_decode(out);
+        out->t_first_ns = req->t_first_ns;
+        out->t_done_ns = clock_now_ns();
+        out->t_sent_ns = 0;
+        out->seq = req->seq;
+        stamp_response(out, req, out->t_done_ns, out->t_done_ns);
+        txsched_commit(TX_PRODUCER_RX, c);
+    }
+    tx_kick();
+}
+
+/**
+ * @brief Build the ERROR_NOT_READY answer to a request in a free transmit slot.
+ *
+ * @param f - the request.
+ * @return mctp_frame_t* The slot holding the answer, or NULL if no slot is
+ *         free or the request cannot be answered that way.
+ */
+static mctp_frame_t* rx_not_ready(const mctp_frame_t* f) {
+    mctp_frame_t* out = txsched_slot(TX_PRODUCER_RX, TX_CLASS_NORMAL);
+    return out && admit_not_ready(f, out) ? out : NULL;
+}
+
+/**
+ * @brief Refuse a request in the receive stage instead of queueing it.
+ *
+ * Single-packet PLDM requests are answered with ERROR_NOT_READY so the
+ * requester backs off; anything else is dropped and left to its retry.
+ *
+ * @param f - the refused frame.
+ * @param out - transmit slot already holding the ERROR_NOT_READY answer, or
+ *              NULL to drop the frame silently.
+ * @param reason - drop counter to charge.
+ * @param kind - fastpath probe kind.
+ */
+static void rx_refuse(mctp_frame_t* f, mctp_frame_t* out, stats_drop_t reason, int kind) {
+    stats_add(&endpoint_stats->drops[reason], 1);
+    PROBE2(fastpath, f->seq, kind);
+    replay_cancel(f);   // a retransmission after the refusal deserves a real answer
+
+    if (!out) return;
+    out->t_first_ns = f->t_first_ns;
+    out->t_done_ns = clock_now_ns();
+    out->t_sent_ns = 0;
+    out->seq = f->seq;
+    stamp_response(out, f, out->t_done_ns, out->t_done_ns);
+    txsched_commit(TX_PRODUCER_RX, TX_CLASS_NORMAL);
+    tx_kick();
+}
+
+/**
+ * @brief Try to answer a received frame without involving the core.
+ *
+ * Frames for local demux clients are handed over first.
+ *
+ * @param f - the received frame.
+ * @return int 1 if the frame has been dealt with and must not reach the core.
+ */
+static int rx_fastpath(mctp_frame_t* f) {
+    if (f->status != MCTP_FRAME_OK) return 0;
+    if (demux_offer(f)) return 1;
+    if (eidstate_offer(f)) return 1;
+
+    mctp_frame_t* out = txsched_slot(TX_PRODUCER_RX, TX_CLASS_CONTROL);
+    if (ctrltmpl_answer(f, out)) {
+        stats_add(&endpoint_stats->rx_template_answers, 1);
+        PROBE2(fastpath, f->seq, 1);
+        out->t_first_ns = f->t_first_ns;
+        out->t_done_ns = clock_now_ns();
+        out->t_sent_ns = 0;
+        out->seq = f->seq;
+        stamp_response(out, f, out->t_done_ns, out->t_done_ns);
+        txsched_commit(TX_PRODUCER_RX, TX_CLASS_CONTROL);
+        tx_kick();
+        return 1;
+    }
+
+    switch (replay_lookup(f, &rx_replay)) {
+    case REPLAY_HIT:
+        stats_add(&endpoint_stats->rx_replay_answers, 1);
+        PROBE2(fastpath, f->seq, 2);
+        rx_send_replay(f, &rx_replay);
+        return 1;
+    case REPLAY_IN_PROGRESS:
+        // the original is still being handled; its response answers this copy
+        stats_add(&endpoint_stats->drops[STATS_DROP_DUPLICATE], 1);
+        return 1;
+    default:
+        break;
+    }
+
+    if (ratelimit_enabled() && !ratelimit_allow(f, f->t_done_ns)) {
+        stats_add(&endpoint_stats->sources[fairq_source(f)].rate_limited, 1);
+        rx_refuse(f, rx_not_ready(f), STATS_DROP_RATE_LIMIT, 4);
+        return 1;
+    }
+
+    if (!admit_enabled()) return 0;
+    out = txsched_slot(TX_PRODUCER_RX, TX_CLASS_NORMAL);
+    if (!admit_shed(f, fairq_count(), out)) return 0;
+    stats_add(&endpoint_stats->sources[fairq_source(f)].shed, 1);
+    rx_refuse(f, out, STATS_DROP_SHED, 3);
+    return 1;
+}
+
+/**
+ * @brief Move the deframer's completed frame into the receive queue.
+ *
+ * @return int 1 if the frame was consumed, 0 if the queue is full.
+ */
+static int rx_queue_frame() {
+    if (!deframed_pending) {
+        deframer.frame.seq = ++rx_seq;
+        deframed_pending = 1;
+        PROBE3(frame_complete, deframer.frame.seq, deframer.frame.len,
+               deframer.frame.t_done_ns - deframer.frame.t_first_ns);
+        rx_count_frame(&deframer.frame);
+        faultinj_rx_frame(deframer.frame.status == MCTP_FRAME_OK, deframer.frame.t_first_ns);
+        capture_frame(CAPTURE_RX, &deframer.frame, deframer.frame.t_done_ns);
+        flight_frame(FLIGHT_RX_FRAME, &deframer.frame, deframer.frame.t_done_ns);
+        if (rx_fastpath(&deframer.frame)) {
+            deframed_pending = 0;
+            return 1;
+        }
+    }
+
+    mctp_frame_t* slot = fairq_slot(&deframer.frame);
+    if (!slot) {
+        // a source that has filled its queue is refused rather than stalling the others
+        mctp_frame_t* out = rx_not_ready(&deframer.frame);
+        if (!out) return 0;
+        stats_add(&endpoint_stats->sources[fairq_source(&deframer.frame)].shed, 1);
+        rx_refuse(&deframer.frame, out, STATS_DROP_SHED, 5);
+        deframed_pending = 0;
+        return 1;
+    }
+    mctp_frame_copy(slot, &deframer.frame);
+    fairq_commit();
+    deframed_pending = 0;
+
+    if (use_threads) {
+        uint64_t one = 1, idle = 0;
+        if (jitter_enabled()) {
+            __atomic_compare_exchange_n(&notify_ns, &idle, clock_now_ns(), 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        }
+        ssize_t r = write(notify_fd, &one, sizeof one);
+        (void)r;
+    }
+    return 1;
+}
+
+/**
+ * @brief Deframe buffered bytes until they run out or the receive queue fills.
+ *
+ * Unprocessed bytes stay buffered, so a full queue pushes back on the device
+ * instead of dropping frames.
+ *
+ * @return int 1 if progress stopped because the receive queue is full.
+ */
+static int rx_process() {
+    if (deframed_pending && !rx_queue_frame()) return 1;
+
+    while (rx_buf_pos < rx_buf_len) {
+        uint8_t b = rx_buf[rx_buf_pos++];
+        if (mctp_deframer_push(&deframer, b, clock_now_ns())) {
+            if (!rx_queue_frame()) return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Read whatever the device has and deframe it.  Never blocks.
+ *
+ * @return ssize_t Bytes read, 0 if none were available, -1 on a device error.
+ */
+static ssize_t rx_pump() {
+    if (rx_process()) return 0;
+
+    // sampled before the read, the input queue shows the backlog that built up while away
+    ttyq_poll();
+
+    int inject = faultinj_active(FAULTINJ_RX);
+    ssize_t n = read(serial_fd, inject ? rx_raw : rx_buf, RX_READ_CHUNK);
+    stats_add(&endpoint_stats->rx_read_calls, 1);
+    if (n <= 0) {
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return 0;
+        return -1;
+    }
+    stats_add(&endpoint_stats->rx_bytes, (uint64_t)n);
+    PROBE1(rx_read, n);
+    rx_buf_pos = 0;
+    rx_buf_len = inject ? faultinj_apply(FAULTINJ_RX, rx_raw, (size_t)n, rx_buf, sizeof rx_buf) : (size_t)n;
+
+    uint64_t noise = deframer.noise;
+    rx_process();
+    if (deframer.noise != noise) {
+        stats_add(&endpoint_stats->drops[STATS_DROP_NOISE], deframer.noise - noise);
+        flight_event(FLIGHT_NOISE, (uint32_t)(deframer.noise - noise));
+    }
+    return n;
+}
+
+/**
+ * @brief Receive stage thread: wait for the device, read, deframe, queue.
+ *
+ * @param unused - required by the pthread signature.
+ * @return void* Always NULL.
+ */
+static void* rx_main(void* unused) {
+    (void)unused;
+    struct pollfd fds[2] = {
+        {.fd = serial_fd, .events = POLLIN},
+        {.fd = wake_fd, .events = POLLIN},
+    };
+
+    while (!stopping) {
+        if (rx_process()) {
+            // core has not caught up; wait for it to release a slot
+            pthread_mutex_lock(&lock);
+            if (!fairq_slot(&deframer.frame) && !stopping) timed_wait(&rx_space_cv, 10);
+            pthread_mutex_unlock(&lock);
+            continue;
+        }
+
+        int r = poll(fds, 2, ttyq_poll_timeout());
+        stats_add(&endpoint_stats->rx_poll_calls, 1);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("poll: %m");
+            break;
+        }
+        if (r == 0) {
+            // idle line: keep the queue gauges and driver counts current
+            ttyq_poll();
+            continue;
+        }
+        if (fds[1].revents) break;
+        if (fds[0].revents) {
+            if (rx_pump() < 0) {
+                // e.g. pty with no peer attached: avoid spinning on POLLHUP
+                usleep(50000);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Write one queued frame to the device, waiting for room as needed.
+ *
+ * @param f - the frame to send.
+ * @return int 0 when the whole frame was written, -1 if it was abandoned.
+ */
+static int tx_write_frame(mctp_frame_t* f) {
+    endpoint_stats_t* s = endpoint_stats;
+    const uint8_t* raw = f->raw;
+    size_t raw_len = f->raw_len;
+    size_t off = 0;
+    uint64_t stall_start = 0;
+
+    if (faultinj_active(FAULTINJ_TX)) {
+        static uint8_t damaged[2 * MCTP_SERIAL_RAW_MAX];
+        faultinj_delay_write();
+        raw_len = faultinj_apply(FAULTINJ_TX, f->raw, f->raw_len, damaged, sizeof damaged);
+        raw = damaged;
+    }
+
+    while (off < raw_len) {
+        ssize_t n = write(serial_fd, raw + off, raw_len - off);
+        stats_add(&s->tx_write_calls, 1);
+        if (n > 0) {
+            off += (size_t)n;
+            if (stall_start) stats_add(&s->tx_stall_ns, clock_now_ns() - stall_start);
+            stall_start = 0;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno != EAGAIN) {
+            LOG_ERROR("write: %m");
+            stats_add(&s->drops[STATS_DROP_TX_ERROR], 1);
+            flight_event(FLIGHT_TX_ERROR, (uint32_t)errno);
+            return -1;
+        }
+
+        // device is full: wait until it drains, but not forever
+        uint64_t now = clock_now_ns();
+        if (!stall_start) stall_start = now;
+        if (now - stall_start > (uint64_t)PIPELINE_TX_STALL_LIMIT_MS * 1000000ull) {
+            LOG_WARN("write: transmit stalled, frame dropped");
+            stats_add(&s->tx_stall_ns, now - stall_start);
+            stats_add(&s->drops[STATS_DROP_TX_STALL], 1);
+            flight_event(FLIGHT_TX_STALL, (uint32_t)((now - stall_start) / 1000000ull));
+            return -1;
+        }
+        struct pollfd p = {.fd = serial_fd, .events = POLLOUT};
+        poll(&p, 1, 10);
+        stats_add(&s->tx_poll_calls, 1);
+    }
+    f->t_sent_ns = clock_now_ns();
+
+    PROBE3(tx_flush, f->seq, f->raw_len, f->t_sent_ns - f->t_done_ns);
+    latency_record(&f->req, f->t_sent_ns);
+    capture_frame(CAPTURE_TX, f, f->t_sent_ns);
+    flight_frame(FLIGHT_TX_FRAME, f, f->t_sent_ns);
+
+    stats_add(&s->tx_frames, 1);
+    stats_add(&s->tx_bytes, raw_len);
+    if (mctp_frame_has_header(f) && (f->data[MCTP_OFF_FLAGS] & MCTP_FLAG_SOM)) {
+        stats_add(&s->tx_msg_type[stats_msg_slot(mctp_frame_msg_type(f))], 1);
+    }
+    return 0;
+}
+
+/**
+ * @brief Hold off until the kernel output queue is at or below the pacing limit.
+ *
+ * Waiting here rather than in the kernel keeps the scheduling decision open:
+ * the frame chosen after the wait is the highest-priority one at that moment.
+ */
+static void tx_pace() {
+    while (tx_outq_limit && !stopping) {
+        stats_add(&endpoint_stats->tx_ioctl_calls, 1);
+        int queued = ttyq_outq();
+        if (queued < 0) {
+            tx_outq_limit = 0;  // not supported by this device
+            return;
+        }
+        if (queued <= (int)tx_outq_limit) return;
+
+        // sleep for roughly the time the excess takes on the wire (10 bits per byte)
+        uint64_t us = (uint64_t)(queued - (int)tx_outq_limit) * 10u * 1000000u / tx_bps;
+        if (us < 100) us = 100;
+        if (us > 10000) us = 10000;
+        uint64_t t0 = clock_now_ns();
+        usleep((useconds_t)us);
+        stats_add(&endpoint_stats->tx_stall_ns, clock_now_ns() - t0);
+    }
+}
+
+/**
+ * @brief Transmit stage thread: drain queued frames to the device.
+ *
+ * Frames still queued when the pipeline is stopped are flushed before the
+ * thread exits.
+ *
+ * @param unused - required by the pthread signature.
+ * @return void* Always NULL.
+ */
+static void* tx_main(void* unused) {
+    (void)unused;
+    for (;;) {
+        pthread_mutex_lock(&lock);
+        while (!txsched_pending() && !stopping) {
+            pthread_cond_wait(&tx_ready_cv, &lock);
+        }
+        pthread_mutex_unlock(&lock);
+
+        if (!txsched_pending()) break;
+        tx_pace();
+
+        txsched_ref_t ref;
+        mctp_frame_t* f = txsched_peek(&ref);
+        uint64_t t_start = clock_now_ns();
+        tx_write_frame(f);
+        txsched_pop(ref, t_start);
+
+        pthread_mutex_lock(&lock);
+        pthread_cond_signal(&tx_space_cv);
+        pthread_mutex_unlock(&lock);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Start the receive and transmit stages on an open serial device.
+ *
+ * The descriptor is switched to non-blocking mode; the stages do their own
+ * waiting.
+ *
+ * @param fd - open serial (or pty master) descriptor.
+ * @param threaded - non-zero to run the stages on dedicated threads.
+ * @return int 0 on success, -1 on error.
+ */
+int pipeline_start(int fd, int threaded) {
+    if (running) return 0;
+    if (fairq_init(PIPELINE_RX_FRAMES) != 0 || txsched_init(PIPELINE_TX_FRAMES) != 0) {
+        LOG_ERROR("frameq_init: %m");
+        return -1;
+    }
+
+    int flags = fcntl(fd, F_GETFL);
+    if (flags != -1) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    serial_fd = fd;
+    use_threads = threaded;
+    stopping = 0;
+    mctp_deframer_init(&deframer);
+    deframed_pending = 0;
+    rx_buf_pos = rx_buf_len = 0;
+    rx_cur = NULL;
+    rx_seq = 0;
+    rx_last.len = 0;
+    rx_last.raw_len = 0;
+    tx_asm.raw_len = 0;
+    tx_asm_has_data = 0;
+
+    if (use_threads) {
+        init_monotonic_cond(&rx_space_cv);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd == -1 || notify_fd == -1) {
+            LOG_ERROR("eventfd: %m");
+            use_threads = 0;
+        }
+    }
+
+    // bytes a predecessor received but did not handle come before anything read now
+    if (preload) {
+        for (size_t i = 0; i < preload_len; i++) {
+            if (mctp_deframer_push(&deframer, preload[i], clock_now_ns()) && !rx_queue_frame()) break;
+        }
+        free(preload);
+        preload = NULL;
+        preload_len = 0;
+    }
+
+    if (use_threads) {
+        // keep process signals on the I/O thread so they interrupt its wait
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+        int err = pthread_create(&rx_thread, NULL, rx_main, NULL);
+        if (err == 0) {
+            err = pthread_create(&tx_thread, NULL, tx_main, NULL);
+            if (err != 0) {
+                stopping = 1;
+                uint64_t one = 1;
+                ssize_t r = write(wake_fd, &one, sizeof one);
+                (void)r;
+                pthread_join(rx_thread, NULL);
+                stopping = 0;
+            }
+        }
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        if (err != 0) {
+            LOG_WARN("pthread_create: %s, running pipeline inline", strerror(err));
+            use_threads = 0;
+        }
+    }
+
+    running = 1;
+    return 0;
+}
+
+/**
+ * @brief Append one frame's bytes to a carry-over buffer if they fit.
+ *
+ * @param out - the buffer.
+ * @param max - its capacity.
+ * @param n - bytes already in it.
+ * @param raw - the bytes to add.
+ * @param len - number of bytes.
+ * @return size_t The new length.
+ */
+static size_t carry_bytes(uint8_t* out, size_t max, size_t n, const uint8_t* raw, size_t len) {
+    if (!out || len > max - n) return n;
+    memcpy(out + n, raw, len);
+    return n + len;
+}
+
+/**
+ * @brief Stop the stages and return what was received but not handled.
+ *
+ * Frames already queued for transmit are flushed.  Received frames still
+ * queued for the core, a partly received frame and bytes not yet deframed
+ * are copied out in arrival order, as they appeared on the wire, so that a
+ * successor can pick up where this process left off.
+ *
+ * @param out - destination, or NULL to discard.
+ * @param max - capacity of out; whole frames that do not fit are dropped.
+ * @return size_t Number of bytes copied.
+ */
+size_t pipeline_stop_unread(uint8_t* out, size_t max) {
+    if (!running) return 0;
+    if (use_threads) {
+        pthread_mutex_lock(&lock);
+        stopping = 1;
+        pthread_cond_broadcast(&tx_ready_cv);
+        pthread_cond_broadcast(&rx_space_cv);
+        pthread_mutex_unlock(&lock);
+        uint64_t one = 1;
+        ssize_t r = write(wake_fd, &one, sizeof one);
+        (void)r;
+        pthread_join(rx_thread, NULL);
+        pthread_join(tx_thread, NULL);
+        close(wake_fd);
+        close(notify_fd);
+        wake_fd = notify_fd = -1;
+    }
+    running = 0;
+
+    size_t n = 0;
+    if (rx_cur && !rx_cur_local) {
+        n = carry_bytes(out, max, n, rx_cur->raw + rx_pos, rx_cur->raw_len - rx_pos);
+        fairq_pop(rx_cur_ns);
+    }
+    rx_cur = NULL;
+    rx_cur_local = 0;
+    for (const mctp_frame_t* f; (f = fairq_peek()) != NULL; fairq_pop(0)) {
+        n = carry_bytes(out, max, n, f->raw, f->raw_len);
+    }
+    if (deframed_pending) {
+        n = carry_bytes(out, max, n, deframer.frame.raw, deframer.frame.raw_len);
+    } else if (deframer.restart) {
+        // the last closing flag also opens the next frame
+        static const uint8_t flag = MCTP_SERIAL_FLAG;
+        n = carry_bytes(out, max, n, &flag, 1);
+    } else if (deframer.in_frame) {
+        n = carry_bytes(out, max, n, deframer.frame.raw, deframer.frame.raw_len);
+    }
+    n = carry_bytes(out, max, n, rx_buf + rx_buf_pos, rx_buf_len - rx_buf_pos);
+
+    fairq_free();
+    txsched_free();
+    return n;
+}
+
+/**
+ * @brief Stop the stages, flushing frames that are already queued for transmit.
+ */
+void pipeline_stop() {
+    pipeline_stop_unread(NULL, 0);
+}
+
+/**
+ * @brief Hand bytes received by a previous process to the next pipeline_start().
+ *
+ * @param raw - the bytes, as they appeared on the wire.
+ * @param len - number of bytes.
+ * @return int 0 on success, -1 if they could not be kept.
+ */
+int pipeline_preload(const uint8_t* raw, size_t len) {
+    free(preload);
+    preload_len = 0;
+    preload = len ? malloc(len) : NULL;
+    if (!preload) return len ? -1 : 0;
+    memcpy(preload, raw, len);
+    preload_len = len;
+    return 0;
+}
+
+/**
+ * @brief Configure transmit pacing for a real serial line.
+ *
+ * @param bps - line rate in bits per second (0 disables pacing).
+ * @param outq_limit - bytes the kernel output queue may hold before the
+ *                     transmit stage waits (0 disables pacing).
+ */
+void pipeline_set_pacing(unsigned bps, unsigned outq_limit) {
+    tx_bps = bps;
+    tx_outq_limit = bps ? outq_limit : 0;
+}
+
+/**
+ * @brief Report whether received bytes are waiting for the core.
+ *
+ * @return uint8_t Non-zero when platform_serial_read_byte() will return data.
+ */
+uint8_t pipeline_rx_has_data() {
+    if (rx_cur) return 1;
+    if (!running) return 0;
+    if (local_pending) {
+        // the core learns restored state before it sees anything from the wire
+        local_pending = 0;
+        local_frame.seq = rx_last.seq;
+        ctrltmpl_invalidate(local_frame.seq);
+        replay_flush();
+        rx_cur = &local_frame;
+        rx_cur_local = 1;
+        rx_pos = 0;
+        rx_cur_ns = clock_now_ns();
+        return 1;
+    }
+    // inline, read first so frames still in the kernel compete for the next turn
+    if (!use_threads) rx_pump();
+    rx_cur = fairq_peek();
+    rx_pos = 0;
+    if (!rx_cur) return 0;
+    rx_cur_ns = clock_now_ns();
+    if (jitter_enabled()) jitter_record(JITTER_SERVICE, rx_cur->t_done_ns, rx_cur_ns);
+    return 1;
+}
+
+/**
+ * @brief Hand the next received byte to the core.
+ *
+ * @return uint8_t The byte, or 0 if nothing is available.
+ */
+uint8_t pipeline_rx_read_byte() {
+    if (!rx_cur && !pipeline_rx_has_data()) return 0;
+
+    uint8_t b = rx_cur->raw[rx_pos++];
+    if (rx_pos >= rx_cur->raw_len && rx_cur_local) {
+        mctp_frame_copy(&rx_last, rx_cur);
+        rx_last_local = 1;
+        rx_cur_local = 0;
+        rx_cur = NULL;
+    } else if (rx_pos >= rx_cur->raw_len) {
+        mctp_frame_copy(&rx_last, rx_cur);
+        rx_last_local = 0;
+        PROBE1(rx_consumed, rx_last.seq);
+        rx_cur = NULL;
+        fairq_pop(rx_cur_ns);
+        if (use_threads) {
+            pthread_mutex_lock(&lock);
+            pthread_cond_signal(&rx_space_cv);
+            pthread_mutex_unlock(&lock);
+        }
+    }
+    return b;
+}
+
+/**
+ * @brief Return the frame most recently consumed in full by the core.
+ *
+ * While a handler runs this is the request being handled.
+ *
+ * @return const mctp_frame_t* The frame (len 0 if none yet).
+ */
+const mctp_frame_t* pipeline_rx_last() {
+    return &rx_last;
+}
+
+/**
+ * @brief Note that the core is about to handle the frame in rx_last.
+ *
+ * Called from the I/O loop just before dispatch; responses produced
+ * afterwards measure their handler time from here.
+ */
+void pipeline_dispatch_begin() {
+    dispatch_ns = clock_now_ns();
+    in_dispatch = 1;
+    watchdog_arm(&rx_last, dispatch_ns);
+#ifdef IOTFOUNDRY_PROBES
+    unsigned type = 0xFF, cmd = 0xFFFF;
+    if (rx_last.len > MCTP_OFF_PLDM_CMD) {
+        type = rx_last.data[MCTP_OFF_MSG_TYPE] & MCTP_MSG_TYPE_MASK;
+        cmd = type == MCTP_MSG_TYPE_PLDM
+                  ? (unsigned)(rx_last.data[MCTP_OFF_PLDM_TYPE] & 0x3F) << 8 | rx_last.data[MCTP_OFF_PLDM_CMD]
+                  : rx_last.data[MCTP_OFF_CTRL_CMD];
+    }
+    PROBE3(dispatch, rx_last.seq, type, cmd);
+#endif
+}
+
+/**
+ * @brief Note that the handler dispatched by pipeline_dispatch_begin() returned.
+ */
+void pipeline_dispatch_end() {
+    watchdog_disarm();
+    in_dispatch = 0;
+    uint64_t ns = clock_now_ns() - dispatch_ns;
+    if (rx_last_local) {
+        rx_last_local = 0;
+        return;
+    }
+    fairq_charge(ns);
+    if (admit_enabled()) admit_note_handler(ns);
+    PROBE2(handler_return, rx_last.seq, ns);
+}
+
+/**
+ * @brief Tell the transmit stage that frames were queued.
+ *
+ * Inline, there is no transmit thread, so everything queued is sent now.
+ */
+static void tx_kick() {
+    if (use_threads) {
+        pthread_mutex_lock(&lock);
+        pthread_cond_signal(&tx_ready_cv);
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+
+    txsched_ref_t ref;
+    mctp_frame_t* f;
+    while ((f = txsched_peek(&ref)) != NULL) {
+        uint64_t t_start = clock_now_ns();
+        tx_write_frame(f);
+        txsched_pop(ref, t_start);
+    }
+}
+
+/**
+ * @brief Record a successful SET_ENDPOINT_ID in the flight recorder.
+ *
+ * @param req - the request being answered.
+ * @param resp - the decoded response.
+ */
+static void note_eid_change(const mctp_frame_t* req, const mctp_frame_t* resp) {
+    if (!mctp_frame_has_header(req) || mctp_frame_msg_type(req) != MCTP_MSG_TYPE_CONTROL ||
+        req->len <= MCTP_OFF_CTRL_CMD || req->data[MCTP_OFF_CTRL_CMD] != MCTP_CTRL_CMD_SET_ENDPOINT_ID) {
+        return;
+    }
+    // response: command, completion code, status, EID setting, pool size, FCS
+    if (!mctp_frame_has_header(resp) || resp->len < MCTP_OFF_CTRL_CMD + 4 + 2 ||
+        resp->data[MCTP_OFF_CTRL_CMD] != MCTP_CTRL_CMD_SET_ENDPOINT_ID || resp->data[MCTP_OFF_CTRL_CMD + 1] != 0) {
+        return;
+    }
+    assigned_eid = resp->data[MCTP_OFF_CTRL_CMD + 3];
+    owner_eid = req->data[MCTP_OFF_SRC];
+    flight_event(FLIGHT_EID_SET, assigned_eid);
+    demux_note_eid(assigned_eid);
+    eidstate_note(assigned_eid, owner_eid);
+}
+
+/**
+ * @brief Queue the assembled transmit frame for the transmit stage.
+ *
+ * Blocks while the transmit queue is full, which gives the core the same
+ * back-pressure a blocking write would.
+ */
+static void tx_queue_frame() {
+    mctp_frame_t* slot;
+
+    tx_asm.t_done_ns = clock_now_ns();
+    mctp_serial_decode(&tx_asm);
+    if (rx_last_local) {
+        // answers a request made on this host: note its effect, send nothing
+        note_eid_change(&rx_last, &tx_asm);
+        tx_asm.raw_len = 0;
+        tx_asm_has_data = 0;
+        return;
+    }
+    tx_class_t c = txsched_classify(&tx_asm);
+    stamp_response(&tx_asm, &rx_last, dispatch_ns, tx_asm.t_done_ns);
+    ctrltmpl_learn(&rx_last, &tx_asm);
+    replay_record(&rx_last, &tx_asm);
+    note_eid_change(&rx_last, &tx_asm);
+
+    pthread_mutex_lock(&lock);
+    while (!(slot = txsched_slot(TX_PRODUCER_CORE, c))) {
+        if (!use_threads) break;
+        pthread_cond_wait(&tx_space_cv, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (slot) {
+        mctp_frame_copy(slot, &tx_asm);
+        txsched_commit(TX_PRODUCER_CORE, c);
+        tx_kick();
+    }
+
+    tx_asm.raw_len = 0;
+    tx_asm_has_data = 0;
+}
+
+/**
+ * @brief Accept one byte written by the core.
+ *
+ * Bytes are gathered until the closing flag of a frame and then queued as a
+ * unit.  A frame that would overflow the buffer is queued as-is.
+ *
+ * @param b - the byte to transmit.
+ */
+void pipeline_tx_byte(uint8_t b) {
+    if (!running) return;
+    if (tx_asm.raw_len == 0) tx_asm.t_first_ns = clock_now_ns();
+
+    tx_asm.raw[tx_asm.raw_len++] = b;
+    if (b != MCTP_SERIAL_FLAG) tx_asm_has_data = 1;
+
+    if ((b == MCTP_SERIAL_FLAG && tx_asm_has_data) || tx_asm.raw_len >= MCTP_SERIAL_RAW_MAX) {
+        tx_queue_frame();
+    }
+}
+
+/**
+ * @brief Report whether the core may write.
+ *
+ * The assembly buffer always has room for the current frame, so writes are
+ * accepted whenever the stages are running.
+ *
+ * @return uint8_t Non-zero when writes are allowed.
+ */
+uint8_t pipeline_tx_can_accept() {
+    return running ? 1 : 0;
+}
+
+/**
+ * @brief Return the descriptor that becomes readable when received data is waiting.
+ *
+ * Threaded, this is the receive stage's notification eventfd; inline, it is
+ * the device itself.
+ *
+ * @return int The descriptor, or -1 when the pipeline is not running.
+ */
+int pipeline_wait_fd() {
+    if (!running) return -1;
+    return use_threads ? notify_fd : serial_fd;
+}
+
+/**
+ * @brief Note that the I/O thread is about to sleep on pipeline_wait_fd().
+ *
+ * @param timeout_ms - the longest the caller will sleep.
+ * @return int Non-zero when received data is already waiting and the caller should not sleep.
+ */
+int pipeline_wait_begin(int timeout_ms) {
+    if (rx_cur || (running && (local_pending || fairq_count()))) return 1;
+    if (running && !use_threads && (rx_buf_pos < rx_buf_len || deframed_pending)) return 1;
+
+    wait_start_ns = clock_now_ns();
+    wait_deadline_ns = wait_start_ns + (uint64_t)timeout_ms * 1000000ull;
+    if (jitter_enabled()) __atomic_store_n(&notify_ns, 0, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/**
+ * @brief Account for a sleep begun with pipeline_wait_begin().
+ *
+ * Drains the receive notification so that a level-triggered wait does not
+ * spin.  Safe to call when the I/O thread did not sleep.
+ */
+void pipeline_wait_end() {
+    int notified = 0;
+    if (running && use_threads) {
+        uint64_t count;
+        notified = read(notify_fd, &count, sizeof count) == (ssize_t)sizeof count;
+    }
+    if (!wait_start_ns) return;
+
+    /* a notification raised while asleep times the wakeup; a timeout times the oversleep */
+    uint64_t now = clock_now_ns();
+    stats_add(&endpoint_stats->io_poll_calls, 1);
+    if (notified || now < wait_deadline_ns) stats_add(&endpoint_stats->io_wakeups, 1);
+    if (jitter_enabled()) {
+        if (notified) {
+            jitter_record(JITTER_WAKE, __atomic_exchange_n(&notify_ns, 0, __ATOMIC_RELAXED), now);
+        } else if (now >= wait_deadline_ns) {
+            jitter_record(JITTER_TIMER, wait_deadline_ns, now);
+        }
+    }
+    wait_start_ns = 0;
+}
+
+/**
+ * @brief Report whether the stages run on their own threads.
+ *
+ * @return int Non-zero when threaded.
+ */
+int pipeline_threaded() {
+    return running && use_threads;
+}
+
+/**
+ * @brief Wake the transmit stage for frames queued by another thread.
+ *
+ * Only meaningful with the threaded pipeline; inline, the I/O thread
+ * transmits what it queues itself.
+ */
+void pipeline_tx_notify() {
+    if (use_threads) tx_kick();
+}
+
+/**
+ * @brief Queue a SET_ENDPOINT_ID request from the bus owner for the core.
+ *
+ * The request is generated locally and handed to the core ahead of anything
+ * received; its response is not transmitted.
+ *
+ * @param op - SET_ENDPOINT_ID operation (0 set, 2 reset).
+ * @param eid - the endpoint ID.
+ * @param owner - EID of the bus owner.
+ */
+static void queue_local_set(uint8_t op, uint8_t eid, uint8_t owner) {
+    // control header, then command, operation and the EID
+    uint8_t body[] = {
+        1, 0, owner, MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO, MCTP_MSG_TYPE_CONTROL,
+        MCTP_INSTANCE_RQ, MCTP_CTRL_CMD_SET_ENDPOINT_ID, op, eid
+    };
+    mctp_serial_encode(&local_frame, body, sizeof body);
+    local_frame.t_first_ns = local_frame.t_done_ns = clock_now_ns();
+    local_pending = 1;
+}
+
+/**
+ * @brief Give the core an endpoint ID assigned before this process started.
+ *
+ * The core ends up in the state the bus owner left it in, before it
+ * answers anything from the wire.
+ *
+ * @param eid - the endpoint ID to restore.
+ * @param owner - EID of the bus owner that assigned it.
+ */
+void pipeline_restore_eid(uint8_t eid, uint8_t owner) {
+    queue_local_set(0x00, eid, owner);
+}
+
+/**
+ * @brief Take back a restored endpoint ID that the bus owner did not confirm.
+ *
+ * @param owner - EID of the bus owner it was restored from.
+ */
+void pipeline_withdraw_eid(uint8_t owner) {
+    queue_local_set(0x02, 0, owner);
+}
+
+/**
+ * @brief Transmit a request generated on this host.  I/O thread only.
+ *
+ * @param body - transport header onwards (header version first).
+ * @param len - number of bytes in body.
+ * @return int 0 if queued, -1 if the pipeline is stopped or the queue is full.
+ */
+int pipeline_send_local(const uint8_t* body, uint8_t len) {
+    if (!running) return -1;
+    mctp_frame_t* slot = txsched_slot(TX_PRODUCER_CORE, TX_CLASS_CONTROL);
+    if (!slot) return -1;
+    mctp_serial_encode(slot, body, len);
+    slot->t_first_ns = slot->t_done_ns = clock_now_ns();
+    slot->t_sent_ns = 0;
+    slot->seq = 0;
+    slot->req.valid = 0;
+    txsched_commit(TX_PRODUCER_CORE, TX_CLASS_CONTROL);
+    tx_kick();
+    return 0;
+}
+
+/**
+ * @brief Capture the request being handled, for a response produced later.
+ *
+ * Called by a handler (I/O thread) that hands its work to another thread.
+ *
+ * @param out - receives the requester, tag and timing; timing.valid is 0 if no request is being handled.
+ * @return int 0 on success, -1 when called outside a handler.
+ */
+int pipeline_request_capture(pipeline_request_t* out) {
+    if (!in_dispatch || rx_last_local) {
+        memset(out, 0, sizeof *out);
+        return -1;
+    }
+    return capture_request(out, &rx_last, dispatch_ns);
+}
+
+/**
+ * @brief Transmit a response produced after its handler returned.  I/O thread only.
+ *
+ * The framed bytes are queued through their own producer, so nothing about
+ * the request the core is handling now (response caches, EID tracking,
+ * latency) is applied to them; latency is charged to the captured request,
+ * and the request is released from the replay cache.
+ *
+ * @param raw - one or more serial frames, flags included.
+ * @param len - number of bytes in raw.
+ * @param req - the request answered, from pipeline_request_capture(), or NULL.
+ * @param end_ns - when the response was produced.
+ * @return int Number of frames queued, -1 if the pipeline is stopped or a frame was dropped.
+ */
+int pipeline_send_deferred(const uint8_t* raw, size_t len, const pipeline_request_t* req, uint64_t end_ns) {
+    if (!running) return -1;
+    int queued = 0;
+    mctp_deframer_init(&deferred);
+    for (size_t i = 0; i < len; i++) {
+        if (!mctp_deframer_push(&deferred, raw[i], clock_now_ns())) continue;
+        mctp_frame_t* f = &deferred.frame;
+        tx_class_t c = txsched_classify(f);
+        f->req.valid = 0;
+        if (req) stamp_captured(f, req, end_ns);
+        f->seq = 0;
+        f->t_sent_ns = 0;
+
+        mctp_frame_t* slot;
+        pthread_mutex_lock(&lock);
+        while (!(slot = txsched_slot(TX_PRODUCER_WORK, c))) {
+            if (!use_threads) break;
+            pthread_cond_wait(&tx_space_cv, &lock);
+        }
+        pthread_mutex_unlock(&lock);
+        if (!slot) {
+            queued = -1;
+            break;
+        }
+        mctp_frame_copy(slot, f);
+        txsched_commit(TX_PRODUCER_WORK, c);
+        tx_kick();
+        if (req && req->timing.valid) replay_record_answer(req->seq, req->src, req->tag, f);
+        queued++;
+    }
+    if (req && req->timing.valid) replay_complete(req->seq);
+    return queued;
+}
+
+/**
+ * @brief Report the endpoint ID last assigned by the bus owner.
+ *
+ * @param eid - receives the endpoint ID.
+ * @param owner - receives the EID of the bus owner that assigned it.
+ * @return int Non-zero when an endpoint ID has been assigned.
+ */
+int pipeline_eid(uint8_t* eid, uint8_t* owner) {
+    *eid = assigned_eid;
+    *owner = owner_eid;
+    return assigned_eid != 0;
+}
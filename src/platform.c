@@ -3,7 +3,9 @@
  * @brief Platform API shim layer for Linux microcontrollers/microprocessors.
  * 
  * Provides implementations of platform-specific functions for serial I/O.  Initialization
- * is performed based on command-line settings.
+ * is performed based on command-line settings.  Byte-level reads and writes from the core
+ * are served by the receive/transmit pipeline (pipeline.c) rather than by one system call
+ * per byte.
  *
  * @author Douglas Sandy
  *
@@ -35,6 +37,9 @@
 #endif
 #include "core/platform.h"
 #include "config.h"
+#include "log.h"
+#include "pipeline.h"
+#include "ttyq.h"
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -44,7 +49,6 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <sys/select.h>
 #include <sys/time.h>
 #include <termios.h>
 #include <unistd.h>
@@ -52,6 +56,64 @@
 /* Global/static serial device instance for platform serial I/O */
 extern config_t serial_device;
 
+/**
+ * @brief Convert a termios speed constant to bits per second.
+ *
+ * @param speed - termios speed (e.g. B9600) or a plain rate (e.g. 115200).
+ * @return unsigned The line rate, or 0 if the constant is not recognized.
+ */
+static unsigned speedToBps(int speed) {
+    static const struct {
+        int speed;
+        unsigned bps;
+    } speedMap[] = {
+        {B4800, 4800}, {B9600, 9600}, {B19200, 19200}, {B38400, 38400},
+        {B57600, 57600}, {B115200, 115200}, {B230400, 230400}, {0, 0}
+    };
+
+    // the default configuration holds a plain rate rather than a termios constant
+    for (const typeof(speedMap[0]) *e = speedMap; e->bps != 0; ++e) {
+        if (e->speed == speed || (int)e->bps == speed) return e->bps;
+    }
+    return 0;
+}
+
+/**
+ * @brief Adopt a descriptor opened by a service manager, a parent process or a
+ * --takeover predecessor.
+ *
+ * Line settings are left as whoever opened the descriptor chose them; only
+ * queue sampling and transmit pacing depend on what kind of file it is.
+ *
+ * @param fd - the inherited descriptor.
+ */
+static void adopt_inherited(int fd) {
+    printf("  Using inherited descriptor %d\n", fd);
+    serial_device.fd = fd;
+
+    struct termios tty;
+    const char* slave_name;
+    if (tcgetattr(fd, &tty) != 0) {
+        // a socket or pipe: no line settings, no driver queues to sample and no wire to pace
+        printf("  Socket or pipe, unpaced\n");
+    } else if ((slave_name = ptsname(fd)) != NULL) {
+        // a pty master: queues are sampled as for a pty created here, but nothing is paced.
+        // Clients open the slave; a predecessor has already reported it, a service manager has not
+        ttyq_init(fd, (unsigned)serial_device.tty_sample_ms);
+        if (serial_device.path[0] == '\0') {
+            snprintf(serial_device.path, SERIAL_PATH_MAX, "%s", slave_name);
+        }
+        printf("  Pty device: %s\n", serial_device.path);
+    } else {
+        // any other tty is taken to be a serial line, paced at the output speed it was left at
+        unsigned bps = speedToBps((int)cfgetospeed(&tty));
+        ttyq_init(fd, (unsigned)serial_device.tty_sample_ms);
+        pipeline_set_pacing(bps, serial_device.tx_outq_limit);
+        printf("  Tty at %u bps\n", bps);
+    }
+    fflush(stdout);
+}
+
 /**
  * @brief Initialize platform hardware.
  *
@@ -61,24 +123,33 @@ extern config_t serial_device;
 void platform_init(void) {
     // special case: if path is empty, create a ptys pair for testing
     printf("Initializing platform serial interface...\n");
+    if (serial_device.inherit_fd >= 0) {
+        adopt_inherited(serial_device.inherit_fd);
+        if (pipeline_start(serial_device.fd, serial_device.pipeline) != 0) {
+            close(serial_device.fd);
+            serial_device.fd = -1;
+        }
+        return;
+    }
     printf("  Device path: %s\n", serial_device.path[0] == '\0' ? "(pty)" : serial_device.path);
     printf("  Baud rate: %d\n", serial_device.baud);
     printf("  Hardware flow control: %s\n", serial_device.hwflow ? "ENABLED" : "DISABLED");
-    if (serial_device.path[0] == '\0') {
+    int is_pty = serial_device.path[0] == '\0';
+    if (is_pty) {
         // open a pty device and get its name
         int master_fd = posix_openpt(O_RDWR | O_NOCTTY);
         if (master_fd == -1) {
-            perror("posix_openpt");
+            LOG_ERROR("posix_openpt: %m");
             return;
         }
         if (grantpt(master_fd) == -1 || unlockpt(master_fd) == -1) {
-            perror("grantpt/unlockpt");
+            LOG_ERROR("grantpt/unlockpt: %m");
             close(master_fd);
             return;
         }
         char* slave_name = ptsname(master_fd);
         if (slave_name == NULL) {
-            perror("ptsname");
+            LOG_ERROR("ptsname: %m");
             close(master_fd);
             return;
         }
@@ -91,7 +162,7 @@ void platform_init(void) {
     } else {
         serial_device.fd = open(serial_device.path, O_RDWR | O_NOCTTY | O_NDELAY);
         if (serial_device.fd == -1) {
-            perror("open");
+            LOG_ERROR("open %s: %m", serial_device.path);
             return;
         }
 
@@ -100,7 +171,7 @@ void platform_init(void) {
         memset(&tty, 0, sizeof tty);
 
         if (tcgetattr(serial_device.fd, &tty) != 0) {
-            perror("tcgetattr");
+            LOG_ERROR("tcgetattr: %m");
             close(serial_device.fd);
             serial_device.fd = -1;
             return;
@@ -128,12 +199,26 @@ void platform_init(void) {
 
         // Apply settings
         if (tcsetattr(serial_device.fd, TCSANOW, &tty) != 0) {
-            perror("tcsetattr");
+            LOG_ERROR("tcsetattr: %m");
             close(serial_device.fd);
             serial_device.fd = -1;
             return;
         }
     }
+
+    // queue depths and driver errors are sampled on ptys too, for testing
+    ttyq_init(serial_device.fd, (unsigned)serial_device.tty_sample_ms);
+
+    // pace transmit on real lines only; a pty has no wire to wait for
+    if (!is_pty) {
+        pipeline_set_pacing(speedToBps(serial_device.baud), serial_device.tx_outq_limit);
+    }
+
+    // start the receive/transmit stages on the open device
+    if (pipeline_start(serial_device.fd, serial_device.pipeline) != 0) {
+        close(serial_device.fd);
+        serial_device.fd = -1;
+    }
 }
 
 /**
@@ -143,50 +228,31 @@ void platform_init(void) {
  */
 uint8_t platform_serial_has_data(void) {
     if (serial_device.fd == -1) return 0;
-
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    FD_SET(serial_device.fd, &rfds);
-
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 0; /* non-blocking */
-
-    int ret = select(serial_device.fd + 1, &rfds, NULL, NULL, &tv);
-    if (ret > 0) {
-        return FD_ISSET(serial_device.fd, &rfds) ? 1 : 0;
-    }
-    /* on error or no data available, return 0 */
-    return 0;
+    return pipeline_rx_has_data();
 }
 
 /**
- * @brief Read a byte from the serial interface. May block if no data is available.
+ * @brief Read a byte from the serial interface.
+ *
+ * Bytes come from frames already collected by the receive stage, so this does
+ * not make a system call.
  *
- * @return uint8_t The byte read from the serial interface.
+ * @return uint8_t The byte read from the serial interface, or 0 if none is available.
  */
 uint8_t platform_serial_read_byte(void) {
-    uint8_t byte;
-    ssize_t result = read(serial_device.fd, &byte, 1);
-    if (result == 1) {
-        return byte;
-    } else {
-        /* on error or no data, return 0 */
-        return 0;
-    }
+    return pipeline_rx_read_byte();
 }
 
 /**
- * @brief Write a byte to the serial interface. May block if the interface is not ready.
+ * @brief Write a byte to the serial interface.
+ *
+ * The byte is added to the frame being assembled for the transmit stage.  This
+ * only blocks when the transmit queue is full.
  *
  * @param b The byte to write.
  */
 void platform_serial_write_byte(uint8_t b) {
-    ssize_t result = write(serial_device.fd, &b, 1);
-    if (result != 1) {
-        /* handle error */
-        perror("write");
-    }   
+    pipeline_tx_byte(b);
 }
 
 /**
@@ -196,19 +262,5 @@ void platform_serial_write_byte(uint8_t b) {
  */
 uint8_t platform_serial_can_write(void) {
     if (serial_device.fd == -1) return 0;
-
-    fd_set wfds;
-    FD_ZERO(&wfds);
-    FD_SET(serial_device.fd, &wfds);
-
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 0; /* non-blocking */
-
-    int ret = select(serial_device.fd + 1, NULL, &wfds, NULL, &tv);
-    if (ret > 0) {
-        return FD_ISSET(serial_device.fd, &wfds) ? 1 : 0;
-    }
-    /* on error or not writable, return 0 */
-    return 0;
+    return pipeline_tx_can_accept();
 }
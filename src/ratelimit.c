@@ -0,0 +1,218 @@
+/**
+ * @file ratelimit.c
+ * @brief Token buckets for received requests, used by the receive stage only.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "ratelimit.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EIDS 256
+#define TYPES (MCTP_MSG_TYPE_MASK + 1)
+
+typedef struct {
+    double rate;        /* tokens per second, 0 = unlimited */
+    double burst;       /* bucket size */
+    double tokens;
+    uint64_t last_ns;   /* last refill */
+    uint64_t passed;
+    uint64_t limited;
+} bucket_t;
+
+static bucket_t eid_buckets[EIDS];
+static bucket_t type_buckets[TYPES];
+static int enabled = 0;
+
+/**
+ * @brief Parse "<rate>[/<burst>]" into a bucket.
+ *
+ * @param s - the value text.
+ * @param b - bucket to configure.
+ * @return int 0 on success, -1 if malformed.
+ */
+static int parse_bucket(const char* s, bucket_t* b) {
+    char* end = NULL;
+    double rate = strtod(s, &end);
+    if (end == s || rate < 0) return -1;
+    double burst = rate < 1 ? 1 : rate;   // a second's worth by default
+    if (*end == '/') {
+        const char* bs = end + 1;
+        burst = strtod(bs, &end);
+        if (end == bs || burst < 1) return -1;
+    }
+    if (*end != '\0') return -1;
+    b->rate = rate;
+    b->burst = burst;
+    b->tokens = burst;
+    return 0;
+}
+
+/**
+ * @brief Parse a key's numeric suffix ("eid.8" -> 8).
+ *
+ * @param s - text after the dot.
+ * @param limit - largest value accepted.
+ * @return int The value, or -1 if malformed or out of range.
+ */
+static int parse_index(const char* s, unsigned long limit) {
+    char* end = NULL;
+    unsigned long v = strtoul(s, &end, 0);
+    if (end == s || *end != '\0' || v > limit) return -1;
+    return (int)v;
+}
+
+/**
+ * @brief Parse a rate limit specification and enable the limits it names.
+ *
+ * @param spec - comma separated items (see ratelimit.h); NULL or empty
+ *               leaves every request unlimited.
+ * @return int 0 on success, -1 if the specification is malformed.
+ */
+int ratelimit_init(const char* spec) {
+    memset(eid_buckets, 0, sizeof eid_buckets);
+    memset(type_buckets, 0, sizeof type_buckets);
+    enabled = 0;
+    if (!spec || !*spec) return 0;
+
+    char* copy = strdup(spec);
+    if (!copy) return -1;
+    bucket_t def = {0};
+    uint8_t eid_set[EIDS] = {0};
+    int rc = 0;
+    for (char* save = NULL, *item = strtok_r(copy, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        char* eq = strchr(item, '=');
+        if (!eq) {
+            rc = -1;
+            break;
+        }
+        *eq++ = '\0';
+        int n;
+        if (strcmp(item, "eid") == 0) {
+            rc = parse_bucket(eq, &def);
+        } else if (strncmp(item, "eid.", 4) == 0 && (n = parse_index(item + 4, EIDS - 1)) >= 0) {
+            rc = parse_bucket(eq, &eid_buckets[n]);
+            eid_set[n] = 1;
+        } else if (strncmp(item, "type.", 5) == 0 && (n = parse_index(item + 5, TYPES - 1)) >= 0) {
+            rc = parse_bucket(eq, &type_buckets[n]);
+        } else {
+            rc = -1;
+        }
+        if (rc) break;
+    }
+    free(copy);
+    if (rc) return -1;
+
+    for (int e = 0; e < EIDS; e++) {
+        if (!eid_set[e]) eid_buckets[e] = def;
+        if (eid_buckets[e].rate > 0) enabled = 1;
+    }
+    for (int t = 0; t < TYPES; t++) {
+        if (type_buckets[t].rate > 0) enabled = 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Report whether any limit is configured.
+ *
+ * @return int Non-zero when ratelimit_allow() may refuse requests.
+ */
+int ratelimit_enabled() {
+    return enabled;
+}
+
+/**
+ * @brief Add the tokens earned since the last refill.
+ *
+ * @param b - the bucket.
+ * @param now_ns - current time.
+ */
+static void refill(bucket_t* b, uint64_t now_ns) {
+    if (b->last_ns && now_ns > b->last_ns) {
+        b->tokens += (double)(now_ns - b->last_ns) * b->rate / 1e9;
+        if (b->tokens > b->burst) b->tokens = b->burst;
+    }
+    b->last_ns = now_ns;
+}
+
+/**
+ * @brief Take a token for a received request if both of its buckets have one.
+ *
+ * Only the first packet of a request message is counted; responses and
+ * continuation packets always pass.
+ *
+ * @param f - the received frame.
+ * @param now_ns - current time.
+ * @return int 1 if the frame may be queued, 0 if it is over a limit.
+ */
+int ratelimit_allow(const mctp_frame_t* f, uint64_t now_ns) {
+    if (!enabled || !mctp_frame_has_header(f) || !mctp_frame_is_request(f)) return 1;
+    if (!(f->data[MCTP_OFF_FLAGS] & MCTP_FLAG_SOM)) return 1;
+
+    bucket_t* e = &eid_buckets[f->data[MCTP_OFF_SRC]];
+    bucket_t* t = &type_buckets[mctp_frame_msg_type(f)];
+    if (e->rate > 0) refill(e, now_ns);
+    if (t->rate > 0) refill(t, now_ns);
+    if (e->rate > 0 && e->tokens < 1) {
+        e->limited++;
+        return 0;
+    }
+    if (t->rate > 0 && t->tokens < 1) {
+        t->limited++;
+        return 0;
+    }
+    if (e->rate > 0) {
+        e->tokens -= 1;
+        e->passed++;
+    }
+    if (t->rate > 0) {
+        t->tokens -= 1;
+        t->passed++;
+    }
+    return 1;
+}
+
+/**
+ * @brief Print the limits that saw traffic and what they refused.
+ *
+ * @param out - stream to print to.
+ */
+void ratelimit_dump_stats(FILE* out) {
+    if (!enabled) return;
+    fprintf(out, "Rate limits:\n");
+    for (int e = 0; e < EIDS; e++) {
+        const bucket_t* b = &eid_buckets[e];
+        if (!b->passed && !b->limited) continue;
+        fprintf(out, "  eid %-5d %8.1f/s burst %-6.0f %10llu passed %10llu limited\n", e, b->rate, b->burst,
+                (unsigned long long)b->passed, (unsigned long long)b->limited);
+    }
+    for (int t = 0; t < TYPES; t++) {
+        const bucket_t* b = &type_buckets[t];
+        if (!b->passed && !b->limited) continue;
+        fprintf(out, "  type %-4d %8.1f/s burst %-6.0f %10llu passed %10llu limited\n", t, b->rate, b->burst,
+                (unsigned long long)b->passed, (unsigned long long)b->limited);
+    }
+}
@@ -0,0 +1,432 @@
+/**
+ * @file replay.c
+ * @brief Duplicate-request detection and response replay cache.
+ *
+ * Lookups happen on the receive stage and responses are recorded on the I/O
+ * thread as the core writes them, so the table is protected by a mutex.  The
+ * table is a small fixed array searched linearly; entries hold the escaped
+ * wire image of every packet of the response so a replay is byte-identical
+ * to the original.
+ *
+ * Only responses to read-only queries are kept.  Any other request may change
+ * the state those answers were computed from, so it clears the stored
+ * responses when it arrives and again when it has been answered.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "replay.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock.h"
+
+typedef enum { ENTRY_EMPTY = 0, ENTRY_PENDING, ENTRY_READY } entry_state_t;
+
+/* MCTP control queries */
+static const uint8_t control_queries[] = {
+    0x02,  // Get Endpoint ID
+    0x03,  // Get Endpoint UUID
+    0x04,  // Get MCTP Version Support
+    0x05,  // Get Message Type Support
+    0x06,  // Get Vendor Defined Message Support
+};
+
+/* PLDM queries, as (PLDM type, command) */
+static const uint8_t pldm_queries[][2] = {
+    {0x00, 0x02},  // base: GetTID
+    {0x00, 0x03},  // base: GetPLDMVersion
+    {0x00, 0x04},  // base: GetPLDMTypes
+    {0x00, 0x05},  // base: GetPLDMCommands
+    {0x02, 0x50},  // platform: GetPDRRepositoryInfo
+    {0x02, 0x51},  // platform: GetPDR
+    {0x02, 0x53},  // platform: GetPDRRepositorySignature
+    {0x04, 0x01},  // FRU: GetFRURecordTableMetadata
+    {0x04, 0x02},  // FRU: GetFRURecordTable
+};
+
+typedef struct {
+    uint8_t state;
+    uint8_t src;             /* key: requester EID */
+    uint8_t tag;             /* key: message tag */
+    uint8_t msg_type;        /* key: MCTP message type */
+    uint8_t instance;        /* key: instance id */
+    uint8_t query;           /* read-only request: its answer goes stale when state changes */
+    uint32_t hash;           /* key: hash of the message bytes */
+    uint32_t seq;            /* receive sequence number of the original request */
+    uint64_t t_created_ns;
+    uint64_t last_used;
+    uint16_t raw_used;
+    replay_response_t resp;
+} entry_t;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static entry_t* entries = NULL;
+static unsigned entry_count = 0;
+static uint64_t ttl_ns = 0;
+static uint64_t use_clock = 0;
+static replay_stats_t stats;
+
+/**
+ * @brief Allocate the cache.
+ *
+ * @param count - number of entries (0 disables the cache).
+ * @param ttl_ms - lifetime of an entry in milliseconds.
+ * @return int 0 on success, -1 on allocation failure.
+ */
+int replay_init(unsigned count, unsigned ttl_ms) {
+    pthread_mutex_lock(&lock);
+    free(entries);
+    entries = NULL;
+    entry_count = 0;
+    memset(&stats, 0, sizeof stats);
+    if (count > REPLAY_MAX_ENTRIES) count = REPLAY_MAX_ENTRIES;
+    if (count) {
+        entries = calloc(count, sizeof(entry_t));
+        if (!entries) {
+            pthread_mutex_unlock(&lock);
+            return -1;
+        }
+    }
+    entry_count = count;
+    ttl_ns = (uint64_t)(ttl_ms ? ttl_ms : REPLAY_DEFAULT_TTL_MS) * 1000000ull;
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+/**
+ * @brief Release the cache.
+ */
+void replay_free() {
+    pthread_mutex_lock(&lock);
+    free(entries);
+    entries = NULL;
+    entry_count = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Report whether a frame is a single-packet request that expects a response.
+ *
+ * Only MCTP control and PLDM messages carry the Rq/D/instance id byte that
+ * makes retransmissions recognizable.
+ *
+ * @param f - received frame.
+ * @return int Non-zero if the frame can be tracked.
+ */
+static int trackable(const mctp_frame_t* f) {
+    if (!mctp_frame_has_header(f) || f->len < MCTP_OFF_INSTANCE + 4) return 0;
+    uint8_t flags = f->data[MCTP_OFF_FLAGS];
+    if ((flags & (MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO)) !=
+        (MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO)) {
+        return 0;
+    }
+    uint8_t type = f->data[MCTP_OFF_MSG_TYPE];
+    if (type != MCTP_MSG_TYPE_CONTROL && type != MCTP_MSG_TYPE_PLDM) return 0;
+    return (f->data[MCTP_OFF_INSTANCE] & (MCTP_INSTANCE_RQ | MCTP_INSTANCE_D)) == MCTP_INSTANCE_RQ;
+}
+
+/**
+ * @brief Report whether a trackable request only reads endpoint state.
+ *
+ * Every other request is treated as one that may change state, so that its
+ * completion clears the stored query answers.
+ *
+ * @param f - a trackable frame.
+ * @return int Non-zero for the queries listed above.
+ */
+static int is_query(const mctp_frame_t* f) {
+    if (f->data[MCTP_OFF_MSG_TYPE] == MCTP_MSG_TYPE_CONTROL) {
+        for (unsigned i = 0; i < sizeof control_queries; i++) {
+            if (f->data[MCTP_OFF_CTRL_CMD] == control_queries[i]) return 1;
+        }
+        return 0;
+    }
+    uint8_t type = f->data[MCTP_OFF_PLDM_TYPE] & 0x3F;
+    for (unsigned i = 0; i < sizeof pldm_queries / sizeof pldm_queries[0]; i++) {
+        if (type == pldm_queries[i][0] && f->data[MCTP_OFF_PLDM_CMD] == pldm_queries[i][1]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Drop every stored query answer.  Caller holds the lock.
+ *
+ * Answers to state-changing requests stay, since a retransmission of one
+ * must not run its handler again.  Pending entries stay too, so copies of
+ * requests still being handled are dropped as before.
+ */
+static void flush_locked() {
+    for (unsigned i = 0; i < entry_count; i++) {
+        if (entries[i].state == ENTRY_READY && entries[i].query) {
+            entries[i].state = ENTRY_EMPTY;
+            stats.flushed++;
+        }
+    }
+}
+
+/**
+ * @brief FNV-1a hash of the message bytes of a frame.
+ *
+ * @param f - a trackable frame.
+ * @return uint32_t Hash of the message type through the last message byte.
+ */
+static uint32_t message_hash(const mctp_frame_t* f) {
+    uint32_t h = 2166136261u;
+    for (uint16_t i = MCTP_OFF_MSG_TYPE; i < f->len - 2; i++) {
+        h = (h ^ f->data[i]) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Look up a received request and decide how to handle it.
+ *
+ * New requests are entered into the cache as pending so that duplicates
+ * arriving while the core is still busy can be recognized.
+ *
+ * @param req - received frame.
+ * @param out - receives the cached response on REPLAY_HIT.
+ * @return replay_result_t How the receive stage should treat the frame.
+ */
+replay_result_t replay_lookup(const mctp_frame_t* req, replay_response_t* out) {
+    if (!entry_count || !trackable(req)) return REPLAY_MISS;
+
+    uint8_t src = req->data[MCTP_OFF_SRC];
+    uint8_t tag = req->data[MCTP_OFF_FLAGS] & MCTP_FLAG_TAG_MASK;
+    uint8_t type = req->data[MCTP_OFF_MSG_TYPE];
+    uint8_t iid = req->data[MCTP_OFF_INSTANCE] & MCTP_INSTANCE_ID_MASK;
+    uint32_t hash = message_hash(req);
+    int query = is_query(req);
+    uint64_t now = clock_now_ns();
+
+    pthread_mutex_lock(&lock);
+    stats.lookups++;
+
+    entry_t* victim = NULL;
+    for (unsigned i = 0; i < entry_count; i++) {
+        entry_t* e = &entries[i];
+        if (e->state != ENTRY_EMPTY && now - e->t_created_ns > ttl_ns) {
+            e->state = ENTRY_EMPTY;
+            stats.expirations++;
+        }
+        if (e->state == ENTRY_EMPTY) {
+            if (!victim || victim->state != ENTRY_EMPTY) victim = e;
+            continue;
+        }
+        if (e->src == src && e->tag == tag && e->msg_type == type && e->instance == iid &&
+            e->hash == hash) {
+            e->last_used = ++use_clock;
+            replay_result_t r = REPLAY_IN_PROGRESS;
+            if (e->state == ENTRY_READY) {
+                if (out) *out = e->resp;
+                stats.hits++;
+                r = REPLAY_HIT;
+            } else {
+                stats.in_progress++;
+            }
+            pthread_mutex_unlock(&lock);
+            return r;
+        }
+        if (!victim || (victim->state != ENTRY_EMPTY && e->last_used < victim->last_used)) {
+            victim = e;
+        }
+    }
+
+    // remember the new request as pending, displacing the least recently used entry
+    stats.misses++;
+    if (victim->state != ENTRY_EMPTY) stats.evictions++;
+    victim->state = ENTRY_PENDING;
+    victim->src = src;
+    victim->tag = tag;
+    victim->msg_type = type;
+    victim->instance = iid;
+    victim->query = (uint8_t)query;
+    victim->hash = hash;
+    victim->seq = req->seq;
+    victim->t_created_ns = now;
+    victim->last_used = ++use_clock;
+    victim->raw_used = 0;
+    victim->resp.frames = 0;
+    pthread_mutex_unlock(&lock);
+    return REPLAY_MISS;
+}
+
+/**
+ * @brief Record a response packet the core wrote while handling a request.
+ *
+ * @param req - the request the core was processing.
+ * @param resp - the outgoing frame.
+ */
+void replay_record(const mctp_frame_t* req, const mctp_frame_t* resp) {
+    if (!entry_count || !trackable(req)) return;
+    replay_record_answer(req->seq, req->data[MCTP_OFF_SRC],
+                         req->data[MCTP_OFF_FLAGS] & MCTP_FLAG_TAG_MASK, resp);
+}
+
+/**
+ * @brief Record a response packet to a pending request.
+ *
+ * The response is kept once its last packet is seen.  When a request that
+ * is not a query has been answered, the stored query answers are cleared
+ * first, since they may predate a change it made.
+ *
+ * @param seq - receive sequence number of the request.
+ * @param src - requester EID.
+ * @param tag - the request's message tag.
+ * @param resp - the outgoing frame.
+ */
+void replay_record_answer(uint32_t seq, uint8_t src, uint8_t tag, const mctp_frame_t* resp) {
+    if (!entry_count || resp->status != MCTP_FRAME_OK || resp->len < MCTP_OFF_MSG_TYPE + 2) return;
+    uint8_t flags = resp->data[MCTP_OFF_FLAGS];
+    if ((flags & MCTP_FLAG_TO) || (flags & MCTP_FLAG_TAG_MASK) != tag ||
+        resp->data[MCTP_OFF_DEST] != src) {
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    entry_t* e = NULL;
+    for (unsigned i = 0; i < entry_count; i++) {
+        if (entries[i].state == ENTRY_PENDING && entries[i].seq == seq) {
+            e = &entries[i];
+            break;
+        }
+    }
+    if (!e) {
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+
+    if (flags & MCTP_FLAG_SOM) {
+        e->raw_used = 0;
+        e->resp.frames = 0;
+    }
+    if (e->resp.frames >= REPLAY_MAX_FRAMES || e->raw_used + resp->raw_len > REPLAY_RAW_MAX) {
+        // too big to keep; stop suppressing duplicates of it as well
+        e->state = ENTRY_EMPTY;
+        stats.uncacheable++;
+        if (!e->query) flush_locked();
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+    memcpy(&e->resp.raw[e->raw_used], resp->raw, resp->raw_len);
+    e->resp.frame_len[e->resp.frames++] = resp->raw_len;
+    e->raw_used += resp->raw_len;
+    if (flags & MCTP_FLAG_EOM) {
+        if (!e->query) flush_locked();
+        e->state = ENTRY_READY;
+        stats.stored++;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Forget a request that will not reach the core after all.
+ *
+ * Called when the receive stage answers a request that replay_lookup() has
+ * just recorded as pending, so that its retransmission is handled afresh.
+ *
+ * @param req - the request.
+ */
+void replay_cancel(const mctp_frame_t* req) {
+    if (!entry_count || !trackable(req)) return;
+
+    pthread_mutex_lock(&lock);
+    for (unsigned i = 0; i < entry_count; i++) {
+        if (entries[i].state == ENTRY_PENDING && entries[i].seq == req->seq) {
+            entries[i].state = ENTRY_EMPTY;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Release a request answered outside the core's write path.
+ *
+ * Called once a worker's response has been passed to replay_record_answer().
+ * A request still pending then had an answer that could not be kept; if it
+ * was not a query, the stored query answers are cleared, as for one that was.
+ *
+ * @param seq - receive sequence number of the request.
+ */
+void replay_complete(uint32_t seq) {
+    if (!entry_count) return;
+
+    pthread_mutex_lock(&lock);
+    for (unsigned i = 0; i < entry_count; i++) {
+        if (entries[i].state == ENTRY_PENDING && entries[i].seq == seq) {
+            entries[i].state = ENTRY_EMPTY;
+            if (!entries[i].query) flush_locked();
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Drop every stored query answer after endpoint state changed.
+ *
+ * Called when state is restored or changed other than by a request the
+ * cache saw, for example when the saved EID is replayed to the core.
+ */
+void replay_flush() {
+    if (!entry_count) return;
+
+    pthread_mutex_lock(&lock);
+    flush_locked();
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Copy the cache counters.
+ *
+ * @param out - destination for the snapshot.
+ */
+void replay_get_stats(replay_stats_t* out) {
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Print the cache counters and hit rate.
+ *
+ * @param out - stream to print to.
+ */
+void replay_dump_stats(FILE* out) {
+    replay_stats_t s;
+    replay_get_stats(&s);
+    if (!entry_count && !s.lookups) return;
+    double rate = s.lookups ? 100.0 * (double)(s.hits + s.in_progress) / (double)s.lookups : 0.0;
+    fprintf(out, "Replay cache: %llu lookups, %llu replayed, %llu in-progress drops (%.1f%% duplicate), "
+                 "%llu stored, %llu evicted, %llu expired, %llu flushed, %llu uncacheable\n",
+            (unsigned long long)s.lookups, (unsigned long long)s.hits,
+            (unsigned long long)s.in_progress, rate, (unsigned long long)s.stored,
+            (unsigned long long)s.evictions, (unsigned long long)s.expirations,
+            (unsigned long long)s.flushed, (unsigned long long)s.uncacheable);
+}
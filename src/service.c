@@ -0,0 +1,234 @@
+/**
+ * @file service.c
+ * @brief LISTEN_FDS descriptors, readiness notification and time-to-ready.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "service.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "log.h"
+#include "stats.h"
+
+static uint64_t start_ns = 0;
+static uint64_t ready_ns = 0;      /* start to ready, 0 until ready */
+
+/**
+ * @brief Remember when the process started; later calls keep the first time.
+ *
+ * The endpoint program calls this first thing in main(), so time-to-ready
+ * covers option parsing and the whole of endpoint_init().
+ */
+void service_mark_start() {
+    if (!start_ns) start_ns = clock_now_ns();
+}
+
+/**
+ * @brief Report whether a descriptor is a socket accepting connections.
+ *
+ * @param fd - the descriptor.
+ * @return int Non-zero for a listening socket.
+ */
+static int is_listening(int fd) {
+    int on = 0;
+    socklen_t len = sizeof on;
+    return getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &on, &len) == 0 && on;
+}
+
+/**
+ * @brief Take descriptors passed by a service manager with the LISTEN_FDS protocol.
+ *
+ * Descriptors named "demux" or "takeover" in LISTEN_FDNAMES become those
+ * listening sockets.  A descriptor named "device", or any unnamed one that
+ * is not a listening socket (a tty, a connected socket, a pipe), becomes
+ * the device.  The variables are removed so they are not passed on.
+ *
+ * @param cfg - configuration to update; command-line options given later still win.
+ * @return int Number of descriptors taken, -1 if the variables are malformed.
+ */
+int service_collect_fds(config_t* cfg) {
+    service_mark_start();
+    const char* pid = getenv("LISTEN_PID");
+    const char* fds = getenv("LISTEN_FDS");
+    if (!pid || !fds || strtol(pid, NULL, 10) != (long)getpid()) return 0;
+
+    char* end;
+    long count = strtol(fds, &end, 10);
+    const char* names = getenv("LISTEN_FDNAMES");
+    char* list = strdup(names ? names : "");
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    unsetenv("LISTEN_FDNAMES");
+    if (*end || count < 0 || count > 64 || !list) {
+        printf("Error: bad LISTEN_FDS '%s'.\n", fds);
+        free(list);
+        return -1;
+    }
+
+    int taken = 0;
+    char* next = list;
+    for (int fd = SERVICE_LISTEN_FDS_START; fd < SERVICE_LISTEN_FDS_START + count; fd++) {
+        const char* name = next ? strsep(&next, ":") : "";
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            printf("Error: LISTEN_FDS descriptor %d is not open.\n", fd);
+            free(list);
+            return -1;
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        const char* role;
+        if (!strcmp(name, SERVICE_FDNAME_DEMUX)) {
+            cfg->demux_fd = fd;
+            role = "demux socket";
+        } else if (!strcmp(name, SERVICE_FDNAME_TAKEOVER)) {
+            cfg->takeover_fd = fd;
+            role = "takeover socket";
+        } else if (cfg->inherit_fd < 0 && (!strcmp(name, SERVICE_FDNAME_DEVICE) || !is_listening(fd))) {
+            cfg->inherit_fd = fd;
+            role = "device";
+        } else {
+            printf("Warning: LISTEN_FDS descriptor %d (%s) has no use, ignored.\n", fd, name[0] ? name : "unnamed");
+            continue;
+        }
+        printf("Socket activation: descriptor %d%s%s%s is the %s\n", fd,
+               name[0] ? " (" : "", name, name[0] ? ")" : "", role);
+        taken++;
+    }
+    free(list);
+    return taken;
+}
+
+/**
+ * @brief Write a message without letting a vanished reader raise SIGPIPE.
+ *
+ * @param fd - socket, pipe or file.
+ * @param msg - the bytes.
+ * @param len - number of bytes.
+ * @return int 0 if everything was written, -1 otherwise.
+ */
+static int write_nosignal(int fd, const char* msg, size_t len) {
+    ssize_t n = send(fd, msg, len, MSG_NOSIGNAL);
+    if (n >= 0 || errno != ENOTSOCK) return n == (ssize_t)len ? 0 : -1;
+
+    // a pipe: block SIGPIPE around the write and discard one it raised
+    sigset_t pipe_set, old, pending;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &old);
+    sigpending(&pending);
+    int was_pending = sigismember(&pending, SIGPIPE);
+    n = write(fd, msg, len);
+    if (n < 0 && errno == EPIPE && !was_pending) {
+        struct timespec zero = { 0, 0 };
+        sigtimedwait(&pipe_set, NULL, &zero);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return n == (ssize_t)len ? 0 : -1;
+}
+
+/**
+ * @brief Send a message to the service manager's NOTIFY_SOCKET, if there is one.
+ *
+ * @param msg - newline-separated assignments.
+ * @param len - number of bytes.
+ */
+static void notify_socket(const char* msg, size_t len) {
+    const char* path = getenv("NOTIFY_SOCKET");
+    if (!path || !*path) return;
+
+    struct sockaddr_un addr;
+    size_t path_len = strlen(path);
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (path_len >= sizeof addr.sun_path || (path[0] != '/' && path[0] != '@')) {
+        LOG_WARN("NOTIFY_SOCKET %s is not a UNIX socket path", path);
+        return;
+    }
+    memcpy(addr.sun_path, path, path_len);
+    if (path[0] == '@') addr.sun_path[0] = '\0';
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || sendto(fd, msg, len, MSG_NOSIGNAL, (struct sockaddr*)&addr,
+                         (socklen_t)(offsetof(struct sockaddr_un, sun_path) + path_len)) != (ssize_t)len) {
+        LOG_WARN("NOTIFY_SOCKET %s: %m", path);
+    }
+    if (fd >= 0) close(fd);
+}
+
+/**
+ * @brief Announce that the endpoint accepts traffic.  Called once.
+ *
+ * The time since service_mark_start() is logged, published in the
+ * statistics segment and included in the message.
+ *
+ * @param ready_fd - descriptor to write the message to and close, or -1.
+ * @param device - device path (the pty slave when simulating), may be empty.
+ * @param eid - endpoint ID in force, 0 if none has been assigned yet.
+ */
+void service_ready(int ready_fd, const char* device, uint8_t eid) {
+    service_mark_start();
+    ready_ns = clock_now_ns() - start_ns;
+    if (!ready_ns) ready_ns = 1;
+    uint64_t us = ready_ns / 1000;
+    endpoint_stats->ready_us = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+
+    char msg[512];
+    // MAINPID lets a supervisor follow a successor started with --takeover
+    int len = snprintf(msg, sizeof msg,
+                       "READY=1\nSTATUS=Serving MCTP on %s, EID %u\nMAINPID=%ld\n"
+                       "MCTP_DEVICE=%s\nMCTP_EID=%u\nREADY_USEC=%llu\n",
+                       device[0] ? device : "inherited descriptor", eid, (long)getpid(),
+                       device, eid, (unsigned long long)us);
+    if (len < 0 || len >= (int)sizeof msg) len = (int)strlen(msg);
+
+    notify_socket(msg, (size_t)len);
+    if (ready_fd >= 0) {
+        if (write_nosignal(ready_fd, msg, (size_t)len) != 0) LOG_WARN("ready fd %d: %m", ready_fd);
+        close(ready_fd);
+    }
+    printf("Ready in %.1f ms (device %s, EID %u)\n", ready_ns / 1e6, device[0] ? device : "inherited", eid);
+    fflush(stdout);
+}
+
+/**
+ * @brief Return how long the endpoint took to become ready.
+ *
+ * @return uint64_t Nanoseconds from start to ready, 0 if not ready yet.
+ */
+uint64_t service_ready_ns() {
+    return ready_ns;
+}
@@ -0,0 +1,196 @@
+/**
+ * @file stats.c
+ * @brief Shared-memory statistics segment for the Linux endpoint.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE
+#endif
+#include "stats.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log.h"
+
+/* counters land here until (and unless) the shared segment is mapped */
+static endpoint_stats_t fallback;
+endpoint_stats_t* endpoint_stats = &fallback;
+
+static char segment_path[256] = "";
+/* identity of the file this process created, so it never removes a successor's */
+static dev_t segment_dev;
+static ino_t segment_ino;
+
+/**
+ * @brief Build the default segment path for a port.
+ *
+ * The device path is reduced to a file-name-safe token, e.g. /dev/ttyS0
+ * becomes iotfoundry-endpoint.ttyS0.stats.  A simulated pty (empty path) is
+ * named after the process id.
+ *
+ * @param port - serial device path, possibly empty.
+ * @param out - destination buffer.
+ * @param len - size of out.
+ */
+static void default_path(const char* port, char* out, size_t len) {
+    char name[64];
+    if (!port || !port[0]) {
+        snprintf(name, sizeof name, "pty-%d", (int)getpid());
+    } else {
+        const char* base = strncmp(port, "/dev/", 5) == 0 ? port + 5 : port;
+        size_t i = 0;
+        for (; base[i] && i < sizeof name - 1; i++) {
+            name[i] = isalnum((unsigned char)base[i]) ? base[i] : '-';
+        }
+        name[i] = '\0';
+    }
+    snprintf(out, len, "%s/%s%s%s", STATS_DIR, STATS_PREFIX, name, STATS_SUFFIX);
+}
+
+/**
+ * @brief Create the segment file, replacing one left behind by an earlier run.
+ *
+ * The file is created exclusively and never through a symlink.  An existing
+ * entry is removed first only if it is a regular file owned by this user;
+ * anything else under the name is left alone and the call fails.
+ *
+ * @param path - segment file.
+ * @return int Open descriptor, or -1 with errno set.
+ */
+static int create_segment(const char* path) {
+    for (int attempt = 0;; attempt++) {
+        int fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+        if (fd != -1 || errno != EEXIST || attempt) return fd;
+
+        struct stat st;
+        if (lstat(path, &st) != 0) continue;
+        if (!S_ISREG(st.st_mode) || st.st_uid != geteuid()) {
+            errno = EEXIST;
+            return -1;
+        }
+        if (unlink(path) != 0 && errno != ENOENT) return -1;
+    }
+}
+
+/**
+ * @brief Create and map the statistics segment.
+ *
+ * Counters accumulated before the call are carried over.  If the file cannot
+ * be created the counters stay in private memory and the endpoint runs as
+ * normal.  A stale segment from an earlier run is replaced, but a symlink or
+ * another user's file in its place is not.
+ *
+ * @param path - segment file, NULL/empty for the default location, or "none"
+ *               to keep the counters private.
+ * @param port - serial device path, used for the default name and the header.
+ * @return int 0 if a shared segment was mapped, -1 otherwise.
+ */
+int stats_open(const char* path, const char* port) {
+    endpoint_stats_t* seg = NULL;
+
+    if (path && strcmp(path, "none") == 0) {
+        segment_path[0] = '\0';
+    } else {
+        if (path && path[0]) {
+            snprintf(segment_path, sizeof segment_path, "%s", path);
+        } else {
+            default_path(port, segment_path, sizeof segment_path);
+        }
+
+        int fd = create_segment(segment_path);
+        struct stat st;
+        if (fd == -1 || fstat(fd, &st) != 0 || ftruncate(fd, sizeof(endpoint_stats_t)) != 0) {
+            LOG_ERROR("stats segment %s: %m", segment_path);
+            if (fd != -1) {
+                close(fd);
+                unlink(segment_path);
+            }
+            segment_path[0] = '\0';
+        } else {
+            segment_dev = st.st_dev;
+            segment_ino = st.st_ino;
+            void* p = mmap(NULL, sizeof(endpoint_stats_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED) {
+                LOG_ERROR("mmap %s: %m", segment_path);
+                unlink(segment_path);
+                segment_path[0] = '\0';
+            } else {
+                seg = p;
+            }
+        }
+    }
+
+    endpoint_stats_t* s = seg ? seg : &fallback;
+    if (seg) memcpy(seg, &fallback, sizeof fallback);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    s->size = sizeof(endpoint_stats_t);
+    s->version = STATS_VERSION;
+    s->pid = (uint32_t)getpid();
+    s->start_realtime_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    snprintf(s->port, sizeof s->port, "%s", port && port[0] ? port : "(pty)");
+    // magic last, so a reader never sees a valid header over an incomplete block
+    __atomic_store_n(&s->magic, STATS_MAGIC, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&endpoint_stats, s, __ATOMIC_RELEASE);
+    return seg ? 0 : -1;
+}
+
+/**
+ * @brief Remove the shared segment.  Counters continue in private memory.
+ */
+void stats_close() {
+    endpoint_stats_t* s = endpoint_stats;
+    if (s == &fallback) return;
+
+    memcpy(&fallback, s, sizeof fallback);
+    __atomic_store_n(&endpoint_stats, &fallback, __ATOMIC_RELEASE);
+    munmap(s, sizeof(endpoint_stats_t));
+    // after a takeover the name may already belong to the successor's segment
+    struct stat st;
+    if (segment_path[0] && lstat(segment_path, &st) == 0 && st.st_dev == segment_dev &&
+        st.st_ino == segment_ino) {
+        unlink(segment_path);
+    }
+    segment_path[0] = '\0';
+}
+
+/**
+ * @brief Path of the shared segment, or an empty string if none is mapped.
+ *
+ * @return const char* The path.
+ */
+const char* stats_path() {
+    return segment_path;
+}
@@ -0,0 +1,442 @@
+/**
+ * @file takeover.c
+ * @brief Passing the open device, EID and unread bytes to a successor process.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+#include "takeover.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "log.h"
+#include "pipeline.h"
+
+/* how long an accepted successor has to send its request */
+#define REQUEST_TIMEOUT_MS 100
+
+static int listen_fd = -1;
+static char sock_path[sizeof(((struct sockaddr_un*)0)->sun_path)];  /* file to unlink, empty if abstract */
+
+/* connection accepted on the listener whose request has not arrived yet */
+static int pending_fd = -1;
+static pid_t pending_pid = 0;
+static uint64_t pending_deadline_ns = 0;
+
+/* successor waiting for the device, and what it will be given */
+static int successor_fd = -1;
+static pid_t successor_pid = 0;
+static uint8_t* unread = NULL;
+static size_t unread_len = 0;
+static uint8_t eid = 0;
+static uint8_t owner_eid = 0;
+static int have_eid = 0;
+
+/**
+ * @brief Fill a UNIX socket address; a leading '@' selects the abstract namespace.
+ *
+ * @param path - the socket path.
+ * @param addr - the address to fill.
+ * @return socklen_t Length of the address, or 0 if the path is too long.
+ */
+static socklen_t socket_address(const char* path, struct sockaddr_un* addr) {
+    size_t len = strlen(path);
+    memset(addr, 0, sizeof *addr);
+    addr->sun_family = AF_UNIX;
+    if (len >= sizeof addr->sun_path) return 0;
+    memcpy(addr->sun_path, path, len);
+    if (path[0] == '@') addr->sun_path[0] = '\0';
+    return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + len);
+}
+
+/**
+ * @brief Remove a socket left behind by an endpoint that did not exit cleanly.
+ *
+ * Only a socket owned by this user that nobody answers on is removed.  Any
+ * other file, or a socket another process is serving, is left in place.
+ *
+ * @param path - the socket path.
+ * @param addr - its address.
+ * @param addr_len - length of the address.
+ * @return int 0 if the path is free, -1 with errno set otherwise.
+ */
+static int remove_stale_socket(const char* path, const struct sockaddr_un* addr, socklen_t addr_len) {
+    struct stat st;
+    if (lstat(path, &st) != 0) return errno == ENOENT ? 0 : -1;
+    if (!S_ISSOCK(st.st_mode) || st.st_uid != geteuid()) {
+        errno = EEXIST;
+        return -1;
+    }
+    int probe = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (probe < 0) return -1;
+    int live = connect(probe, (const struct sockaddr*)addr, addr_len) == 0 || errno != ECONNREFUSED;
+    close(probe);
+    if (live) {
+        errno = EADDRINUSE;
+        return -1;
+    }
+    return unlink(path) != 0 && errno != ENOENT ? -1 : 0;
+}
+
+/**
+ * @brief Take the device over from an endpoint listening on path, if there is one.
+ *
+ * On success the configuration is pointed at the inherited descriptor and
+ * the pipeline is primed with the unread bytes and the assigned EID.
+ *
+ * @param path - the takeover socket.
+ * @param cfg - configuration to update.
+ * @return int 1 if the device was taken over, 0 if nobody was listening or the old
+ *             endpoint closed the device instead, -1 on failure.
+ */
+int takeover_acquire(const char* path, config_t* cfg) {
+    struct sockaddr_un addr;
+    socklen_t addr_len = socket_address(path, &addr);
+    if (!addr_len) {
+        LOG_ERROR("takeover: socket path too long: %s", path);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("takeover: socket: %m");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&addr, addr_len) != 0) {
+        int err = errno;
+        close(fd);
+        // nobody listening: an ordinary start
+        if (err == ENOENT || err == ECONNREFUSED) return 0;
+        errno = err;
+        LOG_ERROR("takeover: connect %s: %m", path);
+        return -1;
+    }
+
+    uint64_t t_start = clock_now_ns();
+    takeover_request_t req = {.magic = TAKEOVER_MAGIC, .version = TAKEOVER_VERSION};
+    struct pollfd p = {.fd = fd, .events = POLLIN};
+    if (send(fd, &req, sizeof req, MSG_NOSIGNAL) != (ssize_t)sizeof req || poll(&p, 1, TAKEOVER_TIMEOUT_MS) <= 0) {
+        LOG_ERROR("takeover: no answer from %s", path);
+        close(fd);
+        return -1;
+    }
+
+    // the old endpoint answers once it has shut down around the open device
+    takeover_state_t st;
+    uint8_t* bytes = malloc(TAKEOVER_UNREAD_MAX);
+    struct iovec iov[2] = {{&st, sizeof st}, {bytes, bytes ? TAKEOVER_UNREAD_MAX : 0}};
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+    struct msghdr msg = {.msg_iov = iov, .msg_iovlen = 2, .msg_control = ctl.buf, .msg_controllen = sizeof ctl.buf};
+    ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    close(fd);
+
+    int dev_fd = -1;
+    for (struct cmsghdr* c = n >= 0 ? CMSG_FIRSTHDR(&msg) : NULL; c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS && c->cmsg_len >= CMSG_LEN(sizeof(int))) {
+            memcpy(&dev_fd, CMSG_DATA(c), sizeof dev_fd);
+        }
+    }
+    // the old endpoint could not pass the device and has closed it: open it as usual
+    if (n >= (ssize_t)sizeof st && st.magic == TAKEOVER_MAGIC && st.version == TAKEOVER_VERSION &&
+        (st.flags & TAKEOVER_REOPEN) && dev_fd < 0) {
+        LOG_WARN("takeover: %s could not hand the device over, opening it afresh", path);
+        free(bytes);
+        return 0;
+    }
+    if (n < (ssize_t)sizeof st || st.magic != TAKEOVER_MAGIC || st.version != TAKEOVER_VERSION || dev_fd < 0 ||
+        st.unread_len > (size_t)n - sizeof st) {
+        LOG_ERROR("takeover: no usable hand-over from %s", path);
+        if (dev_fd >= 0) close(dev_fd);
+        free(bytes);
+        return -1;
+    }
+
+    // line settings belong to the device, but apply them in case a tool changed them meanwhile
+    if ((st.flags & TAKEOVER_HAS_TERMIOS) && tcsetattr(dev_fd, TCSANOW, &st.tio) != 0) {
+        LOG_WARN("takeover: tcsetattr: %m");
+    }
+    cfg->inherit_fd = dev_fd;
+    st.path[sizeof st.path - 1] = '\0';
+    snprintf(cfg->path, sizeof cfg->path, "%s", st.path);
+    if (pipeline_preload(bytes, st.unread_len) != 0) {
+        LOG_WARN("takeover: %u unread bytes dropped", (unsigned)st.unread_len);
+    }
+    if (st.flags & TAKEOVER_HAS_EID) pipeline_restore_eid(st.eid, st.owner_eid);
+    free(bytes);
+
+    LOG_INFO("takeover: took over %s in %.1f ms, %u unread bytes, EID %u", st.path[0] ? st.path : "device",
+             (double)(clock_now_ns() - t_start) / 1e6, (unsigned)st.unread_len,
+             (st.flags & TAKEOVER_HAS_EID) ? st.eid : 0);
+    return 1;
+}
+
+/**
+ * @brief Listen for a successor that wants to take the device over.
+ *
+ * @param path - the takeover socket; a leading '@' selects the abstract namespace.
+ * @param fd - a socket already listening (socket activation), or -1 to create one at path.
+ * @return int 0 on success, -1 on failure.
+ */
+int takeover_listen(const char* path, int fd) {
+    sock_path[0] = '\0';
+    if (fd >= 0) {
+        // the service manager keeps its own copy and the path
+        listen_fd = fd;
+        fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+        return 0;
+    }
+
+    struct sockaddr_un addr;
+    socklen_t addr_len = socket_address(path, &addr);
+    if (!addr_len) {
+        LOG_ERROR("takeover: socket path too long: %s", path);
+        return -1;
+    }
+    if (path[0] != '@') {
+        if (remove_stale_socket(path, &addr, addr_len) != 0) {
+            LOG_ERROR("takeover: %s: %s", path,
+                      errno == EADDRINUSE ? "another process is serving it" : "not a stale socket of ours");
+            return -1;
+        }
+        snprintf(sock_path, sizeof sock_path, "%s", path);
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, addr_len) != 0 || listen(listen_fd, 1) != 0) {
+        LOG_ERROR("takeover: %s: %m", path);
+        if (listen_fd >= 0) close(listen_fd);
+        listen_fd = -1;
+        sock_path[0] = '\0';
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Return the descriptor to wait on for a successor.
+ *
+ * While an accepted connection's request is awaited this is that
+ * connection, otherwise the listener.
+ *
+ * @return int The descriptor, or -1 when not listening.
+ */
+int takeover_fd() {
+    return pending_fd >= 0 ? pending_fd : listen_fd;
+}
+
+/**
+ * @brief Return how long the caller may wait before takeover_poll() must run.
+ *
+ * @return int Milliseconds until an awaited request is given up, or -1 for no limit.
+ */
+int takeover_timeout() {
+    if (pending_fd < 0) return -1;
+    uint64_t now = clock_now_ns();
+    if (now >= pending_deadline_ns) return 0;
+    return (int)((pending_deadline_ns - now + 999999) / 1000000);
+}
+
+/**
+ * @brief Drop the accepted connection whose request is awaited.
+ */
+static void drop_pending() {
+    close(pending_fd);
+    pending_fd = -1;
+}
+
+/**
+ * @brief Accept a successor and read its request once it is there.  Never blocks.
+ *
+ * Only processes of the same user (or root) may take the device.  An
+ * accepted connection that has not sent its request within
+ * REQUEST_TIMEOUT_MS is dropped.
+ *
+ * @return int Non-zero when a successor is waiting and the endpoint should shut down.
+ */
+int takeover_poll() {
+    if (successor_fd >= 0) return 1;
+    if (pending_fd < 0) {
+        if (listen_fd < 0) return 0;
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return 0;
+
+        struct ucred cred;
+        socklen_t cred_len = sizeof cred;
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) != 0 ||
+            (cred.uid != geteuid() && cred.uid != 0)) {
+            LOG_WARN("takeover: refused a request from another user");
+            close(fd);
+            return 0;
+        }
+        pending_fd = fd;
+        pending_pid = cred.pid;
+        pending_deadline_ns = clock_now_ns() + REQUEST_TIMEOUT_MS * 1000000ull;
+    }
+
+    takeover_request_t req;
+    ssize_t n = recv(pending_fd, &req, sizeof req, 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        if (clock_now_ns() < pending_deadline_ns) return 0;
+        LOG_WARN("takeover: pid %d sent no request in time", (int)pending_pid);
+        drop_pending();
+        return 0;
+    }
+    if (n != (ssize_t)sizeof req || req.magic != TAKEOVER_MAGIC || req.version != TAKEOVER_VERSION) {
+        LOG_WARN("takeover: ignored a malformed request from pid %d", (int)pending_pid);
+        drop_pending();
+        return 0;
+    }
+
+    // the hand-over is one large message; let it wait for buffer space
+    fcntl(pending_fd, F_SETFL, fcntl(pending_fd, F_GETFL) & ~O_NONBLOCK);
+    successor_fd = pending_fd;
+    successor_pid = pending_pid;
+    pending_fd = -1;
+    LOG_INFO("takeover: pid %d is taking over, shutting down", (int)successor_pid);
+    return 1;
+}
+
+/**
+ * @brief Stop the pipeline for a waiting successor, keeping what it needs.
+ *
+ * Queued responses are still transmitted; received frames not yet handled
+ * and the assigned EID are kept for takeover_release().
+ *
+ * @return int Non-zero if the pipeline was stopped here, 0 if no successor is waiting.
+ */
+int takeover_detach() {
+    if (successor_fd < 0) return 0;
+    unread = malloc(TAKEOVER_UNREAD_MAX);
+    unread_len = pipeline_stop_unread(unread, unread ? TAKEOVER_UNREAD_MAX : 0);
+    have_eid = pipeline_eid(&eid, &owner_eid);
+    return 1;
+}
+
+/**
+ * @brief Stop listening and hand the device to a waiting successor.
+ *
+ * Called last during shutdown, once everything the successor reopens
+ * (statistics, flight recorder, sockets) has been released.  If the
+ * hand-over cannot be sent, the successor stays connected until
+ * takeover_close(), after the caller has closed the device.
+ *
+ * @param dev_fd - the open device.
+ * @param dev_path - its path, reported by the successor.
+ * @return int 1 if the device was handed over, 0 if no successor is waiting,
+ *             -1 if the hand-over failed.
+ */
+int takeover_release(int dev_fd, const char* dev_path) {
+    // the successor binds the same path as soon as it has the device, so the name goes first
+    if (listen_fd >= 0) close(listen_fd);
+    listen_fd = -1;
+    if (sock_path[0]) unlink(sock_path);
+    sock_path[0] = '\0';
+    if (successor_fd < 0) return 0;
+
+    takeover_state_t st;
+    memset(&st, 0, sizeof st);
+    st.magic = TAKEOVER_MAGIC;
+    st.version = TAKEOVER_VERSION;
+    if (dev_fd >= 0 && tcgetattr(dev_fd, &st.tio) == 0) st.flags |= TAKEOVER_HAS_TERMIOS;
+    if (have_eid) {
+        st.flags |= TAKEOVER_HAS_EID;
+        st.eid = eid;
+        st.owner_eid = owner_eid;
+    }
+    st.unread_len = (uint32_t)unread_len;
+    snprintf(st.path, sizeof st.path, "%s", dev_path);
+
+    struct iovec iov[2] = {{&st, sizeof st}, {unread, unread_len}};
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+    memset(&ctl, 0, sizeof ctl);
+    struct msghdr msg = {.msg_iov = iov, .msg_iovlen = 2, .msg_control = ctl.buf, .msg_controllen = sizeof ctl.buf};
+    struct cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(c), &dev_fd, sizeof dev_fd);
+
+    if (dev_fd < 0) errno = EBADF;
+    if (dev_fd < 0 || sendmsg(successor_fd, &msg, MSG_NOSIGNAL) != (ssize_t)(sizeof st + unread_len)) {
+        LOG_ERROR("takeover: hand-over to pid %d failed: %m", (int)successor_pid);
+        return -1;
+    }
+    LOG_INFO("takeover: handed the device to pid %d with %zu unread bytes", (int)successor_pid, unread_len);
+    close(successor_fd);
+    successor_fd = -1;
+    takeover_close();
+    return 1;
+}
+
+/**
+ * @brief Release what is left of a hand-over, once the device is closed.
+ *
+ * A successor still connected after a failed hand-over is told to open the
+ * device itself, which it can only do now that this process has closed it.
+ */
+void takeover_close() {
+    if (pending_fd >= 0) drop_pending();
+    if (listen_fd >= 0) close(listen_fd);
+    listen_fd = -1;
+    if (sock_path[0]) unlink(sock_path);
+    sock_path[0] = '\0';
+
+    if (successor_fd >= 0) {
+        takeover_state_t st;
+        memset(&st, 0, sizeof st);
+        st.magic = TAKEOVER_MAGIC;
+        st.version = TAKEOVER_VERSION;
+        st.flags = TAKEOVER_REOPEN;
+        if (send(successor_fd, &st, sizeof st, MSG_NOSIGNAL) != (ssize_t)sizeof st) {
+            LOG_WARN("takeover: could not tell pid %d to open the device: %m", (int)successor_pid);
+        } else {
+            LOG_INFO("takeover: pid %d opens the device itself", (int)successor_pid);
+        }
+        close(successor_fd);
+        successor_fd = -1;
+    }
+    free(unread);
+    unread = NULL;
+    unread_len = 0;
+}
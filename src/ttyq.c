@@ -0,0 +1,151 @@
+/**
+ * @file ttyq.c
+ * @brief Kernel tty queue depth and driver error sampling.
+ *
+ * Periodic samples are taken by whichever thread runs the receive stage, at
+ * most once per interval; the receive thread shortens its poll timeout to
+ * the interval so an idle line is still sampled.  The transmit stage reads
+ * the output queue through ttyq_outq() when pacing, which keeps that gauge
+ * and its high-water mark current between samples.  Drivers without
+ * TIOCGICOUNT (ptys, most USB adapters) only report queue depths.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "ttyq.h"
+#include <linux/serial.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include "clock.h"
+#include "flightrec.h"
+#include "log.h"
+#include "stats.h"
+
+static int tty_fd = -1;
+static uint64_t interval_ns = 0;   /* 0 = no periodic sampling */
+static uint64_t next_ns = 0;
+static uint64_t sample_ns = 0;
+static int have_inq = 0;
+static int have_outq = 0;
+static int have_icount = 0;
+static struct serial_icounter_struct base;   /* driver counts when sampling began */
+
+/**
+ * @brief Start sampling a device.
+ *
+ * @param fd - the serial device (or pty master).
+ * @param interval_ms - period of the receive-side samples, 0 for none.
+ */
+void ttyq_init(int fd, unsigned interval_ms) {
+    tty_fd = fd;
+    interval_ns = (uint64_t)interval_ms * 1000000ull;
+    next_ns = sample_ns = 0;
+    have_inq = have_outq = 1;
+    have_icount = ioctl(fd, TIOCGICOUNT, &base) == 0;
+}
+
+/**
+ * @brief Poll timeout that keeps an idle receive stage sampling.
+ *
+ * @return int Milliseconds, or -1 when periodic sampling is off.
+ */
+int ttyq_poll_timeout() {
+    return tty_fd >= 0 && interval_ns ? (int)(interval_ns / 1000000ull) : -1;
+}
+
+/**
+ * @brief Take a periodic sample if one is due.
+ *
+ * Called from the receive stage only.
+ */
+void ttyq_poll() {
+    if (tty_fd < 0 || !interval_ns) return;
+    uint64_t now = clock_now_ns();
+    if (now < next_ns) return;
+    next_ns = now + interval_ns;
+
+    endpoint_stats_t* s = endpoint_stats;
+    int n = 0;
+    if (have_inq) {
+        if (ioctl(tty_fd, TIOCINQ, &n) == 0) {
+            stats_gauge(&s->tty_inq, &s->tty_inq_max, (uint64_t)n);
+        } else {
+            have_inq = 0;
+        }
+    }
+    ttyq_outq();
+
+    struct serial_icounter_struct ic;
+    if (have_icount && ioctl(tty_fd, TIOCGICOUNT, &ic) == 0) {
+        uint64_t overruns = (uint64_t)(uint32_t)(ic.overrun - base.overrun);
+        uint64_t buf_overruns = (uint64_t)(uint32_t)(ic.buf_overrun - base.buf_overrun);
+        uint64_t lost = overruns + buf_overruns - s->tty_overruns - s->tty_buf_overruns;
+        if (lost) {
+            // the kernel dropped bytes before we could read them: expect FCS errors
+            LOG_WARN("serial driver reported %llu overruns (%d bytes queued)", (unsigned long long)lost, n);
+            flight_event(FLIGHT_TTY_OVERRUN, (uint32_t)lost);
+        }
+        stats_add(&s->tty_overruns, overruns - s->tty_overruns);
+        stats_add(&s->tty_buf_overruns, buf_overruns - s->tty_buf_overruns);
+        stats_add(&s->tty_frame_errors, (uint64_t)(uint32_t)(ic.frame - base.frame) - s->tty_frame_errors);
+        stats_add(&s->tty_parity_errors, (uint64_t)(uint32_t)(ic.parity - base.parity) - s->tty_parity_errors);
+        stats_add(&s->tty_breaks, (uint64_t)(uint32_t)(ic.brk - base.brk) - s->tty_breaks);
+    } else {
+        have_icount = 0;
+    }
+
+    stats_add(&s->tty_samples, 1);
+    __atomic_store_n(&sample_ns, now, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Read the kernel transmit queue depth and publish it.
+ *
+ * @return int Bytes not yet on the wire, or -1 if the device cannot say.
+ */
+int ttyq_outq() {
+    if (tty_fd < 0 || !have_outq) return -1;
+    int n = 0;
+    if (ioctl(tty_fd, TIOCOUTQ, &n) != 0) {
+        have_outq = 0;
+        return -1;
+    }
+    stats_gauge(&endpoint_stats->tty_outq, &endpoint_stats->tty_outq_max, (uint64_t)n);
+    return n;
+}
+
+/**
+ * @brief Return the latest queue depths and driver counts.
+ *
+ * @param out - receives the sample.
+ */
+void ttyq_get(ttyq_sample_t* out) {
+    const endpoint_stats_t* s = endpoint_stats;
+    out->t_ns = __atomic_load_n(&sample_ns, __ATOMIC_RELAXED);
+    out->inq = (uint32_t)__atomic_load_n(&s->tty_inq, __ATOMIC_RELAXED);
+    out->outq = (uint32_t)__atomic_load_n(&s->tty_outq, __ATOMIC_RELAXED);
+    out->inq_max = (uint32_t)__atomic_load_n(&s->tty_inq_max, __ATOMIC_RELAXED);
+    out->outq_max = (uint32_t)__atomic_load_n(&s->tty_outq_max, __ATOMIC_RELAXED);
+    out->overruns = __atomic_load_n(&s->tty_overruns, __ATOMIC_RELAXED) +
+                    __atomic_load_n(&s->tty_buf_overruns, __ATOMIC_RELAXED);
+    out->errors = __atomic_load_n(&s->tty_frame_errors, __ATOMIC_RELAXED) +
+                  __atomic_load_n(&s->tty_parity_errors, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,247 @@
+/**
+ * @file txsched.c
+ * @brief Priority-aware transmit scheduler for outgoing MCTP serial frames.
+ *
+ * Each (producer, class) pair has its own single-producer/single-consumer
+ * frame queue.  Producers classify and enqueue frames; the transmit stage
+ * picks the highest-priority frame each time the device can take another
+ * packet.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "txsched.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "frameq.h"
+
+static frameq_t queues[TX_PRODUCER_COUNT][TX_CLASS_COUNT];
+static txsched_class_stats_t stats[TX_CLASS_COUNT];
+
+/* class of the message in progress for each (tag owner, tag) pair */
+static uint8_t msg_class[2 * (MCTP_FLAG_TAG_MASK + 1)];
+
+static const char* class_names[TX_CLASS_COUNT] = {"control", "event", "normal", "bulk"};
+
+/**
+ * @brief Number of frames queued in a class across all producers.
+ *
+ * @param c - the class.
+ * @return uint32_t Queued frames.
+ */
+static uint32_t class_depth(int c) {
+    uint32_t n = 0;
+    for (int p = 0; p < TX_PRODUCER_COUNT; p++) n += frameq_count(&queues[p][c]);
+    return n;
+}
+
+/**
+ * @brief Allocate one queue per producer and priority class.
+ *
+ * @param depth_per_class - frames each producer may hold in each class.
+ * @return int 0 on success, -1 on allocation failure.
+ */
+int txsched_init(uint32_t depth_per_class) {
+    memset(stats, 0, sizeof stats);
+    memset(msg_class, TX_CLASS_NORMAL, sizeof msg_class);
+    memset(queues, 0, sizeof queues);
+    for (int p = 0; p < TX_PRODUCER_COUNT; p++) {
+        for (int c = 0; c < TX_CLASS_COUNT; c++) {
+            if (frameq_init(&queues[p][c], depth_per_class) != 0) {
+                txsched_free();
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Release the class queues.
+ */
+void txsched_free() {
+    for (int p = 0; p < TX_PRODUCER_COUNT; p++) {
+        for (int c = 0; c < TX_CLASS_COUNT; c++) frameq_free(&queues[p][c]);
+    }
+}
+
+/**
+ * @brief Choose the priority class for an outgoing frame.
+ *
+ * The class is decided on the first packet of a message, where the message
+ * type is visible, and reused for the rest of that message's packets.
+ * Messages that span more than one packet are treated as bulk traffic.
+ * Must be called in transmit order by the core producer; the receive stage
+ * only queues single-packet responses and picks their class directly.
+ *
+ * @param f - decoded outgoing frame.
+ * @return tx_class_t The class to queue the frame in.
+ */
+tx_class_t txsched_classify(const mctp_frame_t* f) {
+    if (f->status != MCTP_FRAME_OK || f->len < MCTP_OFF_MSG_TYPE) return TX_CLASS_NORMAL;
+
+    uint8_t flags = f->data[MCTP_OFF_FLAGS];
+    int ctx = ((flags & MCTP_FLAG_TO) ? MCTP_FLAG_TAG_MASK + 1 : 0) + (flags & MCTP_FLAG_TAG_MASK);
+
+    if (!(flags & MCTP_FLAG_SOM)) return (tx_class_t)msg_class[ctx];
+
+    tx_class_t c = TX_CLASS_NORMAL;
+    if (!(flags & MCTP_FLAG_EOM)) {
+        c = TX_CLASS_BULK;
+    } else if (mctp_frame_has_header(f) && mctp_frame_msg_type(f) == MCTP_MSG_TYPE_CONTROL) {
+        c = TX_CLASS_CONTROL;
+    } else if (f->len > MCTP_OFF_PLDM_CMD && mctp_frame_msg_type(f) == MCTP_MSG_TYPE_PLDM &&
+               (f->data[MCTP_OFF_PLDM_TYPE] & PLDM_TYPE_MASK) == PLDM_TYPE_PLATFORM &&
+               (f->data[MCTP_OFF_PLDM_CMD] == PLDM_CMD_PLATFORM_EVENT_MESSAGE ||
+                f->data[MCTP_OFF_PLDM_CMD] == PLDM_CMD_POLL_FOR_PLATFORM_EVENT)) {
+        c = TX_CLASS_EVENT;
+    }
+    msg_class[ctx] = (uint8_t)c;
+    return c;
+}
+
+/**
+ * @brief Producer: return a free slot in a class queue, or NULL when it is full.
+ *
+ * @param p - the calling producer.
+ * @param c - the class.
+ * @return mctp_frame_t* Slot to fill.
+ */
+mctp_frame_t* txsched_slot(tx_producer_t p, tx_class_t c) {
+    return frameq_slot(&queues[p][c]);
+}
+
+/**
+ * @brief Producer: publish the slot returned by txsched_slot().
+ *
+ * Producers run on different threads, so the class high-water mark is
+ * raised with a compare-and-swap rather than a plain store.
+ *
+ * @param p - the calling producer.
+ * @param c - the class.
+ */
+void txsched_commit(tx_producer_t p, tx_class_t c) {
+    frameq_commit(&queues[p][c]);
+    uint32_t depth = class_depth(c);
+    uint32_t* max = &stats[c].depth_max;
+    uint32_t m = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (depth > m &&
+           !__atomic_compare_exchange_n(max, &m, depth, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * @brief Consumer: return the next frame to send, highest priority first.
+ *
+ * Within a class the oldest head frame among the producers goes first.
+ *
+ * @param ref - receives the queue of the returned frame.
+ * @return mctp_frame_t* The frame, or NULL when nothing is queued.
+ */
+mctp_frame_t* txsched_peek(txsched_ref_t* ref) {
+    for (int c = 0; c < TX_CLASS_COUNT; c++) {
+        mctp_frame_t* best = NULL;
+        for (int p = 0; p < TX_PRODUCER_COUNT; p++) {
+            mctp_frame_t* f = frameq_peek(&queues[p][c]);
+            if (f && (!best || f->t_done_ns < best->t_done_ns)) {
+                best = f;
+                ref->producer = (uint8_t)p;
+                ref->cls = (uint8_t)c;
+            }
+        }
+        if (best) return best;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Consumer: release a sent frame and account for its queueing delay.
+ *
+ * @param ref - the queue reference passed back by txsched_peek().
+ * @param t_start_ns - time the first byte of the frame was written.
+ */
+void txsched_pop(txsched_ref_t ref, uint64_t t_start_ns) {
+    int c = ref.cls;
+    frameq_t* q = &queues[ref.producer][c];
+    mctp_frame_t* f = frameq_peek(q);
+    if (!f) return;
+
+    txsched_class_stats_t* s = &stats[c];
+    uint64_t delay = t_start_ns > f->t_done_ns ? t_start_ns - f->t_done_ns : 0;
+    s->frames++;
+    s->bytes += f->raw_len;
+    s->queue_ns_total += delay;
+    if (delay > s->queue_ns_max) s->queue_ns_max = delay;
+    for (int i = c + 1; i < TX_CLASS_COUNT; i++) {
+        if (class_depth(i)) {
+            s->preemptions++;
+            break;
+        }
+    }
+    frameq_pop(q);
+}
+
+/**
+ * @brief Report whether any class has frames waiting.
+ *
+ * @return int Non-zero when at least one frame is queued.
+ */
+int txsched_pending() {
+    for (int c = 0; c < TX_CLASS_COUNT; c++) {
+        if (class_depth(c)) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Copy the counters for one class.
+ *
+ * @param c - the class.
+ * @param out - destination for the snapshot.
+ */
+void txsched_get_stats(tx_class_t c, txsched_class_stats_t* out) {
+    *out = stats[c];
+    out->depth = class_depth(c);
+    out->depth_max = __atomic_load_n(&stats[c].depth_max, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Print per-class transmit counters and queueing delay.
+ *
+ * @param out - stream to print to.
+ */
+void txsched_dump_stats(FILE* out) {
+    fprintf(out, "Transmit scheduler:\n");
+    fprintf(out, "  %-8s %10s %10s %10s %10s %12s %6s\n", "class", "frames", "bytes", "q-avg",
+            "q-max", "preemptions", "max-q");
+    for (int c = 0; c < TX_CLASS_COUNT; c++) {
+        const txsched_class_stats_t* s = &stats[c];
+        uint64_t n = s->frames ? s->frames : 1;
+        fprintf(out, "  %-8s %10llu %10llu %8lluus %8lluus %12llu %6u\n", class_names[c],
+                (unsigned long long)s->frames, (unsigned long long)s->bytes,
+                (unsigned long long)(s->queue_ns_total / n / 1000),
+                (unsigned long long)(s->queue_ns_max / 1000), (unsigned long long)s->preemptions,
+                __atomic_load_n(&s->depth_max, __ATOMIC_RELAXED));
+    }
+}
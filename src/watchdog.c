@@ -0,0 +1,276 @@
+/**
+ * @file watchdog.c
+ * @brief Slow-handler watchdog for the I/O loop.
+ *
+ * Dispatches are timed with the monotonic clock and judged when the handler
+ * returns.  With stack sampling enabled, a POSIX timer armed for the budget
+ * at every dispatch delivers a signal to the I/O thread itself if the handler
+ * is still running when it expires.  The signal handler samples the stack of
+ * the stuck handler and writes it to the flight recorder straight away, so a
+ * handler that never returns still leaves a trace.  Everything else
+ * (counting, logging, symbolizing) happens when the handler returns, outside
+ * signal context.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+#include "watchdog.h"
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "clock.h"
+#include "flightrec.h"
+#include "log.h"
+#include "stats.h"
+
+#ifndef sigev_notify_thread_id
+    #define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+/* the signal handler and the trampoline it returns through */
+#define SIGNAL_FRAMES 2
+
+/* bounds of the executable's code, provided by the linker; absent (NULL) in the shared library */
+extern char __executable_start __attribute__((weak));
+extern char etext __attribute__((weak));
+
+static uint64_t budget_ns = 0;   /* 0 while disabled */
+static unsigned budget_ms = 0;
+static int sample_stacks = 0;
+static timer_t timer;
+static int overrun_signal = -1;
+
+static const mctp_frame_t* armed_req = NULL;
+static uint64_t armed_ns = 0;
+
+static volatile sig_atomic_t fired = 0;
+static void* stack[WATCHDOG_STACK_DEPTH];
+static volatile sig_atomic_t stack_depth = 0;
+
+static uint64_t dispatches = 0;
+static uint64_t slow = 0;
+static uint64_t sampled = 0;
+
+/**
+ * @brief Timer signal: sample the stack of the handler that overran its budget.
+ *
+ * Runs on the I/O thread in the middle of the handler.  backtrace() was
+ * called once at start-up so that it does not load anything here, and the
+ * flight recorder claims its slot without locking.  Addresses inside the
+ * endpoint binary are recorded relative to its load address, so they can be
+ * resolved with addr2line despite address space randomization.
+ *
+ * @param signum - the watchdog signal.
+ */
+static void overrun_handler(int signum) {
+    (void)signum;
+    int saved_errno = errno;
+
+    int n = backtrace(stack, WATCHDOG_STACK_DEPTH);
+    uint64_t pcs[FLIGHT_DATA_MAX / sizeof(uint64_t)];
+    unsigned k = 0;
+    for (int i = SIGNAL_FRAMES; i < n && k < sizeof pcs / sizeof pcs[0]; i++) {
+        char* pc = (char*)stack[i];
+        pcs[k++] = pc >= &__executable_start && pc < &etext ? (uint64_t)(pc - &__executable_start)
+                                                            : (uint64_t)(uintptr_t)pc;
+    }
+    flight_data(FLIGHT_HANDLER_STACK, budget_ms, pcs, (uint16_t)(k * sizeof pcs[0]), clock_now_ns());
+
+    stack_depth = n;
+    fired = 1;
+    errno = saved_errno;
+}
+
+/**
+ * @brief Create the timer that samples the stack of an overrunning handler.
+ *
+ * @return int 0 on success, -1 on failure.
+ */
+static int sampler_init() {
+    /* the first backtrace() may load libgcc; never let that happen in the handler */
+    void* warm[2];
+    backtrace(warm, 2);
+
+    overrun_signal = SIGRTMIN;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = overrun_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(overrun_signal, &sa, NULL) != 0) {
+        LOG_ERROR("watchdog sigaction: %m");
+        return -1;
+    }
+
+    /* deliver to the I/O thread itself, whose stack is the one of interest */
+    struct sigevent sev;
+    memset(&sev, 0, sizeof sev);
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = overrun_signal;
+    sev.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+    if (timer_create(CLOCK_MONOTONIC, &sev, &timer) != 0) {
+        LOG_ERROR("watchdog timer_create: %m");
+        signal(overrun_signal, SIG_DFL);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Enable the watchdog for the calling (I/O) thread.
+ *
+ * Timing a dispatch costs two clock reads.  Sampling stacks adds a timer
+ * update at each dispatch, and the timer's signal cuts short any sleep the
+ * overrunning handler is in.
+ *
+ * @param ms - handler budget in milliseconds, 0 to disable.
+ * @param backtraces - non-zero to sample the stack of a handler at its deadline.
+ * @return int 0 on success (or when disabled), -1 if stack sampling is unavailable.
+ */
+int watchdog_init(unsigned ms, int backtraces) {
+    budget_ns = 0;
+    sample_stacks = 0;
+    if (!ms) return 0;
+
+    budget_ms = ms;
+    budget_ns = (uint64_t)ms * 1000000ull;
+    if (!backtraces) return 0;
+    if (sampler_init() != 0) return -1;
+    sample_stacks = 1;
+    return 0;
+}
+
+/**
+ * @brief Disable the watchdog and release its timer, if any.
+ */
+void watchdog_shutdown() {
+    budget_ns = 0;
+    if (!sample_stacks) return;
+    sample_stacks = 0;
+    timer_delete(timer);
+    signal(overrun_signal, SIG_DFL);
+}
+
+/**
+ * @brief Start timing a dispatch.
+ *
+ * @param req - the request being handled; must stay valid until watchdog_disarm().
+ * @param start_ns - when the handler was entered.
+ */
+void watchdog_arm(const mctp_frame_t* req, uint64_t start_ns) {
+    if (!budget_ns) return;
+    armed_req = req;
+    armed_ns = start_ns;
+    if (!sample_stacks) return;
+    fired = 0;
+
+    struct itimerspec its;
+    memset(&its, 0, sizeof its);
+    its.it_value.tv_sec = (time_t)(budget_ns / 1000000000ull);
+    its.it_value.tv_nsec = (long)(budget_ns % 1000000000ull);
+    timer_settime(timer, 0, &its, NULL);
+}
+
+/**
+ * @brief Describe a request as message type and command for the log.
+ *
+ * @param f - the request.
+ * @param buf - destination.
+ * @param len - size of buf.
+ */
+static void describe(const mctp_frame_t* f, char* buf, size_t len) {
+    if (!mctp_frame_has_header(f)) {
+        snprintf(buf, len, "frame %u", f->seq);
+    } else if (mctp_frame_msg_type(f) == MCTP_MSG_TYPE_CONTROL) {
+        snprintf(buf, len, "control 0x%02x", f->data[MCTP_OFF_CTRL_CMD]);
+    } else if (mctp_frame_msg_type(f) == MCTP_MSG_TYPE_PLDM && f->len > MCTP_OFF_PLDM_CMD) {
+        snprintf(buf, len, "pldm 0x%02x/0x%02x", f->data[MCTP_OFF_PLDM_TYPE] & 0x3F, f->data[MCTP_OFF_PLDM_CMD]);
+    } else {
+        snprintf(buf, len, "type 0x%02x", mctp_frame_msg_type(f));
+    }
+}
+
+/**
+ * @brief Stop timing a dispatch and report it if it exceeded the budget.
+ */
+void watchdog_disarm() {
+    if (!budget_ns || !armed_req) return;
+    uint64_t end_ns = clock_now_ns();
+    if (sample_stacks && !fired) {
+        struct itimerspec its;
+        memset(&its, 0, sizeof its);
+        timer_settime(timer, 0, &its, NULL);
+    }
+
+    const mctp_frame_t* req = armed_req;
+    uint64_t elapsed = end_ns - armed_ns;
+    armed_req = NULL;
+    dispatches++;
+    if (elapsed > endpoint_stats->io_handler_max_ns) {
+        __atomic_store_n(&endpoint_stats->io_handler_max_ns, elapsed, __ATOMIC_RELAXED);
+    }
+    if (elapsed < budget_ns) return;
+
+    slow++;
+    stats_add(&endpoint_stats->io_slow_handlers, 1);
+    uint64_t us = elapsed / 1000;
+    flight_data(FLIGHT_SLOW_HANDLER, us > UINT32_MAX ? UINT32_MAX : (uint32_t)us, req->data, req->len, end_ns);
+
+    char what[32];
+    describe(req, what, sizeof what);
+    LOG_WARN("slow handler: %s from EID %u took %.1f ms (budget %u ms)", what,
+             mctp_frame_has_header(req) ? req->data[MCTP_OFF_SRC] : 0, (double)elapsed / 1e6, budget_ms);
+
+    if (fired) {
+        /* symbolize the stack sampled at the deadline, now that malloc is safe */
+        sampled++;
+        int n = stack_depth;
+        char** names = backtrace_symbols(stack, n);
+        for (int i = SIGNAL_FRAMES; names && i < n; i++) {
+            LOG_CONT(LOG_LEVEL_WARN, "  #%d %s", i - SIGNAL_FRAMES, names[i]);
+        }
+        free(names);
+        fired = 0;
+    }
+}
+
+/**
+ * @brief Print the watchdog counters.
+ *
+ * @param out - destination.
+ */
+void watchdog_dump_stats(FILE* out) {
+    if (!budget_ns) return;
+    fprintf(out, "Handler watchdog: budget %u ms, %llu dispatches, %llu over budget, %llu stacks sampled, "
+                 "longest %.1f ms\n",
+            budget_ms, (unsigned long long)dispatches, (unsigned long long)slow, (unsigned long long)sampled,
+            (double)endpoint_stats->io_handler_max_ns / 1e6);
+}
@@ -0,0 +1,402 @@
+/**
+ * @file workpool.c
+ * @brief Bounded worker thread pool for long-running message handlers.
+ *
+ * Jobs are queued FIFO to a fixed number of worker threads.  The queue is
+ * bounded so a burst of slow requests cannot grow memory without limit;
+ * callers are told immediately when the pool is saturated so they can answer
+ * with a "not ready" style completion instead.  Finished jobs are moved to a
+ * completion list and an eventfd is signalled so the I/O loop can pick them
+ * up with workpool_poll().
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "workpool.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "log.h"
+
+static pthread_t threads[WORKPOOL_MAX_WORKERS];
+static unsigned worker_count = 0;
+static unsigned workers_wanted = 0;   /* started when the first handler registers */
+static unsigned queue_limit = WORKPOOL_DEFAULT_QUEUE;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cv = PTHREAD_COND_INITIALIZER;
+
+/* pending jobs (FIFO) and finished jobs waiting for the I/O thread */
+static workpool_job_t* queue_head = NULL;
+static workpool_job_t* queue_tail = NULL;
+static unsigned queue_len = 0;
+static workpool_job_t* done_head = NULL;
+static workpool_job_t* done_tail = NULL;
+static unsigned in_flight = 0;
+
+static int stopping = 0;
+static int initialized = 0;
+static int event_fd = -1;
+
+static workpool_handler_stats_t handlers[WORKPOOL_MAX_HANDLERS];
+static int handler_count = 0;
+
+/**
+ * @brief Record a finished job and wake the I/O thread.
+ *
+ * Must be called with the pool lock held.
+ *
+ * @param job - the job whose run function has returned.
+ */
+static void finish_locked(workpool_job_t* job) {
+    job->next = NULL;
+    int was_empty = (done_head == NULL);
+    if (done_tail) {
+        done_tail->next = job;
+    } else {
+        __atomic_store_n(&done_head, job, __ATOMIC_RELEASE);
+    }
+    done_tail = job;
+
+    if (job->handler >= 0 && job->handler < handler_count) {
+        workpool_handler_stats_t* h = &handlers[job->handler];
+        uint64_t wait = job->t_start_ns - job->t_submit_ns;
+        uint64_t run = job->t_end_ns - job->t_start_ns;
+        h->wait_ns_total += wait;
+        h->run_ns_total += run;
+        if (wait > h->wait_ns_max) h->wait_ns_max = wait;
+        if (run > h->run_ns_max) h->run_ns_max = run;
+    }
+
+    // the eventfd is readable exactly while the completion list is non-empty
+    if (was_empty && event_fd != -1) {
+        uint64_t one = 1;
+        ssize_t r = write(event_fd, &one, sizeof one);
+        (void)r;
+    }
+}
+
+/**
+ * @brief Worker thread body: pull jobs from the queue until shutdown.
+ *
+ * @param unused - required by the pthread signature.
+ * @return void* Always NULL.
+ */
+static void* worker_main(void* unused) {
+    (void)unused;
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (!queue_head && !stopping) {
+            pthread_cond_wait(&work_cv, &lock);
+        }
+        if (!queue_head) break;
+
+        workpool_job_t* job = queue_head;
+        queue_head = job->next;
+        if (!queue_head) queue_tail = NULL;
+        queue_len--;
+        pthread_mutex_unlock(&lock);
+
+        job->t_start_ns = clock_now_ns();
+        if (job->run) job->run(job);
+        job->t_end_ns = clock_now_ns();
+
+        pthread_mutex_lock(&lock);
+        finish_locked(job);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+/**
+ * @brief Start the wanted worker threads.  Called with the pool lock held.
+ */
+static void start_workers_locked() {
+    // workers never handle process signals; leave them to the I/O thread
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (; worker_count < workers_wanted; worker_count++) {
+        int err = pthread_create(&threads[worker_count], NULL, worker_main, NULL);
+        if (err != 0) {
+            LOG_ERROR("pthread_create: %s", strerror(err));
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+/**
+ * @brief Prepare the worker pool.
+ *
+ * No thread is started until a handler registers, so a process without
+ * long-running handlers pays nothing.  A worker count of zero keeps the
+ * pool single-threaded: submitted jobs run inline but their completions are
+ * still deferred to workpool_poll(), which keeps the calling convention
+ * identical for handlers.
+ *
+ * @param workers - number of worker threads (clamped to WORKPOOL_MAX_WORKERS).
+ * @param queue_depth - maximum number of jobs waiting to start.
+ * @return int 0 on success, -1 on error.
+ */
+int workpool_init(unsigned workers, unsigned queue_depth) {
+    if (initialized) return 0;
+    if (workers > WORKPOOL_MAX_WORKERS) workers = WORKPOOL_MAX_WORKERS;
+    queue_limit = queue_depth ? queue_depth : WORKPOOL_DEFAULT_QUEUE;
+
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd == -1) {
+        LOG_ERROR("eventfd: %m");
+        return -1;
+    }
+
+    pthread_mutex_lock(&lock);
+    stopping = 0;
+    workers_wanted = workers;
+    if (handler_count > 0) start_workers_locked();
+    initialized = 1;
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+/**
+ * @brief Stop the worker threads after they finish any queued work.
+ *
+ * Completions that have not been polled are discarded.
+ */
+void workpool_shutdown() {
+    if (!initialized) return;
+    pthread_mutex_lock(&lock);
+    stopping = 1;
+    pthread_cond_broadcast(&work_cv);
+    pthread_mutex_unlock(&lock);
+
+    for (unsigned i = 0; i < worker_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    worker_count = 0;
+    done_head = done_tail = NULL;
+    if (event_fd != -1) {
+        close(event_fd);
+        event_fd = -1;
+    }
+    initialized = 0;
+}
+
+/**
+ * @brief Register a handler so its jobs are accounted separately.
+ *
+ * The first registration starts the worker threads.
+ *
+ * @param name - short human-readable handler name.
+ * @return int Handler id for workpool_job_t.handler, or -1 if the table is full.
+ */
+int workpool_register_handler(const char* name) {
+    pthread_mutex_lock(&lock);
+    if (handler_count >= WORKPOOL_MAX_HANDLERS) {
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+    int id = handler_count++;
+    memset(&handlers[id], 0, sizeof handlers[id]);
+    strncpy(handlers[id].name, name ? name : "?", sizeof handlers[id].name - 1);
+    if (initialized && !stopping) start_workers_locked();
+    pthread_mutex_unlock(&lock);
+    return id;
+}
+
+/**
+ * @brief Queue a job for execution on a worker thread.
+ *
+ * The job structure must remain valid until its completion has been
+ * delivered by workpool_poll().
+ *
+ * @param job - the job to run.
+ * @return int 0 when accepted, -1 if the pool is not running or is full.
+ */
+int workpool_submit(workpool_job_t* job) {
+    if (!initialized || !job) return -1;
+    pipeline_request_capture(&job->request);
+
+    pthread_mutex_lock(&lock);
+    workpool_handler_stats_t* h = NULL;
+    if (job->handler >= 0 && job->handler < handler_count) h = &handlers[job->handler];
+
+    if (queue_len >= queue_limit) {
+        if (h) h->rejected++;
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+
+    job->t_submit_ns = clock_now_ns();
+    job->next = NULL;
+    in_flight++;
+    if (h) {
+        h->submitted++;
+        h->depth++;
+        if (h->depth > h->max_depth) h->max_depth = h->depth;
+    }
+
+    if (worker_count == 0) {
+        // no threads: run now, complete later from the I/O loop
+        pthread_mutex_unlock(&lock);
+        job->t_start_ns = clock_now_ns();
+        if (job->run) job->run(job);
+        job->t_end_ns = clock_now_ns();
+        pthread_mutex_lock(&lock);
+        finish_locked(job);
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+
+    if (queue_tail) {
+        queue_tail->next = job;
+    } else {
+        queue_head = job;
+    }
+    queue_tail = job;
+    queue_len++;
+    pthread_cond_signal(&work_cv);
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+/**
+ * @brief Deliver finished jobs on the calling (I/O) thread.
+ *
+ * For each finished job any attached response is queued for transmission,
+ * tagged with the request it answers, then the job's completion callback is
+ * invoked.
+ *
+ * @return int Number of completions delivered.
+ */
+int workpool_poll() {
+    // cheap unlocked check keeps the idle I/O loop free of syscalls
+    if (!initialized || !__atomic_load_n(&done_head, __ATOMIC_ACQUIRE)) return 0;
+
+    pthread_mutex_lock(&lock);
+    workpool_job_t* job = done_head;
+    done_head = done_tail = NULL;
+    uint64_t count;
+    ssize_t r = read(event_fd, &count, sizeof count);
+    (void)r;
+    pthread_mutex_unlock(&lock);
+
+    int delivered = 0;
+    while (job) {
+        workpool_job_t* next = job->next;
+
+        // charged to the request it answers, not the one the core is handling now
+        if (job->response_len &&
+            pipeline_send_deferred(job->response, job->response_len, &job->request, job->t_end_ns) < 0) {
+            LOG_WARN("worker pool: response of %s dropped",
+                     job->handler >= 0 && job->handler < handler_count ? handlers[job->handler].name : "job");
+        }
+
+        pthread_mutex_lock(&lock);
+        in_flight--;
+        if (job->handler >= 0 && job->handler < handler_count) {
+            handlers[job->handler].depth--;
+            handlers[job->handler].completed++;
+        }
+        pthread_mutex_unlock(&lock);
+
+        if (job->complete) job->complete(job);
+        delivered++;
+        job = next;
+    }
+    return delivered;
+}
+
+/**
+ * @brief File descriptor that becomes readable when completions are pending.
+ *
+ * @return int An eventfd, or -1 if the pool is not running.
+ */
+int workpool_event_fd() {
+    return event_fd;
+}
+
+/**
+ * @brief Number of jobs submitted but not yet delivered by workpool_poll().
+ *
+ * @return unsigned Jobs queued, running or awaiting completion.
+ */
+unsigned workpool_pending() {
+    pthread_mutex_lock(&lock);
+    unsigned n = in_flight;
+    pthread_mutex_unlock(&lock);
+    return n;
+}
+
+/**
+ * @brief Copy the counters for one handler.
+ *
+ * @param handler - handler id.
+ * @param out - destination for the snapshot.
+ * @return int 0 on success, -1 for an unknown handler.
+ */
+int workpool_get_stats(int handler, workpool_handler_stats_t* out) {
+    pthread_mutex_lock(&lock);
+    if (handler < 0 || handler >= handler_count) {
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+    *out = handlers[handler];
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+/**
+ * @brief Print per-handler queue depth and latency figures.
+ *
+ * @param out - stream to print to.
+ */
+void workpool_dump_stats(FILE* out) {
+    pthread_mutex_lock(&lock);
+    if (handler_count == 0) {
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+    fprintf(out, "Worker pool: %u threads, queue limit %u\n", worker_count, queue_limit);
+    fprintf(out, "  %-23s %6s %6s %10s %10s %8s %10s %10s %10s %10s\n", "handler", "depth", "max",
+            "submitted", "completed", "rejected", "wait-avg", "wait-max", "run-avg", "run-max");
+    for (int i = 0; i < handler_count; i++) {
+        const workpool_handler_stats_t* h = &handlers[i];
+        uint64_t done = h->completed ? h->completed : 1;
+        fprintf(out, "  %-23s %6u %6u %10llu %10llu %8llu %8lluus %8lluus %8lluus %8lluus\n",
+                h->name, h->depth, h->max_depth, (unsigned long long)h->submitted,
+                (unsigned long long)h->completed, (unsigned long long)h->rejected,
+                (unsigned long long)(h->wait_ns_total / done / 1000),
+                (unsigned long long)(h->wait_ns_max / 1000),
+                (unsigned long long)(h->run_ns_total / done / 1000),
+                (unsigned long long)(h->run_ns_max / 1000));
+    }
+    pthread_mutex_unlock(&lock);
+}
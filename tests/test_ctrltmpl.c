@@ -0,0 +1,261 @@
+/**
+ * @file test_ctrltmpl.c
+ * @brief Unit tests for the control response template cache.
+ *
+ * Answers patched into a learned wire image must be byte-for-byte what a
+ * fresh encoding of the same response would produce, including the FCS and
+ * any escaping it needs.  Requests that change endpoint state must clear the
+ * cache, and responses to requests older than the clear must not be learned.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "ctrltmpl.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "mctp_serial.h"
+#include "unit.h"
+
+#define OWN_EID 0x08
+
+static mctp_frame_t req, resp, out, expect;
+
+/**
+ * @brief Build a single-packet control request addressed to the endpoint.
+ *
+ * @param f - destination frame.
+ * @param src - requester EID.
+ * @param tag - message tag.
+ * @param iid - instance id.
+ * @param cmd - control command.
+ * @param payload - request data after the command, or NULL.
+ * @param plen - bytes of payload.
+ * @param seq - receive sequence number.
+ */
+static void control_request(mctp_frame_t* f, uint8_t src, uint8_t tag, uint8_t iid, uint8_t cmd,
+                            const uint8_t* payload, uint8_t plen, uint32_t seq) {
+    uint8_t body[16] = {1, OWN_EID, src, MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO | tag,
+                        MCTP_MSG_TYPE_CONTROL, MCTP_INSTANCE_RQ | iid, cmd};
+    if (plen) memcpy(&body[7], payload, plen);
+    mctp_serial_encode(f, body, (uint8_t)(7 + plen));
+    f->seq = seq;
+}
+
+/**
+ * @brief Build the GET_ENDPOINT_ID response the core would send.
+ *
+ * @param f - destination frame.
+ * @param dest - requester EID.
+ * @param tag - message tag.
+ * @param iid - instance id.
+ * @param eid - EID reported in the response.
+ */
+static void get_eid_response(mctp_frame_t* f, uint8_t dest, uint8_t tag, uint8_t iid, uint8_t eid) {
+    uint8_t body[] = {1,
+                      dest,
+                      OWN_EID,
+                      MCTP_FLAG_SOM | MCTP_FLAG_EOM | tag,
+                      MCTP_MSG_TYPE_CONTROL,
+                      iid,
+                      MCTP_CTRL_CMD_GET_ENDPOINT_ID,
+                      0,
+                      eid,
+                      0,
+                      0};
+    mctp_serial_encode(f, body, sizeof body);
+}
+
+/**
+ * @brief Answers match a fresh encoding for every requester, tag and instance id.
+ *
+ * Requester EIDs 0x7d and 0x7e need escaping and force re-encoding; the
+ * others are patched into the learned image.  The learned EID is varied so
+ * the image itself may hold escaped bytes ahead of the FCS.
+ */
+static void test_patch_matches_encoding() {
+    static const uint8_t srcs[] = {0x09, 0x10, 0x55, MCTP_SERIAL_ESCAPE, MCTP_SERIAL_FLAG};
+    static const uint8_t eids[] = {OWN_EID, MCTP_SERIAL_ESCAPE};
+
+    for (unsigned e = 0; e < sizeof eids; e++) {
+        ctrltmpl_init(1);
+        control_request(&req, 0x10, 1, 3, MCTP_CTRL_CMD_GET_ENDPOINT_ID, NULL, 0, 1);
+        get_eid_response(&resp, 0x10, 1, 3, eids[e]);
+        ctrltmpl_learn(&req, &resp);
+
+        int mismatches = 0;
+        for (unsigned s = 0; s < sizeof srcs; s++) {
+            for (uint8_t tag = 0; tag <= MCTP_FLAG_TAG_MASK; tag++) {
+                for (uint8_t iid = 0; iid <= MCTP_INSTANCE_ID_MASK; iid++) {
+                    control_request(&req, srcs[s], tag, iid, MCTP_CTRL_CMD_GET_ENDPOINT_ID, NULL, 0,
+                                    2);
+                    memset(&out, 0xa5, sizeof out);
+                    if (ctrltmpl_answer(&req, &out) != 1) {
+                        mismatches++;
+                        continue;
+                    }
+                    get_eid_response(&expect, srcs[s], tag, iid, eids[e]);
+                    if (out.len != expect.len || memcmp(out.data, expect.data, expect.len) ||
+                        out.raw_len != expect.raw_len ||
+                        memcmp(out.raw, expect.raw, expect.raw_len)) {
+                        mismatches++;
+                    }
+                }
+            }
+        }
+        CHECK_EQ(mismatches, 0);
+
+        ctrltmpl_stats_t st;
+        ctrltmpl_get_stats(&st);
+        CHECK_EQ(st.learned, 1);
+        CHECK_EQ(st.hits, sizeof srcs * (MCTP_FLAG_TAG_MASK + 1) * (MCTP_INSTANCE_ID_MASK + 1));
+        CHECK(st.patched > 0);
+        CHECK(st.patched < st.hits);
+    }
+}
+
+/**
+ * @brief The patched wire image decodes to a valid frame.
+ */
+static void test_patched_frame_decodes() {
+    ctrltmpl_init(1);
+    control_request(&req, 0x10, 0, 0, MCTP_CTRL_CMD_GET_ENDPOINT_ID, NULL, 0, 1);
+    get_eid_response(&resp, 0x10, 0, 0, OWN_EID);
+    ctrltmpl_learn(&req, &resp);
+
+    control_request(&req, 0x22, 5, 17, MCTP_CTRL_CMD_GET_ENDPOINT_ID, NULL, 0, 2);
+    CHECK_EQ(ctrltmpl_answer(&req, &out), 1);
+    memcpy(expect.raw, out.raw, out.raw_len);
+    expect.raw_len = out.raw_len;
+    mctp_serial_decode(&expect);
+    CHECK_EQ(expect.status, MCTP_FRAME_OK);
+    CHECK_EQ(expect.data[MCTP_OFF_DEST], 0x22);
+    CHECK_EQ(expect.data[MCTP_OFF_FLAGS] & MCTP_FLAG_TAG_MASK, 5);
+    CHECK_EQ(expect.data[MCTP_OFF_INSTANCE], 17);
+}
+
+/**
+ * @brief Templates are keyed on command, destination and request payload.
+ */
+static void test_key() {
+    static const uint8_t ctrl_version[] = {0xff};
+    static const uint8_t pldm_version[] = {0x01};
+
+    ctrltmpl_init(1);
+    control_request(&req, 0x10, 0, 0, MCTP_CTRL_CMD_GET_ENDPOINT_ID, NULL, 0, 1);
+    get_eid_response(&resp, 0x10, 0, 0, OWN_EID);
+    ctrltmpl_learn(&req, &resp);
+
+    control_request(&req, 0x10, 0, 1, MCTP_CTRL_CMD_GET_VERSION_SUPPORT, ctrl_version, 1, 2);
+    CHECK_EQ(ctrltmpl_answer(&req, &out), 0);
+
+    // one version entry: 1.3.1
+    uint8_t body[] = {1, 0x10, OWN_EID, MCTP_FLAG_SOM | MCTP_FLAG_EOM, MCTP_MSG_TYPE_CONTROL, 1,
+                      MCTP_CTRL_CMD_GET_VERSION_SUPPORT, 0, 1, 0xf1, 0xf3, 0xf1, 0x00};
+    mctp_serial_encode(&resp, body, sizeof body);
+    ctrltmpl_learn(&req, &resp);
+    control_request(&req, 0x10, 2, 4, MCTP_CTRL_CMD_GET_VERSION_SUPPORT, ctrl_version, 1, 3);
+    CHECK_EQ(ctrltmpl_answer(&req, &out), 1);
+    CHECK_EQ(out.data[MCTP_OFF_CTRL_CMD], MCTP_CTRL_CMD_GET_VERSION_SUPPORT);
+
+    // same command, different payload
+    control_request(&req, 0x10, 2, 4, MCTP_CTRL_CMD_GET_VERSION_SUPPORT, pldm_version, 1, 4);
+    CHECK_EQ(ctrltmpl_answer(&req, &out), 0);
+
+    // GET_ENDPOINT_ID addressed to the null EID
+    control_request(&req, 0x10, 0, 0, MCTP_CTRL_CMD_GET_ENDPOINT_ID, NULL, 0, 5);
+    req.data[MCTP_OFF_DEST] = 0;
+    CHECK_EQ(ctrltmpl_answer(&req, &out), 0);
+}
+
+/**
+ * @brief SET_ENDPOINT_ID clears the cache and stale responses are not learned.
+ */
+static void test_invalidate() {
+    static const uint8_t set_eid[] = {0x00, 0x20};
+
+    ctrltmpl_init(1);
+    control_request(&req, 0x10, 0, 0, MCTP_CTRL_CMD_GET_ENDPOINT_ID, NULL, 0, 1);
+    get_eid_response(&resp, 0x10, 0, 0, OWN_EID);
+    ctrltmpl_learn(&req, &resp);
+    CHECK_EQ(ctrltmpl_answer(&req, &out), 1);
+
+    control_request(&req, 0x10, 0, 1, MCTP_CTRL_CMD_SET_ENDPOINT_ID, set_eid, sizeof set_eid, 5);
+    CHECK_EQ(ctrltmpl_answer(&req, &out), 0);
+
+    control_request(&req, 0x10, 0, 2, MCTP_CTRL_CMD_GET_ENDPOINT_ID, NULL, 0, 6);
+    CHECK_EQ(ctrltmpl_answer(&req, &out), 0);
+
+    // a response to a request received before the SET is computed from the old EID
+    control_request(&req, 0x10, 0, 2, MCTP_CTRL_CMD_GET_ENDPOINT_ID, NULL, 0, 4);
+    get_eid_response(&resp, 0x10, 0, 2, OWN_EID);
+    ctrltmpl_learn(&req, &resp);
+    CHECK_EQ(ctrltmpl_answer(&req, &out), 0);
+
+    control_request(&req, 0x10, 0, 2, MCTP_CTRL_CMD_GET_ENDPOINT_ID, NULL, 0, 6);
+    get_eid_response(&resp, 0x10, 0, 2, 0x20);
+    ctrltmpl_learn(&req, &resp);
+    CHECK_EQ(ctrltmpl_answer(&req, &out), 1);
+    CHECK_EQ(out.data[MCTP_OFF_CTRL_CMD + 2], 0x20);
+
+    ctrltmpl_stats_t st;
+    ctrltmpl_get_stats(&st);
+    CHECK_EQ(st.invalidations, 1);
+    CHECK_EQ(st.learned, 2);
+}
+
+/**
+ * @brief Responses that are not a clean answer to the request are not learned.
+ */
+static void test_learn_rejects() {
+    ctrltmpl_init(1);
+    control_request(&req, 0x10, 3, 7, MCTP_CTRL_CMD_GET_ENDPOINT_ID, NULL, 0, 1);
+
+    get_eid_response(&resp, 0x10, 4, 7, OWN_EID);  // wrong tag
+    ctrltmpl_learn(&req, &resp);
+    get_eid_response(&resp, 0x10, 3, 8, OWN_EID);  // wrong instance id
+    ctrltmpl_learn(&req, &resp);
+    get_eid_response(&resp, 0x11, 3, 7, OWN_EID);  // wrong destination
+    ctrltmpl_learn(&req, &resp);
+    get_eid_response(&resp, 0x10, 3, 7, OWN_EID);
+    resp.data[MCTP_OFF_CTRL_CMD + 1] = 0x01;  // error completion code
+    ctrltmpl_learn(&req, &resp);
+    CHECK_EQ(ctrltmpl_answer(&req, &out), 0);
+
+    ctrltmpl_init(0);
+    get_eid_response(&resp, 0x10, 3, 7, OWN_EID);
+    ctrltmpl_learn(&req, &resp);
+    CHECK_EQ(ctrltmpl_answer(&req, &out), 0);
+
+    ctrltmpl_stats_t st;
+    ctrltmpl_get_stats(&st);
+    CHECK_EQ(st.learned, 0);
+}
+
+int main() {
+    test_patch_matches_encoding();
+    test_patched_frame_decodes();
+    test_key();
+    test_invalidate();
+    test_learn_rejects();
+    return unit_report("test_ctrltmpl");
+}
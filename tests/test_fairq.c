@@ -0,0 +1,186 @@
+/**
+ * @file test_fairq.c
+ * @brief Unit tests for the per-source receive queues and their DRR turns.
+ *
+ * Handler times are chosen as fractions or multiples of FAIRQ_QUANTUM_NS so
+ * the expected service order can be written out exactly.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fairq.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "mctp_serial.h"
+#include "unit.h"
+
+#define EID_A 0x0A
+#define EID_B 0x0B
+/* fairq_pop() charges this much per packet before the handler time */
+#define PACKET_NS 50000ull
+
+static mctp_frame_t frame;
+
+/**
+ * @brief Queue n requests from an EID.
+ *
+ * @return int Number queued before the source's queue filled.
+ */
+static int queue(uint8_t src, int n) {
+    uint8_t body[] = {1, 0x08, src, MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO, MCTP_MSG_TYPE_PLDM,
+                      MCTP_INSTANCE_RQ, 0x02, 0x11};
+    mctp_serial_encode(&frame, body, sizeof body);
+    for (int i = 0; i < n; i++) {
+        mctp_frame_t* slot = fairq_slot(&frame);
+        if (!slot) return i;
+        mctp_frame_copy(slot, &frame);
+        fairq_commit();
+    }
+    return n;
+}
+
+/**
+ * @brief Serve frames, charging each source's handler its own time.
+ *
+ * @param order - receives one letter per frame served: 'A', 'B' or '?'.
+ * @param max - frames to serve at most.
+ * @param a_ns - handler time of EID_A's requests.
+ * @param b_ns - handler time of EID_B's requests.
+ */
+static void serve(char* order, int max, uint64_t a_ns, uint64_t b_ns) {
+    int n = 0;
+    mctp_frame_t* f;
+    while (n < max && (f = fairq_peek())) {
+        uint8_t src = f->data[MCTP_OFF_SRC];
+        order[n++] = src == EID_A ? 'A' : src == EID_B ? 'B' : '?';
+        fairq_pop(0);
+        fairq_charge(src == EID_A ? a_ns : b_ns);
+    }
+    order[n] = '\0';
+}
+
+/**
+ * @brief Cheap handlers: a source keeps the turn until its quantum is spent.
+ */
+static void test_credit() {
+    char order[64];
+    fairq_init(16);
+    CHECK_EQ(queue(EID_A, 10), 10);
+    CHECK_EQ(queue(EID_B, 10), 10);
+    CHECK_EQ(fairq_count(), 20);
+
+    // each request costs a quarter of a quantum
+    serve(order, 63, FAIRQ_QUANTUM_NS / 4 - PACKET_NS, FAIRQ_QUANTUM_NS / 4 - PACKET_NS);
+    CHECK(strcmp(order, "AAAABBBBAAAABBBBAABB") == 0);
+    CHECK_EQ(fairq_count(), 0);
+    CHECK(fairq_peek() == NULL);
+    fairq_free();
+}
+
+/**
+ * @brief A handler that overruns puts its source in debt for as many quanta.
+ */
+static void test_debt() {
+    char order[64];
+    fairq_init(32);
+    queue(EID_A, 3);
+    queue(EID_B, 20);
+
+    // A's requests take three quanta each, B's exactly one
+    serve(order, 9, 3 * FAIRQ_QUANTUM_NS, FAIRQ_QUANTUM_NS - PACKET_NS);
+    CHECK(strcmp(order, "ABBBABBBA") == 0);
+    serve(order, 63, 3 * FAIRQ_QUANTUM_NS, FAIRQ_QUANTUM_NS - PACKET_NS);
+    CHECK(strcmp(order, "BBBBBBBBBBBBBB") == 0);
+    fairq_free();
+}
+
+/**
+ * @brief Debt is capped, so one very long handler does not starve its source.
+ */
+static void test_debt_cap() {
+    char order[64];
+    fairq_init(32);
+    queue(EID_A, 2);
+    queue(EID_B, 30);
+
+    serve(order, 63, 100 * FAIRQ_QUANTUM_NS, FAIRQ_QUANTUM_NS - PACKET_NS);
+    const char* second_a = strchr(order + 1, 'A');
+    CHECK(order[0] == 'A' && second_a != NULL);
+    CHECK_EQ(second_a - order - 1, FAIRQ_MAX_DEBT);
+    fairq_free();
+}
+
+/**
+ * @brief A source that goes idle keeps its debt but loses unused credit.
+ */
+static void test_idle() {
+    char order[64];
+    fairq_init(16);
+    queue(EID_A, 1);
+    serve(order, 63, 0, 0);
+    CHECK(strcmp(order, "A") == 0);
+
+    // A left with most of a quantum unused; it must not carry that into B's turn
+    queue(EID_B, 8);
+    queue(EID_A, 8);
+    serve(order, 63, FAIRQ_QUANTUM_NS / 4 - PACKET_NS, FAIRQ_QUANTUM_NS / 4 - PACKET_NS);
+    CHECK(strcmp(order, "BBBBAAAABBBBAAAA") == 0);
+    fairq_free();
+}
+
+/**
+ * @brief A full queue refuses its own source only; EIDs beyond the tracked
+ * sources share the last queue.
+ */
+static void test_sources() {
+    fairq_init(4);
+    CHECK_EQ(queue(EID_A, 10), 4);
+    CHECK_EQ(queue(EID_B, 2), 2);
+    fairq_free();
+
+    fairq_init(4);
+    for (int i = 0; i < FAIRQ_SOURCES - 1; i++) {
+        frame.data[MCTP_OFF_SRC] = (uint8_t)(0x20 + i);
+        CHECK_EQ(fairq_source(&frame), i);
+    }
+    frame.data[MCTP_OFF_SRC] = 0x20;
+    CHECK_EQ(fairq_source(&frame), 0);
+    frame.data[MCTP_OFF_SRC] = 0x60;
+    CHECK_EQ(fairq_source(&frame), FAIRQ_SOURCES - 1);
+    frame.data[MCTP_OFF_SRC] = 0x61;
+    CHECK_EQ(fairq_source(&frame), FAIRQ_SOURCES - 1);
+
+    // A and B arrive after the tracked sources are claimed and share a queue
+    CHECK_EQ(queue(EID_A, 3), 3);
+    CHECK_EQ(queue(EID_B, 3), 1);
+    fairq_free();
+}
+
+int main() {
+    test_credit();
+    test_debt();
+    test_debt_cap();
+    test_idle();
+    test_sources();
+    return unit_report("test_fairq");
+}
@@ -0,0 +1,219 @@
+/**
+ * @file test_faultinj.c
+ * @brief Unit tests for the fault injection parser and byte stream damage.
+ *
+ * Faults are forced with probability 1 so each effect can be counted exactly.
+ * The output must never grow past the capacity given, however many bytes the
+ * injector would like to add.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "faultinj.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "mctp_serial.h"
+#include "unit.h"
+
+#define STREAM_LEN 64
+#define CANARY 0xA5
+
+static uint8_t in[STREAM_LEN];
+static uint8_t out[4 * STREAM_LEN];
+
+/**
+ * @brief Fill the input with two frames of non-flag bytes.
+ */
+static void make_stream() {
+    for (unsigned i = 0; i < STREAM_LEN; i++) in[i] = (uint8_t)(0x10 + i);
+    in[0] = MCTP_SERIAL_FLAG;
+    in[STREAM_LEN / 2] = MCTP_SERIAL_FLAG;
+    in[STREAM_LEN - 1] = MCTP_SERIAL_FLAG;
+}
+
+/**
+ * @brief Damage the stream into a buffer of a given capacity.
+ *
+ * @param cap - capacity offered to faultinj_apply().
+ * @param overrun - receives non-zero if a byte past cap was written.
+ * @return size_t Bytes produced.
+ */
+static size_t apply(size_t cap, int* overrun) {
+    memset(out, CANARY, sizeof out);
+    size_t n = faultinj_apply(FAULTINJ_RX, in, STREAM_LEN, out, cap);
+    *overrun = 0;
+    for (size_t i = cap; i < sizeof out; i++) {
+        if (out[i] != CANARY) *overrun = 1;
+    }
+    return n;
+}
+
+/**
+ * @brief Well-formed specifications enable the expected directions.
+ */
+static void test_parse_valid() {
+    CHECK_EQ(faultinj_init(NULL), 0);
+    CHECK(!faultinj_active(FAULTINJ_RX) && !faultinj_active(FAULTINJ_TX));
+    CHECK_EQ(faultinj_init(""), 0);
+    CHECK(!faultinj_active(FAULTINJ_RX) && !faultinj_active(FAULTINJ_TX));
+
+    CHECK_EQ(faultinj_init("ber=1e-4,drop=0.01,dup=0.01,flag=0.001,trunc=0.1,seed=7"), 0);
+    CHECK(faultinj_active(FAULTINJ_RX) && faultinj_active(FAULTINJ_TX));
+
+    CHECK_EQ(faultinj_init("drop=0.5,dir=rx"), 0);
+    CHECK(faultinj_active(FAULTINJ_RX) && !faultinj_active(FAULTINJ_TX));
+    CHECK_EQ(faultinj_init("dir=tx,drop=0.5"), 0);
+    CHECK(!faultinj_active(FAULTINJ_RX) && faultinj_active(FAULTINJ_TX));
+    CHECK_EQ(faultinj_init("drop=0.5,dir=both"), 0);
+    CHECK(faultinj_active(FAULTINJ_RX) && faultinj_active(FAULTINJ_TX));
+
+    // write delays only apply to transmit
+    CHECK_EQ(faultinj_init("delay=0.5,delay-max=100"), 0);
+    CHECK(!faultinj_active(FAULTINJ_RX) && faultinj_active(FAULTINJ_TX));
+
+    // all probabilities zero: nothing to inject
+    CHECK_EQ(faultinj_init("drop=0,seed=3"), 0);
+    CHECK(!faultinj_active(FAULTINJ_RX) && !faultinj_active(FAULTINJ_TX));
+}
+
+/**
+ * @brief Malformed specifications are rejected and leave injection off.
+ */
+static void test_parse_invalid() {
+    static const char* bad[] = {"drop",       "drop=",     "drop=x",  "drop=-0.1", "drop=0.1x",
+                                "bogus=1",    "dir=up",    "dir=",    "=0.1",      "drop=0.1,,x",
+                                "drop=0.1,ber"};
+    for (unsigned i = 0; i < sizeof bad / sizeof bad[0]; i++) {
+        CHECK_EQ(faultinj_init(bad[i]), -1);
+        CHECK(!faultinj_active(FAULTINJ_RX) && !faultinj_active(FAULTINJ_TX));
+    }
+}
+
+/**
+ * @brief Inserted flags and duplicates only use the spare room in the output.
+ */
+static void test_spare_bytes() {
+    int overrun;
+
+    // no spare room: every byte passes through exactly once, undamaged
+    faultinj_init("flag=1,dup=1,dir=rx");
+    size_t n = apply(STREAM_LEN, &overrun);
+    CHECK_EQ(n, STREAM_LEN);
+    CHECK(!overrun);
+    CHECK(memcmp(out, in, STREAM_LEN) == 0);
+    faultinj_stats_t st;
+    faultinj_get_stats(FAULTINJ_RX, &st);
+    CHECK_EQ(st.flags, 0);
+    CHECK_EQ(st.duplicated, 0);
+    CHECK_EQ(st.bytes, STREAM_LEN);
+
+    // a little room: it is used up, and no more
+    faultinj_init("flag=1,dup=1,dir=rx");
+    n = apply(STREAM_LEN + 5, &overrun);
+    CHECK_EQ(n, STREAM_LEN + 5);
+    CHECK(!overrun);
+    faultinj_get_stats(FAULTINJ_RX, &st);
+    CHECK_EQ(st.flags + st.duplicated, 5);
+
+    // room for everything: each byte gains a flag before it and a copy after it
+    faultinj_init("flag=1,dup=1,dir=rx");
+    n = apply(3 * STREAM_LEN, &overrun);
+    CHECK_EQ(n, 3 * STREAM_LEN);
+    CHECK(!overrun);
+    CHECK_EQ(out[0], MCTP_SERIAL_FLAG);
+    CHECK_EQ(out[6], MCTP_SERIAL_FLAG);
+    CHECK_EQ(out[7], in[2]);
+    CHECK_EQ(out[8], in[2]);
+    faultinj_get_stats(FAULTINJ_RX, &st);
+    CHECK_EQ(st.flags, STREAM_LEN);
+    CHECK_EQ(st.duplicated, STREAM_LEN);
+
+    // dropped bytes free room for later additions
+    faultinj_init("drop=1,flag=1,dir=rx");
+    n = apply(STREAM_LEN, &overrun);
+    CHECK(!overrun);
+    faultinj_get_stats(FAULTINJ_RX, &st);
+    CHECK_EQ(st.dropped, STREAM_LEN);
+    CHECK_EQ(n, st.flags);
+    CHECK_EQ(n, STREAM_LEN - 1);
+}
+
+/**
+ * @brief Bit errors, drops and truncation are counted one for one.
+ */
+static void test_damage() {
+    int overrun;
+
+    faultinj_init("ber=1,dir=rx");
+    size_t n = apply(STREAM_LEN, &overrun);
+    CHECK_EQ(n, STREAM_LEN);
+    int one_bit = 0;
+    for (unsigned i = 0; i < STREAM_LEN; i++) one_bit += __builtin_popcount(out[i] ^ in[i]) == 1;
+    CHECK_EQ(one_bit, STREAM_LEN);
+    faultinj_stats_t st;
+    faultinj_get_stats(FAULTINJ_RX, &st);
+    CHECK_EQ(st.bit_errors, STREAM_LEN);
+
+    // each frame keeps at most FAULTINJ_MAX_CUT bytes after its flag
+    faultinj_init("trunc=1,dir=rx");
+    n = apply(STREAM_LEN, &overrun);
+    faultinj_get_stats(FAULTINJ_RX, &st);
+    CHECK_EQ(st.truncated, 2);
+    CHECK_EQ(st.bytes, STREAM_LEN);
+    CHECK(n < STREAM_LEN);
+    unsigned run = 0, longest = 0;
+    for (size_t i = 0; i < n; i++) {
+        run = out[i] == MCTP_SERIAL_FLAG ? 0 : run + 1;
+        if (run > longest) longest = run;
+    }
+    CHECK(longest >= 1 && longest <= FAULTINJ_MAX_CUT);
+}
+
+/**
+ * @brief The same seed damages the stream the same way; a neighbouring seed does not.
+ */
+static void test_seed() {
+    static uint8_t first[4 * STREAM_LEN];
+    int overrun;
+
+    faultinj_init("ber=0.05,drop=0.05,dup=0.05,seed=42,dir=rx");
+    size_t n1 = apply(sizeof out, &overrun);
+    memcpy(first, out, n1);
+    faultinj_init("ber=0.05,drop=0.05,dup=0.05,seed=42,dir=rx");
+    size_t n2 = apply(sizeof out, &overrun);
+    CHECK(n1 == n2 && memcmp(first, out, n1) == 0);
+
+    faultinj_init("ber=0.05,drop=0.05,dup=0.05,seed=43,dir=rx");
+    size_t n3 = apply(sizeof out, &overrun);
+    CHECK(n1 != n3 || memcmp(first, out, n1) != 0);
+}
+
+int main() {
+    make_stream();
+    test_parse_valid();
+    test_parse_invalid();
+    test_spare_bytes();
+    test_damage();
+    test_seed();
+    return unit_report("test_faultinj");
+}
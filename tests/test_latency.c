@@ -0,0 +1,145 @@
+/**
+ * @file test_latency.c
+ * @brief Unit tests for the latency histogram buckets and percentiles.
+ *
+ * The bucket helpers are private to latency.c, so the source is included
+ * directly.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "../src/latency.c"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "unit.h"
+
+static latency_hist_t hist;
+
+/**
+ * @brief Every value lands in a bucket that holds it, at most 1/16 of the value wide.
+ */
+static void test_bucket_bounds() {
+    int bad = 0;
+    for (unsigned bit = 0; bit < LATENCY_MAX_BITS; bit++) {
+        uint64_t base = 1ull << bit;
+        uint64_t samples[] = {base - 1, base, base + 1, base + base / 3, base + base / 2,
+                              2 * base - 1};
+        for (unsigned i = 0; i < sizeof samples / sizeof samples[0]; i++) {
+            uint64_t v = samples[i];
+            if (v >= (1ull << LATENCY_MAX_BITS)) continue;
+            unsigned idx = bucket_index(v);
+            if (idx >= LATENCY_BUCKETS || bucket_upper(idx) < v) bad++;
+            if (idx > 0 && bucket_upper(idx - 1) >= v) bad++;
+            if (v >= LATENCY_SUB_BUCKETS && (bucket_upper(idx) - v) * LATENCY_SUB_BUCKETS > v) {
+                bad++;
+            }
+        }
+    }
+    CHECK_EQ(bad, 0);
+
+    // consecutive buckets tile the range with no gaps
+    int gaps = 0;
+    for (unsigned idx = 1; idx < LATENCY_BUCKETS; idx++) {
+        uint64_t next = bucket_upper(idx - 1) + 1;
+        if (bucket_index(next) != idx || bucket_upper(idx) < next) gaps++;
+    }
+    CHECK_EQ(gaps, 0);
+}
+
+/**
+ * @brief Small values get a bucket each and the top bucket ends at the clamp.
+ */
+static void test_bucket_edges() {
+    for (uint64_t v = 0; v < LATENCY_SUB_BUCKETS; v++) {
+        CHECK_EQ(bucket_index(v), v);
+        CHECK_EQ(bucket_upper((unsigned)v), v);
+    }
+    CHECK_EQ(bucket_index(LATENCY_SUB_BUCKETS), LATENCY_SUB_BUCKETS);
+    CHECK_EQ(bucket_upper(LATENCY_SUB_BUCKETS), LATENCY_SUB_BUCKETS);
+    CHECK_EQ(bucket_index(2 * LATENCY_SUB_BUCKETS), 2 * LATENCY_SUB_BUCKETS);
+    CHECK_EQ(bucket_upper(2 * LATENCY_SUB_BUCKETS), 2 * LATENCY_SUB_BUCKETS + 1);
+
+    uint64_t top = (1ull << LATENCY_MAX_BITS) - 1;
+    CHECK_EQ(bucket_index(top), LATENCY_BUCKETS - 1);
+    CHECK_EQ(bucket_upper(LATENCY_BUCKETS - 1), top);
+    CHECK_EQ(bucket_index(top + 1), LATENCY_BUCKETS - 1);
+    CHECK_EQ(bucket_index(UINT64_MAX), LATENCY_BUCKETS - 1);
+}
+
+/**
+ * @brief Percentiles of an empty, a single-valued and a uniform histogram.
+ */
+static void test_percentile() {
+    memset(&hist, 0, sizeof hist);
+    CHECK_EQ(latency_percentile(&hist, 50.0), 0);
+
+    // never above the largest value, even though its bucket extends further
+    latency_hist_add(&hist, 1000);
+    CHECK_EQ(latency_percentile(&hist, 0.0), 1000);
+    CHECK_EQ(latency_percentile(&hist, 50.0), 1000);
+    CHECK_EQ(latency_percentile(&hist, 100.0), 1000);
+
+    // 1..1000 us
+    memset(&hist, 0, sizeof hist);
+    for (uint64_t us = 1; us <= 1000; us++) latency_hist_add(&hist, us * 1000);
+    CHECK_EQ(hist.count, 1000);
+    CHECK_EQ(hist.max_ns, 1000000);
+
+    uint64_t p50 = latency_percentile(&hist, 50.0);
+    uint64_t p99 = latency_percentile(&hist, 99.0);
+    uint64_t p999 = latency_percentile(&hist, 99.9);
+    CHECK_EQ(p50, bucket_upper(bucket_index(500000)));
+    CHECK(p99 >= 990000 && p99 <= hist.max_ns);
+    CHECK_EQ(p999, 1000000);
+    CHECK_EQ(latency_percentile(&hist, 100.0), 1000000);
+    CHECK(p50 >= 500000 && p50 < 500000 + 500000 / LATENCY_SUB_BUCKETS);
+
+    uint64_t last = 0;
+    int decreasing = 0;
+    for (double pct = 0.0; pct <= 100.0; pct += 0.5) {
+        uint64_t v = latency_percentile(&hist, pct);
+        if (v < last) decreasing++;
+        last = v;
+    }
+    CHECK_EQ(decreasing, 0);
+}
+
+/**
+ * @brief A percentile rounds up to the sample that covers it.
+ */
+static void test_percentile_rank() {
+    memset(&hist, 0, sizeof hist);
+    for (int i = 0; i < 99; i++) latency_hist_add(&hist, 10);
+    latency_hist_add(&hist, 5000000);
+    CHECK_EQ(latency_percentile(&hist, 99.0), 10);
+    CHECK_EQ(latency_percentile(&hist, 99.5), 5000000);
+    CHECK_EQ(hist.sum_ns, 99 * 10 + 5000000);
+}
+
+int main() {
+    test_bucket_bounds();
+    test_bucket_edges();
+    test_percentile();
+    test_percentile_rank();
+    return unit_report("test_latency");
+}
@@ -0,0 +1,145 @@
+/**
+ * @file test_ratelimit.c
+ * @brief Unit tests for the rate limit specification parser and token buckets.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "ratelimit.h"
+
+#include <stdint.h>
+
+#include "mctp_serial.h"
+#include "unit.h"
+
+#define SEC 1000000000ull
+
+static mctp_frame_t frame;
+
+/**
+ * @brief Build a single-packet message from an EID.
+ *
+ * @param src - source EID.
+ * @param type - MCTP message type.
+ * @param flags - SOM/EOM/TO bits.
+ */
+static void message(uint8_t src, uint8_t type, uint8_t flags) {
+    uint8_t body[] = {1, 0x08, src, flags, type, MCTP_INSTANCE_RQ, 0x02, 0x11};
+    mctp_serial_encode(&frame, body, sizeof body);
+}
+
+/**
+ * @brief Count how many of n requests from an EID pass at one instant.
+ */
+static int allowed(uint8_t src, uint8_t type, int n, uint64_t now_ns) {
+    int passed = 0;
+    message(src, type, MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO);
+    for (int i = 0; i < n; i++) passed += ratelimit_allow(&frame, now_ns);
+    return passed;
+}
+
+/**
+ * @brief Well-formed specifications, default bursts, and per-EID overrides.
+ */
+static void test_parse_valid() {
+    CHECK_EQ(ratelimit_init(NULL), 0);
+    CHECK(!ratelimit_enabled());
+    CHECK_EQ(ratelimit_init(""), 0);
+    CHECK(!ratelimit_enabled());
+    CHECK_EQ(allowed(9, MCTP_MSG_TYPE_PLDM, 100, SEC), 100);
+
+    // explicit burst
+    CHECK_EQ(ratelimit_init("eid=20/5"), 0);
+    CHECK(ratelimit_enabled());
+    CHECK_EQ(allowed(9, MCTP_MSG_TYPE_PLDM, 10, SEC), 5);
+    CHECK_EQ(allowed(10, MCTP_MSG_TYPE_PLDM, 10, SEC), 5);
+
+    // a second's worth by default, and never less than one
+    CHECK_EQ(ratelimit_init("eid=3"), 0);
+    CHECK_EQ(allowed(9, MCTP_MSG_TYPE_PLDM, 10, SEC), 3);
+    CHECK_EQ(ratelimit_init("eid=0.5"), 0);
+    CHECK_EQ(allowed(9, MCTP_MSG_TYPE_PLDM, 10, SEC), 1);
+
+    // per-EID override, including exemption
+    CHECK_EQ(ratelimit_init("eid=20/5,eid.8=0,eid.0x0a=1/2"), 0);
+    CHECK_EQ(allowed(8, MCTP_MSG_TYPE_PLDM, 50, SEC), 50);
+    CHECK_EQ(allowed(10, MCTP_MSG_TYPE_PLDM, 50, SEC), 2);
+    CHECK_EQ(allowed(11, MCTP_MSG_TYPE_PLDM, 50, SEC), 5);
+
+    // per-type limit across all EIDs
+    CHECK_EQ(ratelimit_init("type.1=4/4"), 0);
+    CHECK(ratelimit_enabled());
+    CHECK_EQ(allowed(9, MCTP_MSG_TYPE_PLDM, 3, SEC) + allowed(10, MCTP_MSG_TYPE_PLDM, 3, SEC), 4);
+    CHECK_EQ(allowed(9, MCTP_MSG_TYPE_CONTROL, 20, SEC), 20);
+
+    // every limit zero: nothing to enforce
+    CHECK_EQ(ratelimit_init("eid=0,type.1=0"), 0);
+    CHECK(!ratelimit_enabled());
+}
+
+/**
+ * @brief Malformed specifications are rejected and leave limiting off.
+ */
+static void test_parse_invalid() {
+    static const char* bad[] = {
+        "eid", "eid=", "eid=x", "eid=-1", "eid=5/0", "eid=5/x", "eid=5/2z", "eid=5/",
+        "eid.256=1", "eid.x=1", "eid.=1", "type.128=1", "type.1", "bogus=1", "eid=5,,x",
+        "eid=20/5,eid.8=-1",
+    };
+    for (unsigned i = 0; i < sizeof bad / sizeof bad[0]; i++) {
+        CHECK_EQ(ratelimit_init(bad[i]), -1);
+        CHECK(!ratelimit_enabled());
+    }
+}
+
+/**
+ * @brief Tokens accrue at the configured rate up to the burst size.
+ */
+static void test_refill() {
+    ratelimit_init("eid=20/5");
+    CHECK_EQ(allowed(9, MCTP_MSG_TYPE_PLDM, 10, SEC), 5);
+    CHECK_EQ(allowed(9, MCTP_MSG_TYPE_PLDM, 10, SEC + SEC / 10), 2);
+    CHECK_EQ(allowed(9, MCTP_MSG_TYPE_PLDM, 10, SEC + SEC / 10 + SEC / 40), 0);
+    CHECK_EQ(allowed(9, MCTP_MSG_TYPE_PLDM, 10, 11 * SEC), 5);
+}
+
+/**
+ * @brief Responses and continuation packets are never limited.
+ */
+static void test_exempt() {
+    ratelimit_init("eid=1/1");
+    CHECK_EQ(allowed(9, MCTP_MSG_TYPE_PLDM, 1, SEC), 1);
+
+    message(9, MCTP_MSG_TYPE_PLDM, MCTP_FLAG_SOM | MCTP_FLAG_EOM);
+    CHECK_EQ(ratelimit_allow(&frame, SEC), 1);
+    message(9, MCTP_MSG_TYPE_PLDM, MCTP_FLAG_EOM | MCTP_FLAG_TO);
+    CHECK_EQ(ratelimit_allow(&frame, SEC), 1);
+    message(9, MCTP_MSG_TYPE_PLDM, MCTP_FLAG_SOM | MCTP_FLAG_TO);
+    CHECK_EQ(ratelimit_allow(&frame, SEC), 0);
+}
+
+int main() {
+    test_parse_valid();
+    test_parse_invalid();
+    test_refill();
+    test_exempt();
+    return unit_report("test_ratelimit");
+}
@@ -0,0 +1,344 @@
+/**
+ * @file test_replay.c
+ * @brief Unit tests for the duplicate-request replay cache.
+ *
+ * Covers the lookup key, pending duplicates, expiry, LRU eviction, and that
+ * an answer computed before endpoint state changed is never replayed to a
+ * request that arrives after the change.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "replay.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "mctp_serial.h"
+#include "unit.h"
+
+#define OWN_EID 0x08
+#define BUS_OWNER 0x10
+
+#define CTRL_SET_EID 0x01
+#define CTRL_GET_EID 0x02
+#define PLDM_GET_TID 0x02
+#define PLDM_SET_NUMERIC_EFFECTER_VALUE 0x31
+
+static mctp_frame_t req, resp;
+static replay_response_t cached;
+static uint32_t next_seq = 1;
+static int handler_runs = 0;
+
+/**
+ * @brief Build a single-packet request addressed to the endpoint.
+ *
+ * @param src - requester EID.
+ * @param tag - message tag.
+ * @param iid - instance id.
+ * @param type - MCTP message type.
+ * @param msg - message bytes after the instance id byte.
+ * @param mlen - bytes of msg.
+ */
+static void request(uint8_t src, uint8_t tag, uint8_t iid, uint8_t type, const uint8_t* msg,
+                    uint8_t mlen) {
+    uint8_t body[32] = {1, OWN_EID, src, MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO | tag, type,
+                        MCTP_INSTANCE_RQ | iid};
+    memcpy(&body[6], msg, mlen);
+    mctp_serial_encode(&req, body, (uint8_t)(6 + mlen));
+    req.seq = next_seq++;
+}
+
+/**
+ * @brief Build a control request with no data after the command.
+ */
+static void control(uint8_t src, uint8_t tag, uint8_t iid, uint8_t cmd) {
+    request(src, tag, iid, MCTP_MSG_TYPE_CONTROL, &cmd, 1);
+}
+
+/**
+ * @brief Build a SET_ENDPOINT_ID request assigning an EID.
+ */
+static void set_eid(uint8_t iid, uint8_t eid) {
+    uint8_t msg[] = {CTRL_SET_EID, 0x00, eid};
+    request(BUS_OWNER, 1, iid, MCTP_MSG_TYPE_CONTROL, msg, sizeof msg);
+}
+
+/**
+ * @brief Build the core's single-packet answer to the current request.
+ *
+ * @param value - a byte that identifies the answer.
+ */
+static void answer(uint8_t value) {
+    uint8_t flags = (req.data[MCTP_OFF_FLAGS] & MCTP_FLAG_TAG_MASK) | MCTP_FLAG_SOM | MCTP_FLAG_EOM;
+    uint8_t body[] = {1,
+                      req.data[MCTP_OFF_SRC],
+                      OWN_EID,
+                      flags,
+                      req.data[MCTP_OFF_MSG_TYPE],
+                      (uint8_t)(req.data[MCTP_OFF_INSTANCE] & MCTP_INSTANCE_ID_MASK),
+                      req.data[MCTP_OFF_CTRL_CMD],
+                      0,
+                      value};
+    mctp_serial_encode(&resp, body, sizeof body);
+    replay_record(&req, &resp);
+}
+
+/**
+ * @brief Look up the current request and, on a miss, let the core answer it.
+ *
+ * @param value - byte identifying the core's answer.
+ * @return replay_result_t The lookup result.
+ */
+static replay_result_t handle(uint8_t value) {
+    replay_result_t r = replay_lookup(&req, &cached);
+    if (r == REPLAY_MISS) {
+        handler_runs++;
+        answer(value);
+    }
+    return r;
+}
+
+/**
+ * @brief Report whether the cached answer carries a given identifying byte.
+ */
+static int cached_value_is(uint8_t value) {
+    mctp_frame_t f;
+    memcpy(f.raw, cached.raw, cached.frame_len[0]);
+    f.raw_len = cached.frame_len[0];
+    mctp_serial_decode(&f);
+    return cached.frames == 1 && f.status == MCTP_FRAME_OK &&
+           f.data[MCTP_OFF_CTRL_CMD + 2] == value;
+}
+
+/**
+ * @brief A retransmission is replayed; anything differing in the key is not.
+ */
+static void test_key() {
+    replay_init(8, 1000);
+    control(BUS_OWNER, 2, 5, CTRL_GET_EID);
+    CHECK_EQ(handle(0x21), REPLAY_MISS);
+
+    control(BUS_OWNER, 2, 5, CTRL_GET_EID);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_HIT);
+    CHECK(cached_value_is(0x21));
+    CHECK(memcmp(cached.raw, resp.raw, resp.raw_len) == 0);
+
+    control(BUS_OWNER, 2, 6, CTRL_GET_EID);  // instance id
+    CHECK_EQ(handle(0x22), REPLAY_MISS);
+    control(BUS_OWNER, 3, 5, CTRL_GET_EID);  // tag
+    CHECK_EQ(handle(0x23), REPLAY_MISS);
+    control(0x11, 2, 5, CTRL_GET_EID);       // requester
+    CHECK_EQ(handle(0x24), REPLAY_MISS);
+    control(BUS_OWNER, 2, 5, 0x05);          // message bytes
+    CHECK_EQ(handle(0x25), REPLAY_MISS);
+
+    replay_stats_t st;
+    replay_get_stats(&st);
+    CHECK_EQ(st.hits, 1);
+    CHECK_EQ(st.stored, 5);
+}
+
+/**
+ * @brief A copy arriving while the original is being handled is dropped.
+ */
+static void test_in_progress() {
+    replay_init(8, 1000);
+    control(BUS_OWNER, 0, 1, CTRL_GET_EID);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_IN_PROGRESS);
+    answer(0x30);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_HIT);
+
+    // a request the receive stage answered itself is handled afresh next time
+    control(BUS_OWNER, 0, 2, CTRL_GET_EID);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+    replay_cancel(&req);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+}
+
+/**
+ * @brief Entries older than the TTL are not replayed.
+ */
+static void test_ttl() {
+    replay_init(8, 20);
+    control(BUS_OWNER, 0, 1, CTRL_GET_EID);
+    CHECK_EQ(handle(0x40), REPLAY_MISS);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_HIT);
+
+    struct timespec ts = {0, 30 * 1000000L};
+    nanosleep(&ts, NULL);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+
+    replay_stats_t st;
+    replay_get_stats(&st);
+    CHECK_EQ(st.expirations, 1);
+}
+
+/**
+ * @brief A full cache displaces its least recently used entry.
+ */
+static void test_lru() {
+    replay_init(2, 1000);
+    control(BUS_OWNER, 0, 1, CTRL_GET_EID);
+    CHECK_EQ(handle(0x51), REPLAY_MISS);
+    control(BUS_OWNER, 0, 2, CTRL_GET_EID);
+    CHECK_EQ(handle(0x52), REPLAY_MISS);
+
+    control(BUS_OWNER, 0, 1, CTRL_GET_EID);  // touch the first
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_HIT);
+    control(BUS_OWNER, 0, 3, CTRL_GET_EID);  // displaces the second
+    CHECK_EQ(handle(0x53), REPLAY_MISS);
+
+    control(BUS_OWNER, 0, 1, CTRL_GET_EID);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_HIT);
+    CHECK(cached_value_is(0x51));
+    control(BUS_OWNER, 0, 3, CTRL_GET_EID);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_HIT);
+    control(BUS_OWNER, 0, 2, CTRL_GET_EID);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+
+    replay_stats_t st;
+    replay_get_stats(&st);
+    CHECK_EQ(st.evictions, 2);
+}
+
+/**
+ * @brief GET_EID, SET_EID, then a byte-identical GET_EID sees the new EID.
+ */
+static void test_stale_after_set_eid() {
+    replay_init(8, 1000);
+    control(BUS_OWNER, 1, 4, CTRL_GET_EID);
+    CHECK_EQ(handle(OWN_EID), REPLAY_MISS);
+
+    set_eid(5, 0x20);
+    CHECK_EQ(handle(0), REPLAY_MISS);
+
+    control(BUS_OWNER, 1, 4, CTRL_GET_EID);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+}
+
+/**
+ * @brief A command that changes state is answered once and replayed, never run twice.
+ */
+static void test_state_changes() {
+    replay_init(8, 1000);
+    uint8_t get_tid[] = {0x00, PLDM_GET_TID};
+    request(BUS_OWNER, 0, 1, MCTP_MSG_TYPE_PLDM, get_tid, sizeof get_tid);
+    CHECK_EQ(handle(0x60), REPLAY_MISS);
+
+    // the bus owner misses the answer and sends the command again
+    uint8_t set_effecter[] = {0x02, PLDM_SET_NUMERIC_EFFECTER_VALUE, 0x01, 0x00, 0x00, 0x05};
+    request(BUS_OWNER, 0, 2, MCTP_MSG_TYPE_PLDM, set_effecter, sizeof set_effecter);
+    handler_runs = 0;
+    CHECK_EQ(handle(0x61), REPLAY_MISS);
+    CHECK_EQ(handle(0x62), REPLAY_HIT);
+    CHECK_EQ(handle(0x63), REPLAY_HIT);
+    CHECK_EQ(handler_runs, 1);
+    CHECK(cached_value_is(0x61));
+
+    // its completion cleared the query answered before it
+    request(BUS_OWNER, 0, 1, MCTP_MSG_TYPE_PLDM, get_tid, sizeof get_tid);
+    CHECK_EQ(handle(0x64), REPLAY_MISS);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_HIT);
+
+    // state changed outside the cache clears queries only
+    replay_flush();
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+    request(BUS_OWNER, 0, 2, MCTP_MSG_TYPE_PLDM, set_effecter, sizeof set_effecter);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_HIT);
+
+    replay_stats_t st;
+    replay_get_stats(&st);
+    CHECK_EQ(st.stored, 3);
+    CHECK_EQ(st.flushed, 2);
+}
+
+/**
+ * @brief A response a worker sends after its handler returned is kept as well.
+ */
+static void test_deferred() {
+    replay_init(8, 1000);
+    control(BUS_OWNER, 0, 1, CTRL_GET_EID);
+    CHECK_EQ(handle(0x70), REPLAY_MISS);
+
+    uint8_t set_effecter[] = {0x02, PLDM_SET_NUMERIC_EFFECTER_VALUE, 0x02, 0x00, 0x00, 0x07};
+    request(BUS_OWNER, 3, 2, MCTP_MSG_TYPE_PLDM, set_effecter, sizeof set_effecter);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_IN_PROGRESS);
+
+    uint8_t body[] = {1, BUS_OWNER, OWN_EID, MCTP_FLAG_SOM | MCTP_FLAG_EOM | 3, MCTP_MSG_TYPE_PLDM,
+                      2, 0x02, PLDM_SET_NUMERIC_EFFECTER_VALUE, 0x00};
+    mctp_serial_encode(&resp, body, sizeof body);
+    replay_record_answer(req.seq, BUS_OWNER, 3, &resp);
+    replay_complete(req.seq);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_HIT);
+
+    // the worker's answer cleared the query answered before it
+    control(BUS_OWNER, 0, 1, CTRL_GET_EID);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+    answer(0x71);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_HIT);
+
+    // a worker's answer that could not be kept still clears the queries
+    request(BUS_OWNER, 4, 3, MCTP_MSG_TYPE_PLDM, set_effecter, sizeof set_effecter);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+    replay_complete(req.seq);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+    control(BUS_OWNER, 0, 1, CTRL_GET_EID);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+}
+
+/**
+ * @brief Responses larger than an entry are passed over.
+ */
+static void test_uncacheable() {
+    replay_init(8, 1000);
+    control(BUS_OWNER, 0, 1, CTRL_GET_EID);
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+    uint8_t body[] = {1, BUS_OWNER, OWN_EID, 0, MCTP_MSG_TYPE_CONTROL, 1, CTRL_GET_EID, 0};
+    for (int i = 0; i <= REPLAY_MAX_FRAMES; i++) {
+        body[3] = (uint8_t)((i == 0 ? MCTP_FLAG_SOM : 0) |
+                            (i == REPLAY_MAX_FRAMES ? MCTP_FLAG_EOM : 0));
+        mctp_serial_encode(&resp, body, sizeof body);
+        replay_record(&req, &resp);
+    }
+    CHECK_EQ(replay_lookup(&req, &cached), REPLAY_MISS);
+
+    replay_stats_t st;
+    replay_get_stats(&st);
+    CHECK_EQ(st.uncacheable, 1);
+    CHECK_EQ(st.stored, 0);
+}
+
+int main() {
+    test_key();
+    test_in_progress();
+    test_ttl();
+    test_lru();
+    test_stale_after_set_eid();
+    test_state_changes();
+    test_deferred();
+    test_uncacheable();
+    replay_free();
+    return unit_report("test_replay");
+}
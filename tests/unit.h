@@ -0,0 +1,69 @@
+/**
+ * @file unit.h
+ * @brief Minimal check macros shared by the unit tests under tests/.
+ *
+ * A failed check prints its location and the test keeps going; the program
+ * exits non-zero if any check failed.  Each test program links only the
+ * modules it exercises and none of the core.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef UNIT_H
+#define UNIT_H
+
+#include <stdio.h>
+
+static int unit_checks = 0;
+static int unit_failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        unit_checks++;                                                      \
+        if (!(cond)) {                                                      \
+            unit_failures++;                                                \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                      \
+    do {                                                                    \
+        long long a_ = (long long)(a), b_ = (long long)(b);                 \
+        unit_checks++;                                                      \
+        if (a_ != b_) {                                                     \
+            unit_failures++;                                                \
+            fprintf(stderr, "%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, \
+                    __LINE__, #a, #b, a_, b_);                              \
+        }                                                                   \
+    } while (0)
+
+/**
+ * @brief Print the outcome of a test program.
+ *
+ * @param name - the test program's name.
+ * @return int Exit status: 0 if every check passed.
+ */
+static inline int unit_report(const char* name) {
+    printf("%s: %d checks, %d failed\n", name, unit_checks, unit_failures);
+    return unit_failures ? 1 : 0;
+}
+
+#endif /* UNIT_H */
@@ -0,0 +1,508 @@
+/**
+ * @file endpoint-bench.c
+ * @brief Load generator and latency benchmark for the endpoint.
+ *
+ * Sends a weighted mix of MCTP control and PLDM requests with up to eight
+ * requests in flight (one per message tag), either as fast as responses come
+ * back (closed loop) or at a fixed rate (open loop, latency measured from the
+ * scheduled send time so that queueing is not hidden).  Reports requests/s,
+ * latency percentiles per request kind, FCS/framing errors, timeouts and the
+ * CPU time the endpoint process used.
+ *
+ *   endpoint-bench [options] -p /dev/pts/N [-P pid]
+ *   endpoint-bench [options] -- ./endpoint [endpoint options]
+ *
+ * Mix syntax (-m): comma separated items, each optionally followed by
+ * @weight.  Items are eid, uuid, version, types, pldm-tid, pldm-types,
+ * ctrl:<cmd>[/<pad>] and pldm:<type>/<cmd>[/<pad>], where pad appends that
+ * many payload bytes.  Example: -m eid@4,version,pldm:0/2/32@2
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "mctp_serial.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "link.h"
+
+#define MAX_MIX 16
+#define MAX_INFLIGHT (MCTP_FLAG_TAG_MASK + 1)
+#define DEFAULT_MIX "eid@4,version,types,pldm-tid"
+
+typedef struct {
+    char name[32];
+    uint8_t msg_type;
+    uint8_t pldm_type;
+    uint8_t cmd;
+    uint8_t payload[8];        /* command-specific payload */
+    uint8_t payload_len;
+    uint8_t pad;               /* extra payload bytes */
+    unsigned weight;
+
+    uint64_t sent;
+    uint64_t answered;
+    uint64_t failed;           /* non-zero completion code */
+    uint64_t timeouts;
+    uint64_t* lat;             /* latencies of answered requests, ns */
+    size_t lat_cap;
+} mix_t;
+
+typedef struct {
+    int active;
+    mix_t* kind;
+    uint8_t instance;          /* instance byte, echoed by the response */
+    uint64_t t_ns;             /* scheduled (open loop) or actual send time */
+    uint64_t sent_ns;          /* actual send time, for the timeout */
+} inflight_t;
+
+static mix_t mix[MAX_MIX];
+static unsigned nmix = 0;
+static unsigned total_weight = 0;
+static inflight_t inflight[MAX_INFLIGHT];
+static tool_link_t conn = { -1, -1, 0, -1 };
+static uint8_t dest_eid = 0;
+static uint8_t src_eid = 0x10;
+static uint64_t rng = 0x9E3779B97F4A7C15ull;
+static uint64_t fcs_errors = 0, frame_errors = 0, unexpected = 0;
+
+/**
+ * @brief xorshift64* pseudo-random numbers, deterministic for a given seed.
+ *
+ * @return uint64_t Next value.
+ */
+static uint64_t next_random() {
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return rng * 0x2545F4914F6CDD1Dull;
+}
+
+/**
+ * @brief Parse one mix item into an entry.
+ *
+ * @param item - item text, modified.
+ * @param m - entry to fill in.
+ * @return int 0 on success, -1 if the item is not recognized.
+ */
+static int parse_item(char* item, mix_t* m) {
+    memset(m, 0, sizeof *m);
+    m->weight = 1;
+    char* at = strchr(item, '@');
+    if (at) {
+        *at = '\0';
+        m->weight = (unsigned)atoi(at + 1);
+    }
+    snprintf(m->name, sizeof m->name, "%s", item);
+
+    int a = 0, b = 0, c = 0;
+    if (strcmp(item, "eid") == 0) {
+        m->cmd = 0x02;
+    } else if (strcmp(item, "uuid") == 0) {
+        m->cmd = 0x03;
+    } else if (strcmp(item, "version") == 0) {
+        m->cmd = 0x04;
+        m->payload[m->payload_len++] = 0xFF;
+    } else if (strcmp(item, "types") == 0) {
+        m->cmd = 0x05;
+    } else if (strcmp(item, "pldm-tid") == 0) {
+        m->msg_type = MCTP_MSG_TYPE_PLDM;
+        m->cmd = 0x02;
+    } else if (strcmp(item, "pldm-types") == 0) {
+        m->msg_type = MCTP_MSG_TYPE_PLDM;
+        m->cmd = 0x04;
+    } else if (sscanf(item, "ctrl:%i/%i", &a, &b) >= 1) {
+        m->cmd = (uint8_t)a;
+        m->pad = (uint8_t)b;
+    } else if (sscanf(item, "pldm:%i/%i/%i", &a, &b, &c) >= 2) {
+        m->msg_type = MCTP_MSG_TYPE_PLDM;
+        m->pldm_type = (uint8_t)a;
+        m->cmd = (uint8_t)b;
+        m->pad = (uint8_t)c;
+    } else {
+        return -1;
+    }
+    return m->weight ? 0 : -1;
+}
+
+/**
+ * @brief Parse a mix specification.
+ *
+ * @param spec - comma separated items.
+ * @return int 0 on success, -1 on error.
+ */
+static int parse_mix(const char* spec) {
+    char buf[512];
+    snprintf(buf, sizeof buf, "%s", spec);
+    for (char* save = NULL, *item = strtok_r(buf, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        if (nmix >= MAX_MIX || parse_item(item, &mix[nmix]) != 0) {
+            fprintf(stderr, "bad mix item '%s'\n", item);
+            return -1;
+        }
+        total_weight += mix[nmix++].weight;
+    }
+    return nmix ? 0 : -1;
+}
+
+/**
+ * @brief Choose the kind of the next request according to the weights.
+ *
+ * @return mix_t* The entry.
+ */
+static mix_t* pick() {
+    unsigned r = (unsigned)(next_random() % total_weight);
+    for (unsigned i = 0; i < nmix; i++) {
+        if (r < mix[i].weight) return &mix[i];
+        r -= mix[i].weight;
+    }
+    return &mix[nmix - 1];
+}
+
+/**
+ * @brief Encode and send one request on a tag.
+ *
+ * @param tag - message tag, also the in-flight slot.
+ * @param m - kind of request.
+ * @param t_ns - time the latency is measured from.
+ * @return int 0 on success, -1 on a write error.
+ */
+static int send_request(unsigned tag, mix_t* m, uint64_t t_ns) {
+    static uint8_t instance = 0;
+    static mctp_frame_t f;
+    uint8_t body[255];
+    size_t n = 0;
+
+    body[n++] = 0x01;                                   // header version
+    body[n++] = dest_eid;
+    body[n++] = src_eid;
+    body[n++] = MCTP_FLAG_SOM | MCTP_FLAG_EOM | MCTP_FLAG_TO | (uint8_t)tag;
+    body[n++] = m->msg_type;
+    uint8_t inst = instance++ & MCTP_INSTANCE_ID_MASK;
+    body[n++] = MCTP_INSTANCE_RQ | inst;
+    if (m->msg_type == MCTP_MSG_TYPE_PLDM) body[n++] = m->pldm_type & 0x3F;
+    body[n++] = m->cmd;
+    memcpy(&body[n], m->payload, m->payload_len);
+    n += m->payload_len;
+    for (unsigned i = 0; i < m->pad && n < sizeof body; i++) body[n++] = (uint8_t)i;
+
+    mctp_serial_encode(&f, body, (uint8_t)n);
+    if (link_write_all(&conn, f.raw, f.raw_len) != 0) return -1;
+    inflight[tag].active = 1;
+    inflight[tag].kind = m;
+    inflight[tag].instance = inst;
+    inflight[tag].t_ns = t_ns;
+    inflight[tag].sent_ns = clock_now_ns();
+    m->sent++;
+    return 0;
+}
+
+/**
+ * @brief Record a latency sample for a request kind.
+ *
+ * @param m - the kind.
+ * @param ns - latency.
+ */
+static void add_latency(mix_t* m, uint64_t ns) {
+    if (m->answered >= m->lat_cap) {
+        m->lat_cap = m->lat_cap ? m->lat_cap * 2 : 4096;
+        m->lat = realloc(m->lat, m->lat_cap * sizeof *m->lat);
+        if (!m->lat) {
+            perror("realloc");
+            exit(2);
+        }
+    }
+    m->lat[m->answered++] = ns;
+}
+
+/**
+ * @brief Handle one frame received from the endpoint.
+ *
+ * @param f - the frame.
+ * @param now - time it completed.
+ */
+static void receive(const mctp_frame_t* f, uint64_t now) {
+    if (f->status == MCTP_FRAME_FCS_ERROR) {
+        fcs_errors++;
+        return;
+    }
+    if (!mctp_frame_has_header(f)) {
+        frame_errors++;
+        return;
+    }
+    uint8_t flags = f->data[MCTP_OFF_FLAGS];
+    unsigned tag = flags & MCTP_FLAG_TAG_MASK;
+    inflight_t* s = &inflight[tag];
+    if ((flags & MCTP_FLAG_TO) || !s->active || f->data[MCTP_OFF_DEST] != src_eid) {
+        unexpected++;
+        return;
+    }
+
+    mix_t* m = s->kind;
+    unsigned cmd_off = m->msg_type == MCTP_MSG_TYPE_PLDM ? MCTP_OFF_PLDM_CMD : MCTP_OFF_CTRL_CMD;
+    // a late answer to a request that already timed out on this tag carries the old instance id
+    if (mctp_frame_msg_type(f) != m->msg_type || f->len <= cmd_off + 1 || f->data[cmd_off] != m->cmd ||
+        (f->data[MCTP_OFF_INSTANCE] & MCTP_INSTANCE_ID_MASK) != s->instance) {
+        unexpected++;
+        return;
+    }
+    if (!(flags & MCTP_FLAG_EOM)) return;   // latency runs to the last packet
+    if (f->data[cmd_off + 1] != 0) m->failed++;
+    add_latency(m, now - s->t_ns);
+    s->active = 0;
+}
+
+/**
+ * @brief Read and process whatever the endpoint has sent.
+ *
+ * @param d - deframer for the response stream.
+ * @param timeout_ms - how long to wait for data.
+ * @return int 0, or -1 if the link closed.
+ */
+static int pump(mctp_deframer_t* d, int timeout_ms) {
+    struct pollfd pfd = { .fd = conn.fd, .events = POLLIN };
+    if (poll(&pfd, 1, timeout_ms) <= 0) return 0;
+
+    uint8_t buf[4096];
+    ssize_t n = read(conn.fd, buf, sizeof buf);
+    if (n == 0) return -1;
+    if (n < 0) return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    uint64_t now = clock_now_ns();
+    for (ssize_t i = 0; i < n; i++) {
+        if (mctp_deframer_push(d, buf[i], now)) receive(&d->frame, now);
+    }
+    return 0;
+}
+
+/**
+ * @brief Read a process's accumulated user+system CPU time.
+ *
+ * @param pid - process id.
+ * @return double Seconds, or -1 if unavailable.
+ */
+static double cpu_seconds(pid_t pid) {
+    char path[64], buf[1024];
+    snprintf(path, sizeof path, "/proc/%d/stat", (int)pid);
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    size_t n = fread(buf, 1, sizeof buf - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+
+    // fields after the parenthesised command name: state is field 3, utime 14, stime 15
+    char* p = strrchr(buf, ')');
+    unsigned long utime = 0, stime = 0;
+    if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) {
+        return -1;
+    }
+    return (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+}
+
+/**
+ * @brief Compare two latencies for qsort.
+ *
+ * @param a - first value.
+ * @param b - second value.
+ * @return int Ordering.
+ */
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Print one line of latency percentiles.
+ *
+ * @param name - row label.
+ * @param lat - sorted latencies in ns.
+ * @param n - number of samples.
+ * @param sent - requests sent.
+ * @param failed - non-zero completion codes.
+ * @param timeouts - requests never answered.
+ */
+static void print_row(const char* name, const uint64_t* lat, size_t n, uint64_t sent, uint64_t failed,
+                      uint64_t timeouts) {
+#define PCT(p) (n ? lat[(size_t)((double)(n - 1) * (p) / 100.0 + 0.5)] / 1000.0 : 0.0)
+    printf("  %-16s %9llu %9zu %7llu %8llu %9.1f %9.1f %9.1f %9.1f %9.1f\n", name,
+           (unsigned long long)sent, n, (unsigned long long)failed, (unsigned long long)timeouts,
+           PCT(50), PCT(90), PCT(99), PCT(99.9), n ? lat[n - 1] / 1000.0 : 0.0);
+#undef PCT
+}
+
+/**
+ * @brief Print usage.
+ *
+ * @param prog - program name.
+ */
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [options] -p <pty> [-P <endpoint pid>]\n"
+            "       %s [options] -- <endpoint> [endpoint options]\n"
+            "  -m <mix>      request mix (default " DEFAULT_MIX ")\n"
+            "  -c <n>        requests in flight, 1..8 (default 1)\n"
+            "  -r <rate>     requests per second, 0 = as fast as possible (default 0)\n"
+            "  -d <seconds>  run time (default 5)\n"
+            "  -n <count>    stop after this many requests instead\n"
+            "  -t <ms>       response timeout (default 1000)\n"
+            "  -e <eid>      destination EID (default 0)\n"
+            "  -s <seed>     random seed for the mix (default fixed)\n"
+            "  -S <ms>       settle time after starting an endpoint (default 200)\n"
+            "  -v            show endpoint output\n",
+            prog, prog);
+}
+
+int main(int argc, char** argv) {
+    const char* pty = NULL;
+    const char* spec = DEFAULT_MIX;
+    pid_t pid = -1;
+    unsigned concurrency = 1;
+    double rate = 0;
+    double duration = 5;
+    uint64_t count = 0;
+    int timeout_ms = 1000;
+    int settle_ms = 200;
+    int verbose = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "+p:P:m:c:r:d:n:t:e:s:S:vh")) != -1) {
+        switch (opt) {
+        case 'p': pty = optarg; break;
+        case 'P': pid = (pid_t)atoi(optarg); break;
+        case 'm': spec = optarg; break;
+        case 'c': concurrency = (unsigned)atoi(optarg); break;
+        case 'r': rate = atof(optarg); break;
+        case 'd': duration = atof(optarg); break;
+        case 'n': count = strtoull(optarg, NULL, 0); break;
+        case 't': timeout_ms = atoi(optarg); if (timeout_ms < 1) timeout_ms = 1; break;
+        case 'e': dest_eid = (uint8_t)strtoul(optarg, NULL, 0); break;
+        case 's': rng = strtoull(optarg, NULL, 0) | 1; break;
+        case 'S': settle_ms = atoi(optarg); break;
+        case 'v': verbose = 1; break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (concurrency < 1) concurrency = 1;
+    if (concurrency > MAX_INFLIGHT) concurrency = MAX_INFLIGHT;
+    if (optind < argc && strcmp(argv[optind], "--") == 0) optind++;
+    if ((!pty && optind >= argc) || parse_mix(spec) != 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (pty ? link_open_pty(&conn, pty) != 0 : link_spawn(&conn, &argv[optind], argc - optind, verbose ? 0 : LINK_QUIET) != 0) {
+        return 2;
+    }
+    if (conn.pid > 0) pid = conn.pid;
+    link_settle(&conn, settle_ms);
+
+    mctp_deframer_t d;
+    mctp_deframer_init(&d);
+    uint64_t timeout_ns = (uint64_t)timeout_ms * 1000000ull;
+    uint64_t interval_ns = rate > 0 ? (uint64_t)(1e9 / rate) : 0;
+    double cpu0 = pid > 0 ? cpu_seconds(pid) : -1;
+    uint64_t start = clock_now_ns();
+    uint64_t end = start + (uint64_t)(duration * 1e9);
+    uint64_t next_ns = start, sent = 0;
+    int closed = 0;
+
+    for (;;) {
+        uint64_t now = clock_now_ns();
+        int sending = count ? sent < count : now < end;
+        unsigned busy = 0;
+        for (unsigned t = 0; t < MAX_INFLIGHT; t++) busy += (unsigned)inflight[t].active;
+        if (!sending && !busy) break;
+
+        int wait_ms = 10;
+        for (unsigned t = 0; sending && t < concurrency; t++) {
+            if (inflight[t].active) continue;
+            if (interval_ns && now < next_ns) {
+                uint64_t ms = (next_ns - now) / 1000000ull;
+                if ((int)ms < wait_ms) wait_ms = (int)ms;
+                break;
+            }
+            // open loop: measure from the scheduled time, so a slow endpoint cannot hide queueing
+            uint64_t t_ns = interval_ns ? next_ns : now;
+            if (send_request(t, pick(), t_ns) != 0) {
+                closed = 1;
+                break;
+            }
+            sent++;
+            next_ns += interval_ns;
+            if (count && sent >= count) break;
+            wait_ms = 0;
+        }
+        if (closed || pump(&d, wait_ms) != 0) {
+            closed = 1;
+            break;
+        }
+
+        now = clock_now_ns();
+        for (unsigned t = 0; t < MAX_INFLIGHT; t++) {
+            if (inflight[t].active && now - inflight[t].sent_ns > timeout_ns) {
+                inflight[t].kind->timeouts++;
+                inflight[t].active = 0;
+            }
+        }
+    }
+    double secs = (double)(clock_now_ns() - start) / 1e9;
+    double cpu1 = pid > 0 ? cpu_seconds(pid) : -1;
+    link_close(&conn);
+
+    // report
+    uint64_t answered = 0, timeouts = 0, failed = 0;
+    size_t all_n = 0;
+    for (unsigned i = 0; i < nmix; i++) all_n += mix[i].answered;
+    uint64_t* all = calloc(all_n + 1, sizeof *all);
+    all_n = 0;
+    printf("%llu requests in %.2f s, concurrency %u, ", (unsigned long long)sent, secs, concurrency);
+    if (interval_ns) printf("target %.0f req/s\n", rate);
+    else printf("closed loop\n");
+    printf("Latency (us):\n");
+    printf("  %-16s %9s %9s %7s %8s %9s %9s %9s %9s %9s\n", "request", "sent", "answered", "failed",
+           "timeouts", "p50", "p90", "p99", "p99.9", "max");
+    for (unsigned i = 0; i < nmix; i++) {
+        mix_t* m = &mix[i];
+        qsort(m->lat, m->answered, sizeof *m->lat, cmp_u64);
+        print_row(m->name, m->lat, m->answered, m->sent, m->failed, m->timeouts);
+        if (m->answered) memcpy(&all[all_n], m->lat, m->answered * sizeof *all);
+        all_n += m->answered;
+        answered += m->answered;
+        timeouts += m->timeouts;
+        failed += m->failed;
+    }
+    qsort(all, all_n, sizeof *all, cmp_u64);
+    print_row("all", all, all_n, sent, failed, timeouts);
+    free(all);
+
+    printf("Throughput: %.0f responses/s\n", answered / secs);
+    printf("Errors: %llu FCS, %llu framing, %llu unexpected, %llu timeouts%s\n",
+           (unsigned long long)fcs_errors, (unsigned long long)frame_errors,
+           (unsigned long long)unexpected, (unsigned long long)timeouts, closed ? ", link closed" : "");
+    if (cpu0 >= 0 && cpu1 >= 0) {
+        printf("Endpoint CPU: %.3f s (%.1f%% of one core)\n", cpu1 - cpu0, 100.0 * (cpu1 - cpu0) / secs);
+    }
+    return (timeouts || closed) ? 1 : 0;
+}
@@ -0,0 +1,252 @@
+/**
+ * @file endpoint-flight.c
+ * @brief Print the contents of an endpoint's flight recorder file.
+ *
+ * The file stays readable after the endpoint crashed or was killed, since it
+ * is written through a shared mapping.  Records are printed oldest first with
+ * wall-clock times; frames are shown with their MCTP header decoded and their
+ * leading bytes in hex.  Records torn by a crash are skipped.
+ *
+ *   endpoint-flight [-n <last>] <file>
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "flightrec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Read a whole file into memory.
+ *
+ * @param path - file to read.
+ * @param len - receives the length.
+ * @return uint8_t* The contents (caller frees), or NULL on error.
+ */
+static uint8_t* read_file(const char* path, size_t* len) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        perror(path);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long n = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uint8_t* buf = n > 0 ? malloc((size_t)n) : NULL;
+    if (!buf || fread(buf, 1, (size_t)n, fp) != (size_t)n) {
+        fprintf(stderr, "%s: cannot read\n", path);
+        free(buf);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    *len = (size_t)n;
+    return buf;
+}
+
+/**
+ * @brief Format a monotonic timestamp as local wall-clock time.
+ *
+ * @param h - file header, for the clock offset.
+ * @param t_ns - CLOCK_MONOTONIC time from a record.
+ * @param out - destination buffer.
+ * @param len - size of out.
+ */
+static void format_time(const flight_header_t* h, uint64_t t_ns, char* out, size_t len) {
+    uint64_t real = h->start_realtime_ns + (t_ns - h->start_monotonic_ns);
+    time_t secs = (time_t)(real / 1000000000ull);
+    struct tm tm;
+    localtime_r(&secs, &tm);
+    size_t n = strftime(out, len, "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(out + n, len - n, ".%06llu", (unsigned long long)(real % 1000000000ull / 1000));
+}
+
+/**
+ * @brief Print the decoded MCTP header of the frame data kept in a record.
+ *
+ * @param r - a frame or slow-handler record.
+ */
+static void print_header(const flight_record_t* r) {
+    unsigned n = r->len < FLIGHT_DATA_MAX ? r->len : FLIGHT_DATA_MAX;
+    if (n <= MCTP_OFF_INSTANCE) return;
+
+    const uint8_t* d = r->data;
+    uint8_t flags = d[MCTP_OFF_FLAGS];
+    printf("  %u->%u tag %u%s%s%s type 0x%02x", d[MCTP_OFF_SRC], d[MCTP_OFF_DEST], flags & MCTP_FLAG_TAG_MASK,
+           flags & MCTP_FLAG_TO ? " TO" : "", flags & MCTP_FLAG_SOM ? " SOM" : "",
+           flags & MCTP_FLAG_EOM ? " EOM" : "", d[MCTP_OFF_MSG_TYPE]);
+    if (n > MCTP_OFF_PLDM_CMD && (d[MCTP_OFF_MSG_TYPE] & MCTP_MSG_TYPE_MASK) == MCTP_MSG_TYPE_PLDM) {
+        printf(" pldm %u/0x%02x", d[MCTP_OFF_PLDM_TYPE] & 0x3F, d[MCTP_OFF_PLDM_CMD]);
+    } else if (n > MCTP_OFF_CTRL_CMD && (d[MCTP_OFF_MSG_TYPE] & MCTP_MSG_TYPE_MASK) == MCTP_MSG_TYPE_CONTROL) {
+        printf(" cmd 0x%02x", d[MCTP_OFF_CTRL_CMD]);
+    }
+}
+
+/**
+ * @brief Print the leading bytes kept in a record.
+ *
+ * @param r - a frame or slow-handler record.
+ */
+static void print_bytes(const flight_record_t* r) {
+    unsigned n = r->len < FLIGHT_DATA_MAX ? r->len : FLIGHT_DATA_MAX;
+    printf("\n   ");
+    for (unsigned i = 0; i < n; i++) printf(" %02x", r->data[i]);
+    if (r->len > n) printf(" ...");
+    printf("\n");
+}
+
+/**
+ * @brief Print the decoded header and leading bytes of a frame record.
+ *
+ * @param r - a frame record.
+ */
+static void print_frame(const flight_record_t* r) {
+    static const char* status[] = { "ok", "fcs-error", "escape-error", "length-error", "oversize" };
+
+    printf("%s len %u %s", r->type == FLIGHT_RX_FRAME ? "RX" : "TX", r->len,
+           r->arg < sizeof status / sizeof status[0] ? status[r->arg] : "bad");
+    print_header(r);
+    print_bytes(r);
+}
+
+/**
+ * @brief Print the return addresses captured from an overrunning handler.
+ *
+ * Addresses inside the endpoint binary are stored relative to its load
+ * address; resolve them with addr2line -e against the same binary.
+ *
+ * @param r - a handler stack record.
+ */
+static void print_stack(const flight_record_t* r) {
+    unsigned n = (r->len < FLIGHT_DATA_MAX ? r->len : FLIGHT_DATA_MAX) / sizeof(uint64_t);
+    printf("HANDLER OVER BUDGET (%u ms), stack:", r->arg);
+    for (unsigned i = 0; i < n; i++) {
+        uint64_t pc;
+        memcpy(&pc, r->data + i * sizeof pc, sizeof pc);
+        printf(pc < (1ull << 32) ? " endpoint+0x%llx" : " 0x%llx", (unsigned long long)pc);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Print one record.
+ *
+ * @param h - file header.
+ * @param r - the record.
+ */
+static void print_record(const flight_header_t* h, const flight_record_t* r) {
+    char when[48];
+    format_time(h, r->t_ns, when, sizeof when);
+    printf("%8llu %s  ", (unsigned long long)r->seq, when);
+    switch (r->type) {
+    case FLIGHT_RX_FRAME:
+    case FLIGHT_TX_FRAME: print_frame(r); return;
+    case FLIGHT_START: printf("START pid %u\n", r->arg); return;
+    case FLIGHT_STOP: printf("STOP\n"); return;
+    case FLIGHT_EID_SET: printf("EID set to %u\n", r->arg); return;
+    case FLIGHT_NOISE: printf("NOISE %u bytes outside frames\n", r->arg); return;
+    case FLIGHT_TX_STALL: printf("TX STALL %u ms, frame dropped\n", r->arg); return;
+    case FLIGHT_TX_ERROR: printf("TX ERROR %s\n", strerror((int)r->arg)); return;
+    case FLIGHT_SLOW_HANDLER:
+        printf("SLOW HANDLER %.1f ms", r->arg / 1000.0);
+        print_header(r);
+        print_bytes(r);
+        return;
+    case FLIGHT_HANDLER_STACK: print_stack(r); return;
+    case FLIGHT_OVERLOAD:
+        if (r->arg) printf("OVERLOAD about %u ms queued, shedding low-priority requests\n", r->arg);
+        else printf("OVERLOAD cleared\n");
+        return;
+    case FLIGHT_TTY_OVERRUN: printf("TTY OVERRUN %u reported by the serial driver\n", r->arg); return;
+    default: printf("type %u arg %u\n", r->type, r->arg); return;
+    }
+}
+
+/**
+ * @brief Print usage.
+ *
+ * @param prog - program name.
+ */
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [-n <last>] <file>\n"
+            "  -n <last>     print only the most recent records\n",
+            prog);
+}
+
+int main(int argc, char** argv) {
+    uint64_t last = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+        case 'n': last = strtoull(optarg, NULL, 0); break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    size_t len = 0;
+    uint8_t* buf = read_file(argv[optind], &len);
+    if (!buf) return 1;
+    const flight_header_t* h = (const flight_header_t*)buf;
+    if (len < sizeof *h || h->magic != FLIGHT_MAGIC || h->version != FLIGHT_VERSION ||
+        h->record_size != sizeof(flight_record_t) ||
+        len < h->header_size + (size_t)h->records * h->record_size) {
+        fprintf(stderr, "%s: not a flight recorder file (or an incompatible version)\n", argv[optind]);
+        free(buf);
+        return 1;
+    }
+    const flight_record_t* ring = (const flight_record_t*)(buf + h->header_size);
+
+    char when[48];
+    format_time(h, h->start_monotonic_ns, when, sizeof when);
+    printf("Port %s, pid %u, started %s, %s\n", h->port, h->pid, when,
+           h->clean_exit ? "exited cleanly" : "did not exit cleanly");
+
+    // the newest records are those with the highest sequence numbers
+    uint64_t end = h->next;
+    uint64_t begin = end > h->records ? end - h->records : 0;
+    if (last && end - begin > last) begin = end - last;
+    printf("Records %llu..%llu of %llu written\n", (unsigned long long)begin + 1, (unsigned long long)end,
+           (unsigned long long)end);
+
+    uint64_t torn = 0;
+    for (uint64_t seq = begin + 1; seq <= end; seq++) {
+        const flight_record_t* r = &ring[(seq - 1) % h->records];
+        if (r->seq != seq) {
+            torn++;
+            continue;
+        }
+        print_record(h, r);
+    }
+    if (torn) printf("%llu records incomplete (being written when the file was last updated)\n",
+                     (unsigned long long)torn);
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,423 @@
+/**
+ * @file endpoint-link.c
+ * @brief Serial line emulator that moves bytes at a real baud rate.
+ *
+ * A pty or socketpair moves bytes at memory speed, so latency and throughput
+ * measured through one say little about a real UART.  This tool sits between
+ * a host-side pty and the endpoint and forwards bytes in both directions at
+ * the configured line rate: each character occupies bits/baud seconds on the
+ * wire (10 bits for 8N1), and characters queue behind each other exactly as
+ * they would in a UART transmitter.  Optionally the receiver side has a
+ * limited buffer (-f): bytes arriving while it is full are lost as overruns,
+ * or, with CTS-style flow control (-F), the line stops until the receiver
+ * drains it.
+ *
+ *   endpoint-link [options] -e /dev/pts/N             (endpoint already running)
+ *   endpoint-link [options] -- ./endpoint [options]   (endpoint started on --fd 3)
+ *
+ * The host-side pty path is printed on standard output (and linked from -L
+ * when given); point endpoint-bench or endpoint-replay at it with -p.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "link.h"
+
+#define DEFAULT_BAUD 115200
+#define DEFAULT_BITS 10          /* start + 8 data + stop */
+#define DEFAULT_BUFFER 4096      /* transmitter queue, like a kernel tty write buffer */
+#define DEFAULT_PEER_SNDBUF 4096
+
+/* one direction of the line */
+typedef struct {
+    const char* name;
+    int in_fd;                 /* sender's bytes are read here */
+    int out_fd;                /* and delivered here */
+    int level_fd;              /* receiver's own descriptor, FIONREAD gives what it has not read; -1 if unknown */
+    uint8_t* data;             /* transmitter queue */
+    uint64_t* arrival_ns;      /* when each queued byte was read from the sender */
+    size_t cap, head, count;
+    uint64_t line_free_ns;     /* end of the character currently on the wire */
+    int held;                  /* flow control is holding the line */
+    uint64_t held_since_ns;
+
+    uint64_t bytes;
+    uint64_t overruns;         /* bytes lost to a full receiver */
+    uint64_t held_ns;          /* total time the line was held */
+    uint64_t queue_max;        /* transmitter queue high-water mark */
+    int level_max;             /* receiver buffer high-water mark */
+} path_t;
+
+static volatile sig_atomic_t stopping = 0;
+static volatile sig_atomic_t child_exited = 0;
+static uint64_t char_ns;
+static int fifo_depth = 0;
+static int flow_control = 0;
+
+/**
+ * @brief Termination signal handler.
+ *
+ * @param sig - signal number (unused).
+ */
+static void stop_handler(int sig) {
+    (void)sig;
+    stopping = 1;
+}
+
+/**
+ * @brief SIGCHLD handler; the started endpoint has exited.
+ *
+ * @param sig - signal number (unused).
+ */
+static void child_handler(int sig) {
+    (void)sig;
+    child_exited = 1;
+}
+
+/**
+ * @brief Set up one direction of the line.
+ *
+ * @param p - direction to initialize.
+ * @param name - label for the report.
+ * @param in_fd - descriptor the sender writes into.
+ * @param out_fd - descriptor the receiver reads from.
+ * @param level_fd - receiver's descriptor for the fill level, -1 if unknown.
+ * @param cap - transmitter queue size in bytes.
+ * @return int 0 on success, -1 if out of memory.
+ */
+static int path_init(path_t* p, const char* name, int in_fd, int out_fd, int level_fd, size_t cap) {
+    memset(p, 0, sizeof *p);
+    p->name = name;
+    p->in_fd = in_fd;
+    p->out_fd = out_fd;
+    p->level_fd = level_fd;
+    p->cap = cap;
+    p->data = malloc(cap);
+    p->arrival_ns = malloc(cap * sizeof *p->arrival_ns);
+    return (p->data && p->arrival_ns) ? 0 : -1;
+}
+
+/**
+ * @brief Return the number of bytes waiting to be read by the receiver.
+ *
+ * @param p - the direction.
+ * @return int Bytes buffered at the receiver, or -1 if it cannot be measured.
+ */
+static int receiver_level(const path_t* p) {
+    int n = 0;
+    if (p->level_fd == -1 || ioctl(p->level_fd, FIONREAD, &n) != 0) return -1;
+    return n;
+}
+
+/**
+ * @brief Return when the character at the head of the queue finishes on the wire.
+ *
+ * @param p - a direction with queued bytes.
+ * @return uint64_t Monotonic time in nanoseconds.
+ */
+static uint64_t head_due(const path_t* p) {
+    uint64_t start = p->arrival_ns[p->head];
+    if (p->line_free_ns > start) start = p->line_free_ns;
+    return start + char_ns;
+}
+
+/**
+ * @brief Read whatever the sender has written into free queue space.
+ *
+ * @param p - the direction.
+ * @param now - current time.
+ * @return int 0 on success, -1 if the sender has gone away.
+ */
+static int path_fill(path_t* p, uint64_t now) {
+    while (p->count < p->cap) {
+        size_t tail = (p->head + p->count) % p->cap;
+        size_t room = p->cap - p->count;
+        if (room > p->cap - tail) room = p->cap - tail;
+        ssize_t n = read(p->in_fd, &p->data[tail], room);
+        if (n > 0) {
+            for (ssize_t i = 0; i < n; i++) p->arrival_ns[tail + (size_t)i] = now;
+            p->count += (size_t)n;
+            if (p->count > p->queue_max) p->queue_max = p->count;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        // a pty master reports EIO while no one has the slave open; treat it as idle
+        if (n < 0 && (errno == EAGAIN || errno == EIO)) return 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Deliver every character whose transmission time has elapsed.
+ *
+ * @param p - the direction.
+ * @param now - current time.
+ * @return int 0 on success, -1 if the receiver has gone away.
+ */
+static int path_drain(path_t* p, uint64_t now) {
+    uint8_t out[512];
+    while (p->count && head_due(p) <= now) {
+        size_t n = 0;
+        int room = -1;
+        if (fifo_depth > 0) {
+            int level = receiver_level(p);
+            if (level >= 0) {
+                if (level > p->level_max) p->level_max = level;
+                room = fifo_depth > level ? fifo_depth - level : 0;
+            }
+        }
+        if (room == 0 && flow_control) {
+            // CTS deasserted: the transmitter stops until the receiver drains
+            if (!p->held) {
+                p->held = 1;
+                p->held_since_ns = now;
+            }
+            return 0;
+        }
+        if (p->held) {
+            p->held = 0;
+            p->held_ns += now - p->held_since_ns;
+            if (p->line_free_ns < now) p->line_free_ns = now;
+            continue;
+        }
+        // take the characters that have fully arrived, up to what the receiver can hold
+        while (p->count && n < sizeof out && head_due(p) <= now) {
+            if (room == 0 && flow_control) break;
+            p->line_free_ns = head_due(p);
+            uint8_t b = p->data[p->head];
+            p->head = (p->head + 1) % p->cap;
+            p->count--;
+            if (room == 0) {
+                p->overruns++;
+                continue;
+            }
+            out[n++] = b;
+            if (room > 0) room--;
+        }
+        size_t off = 0;
+        while (off < n) {
+            ssize_t w = write(p->out_fd, out + off, n - off);
+            if (w > 0) {
+                off += (size_t)w;
+                p->bytes += (uint64_t)w;
+                continue;
+            }
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0 && (errno == EAGAIN || errno == EIO)) {
+                // the receiver's buffer is full (or nobody is listening): like a UART overrun
+                p->overruns += n - off;
+                break;
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Compute how long the event loop may sleep before the next delivery.
+ *
+ * @param p - the direction.
+ * @param now - current time.
+ * @param wait_ns - current sleep bound, lowered if this direction needs service sooner.
+ */
+static void path_deadline(const path_t* p, uint64_t now, uint64_t* wait_ns) {
+    if (!p->count) return;
+    // a held line is polled once per character time for the receiver to drain
+    uint64_t due = p->held ? now + char_ns : head_due(p);
+    uint64_t w = due > now ? due - now : 0;
+    if (w < *wait_ns) *wait_ns = w;
+}
+
+/**
+ * @brief Print one direction's counters.
+ *
+ * @param p - the direction.
+ */
+static void path_report(const path_t* p) {
+    printf("%-16s %12llu bytes %10llu overruns %10.1f ms held  queue max %zu  receiver max %d\n",
+           p->name, (unsigned long long)p->bytes, (unsigned long long)p->overruns, p->held_ns / 1e6,
+           (size_t)p->queue_max, p->level_max);
+}
+
+/**
+ * @brief Print usage.
+ *
+ * @param prog - program name.
+ */
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [options] -e <endpoint pty>\n"
+            "       %s [options] -- <endpoint> [endpoint options]\n"
+            "  -b <baud>     line rate in bits per second (default %d)\n"
+            "  -B <bits>     bits per character, 10 = 8N1, 11 = 8E1 or 8N2 (default %d)\n"
+            "  -f <bytes>    receiver buffer depth, 0 = unlimited (default 0)\n"
+            "  -F            CTS-style flow control: hold the line instead of overrunning\n"
+            "  -q <bytes>    transmitter queue per direction (default %d)\n"
+            "  -k <bytes>    socket send buffer of a started endpoint (default %d)\n"
+            "  -L <path>     create a symlink to the host-side pty\n"
+            "  -v            show endpoint output\n",
+            prog, prog, DEFAULT_BAUD, DEFAULT_BITS, DEFAULT_BUFFER, DEFAULT_PEER_SNDBUF);
+}
+
+int main(int argc, char** argv) {
+    const char* endpoint_pty = NULL;
+    const char* symlink_path = NULL;
+    long baud = DEFAULT_BAUD;
+    int bits = DEFAULT_BITS;
+    size_t queue = DEFAULT_BUFFER;
+    int peer_sndbuf = DEFAULT_PEER_SNDBUF;
+    int verbose = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "+e:b:B:f:Fq:k:L:vh")) != -1) {
+        switch (opt) {
+        case 'e': endpoint_pty = optarg; break;
+        case 'b': baud = atol(optarg); break;
+        case 'B': bits = atoi(optarg); break;
+        case 'f': fifo_depth = atoi(optarg); break;
+        case 'F': flow_control = 1; break;
+        case 'q': queue = (size_t)atol(optarg); break;
+        case 'k': peer_sndbuf = atoi(optarg); break;
+        case 'L': symlink_path = optarg; break;
+        case 'v': verbose = 1; break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind < argc && strcmp(argv[optind], "--") == 0) optind++;
+    if ((!endpoint_pty && optind >= argc) || baud <= 0 || bits <= 0 || queue == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    char_ns = (uint64_t)bits * 1000000000ull / (uint64_t)baud;
+
+    // host side: a fresh pty; keeping the slave open lets host tools come and go
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (master == -1 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return 2;
+    }
+    const char* host_pty = ptsname(master);
+    int slave = open(host_pty, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (slave == -1) {
+        perror(host_pty);
+        return 2;
+    }
+    struct termios tio;
+    if (tcgetattr(slave, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+    }
+
+    // endpoint side
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = child_handler;
+    sigaction(SIGCHLD, &sa, NULL);
+    tool_link_t conn = { -1, -1, peer_sndbuf, -1 };
+    if (endpoint_pty ? link_open_pty(&conn, endpoint_pty) != 0
+                     : link_spawn(&conn, &argv[optind], argc - optind, LINK_KEEP_PEER | (verbose ? 0 : LINK_QUIET)) != 0) {
+        return 2;
+    }
+    // the endpoint's end of the socketpair is kept so its unread bytes can be counted
+    if (conn.pid <= 0 && fifo_depth > 0) {
+        fprintf(stderr, "note: the receive level of an endpoint pty cannot be measured; "
+                        "-f applies to the host direction only\n");
+    }
+
+    path_t to_endpoint, to_host;
+    if (path_init(&to_endpoint, "host->endpoint", master, conn.fd, conn.peer_fd, queue) != 0 ||
+        path_init(&to_host, "endpoint->host", conn.fd, master, slave, queue) != 0) {
+        fprintf(stderr, "out of memory\n");
+        link_close(&conn);
+        return 2;
+    }
+
+    if (symlink_path) {
+        unlink(symlink_path);
+        if (symlink(host_pty, symlink_path) != 0) {
+            perror(symlink_path);
+            symlink_path = NULL;
+        }
+    }
+    sa.sa_handler = stop_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("Host pty: %s\n", host_pty);
+    if (conn.pid > 0) printf("Endpoint pid: %d\n", (int)conn.pid);
+    printf("Line: %ld baud, %d bits/char (%.1f us/char), receiver buffer %s%s\n", baud, bits, char_ns / 1e3,
+           fifo_depth > 0 ? "limited" : "unlimited", flow_control ? ", CTS flow control" : "");
+    fflush(stdout);
+
+    int closed = 0;
+    while (!stopping && !closed && !child_exited) {
+        uint64_t now = clock_now_ns();
+        uint64_t wait_ns = 100000000ull;
+        path_deadline(&to_endpoint, now, &wait_ns);
+        path_deadline(&to_host, now, &wait_ns);
+
+        // reading stops while a transmitter queue is full, so the sender feels backpressure
+        struct pollfd pfd[2] = {
+            { .fd = master, .events = to_endpoint.count < to_endpoint.cap ? POLLIN : 0 },
+            { .fd = conn.fd, .events = to_host.count < to_host.cap ? POLLIN : 0 },
+        };
+        struct timespec ts = { (time_t)(wait_ns / 1000000000ull), (long)(wait_ns % 1000000000ull) };
+        if (ppoll(pfd, 2, &ts, NULL) < 0 && errno != EINTR) break;
+
+        now = clock_now_ns();
+        if (pfd[0].revents & POLLIN) path_fill(&to_endpoint, now);
+        if (pfd[1].revents & (POLLIN | POLLHUP)) {
+            if (path_fill(&to_host, now) != 0) closed = 1;
+        }
+        if ((pfd[1].revents & (POLLHUP | POLLERR)) && !(pfd[1].revents & POLLIN)) closed = 1;
+        if (path_drain(&to_endpoint, now) != 0) closed = 1;
+        path_drain(&to_host, now);
+    }
+
+    if (symlink_path) unlink(symlink_path);
+    link_close(&conn);
+    path_report(&to_endpoint);
+    path_report(&to_host);
+    close(slave);
+    close(master);
+    free(to_endpoint.data);
+    free(to_endpoint.arrival_ns);
+    free(to_host.data);
+    free(to_host.arrival_ns);
+    return (closed || child_exited) ? 1 : 0;
+}
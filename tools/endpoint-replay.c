@@ -0,0 +1,611 @@
+/**
+ * @file endpoint-replay.c
+ * @brief Replay captured MCTP traffic into an endpoint and compare the answers.
+ *
+ * Requests are taken from a pcap (LINKTYPE_MCTP, as written by --capture) or
+ * from a raw trace of serial bytes, sent to an endpoint, and the responses
+ * are compared with the ones recorded in the trace.  Two pacing modes:
+ *
+ *   fast    requests are sent as soon as the window (-w) allows; measures the
+ *           throughput ceiling
+ *   timed   requests are sent at their recorded offsets (scaled by -s), so
+ *           bursts and idle gaps are reproduced
+ *
+ * Transports:
+ *
+ *   endpoint-replay [options] -p /dev/pts/N trace.pcap
+ *           talk to a running endpoint through its pty
+ *   endpoint-replay [options] trace.pcap -- ./endpoint [endpoint options]
+ *           start the endpoint on one end of a socketpair (--fd 3)
+ *
+ * The report gives frames/s, exchanges/s and latency percentiles (last
+ * request byte written to last response byte read).  The exit status is
+ * non-zero when a response differs from the recording or never arrives, so
+ * the tool can gate regressions in CI.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "mctp_serial.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "link.h"
+
+#define LINKTYPE_MCTP 291
+#define MAX_REQ_PACKETS 16
+#define MCTP_TRANSPORT_HDR 4
+
+typedef struct {
+    uint64_t t_ns;                 /* trace timestamp, 0 for raw traces */
+    uint8_t len;                   /* bytes in body */
+    uint8_t body[255];             /* transport header onward */
+} packet_t;
+
+typedef struct {
+    size_t pkt[MAX_REQ_PACKETS];   /* request packets, in order */
+    unsigned npkt;
+    uint8_t tag;
+    uint8_t src;                   /* requester EID; responses are addressed to it */
+    uint64_t t_ns;                 /* trace time of the first request packet */
+    uint8_t* expected;             /* recorded response message bytes (headers stripped) */
+    size_t expected_len;
+    int recorded;                  /* a complete response was found in the trace */
+} exchange_t;
+
+typedef enum { RUN_IDLE = 0, RUN_SENT, RUN_DONE, RUN_TIMEOUT } run_state_t;
+
+typedef struct {
+    size_t ex;                     /* exchange being replayed */
+    uint64_t sent_ns;
+    uint64_t done_ns;
+    size_t got_len;
+    uint8_t state;
+    uint8_t mismatch;
+} run_t;
+
+static packet_t* packets;
+static size_t npackets, cap_packets;
+static exchange_t* exchanges;
+static size_t nexchanges, cap_exchanges;
+static run_t* runs;
+static size_t nruns;
+
+static tool_link_t conn = { -1, -1, 0, -1 };
+static int verbose = 0;
+static uint64_t frames_tx = 0, frames_rx = 0;
+
+/**
+ * @brief Grow an array when full, exiting on allocation failure.
+ *
+ * @param p - array pointer.
+ * @param cap - current capacity, updated.
+ * @param n - elements in use.
+ * @param size - element size.
+ */
+static void grow(void** p, size_t* cap, size_t n, size_t size) {
+    if (n < *cap) return;
+    *cap = *cap ? *cap * 2 : 256;
+    *p = realloc(*p, *cap * size);
+    if (!*p) {
+        perror("realloc");
+        exit(2);
+    }
+}
+
+/**
+ * @brief Append an MCTP packet (transport header onward) to the trace.
+ *
+ * @param body - packet bytes.
+ * @param len - packet length.
+ * @param t_ns - timestamp.
+ */
+static void add_packet(const uint8_t* body, size_t len, uint64_t t_ns) {
+    if (len < MCTP_TRANSPORT_HDR + 1 || len > 255) return;
+    grow((void**)&packets, &cap_packets, npackets, sizeof *packets);
+    packet_t* p = &packets[npackets++];
+    p->t_ns = t_ns;
+    p->len = (uint8_t)len;
+    memcpy(p->body, body, len);
+}
+
+/**
+ * @brief Read a 32-bit pcap field in the file's byte order.
+ *
+ * @param p - field bytes.
+ * @param swap - non-zero if the file is in the other byte order.
+ * @return uint32_t The value.
+ */
+static uint32_t get32(const uint8_t* p, int swap) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+/**
+ * @brief Load a trace: pcap with LINKTYPE_MCTP, or raw serial bytes.
+ *
+ * @param path - trace file.
+ * @return int 0 on success, -1 on error.
+ */
+static int load_trace(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t* buf = malloc(size > 0 ? (size_t)size : 1);
+    size_t len = (buf && size > 0) ? fread(buf, 1, (size_t)size, f) : 0;
+    fclose(f);
+
+    uint32_t magic = len >= 24 ? get32(buf, 0) : 0;
+    int swap = magic == 0xd4c3b2a1u || magic == 0x4d3cb2a1u;
+    if (swap) magic = __builtin_bswap32(magic);
+
+    if (magic == 0xa1b2c3d4u || magic == 0xa1b23c4du) {
+        int nsec = magic == 0xa1b23c4du;
+        if (get32(buf + 20, swap) != LINKTYPE_MCTP) {
+            fprintf(stderr, "%s: link type %u is not LINKTYPE_MCTP\n", path, get32(buf + 20, swap));
+            free(buf);
+            return -1;
+        }
+        size_t off = 24;
+        while (off + 16 <= len) {
+            uint32_t sub = get32(buf + off + 4, swap);
+            uint64_t t = (uint64_t)get32(buf + off, swap) * 1000000000ull + (nsec ? sub : sub * 1000ull);
+            uint32_t incl = get32(buf + off + 8, swap);
+            if (off + 16 + incl > len) break;
+            add_packet(buf + off + 16, incl, t);
+            off += 16 + incl;
+        }
+    } else {
+        // raw serial bytes: requests only, no timing
+        mctp_deframer_t d;
+        mctp_deframer_init(&d);
+        for (size_t i = 0; i < len; i++) {
+            if (mctp_deframer_push(&d, buf[i], 0) && d.frame.status == MCTP_FRAME_OK) {
+                add_packet(&d.frame.data[MCTP_OFF_HDR_VERSION], d.frame.data[MCTP_OFF_BYTE_COUNT], 0);
+            }
+        }
+    }
+    free(buf);
+    return 0;
+}
+
+/**
+ * @brief Find the oldest exchange with the given tag and requester still expecting data.
+ *
+ * @param tag - message tag.
+ * @param dest - destination of the response, i.e. the requester.
+ * @param open - per-exchange flags marking those still collecting.
+ * @return exchange_t* The exchange, or NULL.
+ */
+static exchange_t* oldest_open(uint8_t tag, uint8_t dest, const uint8_t* open) {
+    for (size_t i = 0; i < nexchanges; i++) {
+        if (open[i] && exchanges[i].tag == tag && exchanges[i].src == dest) return &exchanges[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Pair the requests in the trace with their recorded responses.
+ *
+ * Every packet with the tag owner bit set is treated as a request to the
+ * endpoint; responses are matched by tag and requester EID in order.
+ */
+static void build_exchanges() {
+    long assembling[MCTP_FLAG_TAG_MASK + 1];
+    uint8_t* open = NULL;
+    size_t open_cap = 0;
+    for (unsigned t = 0; t <= MCTP_FLAG_TAG_MASK; t++) assembling[t] = -1;
+
+    for (size_t i = 0; i < npackets; i++) {
+        const packet_t* p = &packets[i];
+        uint8_t flags = p->body[MCTP_OFF_FLAGS - MCTP_OFF_HDR_VERSION];
+        uint8_t tag = flags & MCTP_FLAG_TAG_MASK;
+
+        if (flags & MCTP_FLAG_TO) {
+            if (flags & MCTP_FLAG_SOM) {
+                grow((void**)&exchanges, &cap_exchanges, nexchanges, sizeof *exchanges);
+                exchange_t* e = &exchanges[nexchanges];
+                memset(e, 0, sizeof *e);
+                e->tag = tag;
+                e->src = p->body[MCTP_OFF_SRC - MCTP_OFF_HDR_VERSION];
+                e->t_ns = p->t_ns;
+                assembling[tag] = (long)nexchanges++;
+                if (open_cap < cap_exchanges) {
+                    open = realloc(open, cap_exchanges);
+                    memset(open + open_cap, 0, cap_exchanges - open_cap);
+                    open_cap = cap_exchanges;
+                }
+            }
+            if (assembling[tag] < 0) continue;
+            exchange_t* e = &exchanges[assembling[tag]];
+            if (e->npkt >= MAX_REQ_PACKETS) continue;
+            e->pkt[e->npkt++] = i;
+            if (flags & MCTP_FLAG_EOM) {
+                open[assembling[tag]] = 1;
+                assembling[tag] = -1;
+            }
+        } else {
+            if (!open) continue;
+            exchange_t* e = oldest_open(tag, p->body[MCTP_OFF_DEST - MCTP_OFF_HDR_VERSION], open);
+            if (!e) continue;
+            size_t n = p->len - MCTP_TRANSPORT_HDR;
+            e->expected = realloc(e->expected, e->expected_len + n);
+            memcpy(e->expected + e->expected_len, p->body + MCTP_TRANSPORT_HDR, n);
+            e->expected_len += n;
+            if (flags & MCTP_FLAG_EOM) {
+                e->recorded = 1;
+                open[e - exchanges] = 0;
+            }
+        }
+    }
+    free(open);
+}
+
+/**
+ * @brief Locate the instance byte of a control or PLDM message.
+ *
+ * Each pass of the trace gets its own instance ids; otherwise a request
+ * repeated in a later pass looks like a retransmission to the endpoint and is
+ * answered from its replay cache.
+ *
+ * @param msg - message bytes (message type first).
+ * @param n - number of bytes.
+ * @return int Offset of the instance byte, or -1 if the message has none.
+ */
+static int instance_offset(const uint8_t* msg, size_t n) {
+    uint8_t type = msg[0] & MCTP_MSG_TYPE_MASK;
+    if (n < 2 || (type != MCTP_MSG_TYPE_CONTROL && type != MCTP_MSG_TYPE_PLDM)) return -1;
+    return 1;
+}
+
+/**
+ * @brief Return an instance byte with its id advanced by the pass number.
+ *
+ * @param b - instance byte.
+ * @param pass - pass number.
+ * @return uint8_t The adjusted byte.
+ */
+static uint8_t shift_instance(uint8_t b, size_t pass) {
+    return (uint8_t)((b & ~MCTP_INSTANCE_ID_MASK) | ((b + pass) & MCTP_INSTANCE_ID_MASK));
+}
+
+/**
+ * @brief Send every packet of a run's request.
+ *
+ * @param r - the run.
+ * @return int 0 on success, -1 on error.
+ */
+static int send_run(run_t* r) {
+    static mctp_frame_t f;
+    const exchange_t* e = &exchanges[r->ex];
+    size_t pass = (size_t)(r - runs) / nexchanges;
+    for (unsigned i = 0; i < e->npkt; i++) {
+        const packet_t* p = &packets[e->pkt[i]];
+        uint8_t body[255];
+        memcpy(body, p->body, p->len);
+        int off = instance_offset(body + MCTP_TRANSPORT_HDR, p->len - MCTP_TRANSPORT_HDR);
+        if (i == 0 && pass && off >= 0) {
+            body[MCTP_TRANSPORT_HDR + off] = shift_instance(body[MCTP_TRANSPORT_HDR + off], pass);
+        }
+        mctp_serial_encode(&f, body, p->len);
+        if (link_write_all(&conn, f.raw, f.raw_len) != 0) return -1;
+        frames_tx++;
+    }
+    r->sent_ns = clock_now_ns();
+    r->state = RUN_SENT;
+    return 0;
+}
+
+/**
+ * @brief Print bytes in hex on one line.
+ *
+ * @param label - prefix.
+ * @param p - bytes.
+ * @param n - number of bytes.
+ */
+static void print_hex(const char* label, const uint8_t* p, size_t n) {
+    fprintf(stderr, "  %s", label);
+    for (size_t i = 0; i < n; i++) fprintf(stderr, " %02x", p[i]);
+    fprintf(stderr, "\n");
+}
+
+/**
+ * @brief Attribute a received response packet to the oldest matching run.
+ *
+ * @param f - received frame.
+ * @param first_run - index of the oldest run that may be outstanding.
+ * @param last_run - one past the newest run sent.
+ * @return int 1 if a run completed, 0 otherwise.
+ */
+static int receive_packet(const mctp_frame_t* f, size_t first_run, size_t last_run) {
+    if (!mctp_frame_has_header(f)) return 0;
+    frames_rx++;
+    uint8_t flags = f->data[MCTP_OFF_FLAGS];
+    if (flags & MCTP_FLAG_TO) return 0;   // endpoint-originated request, not ours
+
+    uint8_t tag = flags & MCTP_FLAG_TAG_MASK;
+    uint8_t dest = f->data[MCTP_OFF_DEST];
+    for (size_t i = first_run; i < last_run; i++) {
+        run_t* r = &runs[i];
+        const exchange_t* e = &exchanges[r->ex];
+        if (r->state != RUN_SENT || e->tag != tag || e->src != dest) continue;
+
+        // compare against the recording as if its instance id had been shifted too
+        uint8_t msg[MCTP_SERIAL_DATA_MAX];
+        size_t n = f->data[MCTP_OFF_BYTE_COUNT] - MCTP_TRANSPORT_HDR;
+        memcpy(msg, &f->data[MCTP_OFF_MSG_TYPE], n);
+        size_t pass = i / nexchanges;
+        int off = instance_offset(msg, n);
+        if (r->got_len == 0 && pass && off >= 0) {
+            msg[off] = shift_instance(msg[off], MCTP_INSTANCE_ID_MASK + 1 - pass % (MCTP_INSTANCE_ID_MASK + 1));
+        }
+        if (e->recorded && !r->mismatch &&
+            (r->got_len + n > e->expected_len || memcmp(e->expected + r->got_len, msg, n) != 0)) {
+            r->mismatch = 1;
+            if (verbose) {
+                fprintf(stderr, "response %zu differs at message offset %zu:\n", i, r->got_len);
+                size_t m = e->expected_len > r->got_len ? e->expected_len - r->got_len : 0;
+                print_hex("expected:", e->expected + r->got_len, m < n ? m : n);
+                print_hex("received:", msg, n);
+            }
+        }
+        r->got_len += n;
+        if (flags & MCTP_FLAG_EOM) {
+            if (e->recorded && r->got_len != e->expected_len) r->mismatch = 1;
+            r->done_ns = clock_now_ns();
+            r->state = RUN_DONE;
+            return 1;
+        }
+        return 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read whatever the endpoint has sent and match it to outstanding runs.
+ *
+ * @param d - deframer for the response stream.
+ * @param timeout_ms - how long to wait for data.
+ * @param first_run - index of the oldest run that may be outstanding.
+ * @param last_run - one past the newest run sent.
+ * @return int Number of runs completed, or -1 if the link closed.
+ */
+static int pump(mctp_deframer_t* d, int timeout_ms, size_t first_run, size_t last_run) {
+    struct pollfd pfd = { .fd = conn.fd, .events = POLLIN };
+    if (poll(&pfd, 1, timeout_ms) <= 0) return 0;
+
+    uint8_t buf[4096];
+    ssize_t n = read(conn.fd, buf, sizeof buf);
+    if (n == 0) return -1;
+    if (n < 0) return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+
+    int done = 0;
+    uint64_t now = clock_now_ns();
+    for (ssize_t i = 0; i < n; i++) {
+        if (mctp_deframer_push(d, buf[i], now)) done += receive_packet(&d->frame, first_run, last_run);
+    }
+    return done;
+}
+
+/**
+ * @brief Mark runs that have waited too long for a response.
+ *
+ * @param first_run - index of the oldest run that may be outstanding.
+ * @param last_run - one past the newest run sent.
+ * @param timeout_ns - response timeout.
+ * @return int Number of runs that timed out.
+ */
+static int expire(size_t first_run, size_t last_run, uint64_t timeout_ns) {
+    uint64_t now = clock_now_ns();
+    int n = 0;
+    for (size_t i = first_run; i < last_run; i++) {
+        if (runs[i].state == RUN_SENT && now - runs[i].sent_ns > timeout_ns) {
+            runs[i].state = RUN_TIMEOUT;
+            n++;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Compare two latencies for qsort.
+ *
+ * @param a - first value.
+ * @param b - second value.
+ * @return int Ordering.
+ */
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Print usage.
+ *
+ * @param prog - program name.
+ */
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [options] -p <pty> <trace>\n"
+            "       %s [options] <trace> -- <endpoint> [endpoint options]\n"
+            "  -p <pty>      send to a running endpoint through its pty\n"
+            "  -m fast|timed pacing mode (default fast)\n"
+            "  -w <n>        requests in flight in fast mode (default 1)\n"
+            "  -s <factor>   timed mode speed-up, e.g. 2 replays twice as fast (default 1)\n"
+            "  -n <count>    replay the trace this many times (default 1)\n"
+            "  -t <ms>       response timeout (default 1000)\n"
+            "  -S <ms>       settle time after starting an endpoint (default 200)\n"
+            "  -v            print differing responses and endpoint output\n",
+            prog, prog);
+}
+
+int main(int argc, char** argv) {
+    const char* pty = NULL;
+    int timed = 0;
+    unsigned window = 1;
+    double speed = 1.0;
+    unsigned repeat = 1;
+    int timeout_ms = 1000;
+    int settle_ms = 200;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "+p:m:w:s:n:t:S:vh")) != -1) {
+        switch (opt) {
+        case 'p': pty = optarg; break;
+        case 'm': timed = strcmp(optarg, "timed") == 0; break;
+        case 'w': window = (unsigned)atoi(optarg); if (!window) window = 1; break;
+        case 's': speed = atof(optarg); if (speed <= 0) speed = 1.0; break;
+        case 'n': repeat = (unsigned)atoi(optarg); if (!repeat) repeat = 1; break;
+        case 't': timeout_ms = atoi(optarg); if (timeout_ms < 1) timeout_ms = 1; break;
+        case 'S': settle_ms = atoi(optarg); if (settle_ms < 0) settle_ms = 0; break;
+        case 'v': verbose = 1; break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+    const char* trace = argv[optind++];
+    if (optind < argc && strcmp(argv[optind], "--") == 0) optind++;
+    if (!pty && optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (load_trace(trace) != 0) return 2;
+    build_exchanges();
+    if (!nexchanges) {
+        fprintf(stderr, "%s: no requests found\n", trace);
+        return 2;
+    }
+    size_t recorded = 0;
+    for (size_t i = 0; i < nexchanges; i++) recorded += exchanges[i].recorded;
+    if (timed && exchanges[0].t_ns == 0) {
+        fprintf(stderr, "%s has no timestamps, replaying in fast mode\n", trace);
+        timed = 0;
+    }
+
+    if (pty ? link_open_pty(&conn, pty) != 0 : link_spawn(&conn, &argv[optind], argc - optind, verbose ? 0 : LINK_QUIET) != 0) {
+        return 2;
+    }
+    link_settle(&conn, settle_ms);
+
+    nruns = nexchanges * repeat;
+    runs = calloc(nruns, sizeof *runs);
+    for (size_t i = 0; i < nruns; i++) runs[i].ex = i % nexchanges;
+
+    // timed mode: each pass of the trace starts where the previous one's span ended
+    uint64_t span = exchanges[nexchanges - 1].t_ns - exchanges[0].t_ns + 1000000;
+    mctp_deframer_t d;
+    mctp_deframer_init(&d);
+    uint64_t timeout_ns = (uint64_t)timeout_ms * 1000000ull;
+    size_t next = 0, oldest = 0, finished = 0, in_flight = 0;
+    int link_closed = 0;
+    uint64_t start = clock_now_ns();
+
+    while (finished < nruns && !link_closed) {
+        int wait_ms = 10;
+        if (next < nruns) {
+            if (timed) {
+                const exchange_t* e = &exchanges[runs[next].ex];
+                uint64_t offset = (uint64_t)((double)((next / nexchanges) * span + e->t_ns - exchanges[0].t_ns) / speed);
+                uint64_t now = clock_now_ns();
+                if (now >= start + offset) {
+                    if (send_run(&runs[next++]) != 0) break;
+                    in_flight++;
+                    wait_ms = 0;
+                } else {
+                    uint64_t ms = (start + offset - now) / 1000000ull;
+                    wait_ms = ms < 10 ? (int)ms : 10;
+                }
+            } else if (in_flight < window) {
+                if (send_run(&runs[next++]) != 0) break;
+                in_flight++;
+                if (in_flight < window) wait_ms = 0;
+            }
+        }
+
+        int n = pump(&d, wait_ms, oldest, next);
+        if (n < 0) link_closed = 1;
+        else {
+            finished += (size_t)n;
+            in_flight -= (size_t)n;
+        }
+        int expired = expire(oldest, next, timeout_ns);
+        finished += (size_t)expired;
+        in_flight -= (size_t)expired;
+        while (oldest < next && runs[oldest].state >= RUN_DONE) oldest++;
+    }
+    uint64_t elapsed = clock_now_ns() - start;
+
+    link_close(&conn);
+
+    // report
+    uint64_t* lat = calloc(nruns + 1, sizeof *lat);
+    size_t answered = 0, timeouts = 0, mismatched = 0, compared = 0;
+    for (size_t i = 0; i < nruns; i++) {
+        const run_t* r = &runs[i];
+        if (r->state == RUN_DONE) {
+            lat[answered++] = r->done_ns - r->sent_ns;
+            if (exchanges[r->ex].recorded) {
+                compared++;
+                mismatched += r->mismatch;
+            }
+        } else {
+            timeouts++;
+        }
+    }
+    qsort(lat, answered, sizeof *lat, cmp_u64);
+    double secs = (double)elapsed / 1e9;
+
+    printf("trace: %zu packets, %zu exchanges (%zu with recorded responses)\n", npackets, nexchanges, recorded);
+    printf("mode: %s", timed ? "timed" : "fast");
+    if (timed) printf(", speed x%.2f", speed);
+    else printf(", window %u", window);
+    printf(", %u pass%s\n", repeat, repeat == 1 ? "" : "es");
+    printf("sent %zu, answered %zu, no response %zu%s\n", nruns, answered, timeouts,
+           link_closed ? " (link closed)" : "");
+    printf("compared %zu, mismatched %zu\n", compared, mismatched);
+    printf("elapsed %.3f s: %.0f exchanges/s, %.0f frames/s\n", secs, answered / secs,
+           (double)(frames_tx + frames_rx) / secs);
+    if (answered) {
+#define PCT(p) (lat[(size_t)((double)(answered - 1) * (p) / 100.0 + 0.5)] / 1000.0)
+        printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+               PCT(50), PCT(90), PCT(99), PCT(99.9), lat[answered - 1] / 1000.0);
+#undef PCT
+    }
+    free(lat);
+    return (timeouts || mismatched) ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+/**
+ * @file endpoint-stat.c
+ * @brief vmstat-style viewer for the endpoint's shared-memory statistics.
+ *
+ * Maps the segment published by a running endpoint read-only and prints one
+ * line of per-second rates each interval.  The first line, like vmstat's,
+ * shows averages since the endpoint started.
+ *
+ *   endpoint-stat [-i seconds] [-c count] [-t] [-l] [segment]
+ *
+ * With no segment argument the first /dev/shm/iotfoundry-endpoint.*.stats
+ * file is used.  -t prints the raw totals once and exits; -l prints the
+ * response latency percentiles once and exits.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "latency.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char* drop_names[] = { "noise", "bad-frame", "duplicate", "tx-stall", "tx-error", "shed", "rate-limit" };
+
+/**
+ * @brief Take a consistent copy of the statistics block.
+ *
+ * Individual counters are always readable; the seqlock only matters for
+ * grouped updates, so a bounded number of retries is enough.
+ *
+ * @param seg - mapped segment.
+ * @param out - destination.
+ */
+static void snapshot(const endpoint_stats_t* seg, endpoint_stats_t* out) {
+    for (int tries = 0; tries < 100; tries++) {
+        uint32_t s0 = __atomic_load_n(&seg->seq, __ATOMIC_ACQUIRE);
+        if (s0 & 1) continue;
+        memcpy(out, seg, sizeof *out);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&seg->seq, __ATOMIC_RELAXED) == s0) return;
+    }
+    memcpy(out, seg, sizeof *out);
+}
+
+/**
+ * @brief Sum of the drop counters.
+ *
+ * @param s - statistics block.
+ * @return uint64_t Total drops.
+ */
+static uint64_t drops_total(const endpoint_stats_t* s) {
+    uint64_t n = 0;
+    for (int i = 0; i < STATS_DROP_REASONS; i++) n += s->drops[i];
+    return n;
+}
+
+/**
+ * @brief System calls made by the endpoint's I/O paths.
+ *
+ * @param s - statistics block.
+ * @return uint64_t Total calls.
+ */
+static uint64_t syscalls_total(const endpoint_stats_t* s) {
+    return s->rx_read_calls + s->rx_poll_calls + s->tx_write_calls + s->tx_poll_calls +
+           s->tx_ioctl_calls + s->io_poll_calls;
+}
+
+/**
+ * @brief Print the column header.
+ */
+static void print_header() {
+    printf("%10s %8s %10s %8s %6s %6s %6s %6s %7s %7s %7s %8s %9s %6s %6s\n",
+           "rx-B/s", "rx-fr/s", "tx-B/s", "tx-fr/s", "fcs/s", "esc/s", "len/s", "ovr/s",
+           "tmpl/s", "rply/s", "drop/s", "sysc/s", "stall-ms", "inq", "outq");
+}
+
+/**
+ * @brief Print one line of rates between two snapshots.
+ *
+ * @param a - earlier snapshot (all zero for the since-start line).
+ * @param b - later snapshot.
+ * @param secs - seconds between the snapshots.
+ */
+static void print_rates(const endpoint_stats_t* a, const endpoint_stats_t* b, double secs) {
+    if (secs <= 0) secs = 1;
+#define RATE(field) ((double)(b->field - a->field) / secs)
+    printf("%10.0f %8.0f %10.0f %8.0f %6.0f %6.0f %6.0f %6.0f %7.0f %7.0f %7.0f %8.0f %9.1f %6" PRIu64 " %6" PRIu64 "\n",
+           RATE(rx_bytes), RATE(rx_frames_ok), RATE(tx_bytes), RATE(tx_frames),
+           RATE(rx_fcs_errors), RATE(rx_escape_errors), RATE(rx_length_errors),
+           RATE(tty_overruns) + RATE(tty_buf_overruns),
+           RATE(rx_template_answers), RATE(rx_replay_answers),
+           (double)(drops_total(b) - drops_total(a)) / secs,
+           (double)(syscalls_total(b) - syscalls_total(a)) / secs,
+           (double)(b->tx_stall_ns - a->tx_stall_ns) / 1e6 / secs, b->tty_inq, b->tty_outq);
+#undef RATE
+}
+
+/**
+ * @brief Print every counter once.
+ *
+ * @param s - statistics block.
+ */
+static void print_totals(const endpoint_stats_t* s) {
+    printf("port %s, pid %" PRIu32 "\n", s->port, s->pid);
+    printf("rx: %" PRIu64 " bytes, %" PRIu64 " frames ok, %" PRIu64 " fcs, %" PRIu64 " escape, %" PRIu64 " length errors\n",
+           s->rx_bytes, s->rx_frames_ok, s->rx_fcs_errors, s->rx_escape_errors, s->rx_length_errors);
+    printf("rx: %" PRIu64 " read, %" PRIu64 " poll calls; %" PRIu64 " template, %" PRIu64 " replay answers\n",
+           s->rx_read_calls, s->rx_poll_calls, s->rx_template_answers, s->rx_replay_answers);
+    printf("tx: %" PRIu64 " bytes, %" PRIu64 " frames; %" PRIu64 " write, %" PRIu64 " poll, %" PRIu64 " ioctl calls; stalled %.1f ms\n",
+           s->tx_bytes, s->tx_frames, s->tx_write_calls, s->tx_poll_calls, s->tx_ioctl_calls,
+           (double)s->tx_stall_ns / 1e6);
+    printf("io: %" PRIu64 " poll calls, %" PRIu64 " wakeups; %" PRIu64 " slow handlers, longest %.1f ms\n",
+           s->io_poll_calls, s->io_wakeups, s->io_slow_handlers, (double)s->io_handler_max_ns / 1e6);
+    printf("tty: %" PRIu64 " samples; inq %" PRIu64 " (max %" PRIu64 "), outq %" PRIu64 " (max %" PRIu64 ")\n",
+           s->tty_samples, s->tty_inq, s->tty_inq_max, s->tty_outq, s->tty_outq_max);
+    printf("tty: %" PRIu64 " overruns, %" PRIu64 " buffer overruns, %" PRIu64 " framing, %" PRIu64 " parity errors, %" PRIu64 " breaks\n",
+           s->tty_overruns, s->tty_buf_overruns, s->tty_frame_errors, s->tty_parity_errors, s->tty_breaks);
+    printf("messages (first packets) by type:\n");
+    for (int t = 0; t < STATS_MSG_TYPES; t++) {
+        if (!s->rx_msg_type[t] && !s->tx_msg_type[t]) continue;
+        printf("  type %d%s: rx %" PRIu64 ", tx %" PRIu64 "\n", t, t == STATS_MSG_TYPES - 1 ? "+" : "",
+               s->rx_msg_type[t], s->tx_msg_type[t]);
+    }
+    printf("sources:\n");
+    for (int i = 0; i < STATS_SOURCES; i++) {
+        const stats_source_t* src = &s->sources[i];
+        if (!src->used) continue;
+        char eid[8];
+        if (i == STATS_SOURCES - 1) {
+            snprintf(eid, sizeof eid, "other");
+        } else {
+            snprintf(eid, sizeof eid, "%" PRIu32, src->eid);
+        }
+        printf("  eid %-5s rx %" PRIu64 ", served %" PRIu64 ", limited %" PRIu64 ", shed %" PRIu64
+               "; handlers %.1f ms, queued avg %.1f max %.1f ms\n",
+               eid, src->rx_packets, src->served, src->rate_limited, src->shed, (double)src->handler_ns / 1e6,
+               src->served ? (double)src->queue_ns_total / src->served / 1e6 : 0.0,
+               (double)src->queue_ns_max / 1e6);
+    }
+    printf("drops:\n");
+    for (int i = 0; i < STATS_DROP_REASONS; i++) {
+        if (!s->drops[i]) continue;
+        if (i < (int)(sizeof drop_names / sizeof drop_names[0])) {
+            printf("  %-10s %" PRIu64 "\n", drop_names[i], s->drops[i]);
+        } else {
+            printf("  reason-%-3d %" PRIu64 "\n", i, s->drops[i]);
+        }
+    }
+}
+
+/**
+ * @brief Print usage.
+ *
+ * @param prog - program name.
+ */
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-i seconds] [-c count] [-t] [-l] [segment]\n", prog);
+    fprintf(stderr, "  default segment: first %s/%s*%s\n", STATS_DIR, STATS_PREFIX, STATS_SUFFIX);
+}
+
+int main(int argc, char** argv) {
+    double interval = 1.0;
+    long count = -1;
+    int totals = 0;
+    int latency = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "i:c:tlh")) != -1) {
+        switch (opt) {
+        case 'i': interval = atof(optarg); if (interval <= 0) interval = 1.0; break;
+        case 'c': count = atol(optarg); break;
+        case 't': totals = 1; break;
+        case 'l': latency = 1; break;
+        default: usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+
+    char path[256];
+    if (optind < argc) {
+        snprintf(path, sizeof path, "%s", argv[optind]);
+    } else {
+        glob_t g;
+        if (glob(STATS_DIR "/" STATS_PREFIX "*" STATS_SUFFIX, 0, NULL, &g) != 0 || g.gl_pathc == 0) {
+            fprintf(stderr, "no statistics segment found in %s\n", STATS_DIR);
+            return EXIT_FAILURE;
+        }
+        snprintf(path, sizeof path, "%s", g.gl_pathv[0]);
+        globfree(&g);
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    const endpoint_stats_t* seg = mmap(NULL, sizeof(endpoint_stats_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (seg == MAP_FAILED) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (__atomic_load_n(&seg->magic, __ATOMIC_ACQUIRE) != STATS_MAGIC ||
+        seg->version != STATS_VERSION || seg->size != sizeof(endpoint_stats_t)) {
+        fprintf(stderr, "%s: not a compatible statistics segment\n", path);
+        return EXIT_FAILURE;
+    }
+
+    static endpoint_stats_t prev, cur;
+    snapshot(seg, &cur);
+    if (totals || latency) {
+        if (totals) print_totals(&cur);
+        if (latency) latency_print(stdout, &cur.latency);
+        return 0;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    double uptime = (double)now.tv_sec + now.tv_nsec / 1e9 - (double)cur.start_realtime_ns / 1e9;
+
+    printf("%s (pid %" PRIu32 ", port %s", path, cur.pid, cur.port);
+    if (cur.ready_us) printf(", ready in %.1f ms", cur.ready_us / 1e3);
+    printf(")\n");
+    print_header();
+    memset(&prev, 0, sizeof prev);
+    print_rates(&prev, &cur, uptime);
+
+    struct timespec sleep_ts = { (time_t)interval, (long)((interval - (time_t)interval) * 1e9) };
+    for (long line = 1; count < 0 || line < count; line++) {
+        prev = cur;
+        nanosleep(&sleep_ts, NULL);
+        // the endpoint unlinks its segment on exit; the old mapping stops moving
+        if (access(path, F_OK) != 0) {
+            fprintf(stderr, "%s: endpoint exited\n", path);
+            return 0;
+        }
+        snapshot(seg, &cur);
+        if (line % 20 == 0) print_header();
+        print_rates(&prev, &cur, interval);
+    }
+    return 0;
+}
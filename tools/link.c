@@ -0,0 +1,182 @@
+/**
+ * @file link.c
+ * @brief Connection to an endpoint under test, shared by the host-side tools.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "link.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Open a running endpoint's pty and put it in raw mode.
+ *
+ * @param l - link to fill in.
+ * @param path - pty slave path printed by the endpoint.
+ * @return int 0 on success, -1 on error.
+ */
+int link_open_pty(tool_link_t* l, const char* path) {
+    l->pid = -1;
+    l->peer_fd = -1;
+    l->fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (l->fd == -1) {
+        perror(path);
+        return -1;
+    }
+    struct termios tio;
+    if (tcgetattr(l->fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(l->fd, TCSANOW, &tio);
+    }
+    return 0;
+}
+
+/**
+ * @brief Start an endpoint on one end of a socketpair.
+ *
+ * The endpoint gets its end as descriptor 3 ("--fd 3" is appended to argv).
+ *
+ * @param l - link to fill in.
+ * @param argv - endpoint command line.
+ * @param argc - number of arguments.
+ * @param flags - LINK_QUIET and/or LINK_KEEP_PEER.
+ * @return int 0 on success, -1 on error.
+ */
+int link_spawn(tool_link_t* l, char** argv, int argc, int flags) {
+    int sv[2];
+    l->fd = -1;
+    l->pid = -1;
+    l->peer_fd = -1;
+    if (argc < 1) return -1;
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        perror("socketpair");
+        return -1;
+    }
+    if (l->peer_sndbuf > 0) {
+        // a small buffer makes the endpoint feel backpressure as it would on a real line
+        setsockopt(sv[1], SOL_SOCKET, SO_SNDBUF, &l->peer_sndbuf, sizeof l->peer_sndbuf);
+    }
+    char** args = calloc((size_t)argc + 3, sizeof *args);
+    if (!args) return -1;
+    memcpy(args, argv, (size_t)argc * sizeof *args);
+    args[argc] = "--fd";
+    args[argc + 1] = "3";
+
+    signal(SIGPIPE, SIG_IGN);
+    l->pid = fork();
+    if (l->pid == -1) {
+        perror("fork");
+        free(args);
+        return -1;
+    }
+    if (l->pid == 0) {
+        close(sv[0]);
+        if (sv[1] != 3) {
+            dup2(sv[1], 3);
+            close(sv[1]);
+        }
+        if (flags & LINK_QUIET) {
+            int null = open("/dev/null", O_WRONLY);
+            dup2(null, STDOUT_FILENO);
+            close(null);
+        }
+        execvp(args[0], args);
+        perror(args[0]);
+        _exit(127);
+    }
+    free(args);
+    if (flags & LINK_KEEP_PEER) {
+        l->peer_fd = sv[1];
+    } else {
+        close(sv[1]);
+    }
+    l->fd = sv[0];
+    fcntl(l->fd, F_SETFL, fcntl(l->fd, F_GETFL) | O_NONBLOCK);
+    return 0;
+}
+
+/**
+ * @brief Write a whole buffer to the link, waiting while it is full.
+ *
+ * @param l - the link.
+ * @param p - bytes.
+ * @param len - number of bytes.
+ * @return int 0 on success, -1 on error.
+ */
+int link_write_all(tool_link_t* l, const uint8_t* p, size_t len) {
+    while (len) {
+        ssize_t n = write(l->fd, p, len);
+        if (n > 0) {
+            p += n;
+            len -= (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) {
+            struct pollfd pfd = { .fd = l->fd, .events = POLLOUT };
+            poll(&pfd, 1, 100);
+            continue;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Give a freshly started endpoint time to initialize.
+ *
+ * @param l - the link; nothing is done for a pty link.
+ * @param ms - milliseconds to wait.
+ */
+void link_settle(const tool_link_t* l, int ms) {
+    if (l->pid <= 0 || ms <= 0) return;
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * @brief Close the link, stopping an endpoint started by link_spawn().
+ *
+ * @param l - the link.
+ */
+void link_close(tool_link_t* l) {
+    if (l->pid > 0) {
+        kill(l->pid, SIGTERM);
+        waitpid(l->pid, NULL, 0);
+        l->pid = -1;
+    }
+    if (l->fd != -1) close(l->fd);
+    if (l->peer_fd != -1) close(l->peer_fd);
+    l->fd = -1;
+    l->peer_fd = -1;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file link.h
+ * @brief Connection to an endpoint under test, shared by the host-side tools.
+ *
+ * A tool either opens the pty of an endpoint that is already running, or
+ * starts an endpoint itself with one end of a socketpair passed as --fd 3.
+ *
+ * @author Douglas Sandy
+ *
+ * MIT No Attribution
+ *
+ * Copyright (c) 2026 Douglas Sandy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TOOLS_LINK_H
+#define TOOLS_LINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* link_spawn() flags */
+#define LINK_QUIET 0x01        /* send the endpoint's standard output to /dev/null */
+#define LINK_KEEP_PEER 0x02    /* keep the endpoint's end open, e.g. to read its receive queue */
+
+typedef struct {
+    int fd;            /* non-blocking descriptor connected to the endpoint */
+    pid_t pid;         /* endpoint started by link_spawn(), -1 otherwise */
+    int peer_sndbuf;   /* if > 0, SO_SNDBUF given to the spawned endpoint's end */
+    int peer_fd;       /* endpoint's end kept open with LINK_KEEP_PEER, -1 otherwise */
+} tool_link_t;
+
+int link_open_pty(tool_link_t* l, const char* path);
+int link_spawn(tool_link_t* l, char** argv, int argc, int flags);
+int link_write_all(tool_link_t* l, const uint8_t* p, size_t len);
+void link_settle(const tool_link_t* l, int ms);
+void link_close(tool_link_t* l);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TOOLS_LINK_H */